@@ -0,0 +1,680 @@
+/*
+	Render benchmark over the reference scenes. Every scene is rendered with a fixed frame seed,
+	a number of warmup runs that are not measured and a number of measured repetitions,
+	and the median repetition is reported, human readable on stderr and as JSON on stdout or into a file.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+#include "rtweekend.hpp"
+
+#include "bvh.hpp"
+#include "camera.hpp"
+#include "framebuffer.hpp"
+#include "image_io.hpp"
+#include "micro_benchmark.hpp"
+#include "primitive_store.hpp"
+#include "renderer.hpp"
+#include "sampling_benchmark.hpp"
+#include "scenes.hpp"
+#include "sphere_soa.hpp"
+
+struct benchmark_options {
+	std::vector<std::string> scenes;   // empty = all
+	std::string structure = "bvh";     // bvh, store (primitive_store) or list (hittable_list)
+	render_settings settings;
+	int warmup = 1;
+	int repetitions = 5;
+	std::string json_path;             // empty = stdout
+	bool compare_kernels = false;      // renders every scene with the generic and the specialized kernel
+	int sampling_samples = 0;          // > 0 runs the sampling microbenchmark with that many samples per case instead
+	int micro_operations = 0;          // > 0 runs the ray, hit and pixel microbenchmarks with that many operations per case instead
+	std::string golden_dir;            // non-empty: check every scene's image against the reference image there instead
+	bool write_golden = false;         // write the reference images rather than checking against them
+	double golden_tolerance = 0.01;    // largest RMSE an image may differ from its reference by
+	bool show_help = false;
+};
+
+struct scene_result {
+	std::string name;
+	std::size_t primitives = 0;
+	double build_ms = 0;               // building the acceleration structure or primitive store
+	std::vector<double> seconds;       // one per repetition
+	render_stats median;
+	std::string kernel;                // what the renderer traced with, see renderer::kernel_for()
+	std::uint64_t peak_rss = 0;
+
+	// --kernel compare: the same scene again with the specialized kernel, and whether the images matched.
+	std::vector<double> specialized_seconds;
+	render_stats specialized_median;
+	std::string specialized_kernel;
+	bool identical = true;
+};
+
+// Peak resident set size of the process so far, in bytes (0 where unknown).
+static std::uint64_t peak_rss_bytes() {
+
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+
+		return counters.PeakWorkingSetSize;
+	}
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+
+		return 0;
+	}
+#ifdef __APPLE__
+	return static_cast<std::uint64_t>(usage.ru_maxrss);
+#else
+	return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+static int parse_count(const std::string& name, int argc, char* argv[], int& i, int min) {
+
+	if (i + 1 >= argc) {
+
+		throw std::invalid_argument("missing value for " + name);
+	}
+
+	const std::string value = argv[++i];
+	std::size_t consumed = 0;
+	long long result = 0;
+	try {
+
+		result = std::stoll(value, &consumed);
+	}
+	catch (const std::exception&) {
+
+		consumed = 0;
+	}
+
+	if (consumed != value.size() || value.empty() || result < min || result > 1 << 30) {
+
+		throw std::invalid_argument("invalid value '" + value + "' for " + name);
+	}
+
+	return static_cast<int>(result);
+}
+
+static benchmark_options parse_benchmark_options(int argc, char* argv[]) {
+
+	benchmark_options opts;
+	opts.settings.image_width = 320;
+	opts.settings.image_height = 180;
+	opts.settings.samples_per_pixel = 16;
+	opts.settings.seed = 1;
+	opts.settings.show_progress = false;
+
+	for (int i = 1; i < argc; ++i) {
+
+		const std::string arg = argv[i];
+		if (arg == "-h" || arg == "--help") {
+
+			opts.show_help = true;
+		}
+		else if (arg == "--scene") {
+
+			if (i + 1 >= argc) {
+
+				throw std::invalid_argument("missing value for " + arg);
+			}
+			const std::string name = argv[++i];
+			const auto names = scene_names();
+			if (std::find(names.begin(), names.end(), name) == names.end()) {
+
+				throw std::invalid_argument("unknown scene " + name);
+			}
+			opts.scenes.push_back(name);
+		}
+		else if (arg == "--structure") {
+
+			if (i + 1 >= argc) {
+
+				throw std::invalid_argument("missing value for " + arg);
+			}
+			opts.structure = argv[++i];
+			if (opts.structure != "bvh" && opts.structure != "store" && opts.structure != "list") {
+
+				throw std::invalid_argument("unknown structure " + opts.structure);
+			}
+		}
+		else if (arg == "--engine") {
+
+			if (i + 1 >= argc) {
+
+				throw std::invalid_argument("missing value for " + arg);
+			}
+			opts.settings.engine = render_engine_from_name(argv[++i]);
+		}
+		else if (arg == "--width") {
+
+			opts.settings.image_width = parse_count(arg, argc, argv, i, 2);
+			opts.settings.image_height = std::max(2, static_cast<int>(opts.settings.image_width / (16.0 / 9.0)));
+		}
+		else if (arg == "--kernel") {
+
+			if (i + 1 >= argc) {
+
+				throw std::invalid_argument("missing value for " + arg);
+			}
+			const std::string kernel = argv[++i];
+			opts.compare_kernels = kernel == "compare";
+			opts.settings.kernel = opts.compare_kernels ? render_kernel::generic : render_kernel_from_name(kernel);
+		}
+		else if (arg == "--integrator") {
+
+			if (i + 1 >= argc) {
+
+				throw std::invalid_argument("missing value for " + arg);
+			}
+			opts.settings.integrator = integrator_type_from_name(argv[++i]);
+		}
+		else if (arg == "--sampler") {
+
+			if (i + 1 >= argc) {
+
+				throw std::invalid_argument("missing value for " + arg);
+			}
+			opts.settings.sampler = sampler_type_from_name(argv[++i]);
+		}
+		else if (arg == "--depth") {
+
+			opts.settings.max_depth = parse_count(arg, argc, argv, i, 1);
+		}
+		else if (arg == "--spp") {
+
+			opts.settings.samples_per_pixel = parse_count(arg, argc, argv, i, 1);
+		}
+		else if (arg == "-t" || arg == "--threads") {
+
+			opts.settings.thread_count = static_cast<unsigned>(parse_count(arg, argc, argv, i, 0));
+		}
+		else if (arg == "--warmup") {
+
+			opts.warmup = parse_count(arg, argc, argv, i, 0);
+		}
+		else if (arg == "--repetitions") {
+
+			opts.repetitions = parse_count(arg, argc, argv, i, 1);
+		}
+		else if (arg == "--sampling") {
+
+			opts.sampling_samples = parse_count(arg, argc, argv, i, 1);
+		}
+		else if (arg == "--micro") {
+
+			opts.micro_operations = parse_count(arg, argc, argv, i, 1);
+		}
+		else if (arg == "--golden") {
+
+			if (i + 1 >= argc) {
+
+				throw std::invalid_argument("missing value for " + arg);
+			}
+			opts.golden_dir = argv[++i];
+		}
+		else if (arg == "--write-golden") {
+
+			opts.write_golden = true;
+		}
+		else if (arg == "--tolerance") {
+
+			if (i + 1 >= argc) {
+
+				throw std::invalid_argument("missing value for " + arg);
+			}
+			const std::string value = argv[++i];
+			std::size_t consumed = 0;
+			try {
+
+				opts.golden_tolerance = std::stod(value, &consumed);
+			}
+			catch (const std::exception&) {
+
+				consumed = 0;
+			}
+			if (consumed != value.size() || value.empty() || !(opts.golden_tolerance >= 0)) {
+
+				throw std::invalid_argument("invalid value '" + value + "' for " + arg);
+			}
+		}
+		else if (arg == "--json") {
+
+			if (i + 1 >= argc) {
+
+				throw std::invalid_argument("missing value for " + arg);
+			}
+			opts.json_path = argv[++i];
+		}
+		else {
+
+			throw std::invalid_argument("unknown option " + arg);
+		}
+	}
+
+	if (opts.scenes.empty()) {
+
+		opts.scenes = scene_names();
+	}
+	if (opts.write_golden && opts.golden_dir.empty()) {
+
+		throw std::invalid_argument("--write-golden needs --golden <dir>");
+	}
+	if (opts.settings.engine == render_engine::wavefront
+		&& (opts.compare_kernels || opts.settings.kernel == render_kernel::specialized || opts.settings.sampler != sampler_type::independent)) {
+
+		throw std::invalid_argument("the wavefront engine runs neither specialized kernels nor samplers");
+	}
+
+	return opts;
+}
+
+static std::string benchmark_usage(const char* program) {
+
+	std::ostringstream out;
+	out << "Usage: " << program << " [options]\n"
+		<< "      --scene <name>        basic, random-spheres, stress, instances or lit, may repeat (default: all)\n"
+		<< "      --structure <name>    bvh (default), store (linear, by primitive type) or list (linear, virtual)\n"
+		<< "      --engine <name>       tiled (default) or wavefront\n"
+		<< "      --kernel <name>       generic (default), specialized, or compare to render every scene with both\n"
+		<< "      --integrator <name>   path (default), recursive or nee\n"
+		<< "      --sampler <name>      independent (default), stratified, sobol or blue-noise\n"
+		<< "      --depth <n>           maximum path length, kernels are specialized for 8, 16, 32 and 50 (default 50)\n"
+		<< "      --width <n>           image width, 16:9 (default 320)\n"
+		<< "      --spp <n>             samples per pixel (default 16)\n"
+		<< "  -t, --threads <n>         render threads, 0 = one per hardware thread (default 0)\n"
+		<< "      --warmup <n>          unmeasured renders per scene (default 1)\n"
+		<< "      --repetitions <n>     measured renders per scene, the median is reported (default 5)\n"
+		<< "      --sampling <n>        benchmark the direction samplers instead, n samples per case (ns/sample)\n"
+		<< "      --micro <n>           benchmark vec3 ops, sphere and list hits, random_in_unit_sphere and pixel output instead,\n"
+		<< "                            n operations per case (ns/op)\n"
+		<< "      --golden <dir>        render every scene once and fail if it differs from dir/<scene>.pfm by more than the tolerance\n"
+		<< "      --write-golden        with --golden, write the reference images instead, e.g. from a build without RT_FAST_MATH\n"
+		<< "      --tolerance <e>       largest RMSE against a reference image (default 0.01)\n"
+		<< "      --json <path>         write the JSON report there instead of stdout\n"
+		<< "  -h, --help                show this message\n";
+
+	return out.str();
+}
+
+// Warmup and repetitions of one renderer, returning the median repetition.
+static render_stats measure(renderer& tracer, const hittable& scene, const camera& cam, const benchmark_options& opts,
+	framebuffer& image, std::vector<double>& seconds) {
+
+	for (int i = 0; i < opts.warmup; ++i) {
+
+		tracer.render(scene, cam, image);
+	}
+
+	std::vector<render_stats> runs;
+	for (int i = 0; i < opts.repetitions; ++i) {
+
+		runs.push_back(tracer.render(scene, cam, image));
+		seconds.push_back(runs.back().seconds);
+	}
+
+	std::sort(runs.begin(), runs.end(), [](const render_stats& a, const render_stats& b) { return a.seconds < b.seconds; });
+	return runs[runs.size() / 2];
+}
+
+static scene_result run_scene(const std::string& name, const benchmark_options& opts, renderer& tracer, renderer* specialized) {
+
+	scene_result result;
+	result.name = name;
+
+	const scene_description description = make_scene(name, 0);
+	const hittable_list& world = description.world;
+	result.primitives = world.objects.size();
+
+	std::unique_ptr<bvh_node> world_bvh;
+	std::unique_ptr<primitive_store> world_store;
+	const auto build_start = std::chrono::steady_clock::now();
+	if (opts.structure == "bvh") {
+
+		world_bvh = std::make_unique<bvh_node>(world);
+	}
+	else if (opts.structure == "store") {
+
+		world_store = std::make_unique<primitive_store>(world);
+	}
+	result.build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - build_start).count();
+
+	const hittable& scene = world_bvh ? static_cast<const hittable&>(*world_bvh)
+		: world_store ? static_cast<const hittable&>(*world_store) : world;
+
+	camera_settings view = description.camera;
+	view.aspect_ratio = static_cast<real>(opts.settings.image_width) / static_cast<real>(opts.settings.image_height);
+	const camera cam(view);
+	framebuffer image;
+	tracer.set_materials(material_table(description.materials));
+	if (opts.settings.integrator == integrator_type::nee) {
+
+		tracer.set_lights(light_list(world, tracer.materials()));
+	}
+	result.kernel = tracer.kernel_for(scene);
+	result.median = measure(tracer, scene, cam, opts, image, result.seconds);
+
+	if (specialized) {
+
+		// Both kernels trace the same paths, so the last images have to match bit for bit.
+		framebuffer specialized_image;
+		specialized->set_materials(material_table(description.materials));
+		if (opts.settings.integrator == integrator_type::nee) {
+
+			specialized->set_lights(light_list(world, specialized->materials()));
+		}
+		result.specialized_kernel = specialized->kernel_for(scene);
+		result.specialized_median = measure(*specialized, scene, cam, opts, specialized_image, result.specialized_seconds);
+		result.identical = std::equal(image.data(), image.data() + 3 * image.pixel_count(), specialized_image.data());
+	}
+	result.peak_rss = peak_rss_bytes();
+
+	return result;
+}
+
+static double mrays_per_second(const render_stats& stats) {
+
+	return stats.seconds > 0 ? static_cast<double>(stats.rays) / stats.seconds / 1e6 : 0;
+}
+
+static double samples_per_second(const render_stats& stats) {
+
+	return stats.seconds > 0 ? static_cast<double>(stats.samples) / stats.seconds : 0;
+}
+
+// Every ray is one top-level hit() call, so this is thread time per call.
+static double ns_per_hit(const render_stats& stats, unsigned threads) {
+
+	return stats.rays > 0 ? stats.seconds * threads * 1e9 / static_cast<double>(stats.rays) : 0;
+}
+
+// How many times faster the specialized kernel rendered than the generic one.
+static double kernel_speedup(const scene_result& r) {
+
+	return r.specialized_median.seconds > 0 ? r.median.seconds / r.specialized_median.seconds : 0;
+}
+
+static void write_json(std::ostream& out, const benchmark_options& opts, unsigned threads, const std::vector<scene_result>& results) {
+
+	out << "{\n"
+		<< "  \"config\": {\n"
+		<< "    \"width\": " << opts.settings.image_width << ",\n"
+		<< "    \"height\": " << opts.settings.image_height << ",\n"
+		<< "    \"samples_per_pixel\": " << opts.settings.samples_per_pixel << ",\n"
+		<< "    \"max_depth\": " << opts.settings.max_depth << ",\n"
+		<< "    \"seed\": " << opts.settings.seed << ",\n"
+		<< "    \"structure\": \"" << opts.structure << "\",\n"
+		<< "    \"engine\": \"" << (opts.settings.engine == render_engine::wavefront ? "wavefront" : "tiled") << "\",\n"
+		<< "    \"kernel\": \"" << (opts.compare_kernels ? "compare"
+			: opts.settings.kernel == render_kernel::specialized ? "specialized" : "generic") << "\",\n"
+		<< "    \"integrator\": \"" << integrator_type_name(opts.settings.integrator) << "\",\n"
+		<< "    \"sampler\": \"" << sampler_type_name(opts.settings.sampler) << "\",\n"
+		<< "    \"threads\": " << threads << ",\n"
+		<< "    \"warmup\": " << opts.warmup << ",\n"
+		<< "    \"repetitions\": " << opts.repetitions << ",\n"
+		<< "    \"real\": \"" << (sizeof(real) == sizeof(float) ? "float" : "double") << "\",\n"
+		<< "    \"simd\": \"" << sphere_soa::simd_backend() << "\",\n"
+		<< "    \"fast_math\": " << (fast_math_build ? "true" : "false") << "\n"
+		<< "  },\n"
+		<< "  \"scenes\": [\n";
+
+	for (std::size_t i = 0; i < results.size(); ++i) {
+
+		const auto& r = results[i];
+		out << "    {\n"
+			<< "      \"name\": \"" << r.name << "\",\n"
+			<< "      \"primitives\": " << r.primitives << ",\n"
+			<< "      \"build_ms\": " << r.build_ms << ",\n"
+			<< "      \"seconds\": [";
+		for (std::size_t k = 0; k < r.seconds.size(); ++k) {
+
+			out << (k ? ", " : "") << r.seconds[k];
+		}
+		out << "],\n"
+			<< "      \"median_seconds\": " << r.median.seconds << ",\n"
+			<< "      \"rays\": " << r.median.rays << ",\n"
+			<< "      \"samples\": " << r.median.samples << ",\n"
+			<< "      \"mrays_per_second\": " << mrays_per_second(r.median) << ",\n"
+			<< "      \"samples_per_second\": " << samples_per_second(r.median) << ",\n"
+			<< "      \"ns_per_hit\": " << ns_per_hit(r.median, threads) << ",\n"
+			<< "      \"kernel\": \"" << r.kernel << "\",\n";
+		if (opts.compare_kernels) {
+
+			out << "      \"specialized\": {\n"
+				<< "        \"kernel\": \"" << r.specialized_kernel << "\",\n"
+				<< "        \"seconds\": [";
+			for (std::size_t k = 0; k < r.specialized_seconds.size(); ++k) {
+
+				out << (k ? ", " : "") << r.specialized_seconds[k];
+			}
+			out << "],\n"
+				<< "        \"median_seconds\": " << r.specialized_median.seconds << ",\n"
+				<< "        \"mrays_per_second\": " << mrays_per_second(r.specialized_median) << ",\n"
+				<< "        \"speedup\": " << kernel_speedup(r) << ",\n"
+				<< "        \"identical\": " << (r.identical ? "true" : "false") << "\n"
+				<< "      },\n";
+		}
+		out << "      \"peak_rss_bytes\": " << r.peak_rss << "\n"
+			<< "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+
+	out << "  ]\n"
+		<< "}\n";
+}
+
+// The --sampling mode: the warmup runs are not needed, every case overwrites the same buffers.
+static int run_sampling(const benchmark_options& opts) {
+
+	const std::size_t samples = static_cast<std::size_t>(opts.sampling_samples);
+	std::cerr << "Benchmarking samplers, " << samples << " samples per case, " << opts.repetitions << " repetitions\n";
+
+	const auto results = run_sampling_benchmark(samples, opts.repetitions, opts.settings.seed);
+	for (const auto& r : results) {
+
+		std::cerr << r.name << ": " << r.ns_per_sample << " ns/sample, mean |p|^2 " << r.mean_length_squared << '\n';
+	}
+
+	if (opts.json_path.empty()) {
+
+		write_sampling_json(std::cout, samples, opts.repetitions, opts.settings.seed, results);
+		return 0;
+	}
+
+	std::ofstream file(opts.json_path);
+	write_sampling_json(file, samples, opts.repetitions, opts.settings.seed, results);
+	if (!file) {
+
+		std::cerr << "cannot write " << opts.json_path << '\n';
+		return 1;
+	}
+	return 0;
+}
+
+// The --micro mode, the same shape as --sampling.
+static int run_micro(const benchmark_options& opts) {
+
+	const std::size_t operations = static_cast<std::size_t>(opts.micro_operations);
+	std::cerr << "Microbenchmarks, " << operations << " operations per case, " << opts.repetitions << " repetitions"
+		<< (fast_math_build ? ", fast math" : "") << '\n';
+
+	const auto results = run_micro_benchmark(operations, opts.repetitions, opts.settings.seed);
+	for (const auto& r : results) {
+
+		std::cerr << r.name << ": " << r.ns_per_op << " ns/op, checksum " << r.checksum << '\n';
+	}
+
+	if (opts.json_path.empty()) {
+
+		write_micro_json(std::cout, operations, opts.repetitions, opts.settings.seed, results);
+		return 0;
+	}
+
+	std::ofstream file(opts.json_path);
+	write_micro_json(file, operations, opts.repetitions, opts.settings.seed, results);
+	if (!file) {
+
+		std::cerr << "cannot write " << opts.json_path << '\n';
+		return 1;
+	}
+	return 0;
+}
+
+/*
+	The --golden mode: renders every scene once through a BVH and writes it as its reference image or compares it with
+	the one there. Faster builds (RT_FAST_MATH, other compilers) trace slightly different paths where rounding decides
+	a bounce, so images are compared by RMSE rather than bit for bit; the default tolerance sits well below the noise
+	of another seed at the default 16 spp, so a bias or a broken intersection still fails. Returns the exit code.
+*/
+static int run_golden(const benchmark_options& opts) {
+
+	renderer tracer(opts.settings);
+	int failures = 0;
+	for (const auto& name : opts.scenes) {
+
+		const scene_description description = make_scene(name, 0);
+		const bvh_node world(description.world);
+		camera_settings view = description.camera;
+		view.aspect_ratio = static_cast<real>(opts.settings.image_width) / static_cast<real>(opts.settings.image_height);
+		const camera cam(view);
+		tracer.set_materials(material_table(description.materials));
+		if (opts.settings.integrator == integrator_type::nee) {
+
+			tracer.set_lights(light_list(description.world, tracer.materials()));
+		}
+
+		framebuffer image;
+		tracer.render(world, cam, image);
+		const std::string path = opts.golden_dir + "/" + name + ".pfm";
+		try {
+
+			if (opts.write_golden) {
+
+				write_image(path, image);
+				std::cerr << name << ": wrote " << path << '\n';
+				continue;
+			}
+
+			const auto difference = compare_images(image, read_pfm(path));
+			const bool passed = difference.rmse <= opts.golden_tolerance;
+			std::cerr << name << ": RMSE " << difference.rmse << ", max error " << difference.max_error << ", means "
+				<< difference.mean_a << " / " << difference.mean_b << (passed ? "" : ", FAILED") << '\n';
+			failures += passed ? 0 : 1;
+		}
+		catch (const std::exception& e) {
+
+			std::cerr << name << ": " << e.what() << '\n';
+			++failures;
+		}
+	}
+
+	if (failures > 0) {
+
+		std::cerr << failures << " of " << opts.scenes.size() << " scenes differ from " << opts.golden_dir
+			<< " by more than RMSE " << opts.golden_tolerance << '\n';
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+
+	benchmark_options opts;
+	try {
+
+		opts = parse_benchmark_options(argc, argv);
+	}
+	catch (const std::invalid_argument& e) {
+
+		std::cerr << e.what() << '\n' << benchmark_usage(argv[0]);
+		return 1;
+	}
+
+	if (opts.show_help) {
+
+		std::cerr << benchmark_usage(argv[0]);
+		return 0;
+	}
+
+	if (opts.sampling_samples > 0) {
+
+		return run_sampling(opts);
+	}
+	if (opts.micro_operations > 0) {
+
+		return run_micro(opts);
+	}
+	if (!opts.golden_dir.empty()) {
+
+		return run_golden(opts);
+	}
+
+	renderer tracer(opts.settings);
+	std::unique_ptr<renderer> specialized;
+	if (opts.compare_kernels) {
+
+		auto settings = opts.settings;
+		settings.kernel = render_kernel::specialized;
+		specialized = std::make_unique<renderer>(settings);
+	}
+	const unsigned threads = tracer.thread_count();
+	std::cerr << "Benchmarking " << opts.structure << ", " << opts.settings.image_width << 'x' << opts.settings.image_height << " at "
+		<< opts.settings.samples_per_pixel << " spp on " << threads << " threads, "
+		<< opts.warmup << " warmup + " << opts.repetitions << " repetitions\n";
+
+	std::vector<scene_result> results;
+	for (const auto& name : opts.scenes) {
+
+		results.push_back(run_scene(name, opts, tracer, specialized.get()));
+
+		const auto& r = results.back();
+		std::cerr << r.name << ": " << r.primitives << " primitives, " << opts.structure << " build " << r.build_ms << " ms, "
+			<< r.median.seconds << " s, " << mrays_per_second(r.median) << " Mrays/s, "
+			<< ns_per_hit(r.median, threads) << " ns/hit, " << samples_per_second(r.median) << " samples/s, "
+			<< "peak RSS " << r.peak_rss / (1024 * 1024) << " MiB\n";
+		if (specialized) {
+
+			std::cerr << "  " << r.specialized_kernel << ": " << r.specialized_median.seconds << " s, "
+				<< mrays_per_second(r.specialized_median) << " Mrays/s, " << kernel_speedup(r) << "x the generic kernel"
+				<< (r.identical ? "" : ", IMAGES DIFFER") << '\n';
+		}
+	}
+
+	if (opts.json_path.empty()) {
+
+		write_json(std::cout, opts, threads, results);
+	}
+	else {
+
+		std::ofstream file(opts.json_path);
+		write_json(file, opts, threads, results);
+		if (!file) {
+
+			std::cerr << "cannot write " << opts.json_path << '\n';
+			return 1;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include "micro_benchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+
+#include "rtweekend.hpp"
+
+#include "color.hpp"
+#include "framebuffer.hpp"
+#include "hittable_list.hpp"
+#include "image_io.hpp"
+#include "sphere.hpp"
+
+namespace {
+
+	// Spheres in the list of the hittable_list case, about what a BVH leaf range or a small scene holds.
+	const int list_spheres = 32;
+
+	// Pixels per row of the PPM case's image.
+	const int image_width = 1024;
+
+	// Inputs of all cases, drawn once so that every repetition does the same work.
+	struct micro_inputs {
+		std::vector<vec3> a, b;
+		std::vector<real> s;
+		std::vector<ray> rays;
+		std::vector<float> linear;   // 3 channels per operation
+		std::vector<std::uint8_t> quantized;
+	};
+
+	// Runs an operation per index and returns the checksum of what it produced.
+	using micro_case = std::function<double(micro_inputs&)>;
+
+	template <typename F>
+	double sum_each(const micro_inputs& in, F operation) {
+
+		double sum = 0;
+		for (std::size_t i = 0; i < in.a.size(); ++i) {
+
+			sum += operation(i);
+		}
+		return sum;
+	}
+
+	double component_sum(const vec3& v) {
+
+		return static_cast<double>(v.x()) + v.y() + v.z();
+	}
+
+	std::vector<std::pair<std::string, micro_case>> micro_cases(std::uint64_t seed) {
+
+		std::vector<std::pair<std::string, micro_case>> cases;
+
+		cases.push_back({ "vec3/add-scale", [](micro_inputs& in) {
+			return sum_each(in, [&](std::size_t i) { return component_sum(in.a[i] + in.s[i] * in.b[i]); }); } });
+		cases.push_back({ "vec3/dot", [](micro_inputs& in) {
+			return sum_each(in, [&](std::size_t i) { return static_cast<double>(dot(in.a[i], in.b[i])); }); } });
+		cases.push_back({ "vec3/cross", [](micro_inputs& in) {
+			return sum_each(in, [&](std::size_t i) { return component_sum(cross(in.a[i], in.b[i])); }); } });
+		cases.push_back({ "vec3/unit-vector", [](micro_inputs& in) {
+			return sum_each(in, [&](std::size_t i) { return component_sum(unit_vector(in.a[i])); }); } });
+
+		// Rays from around the origin towards points spread over twice the sphere's extent, so about half hit.
+		auto ball = std::make_shared<sphere>(point3(0, 0, -4), real(1));
+		cases.push_back({ "sphere/hit", [ball](micro_inputs& in) {
+			hit_record rec;
+			return sum_each(in, [&](std::size_t i) {
+				return ball->hit(in.rays[i], real(0.001), infinity, rec) ? static_cast<double>(rec.t) : 0.0; }); } });
+
+		auto list = std::make_shared<hittable_list>();
+		random_engine placement(seed, 2);
+		for (int k = 0; k < list_spheres; ++k) {
+
+			const vec3 offset = vec3::random(placement, -2, 2);
+			list->add(std::make_shared<sphere>(point3(offset.x(), offset.y(), -6 + offset.z()),
+				static_cast<real>(random_double(placement, 0.1, 0.4))));
+		}
+		cases.push_back({ "hittable_list/hit", [list](micro_inputs& in) {
+			hit_record rec;
+			return sum_each(in, [&](std::size_t i) {
+				return list->hit(in.rays[i], real(0.001), infinity, rec) ? static_cast<double>(rec.t) : 0.0; }); } });
+
+		cases.push_back({ "random_in_unit_sphere", [seed](micro_inputs& in) {
+			random_engine rng(seed, 3);
+			return sum_each(in, [&](std::size_t) { return static_cast<double>(random_in_unit_sphere(rng).length_squared()); }); } });
+
+		// ns per pixel: gamma correction and quantization of its three channels, then the same with PPM encoding.
+		cases.push_back({ "write_color/quantize", [](micro_inputs& in) {
+			quantize_channels(in.linear.data(), in.quantized.data(), in.linear.size());
+			double sum = 0;
+			for (const auto byte : in.quantized) {
+
+				sum += byte;
+			}
+			return sum; } });
+		cases.push_back({ "write_color/ppm", [](micro_inputs& in) {
+			const int pixels = static_cast<int>(in.linear.size() / 3);
+			framebuffer image(std::min(pixels, image_width), std::max(pixels / image_width, 1));
+			std::copy(in.linear.begin(), in.linear.begin() + 3 * image.pixel_count(), image.data());
+			const auto bytes = encode_image(image, image_format::ppm);
+			return static_cast<double>(bytes.size()) + bytes.back(); } });
+
+		return cases;
+	}
+}
+
+std::vector<micro_result> run_micro_benchmark(std::size_t operations, int repetitions, std::uint64_t seed) {
+
+	micro_inputs inputs;
+	random_engine rng(seed, 1);
+	for (std::size_t i = 0; i < operations; ++i) {
+
+		inputs.a.push_back(vec3::random(rng, -1, 1));
+		inputs.b.push_back(vec3::random(rng, -1, 1));
+		inputs.s.push_back(static_cast<real>(random_double(rng)));
+
+		const point3 origin = vec3::random(rng, -0.5, 0.5);
+		const point3 target = point3(0, 0, -4) + vec3::random(rng, -2, 2);
+		inputs.rays.emplace_back(origin, target - origin);
+
+		// Mostly in [0, 1], with some out of range to exercise the clamp.
+		for (int c = 0; c < 3; ++c) {
+
+			inputs.linear.push_back(static_cast<float>(random_double(rng, -0.1, 1.2)));
+		}
+	}
+	inputs.quantized.resize(inputs.linear.size());
+
+	std::vector<micro_result> results;
+	for (const auto& c : micro_cases(seed)) {
+
+		std::vector<double> times;
+		micro_result result;
+		result.name = c.first;
+		for (int r = 0; r < repetitions; ++r) {
+
+			const auto start = std::chrono::steady_clock::now();
+			result.checksum = c.second(inputs);
+			times.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+		}
+		std::sort(times.begin(), times.end());
+		result.ns_per_op = operations > 0 ? times[times.size() / 2] / static_cast<double>(operations) : 0;
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+void write_micro_json(std::ostream& out, std::size_t operations, int repetitions, std::uint64_t seed,
+	const std::vector<micro_result>& results) {
+
+	out << "{\n"
+		<< "  \"config\": {\n"
+		<< "    \"operations\": " << operations << ",\n"
+		<< "    \"repetitions\": " << repetitions << ",\n"
+		<< "    \"seed\": " << seed << ",\n"
+		<< "    \"real\": \"" << (sizeof(real) == sizeof(float) ? "float" : "double") << "\",\n"
+		<< "    \"fast_math\": " << (fast_math_build ? "true" : "false") << "\n"
+		<< "  },\n"
+		<< "  \"micro\": [\n";
+
+	for (std::size_t i = 0; i < results.size(); ++i) {
+
+		const auto& r = results[i];
+		out << "    {\n"
+			<< "      \"name\": \"" << r.name << "\",\n"
+			<< "      \"ns_per_op\": " << r.ns_per_op << ",\n"
+			<< "      \"checksum\": " << r.checksum << "\n"
+			<< "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+
+	out << "  ]\n"
+		<< "}\n";
+}
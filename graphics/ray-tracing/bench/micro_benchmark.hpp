@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct micro_result {
+	std::string name;          // what is measured, e.g. sphere/hit
+	double ns_per_op = 0;      // median over the repetitions
+	double checksum = 0;       // folds every result in, so the work cannot be optimized away; compare it across builds
+};
+
+/*
+	Microbenchmarks of the innermost operations: the vec3 arithmetic, sphere::hit with a mix of hits and misses,
+	hittable_list::hit over a list of small spheres, random_in_unit_sphere and the gamma correction and quantization
+	behind every written pixel, alone and as PPM encoding. Every case runs operations times on inputs drawn once
+	from seed, repetitions times, and keeps the median.
+*/
+std::vector<micro_result> run_micro_benchmark(std::size_t operations, int repetitions, std::uint64_t seed);
+
+void write_micro_json(std::ostream& out, std::size_t operations, int repetitions, std::uint64_t seed,
+	const std::vector<micro_result>& results);
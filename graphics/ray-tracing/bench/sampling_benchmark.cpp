@@ -0,0 +1,162 @@
+#include "sampling_benchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+#include "rtweekend.hpp"
+
+#include "sampler.hpp"
+
+namespace {
+
+	// Output of one run: the batch variants write into it directly, the scalar loops store what they return.
+	struct soa_buffer {
+		std::vector<real> x, y, z;
+		std::vector<real> nx, ny, nz;
+	};
+
+	using sampling_case = std::function<void(random_engine&, soa_buffer&)>;
+
+	template <typename F>
+	void store_each(soa_buffer& out, F sample) {
+
+		for (std::size_t i = 0; i < out.x.size(); ++i) {
+
+			const vec3 p = sample(i);
+			out.x[i] = p.x();
+			out.y[i] = p.y();
+			out.z[i] = p.z();
+		}
+	}
+
+	vec3 rejection_in_unit_sphere(random_engine& rng) {
+
+		while (true) {
+
+			const vec3 p = vec3::random(rng, -1, 1);
+			if (p.length_squared() < 1) return p;
+		}
+	}
+
+	vec3 rejection_in_unit_disk(random_engine& rng) {
+
+		while (true) {
+
+			const vec3 p(static_cast<real>(random_double(rng, -1, 1)), static_cast<real>(random_double(rng, -1, 1)), 0);
+			if (p.length_squared() < 1) return p;
+		}
+	}
+
+	std::vector<std::pair<std::string, sampling_case>> sampling_cases() {
+
+		std::vector<std::pair<std::string, sampling_case>> cases;
+
+		cases.push_back({ "unit-sphere/rejection", [](random_engine& rng, soa_buffer& out) {
+			store_each(out, [&](std::size_t) { return rejection_in_unit_sphere(rng); }); } });
+		cases.push_back({ "unit-sphere/closed-form", [](random_engine& rng, soa_buffer& out) {
+			store_each(out, [&](std::size_t) { return sample_in_unit_sphere(rng); }); } });
+		cases.push_back({ "unit-sphere/batch", [](random_engine& rng, soa_buffer& out) {
+			sample_in_unit_spheres(rng, out.x.size(), out.x.data(), out.y.data(), out.z.data()); } });
+
+		cases.push_back({ "unit-vector/rejection", [](random_engine& rng, soa_buffer& out) {
+			store_each(out, [&](std::size_t) { return unit_vector(rejection_in_unit_sphere(rng)); }); } });
+		cases.push_back({ "unit-vector/closed-form", [](random_engine& rng, soa_buffer& out) {
+			store_each(out, [&](std::size_t) { return sample_unit_vector(rng); }); } });
+		cases.push_back({ "unit-vector/batch", [](random_engine& rng, soa_buffer& out) {
+			sample_unit_vectors(rng, out.x.size(), out.x.data(), out.y.data(), out.z.data()); } });
+
+		cases.push_back({ "hemisphere/rejection", [](random_engine& rng, soa_buffer& out) {
+			store_each(out, [&](std::size_t i) {
+				const vec3 p = rejection_in_unit_sphere(rng);
+				return dot(p, vec3(out.nx[i], out.ny[i], out.nz[i])) > 0 ? p : -p; }); } });
+		cases.push_back({ "hemisphere/closed-form", [](random_engine& rng, soa_buffer& out) {
+			store_each(out, [&](std::size_t i) { return sample_in_hemisphere(rng, vec3(out.nx[i], out.ny[i], out.nz[i])); }); } });
+		cases.push_back({ "hemisphere/batch", [](random_engine& rng, soa_buffer& out) {
+			sample_in_hemispheres(rng, out.x.size(), out.nx.data(), out.ny.data(), out.nz.data(),
+				out.x.data(), out.y.data(), out.z.data()); } });
+
+		cases.push_back({ "unit-disk/rejection", [](random_engine& rng, soa_buffer& out) {
+			store_each(out, [&](std::size_t) { return rejection_in_unit_disk(rng); }); } });
+		cases.push_back({ "unit-disk/closed-form", [](random_engine& rng, soa_buffer& out) {
+			store_each(out, [&](std::size_t) { return sample_in_unit_disk(rng); }); } });
+		cases.push_back({ "unit-disk/batch", [](random_engine& rng, soa_buffer& out) {
+			sample_in_unit_disks(rng, out.x.size(), out.x.data(), out.y.data()); } });
+
+		return cases;
+	}
+}
+
+std::vector<sampling_result> run_sampling_benchmark(std::size_t samples, int repetitions, std::uint64_t seed) {
+
+	soa_buffer buffer;
+	for (auto* v : { &buffer.x, &buffer.y, &buffer.z, &buffer.nx, &buffer.ny, &buffer.nz }) {
+
+		v->assign(samples, 0);
+	}
+
+	// Normals of the hemisphere cases, uniform over the sphere and the same for every implementation.
+	random_engine normals(seed, 1);
+	for (std::size_t i = 0; i < samples; ++i) {
+
+		const vec3 n = sample_unit_vector(normals);
+		buffer.nx[i] = n.x();
+		buffer.ny[i] = n.y();
+		buffer.nz[i] = n.z();
+	}
+
+	std::vector<sampling_result> results;
+	for (const auto& c : sampling_cases()) {
+
+		std::vector<double> times;
+		for (int r = 0; r < repetitions; ++r) {
+
+			std::fill(buffer.z.begin(), buffer.z.end(), real(0));
+			random_engine rng(seed, 0);
+			const auto start = std::chrono::steady_clock::now();
+			c.second(rng, buffer);
+			times.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+		}
+		std::sort(times.begin(), times.end());
+
+		sampling_result result;
+		result.name = c.first;
+		result.ns_per_sample = samples > 0 ? times[times.size() / 2] / static_cast<double>(samples) : 0;
+		double sum = 0;
+		for (std::size_t i = 0; i < samples; ++i) {
+
+			sum += static_cast<double>(buffer.x[i]) * buffer.x[i] + static_cast<double>(buffer.y[i]) * buffer.y[i]
+				+ static_cast<double>(buffer.z[i]) * buffer.z[i];
+		}
+		result.mean_length_squared = samples > 0 ? sum / static_cast<double>(samples) : 0;
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+void write_sampling_json(std::ostream& out, std::size_t samples, int repetitions, std::uint64_t seed,
+	const std::vector<sampling_result>& results) {
+
+	out << "{\n"
+		<< "  \"config\": {\n"
+		<< "    \"samples\": " << samples << ",\n"
+		<< "    \"repetitions\": " << repetitions << ",\n"
+		<< "    \"seed\": " << seed << ",\n"
+		<< "    \"real\": \"" << (sizeof(real) == sizeof(float) ? "float" : "double") << "\"\n"
+		<< "  },\n"
+		<< "  \"sampling\": [\n";
+
+	for (std::size_t i = 0; i < results.size(); ++i) {
+
+		const auto& r = results[i];
+		out << "    {\n"
+			<< "      \"name\": \"" << r.name << "\",\n"
+			<< "      \"ns_per_sample\": " << r.ns_per_sample << ",\n"
+			<< "      \"mean_length_squared\": " << r.mean_length_squared << "\n"
+			<< "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+
+	out << "  ]\n"
+		<< "}\n";
+}
\ No newline at end of file
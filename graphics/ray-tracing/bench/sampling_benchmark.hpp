@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct sampling_result {
+	std::string name;             // distribution and implementation, e.g. unit-sphere/rejection
+	double ns_per_sample = 0;     // median over the repetitions
+	double mean_length_squared = 0;   // the same for every implementation of one distribution
+};
+
+/*
+	Microbenchmark of the samplers of vec3.hpp and sampler.hpp: the rejection samplers against the closed-form
+	ones and their batch versions, for points in the unit ball, unit vectors, the hemisphere and the unit disk.
+	Every case draws samples values from a generator seeded with seed, repetitions times, and keeps the median.
+*/
+std::vector<sampling_result> run_sampling_benchmark(std::size_t samples, int repetitions, std::uint64_t seed);
+
+void write_sampling_json(std::ostream& out, std::size_t samples, int repetitions, std::uint64_t seed,
+	const std::vector<sampling_result>& results);
\ No newline at end of file
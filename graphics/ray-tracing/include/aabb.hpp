@@ -0,0 +1,31 @@
+#pragma once
+
+#include "rtweekend.hpp"
+
+// Axis-aligned bounding box. A default constructed box is empty and absorbs nothing when merged.
+class aabb {
+public:
+	point3 minimum;
+	point3 maximum;
+public:
+	aabb() :
+		minimum{ std::numeric_limits<real>::infinity(), std::numeric_limits<real>::infinity(), std::numeric_limits<real>::infinity() },
+		maximum{ -std::numeric_limits<real>::infinity(), -std::numeric_limits<real>::infinity(), -std::numeric_limits<real>::infinity() }
+	{}
+	aabb(const point3& a, const point3& b) : minimum{ a }, maximum{ b } {}
+
+	point3 min() const;
+	point3 max() const;
+
+	bool empty() const;
+	point3 centroid() const;
+	real surface_area() const;
+	int longest_axis() const;
+
+	void expand(const aabb& box);
+	void expand(const point3& p);
+
+	bool hit(const ray& r, real t_min, real t_max) const;
+};
+
+aabb surrounding_box(const aabb& box0, const aabb& box1);
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "framebuffer.hpp"
+
+/*
+	Running per-pixel sums of every sample rendered so far, plus the number of samples behind each sum.
+	Progressive rendering adds passes into it, and resolve() turns it into a displayable image at any time,
+	even in the middle of a pass, since every pixel divides by its own count.
+*/
+class accumulation_buffer {
+public:
+	accumulation_buffer() {}
+	accumulation_buffer(int width, int height) {
+
+		reset(width, height);
+	}
+
+	int width() const;
+	int height() const;
+
+	// Resizes to width x height and drops all samples.
+	void reset(int width, int height);
+
+	void add(int x, int y, const color& sum, std::uint32_t samples);
+	std::uint32_t samples(int x, int y) const;
+
+	// The fewest samples of any pixel, i.e. the number of passes every pixel has completed.
+	std::uint32_t min_samples() const;
+	std::uint64_t total_samples() const;
+
+	// Mean of every pixel, black where there are no samples yet.
+	void resolve(framebuffer& image) const;
+
+	/*
+		Checkpoint file: the magic "RTACCUM1", width and height as 32 bit and the frame seed as 64 bit integers,
+		then per pixel three 32 bit float sums and a 32 bit sample count, all little endian.
+		save() writes a temporary file next to the target and renames it, so a pre-empted save never leaves a torn checkpoint.
+		Both throw std::runtime_error on I/O errors or, for load(), on a malformed file.
+	*/
+	void save(const std::string& path, std::uint64_t seed) const;
+	static accumulation_buffer load(const std::string& path, std::uint64_t& seed);
+private:
+	framebuffer sums;
+	std::vector<std::uint32_t> counts;
+};
\ No newline at end of file
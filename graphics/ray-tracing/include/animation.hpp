@@ -0,0 +1,77 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "bvh.hpp"
+#include "hittable_list.hpp"
+#include "instance.hpp"
+#include "sphere.hpp"
+
+struct animation_settings {
+	int frames = 1;                   // more than one renders a frame sequence
+	real turntable_degrees = 0;       // rotation per frame about the vertical axis through the camera's look-at point
+	double rebuild_threshold = 1.5;   // rebuild once refits have raised the BVH's SAH cost by this factor
+};
+
+/*
+	Moves the spheres and instances of a world from frame to frame: each along its velocity, in units per frame,
+	then all of them around the vertical axis through pivot. Other objects stay where they are.
+	Positions are recomputed from the first frame every time, so no error accumulates over a long sequence.
+*/
+class scene_animation {
+public:
+	// velocities has one entry per object of world or is empty; the world has to outlive the animation.
+	scene_animation(hittable_list& world, const std::vector<vec3>& velocities, const point3& pivot, real turntable_degrees);
+
+	// Whether any object moves at all.
+	bool moves() const;
+
+	// Not while rendering.
+	void set_frame(int frame);
+private:
+	struct moving_sphere {
+		sphere* object;
+		point3 start;
+		vec3 velocity;
+	};
+	struct moving_instance {
+		instance* object;
+		affine_transform start;
+		vec3 velocity;
+	};
+private:
+	std::vector<moving_sphere> spheres;
+	std::vector<moving_instance> instances;
+	point3 pivot;
+	real degrees_per_frame;
+};
+
+struct bvh_update {
+	bool rebuilt = false;
+	double milliseconds = 0;
+	double sah_cost = 0;
+	double cost_ratio = 1;   // SAH cost relative to the last build
+};
+
+/*
+	A BVH kept alive across the frames of a sequence. update() refits it to where the primitives are now
+	and rebuilds it instead once the refits have made it more than rebuild_threshold times as expensive
+	to traverse, by the SAH cost, as right after its last build.
+*/
+class animated_bvh {
+public:
+	animated_bvh(const hittable_list& world, int max_leaf_size, double rebuild_threshold);
+
+	bvh_update update();
+	const bvh_node& bvh() const;
+	bvh_node& bvh();
+private:
+	void rebuild();
+private:
+	const hittable_list& objects;
+	int leaf_size;
+	double threshold;
+	std::unique_ptr<bvh_node> tree;
+	double built_cost = 0;
+};
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+	Bump allocator for objects that live as long as the scene: primitives are placed back to back in large blocks
+	instead of one heap allocation each, and the whole arena is released at once.
+	Objects with non-trivial destructors are destroyed in reverse order of creation when the arena goes away or is reset.
+	Not thread-safe, build a scene on one thread.
+*/
+class scene_arena {
+public:
+	explicit scene_arena(std::size_t first_block_size = 64 * 1024);
+	~scene_arena();
+
+	scene_arena(const scene_arena&) = delete;
+	scene_arena& operator=(const scene_arena&) = delete;
+
+	void* allocate(std::size_t size, std::size_t alignment);
+
+	template <typename T, typename... Args>
+	T* create(Args&&... args) {
+
+		void* memory = allocate(sizeof(T), alignof(T));
+		T* object = ::new (memory) T(std::forward<Args>(args)...);
+		if (!std::is_trivially_destructible<T>::value) {
+
+			register_destructor(object, [](void* p) { static_cast<T*>(p)->~T(); });
+		}
+
+		return object;
+	}
+
+	// Destroys every object and keeps only the largest block for reuse.
+	void reset();
+
+	std::size_t bytes_used() const;
+	std::size_t bytes_reserved() const;
+private:
+	struct block {
+		std::unique_ptr<unsigned char[]> memory;
+		std::size_t size;
+	};
+
+	struct destructor_record {
+		void (*destroy)(void*);
+		void* object;
+		destructor_record* next;
+	};
+
+	void register_destructor(void* object, void (*destroy)(void*));
+	void run_destructors();
+	void add_block(std::size_t min_size);
+private:
+	std::vector<block> blocks;
+	std::size_t next_block_size;
+	std::size_t offset = 0;   // into the last block
+	std::size_t used = 0;
+	destructor_record* destructors = nullptr;
+};
\ No newline at end of file
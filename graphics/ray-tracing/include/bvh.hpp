@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include "aabb.hpp"
+#include "hittable.hpp"
+#include "hittable_list.hpp"
+#include "sphere_soa.hpp"
+
+struct bvh_build_stats {
+	double build_ms = 0.0;
+	std::size_t primitives = 0;
+	std::size_t nodes = 0;
+	std::size_t leaves = 0;
+	std::size_t max_leaf_size = 0;
+	std::size_t sphere_leaves = 0;   // leaves intersected through the packed sphere kernel
+	int max_depth = 0;
+	double sah_cost = 0.0;   // expected cost of a random ray, in units of one primitive test
+};
+
+struct bvh_traversal_stats {
+	std::uint64_t rays = 0;
+	std::uint64_t nodes_visited = 0;
+	std::uint64_t primitive_tests = 0;
+};
+
+/*
+	Bounding volume hierarchy over the objects of a hittable_list.
+	The tree is built top-down with a binned surface area heuristic and stored as one flat array in depth-first order:
+	the first child of an interior node directly follows it, and the node only records where the second child starts.
+	Leaves reference a contiguous range of the reordered primitive array.
+	Leaves made up of spheres only are intersected through a packed sphere_soa copy of the primitives instead,
+	one vector instruction for several spheres and no virtual call per sphere.
+	A BVH can also be a view over nodes and spheres stored elsewhere, such as a memory-mapped scene file.
+*/
+class bvh_node : public hittable {
+public:
+	// The node layout is also the on-disk layout of scene files.
+	struct linear_node {
+		aabb bounds;
+		std::uint32_t offset;   // first primitive for leaves, second child for interior nodes
+		std::uint32_t count;    // number of primitives, 0 for interior nodes
+		std::uint32_t axis;     // split axis of interior nodes, picks the near child first
+		std::uint32_t flags;
+	};
+
+	static const std::uint32_t sphere_leaf = 1;
+public:
+	explicit bvh_node(const hittable_list& list, int max_leaf_size = 4);
+
+	// View over node_count external nodes, whose leaves must all be sphere leaves indexing into spheres.
+	bvh_node(const linear_node* nodes, std::size_t node_count, const sphere_soa& spheres);
+
+	/*
+		Whether external nodes can be traversed safely: every node but the root is the child of exactly one node
+		before it, interior nodes split on an axis, leaves are sphere leaves within sphere_count spheres,
+		and the tree fits the traversal stack. One pass over the nodes.
+	*/
+	static bool valid_layout(const linear_node* nodes, std::size_t node_count, std::size_t sphere_count);
+
+	virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const override;
+	virtual bool intersect(const ray& r, real t_min, real t_max, hit_record& rec) const override;
+	virtual bool occluded(const ray& r, real t_min, real t_max) const override;
+	virtual bool bounding_box(aabb& output_box) const override;
+
+	const bvh_build_stats& build_stats() const;
+
+	/*
+		Recomputes the bounds of every node bottom-up from the current bounds of its primitives and keeps the tree,
+		e.g. after instances moved, and refreshes the packed copies of sphere leaves. Much cheaper than a rebuild,
+		but the tree gets worse the further primitives move from where it was built; the SAH cost in build_stats()
+		is updated to tell. Not while rendering. Returns the milliseconds it took.
+		Throws std::logic_error for views and std::invalid_argument if a primitive lost its bounds.
+	*/
+	double refit();
+
+	// Traversal counters cost a few atomic adds per ray, so they are only gathered on request.
+	void collect_traversal_stats(bool enable);
+	bvh_traversal_stats traversal_stats() const;
+	void reset_traversal_stats();
+
+	void print_report(std::ostream& out) const;
+
+	// Flat node array in depth-first order and the packed spheres its sphere leaves index into.
+	const linear_node* node_data() const;
+	std::size_t node_count() const;
+	const sphere_soa& spheres() const;
+
+	// For every primitive slot the leaves refer to, the index of that object in the source list.
+	const std::vector<std::uint32_t>& primitive_order() const;
+private:
+	struct build_primitive {
+		aabb bounds;
+		point3 centroid;
+		std::size_t index;
+	};
+
+	std::uint32_t build(std::vector<build_primitive>& prims, std::size_t begin, std::size_t end, int depth);
+	void pack_sphere_leaves();
+	void summarize();
+
+	template <bool any_hit>
+	bool traverse(const ray& r, real t_min, real t_max, hit_record& rec) const;
+private:
+	std::vector<linear_node> nodes;
+	const linear_node* node_array = nullptr;   // nodes.data(), or the external nodes of a view
+	std::size_t node_total = 0;
+	std::vector<shared_ptr<hittable>> primitives;
+	std::vector<std::uint32_t> order;
+	sphere_soa packed_spheres;   // parallel to primitives, empty slots for other objects
+	int leaf_size_limit = 0;
+
+	bvh_build_stats stats;
+
+	bool stats_enabled = false;
+	mutable std::atomic<std::uint64_t> rays_traced{ 0 };
+	mutable std::atomic<std::uint64_t> nodes_visited{ 0 };
+	mutable std::atomic<std::uint64_t> primitive_tests{ 0 };
+};
\ No newline at end of file
@@ -1,25 +1,99 @@
 #pragma once
 
+#include <cstddef>
+#include <vector>
+
 #include "rtweekend.hpp"
 
+// Camera placement. The defaults reproduce the original fixed camera: a pinhole at the origin, looking down -z.
+struct camera_settings {
+	point3 lookfrom = point3(0, 0, 0);
+	point3 lookat = point3(0, 0, -1);
+	vec3 vup = vec3(0, 1, 0);
+	real vfov = 90;                        // vertical field of view, in degrees
+	real aspect_ratio = real(16.0 / 9.0);  // viewport width / height
+	real focal_length = 1;                 // distance between projection point and projection plane
+	real aperture = 0;                     // thin lens diameter, 0 = pinhole
+	real focus_distance = 0;               // distance to the plane in focus, 0 = focal_length
+};
+
+// Camera rays in structure-of-arrays layout, e.g. all samples of a pixel.
+struct ray_batch {
+	std::vector<real> origin_x, origin_y, origin_z;
+	std::vector<real> direction_x, direction_y, direction_z;
+
+	void resize(std::size_t count);
+	std::size_t size() const;
+
+	ray get(std::size_t i) const;
+};
+
+/*
+	Perspective camera with an optional thin lens. With an aperture, rays start on a disk of that diameter
+	around lookfrom and converge on the plane at focus_distance, so only that plane is sharp.
+*/
 class camera {
 private:
 	point3 origin;
 	point3 lower_left_corner;
 	vec3 horizontal;
 	vec3 vertical;
+	vec3 lens_u;   // the camera's right and up axes, scaled by the lens radius
+	vec3 lens_v;
+	bool lens = false;
+public:
+	camera() : camera(camera_settings()) {}
+
+	// Throws std::invalid_argument for a negative aperture or focus distance.
+	explicit camera(const camera_settings& settings);
+
+	// Through the center of the lens.
+	ray get_ray(real u, real v) const;
+
+	// Through the point of the lens that [lens_s, lens_t) in [0,1)^2 maps to.
+	ray get_ray(real u, real v, double lens_s, double lens_t) const;
+
+	bool has_lens() const;
+
+	// Sample dimensions a camera ray takes: the position in the pixel and, with a lens, the position on the lens.
+	int sample_dimensions() const;
+
+	// The projection get_ray() works from, for renderers that generate rays themselves, e.g. on a GPU.
+	point3 position() const;
+	point3 viewport_corner() const;
+	vec3 viewport_horizontal() const;
+	vec3 viewport_vertical() const;
+	vec3 lens_horizontal() const;
+	vec3 lens_vertical() const;
+};
+
+/*
+	A camera's projection for one image size. The step from one pixel to the next is precomputed,
+	so a ray direction is one multiply-add per axis from the corner of the image instead of
+	a division by the image size and the full viewport sum of camera::get_ray().
+	Pixel rows count from the top, as in framebuffer.
+*/
+class camera_raster {
 public:
-	camera() {
-		auto aspect_ratio = 16.0 / 9.0;
-		auto viewport_height = 2.0;
-		auto viewport_width = aspect_ratio * viewport_height;
-		auto focal_length = 1.0;  // distance between projection point and projection plane
-
-		origin = point3(0, 0, 0);
-		horizontal = vec3(viewport_width, 0.0, 0.0);
-		vertical = vec3(0.0, viewport_height, 0.0);
-		lower_left_corner = origin - (horizontal / 2) - (vertical / 2) - vec3(0, 0, focal_length);
-	}
-
-	ray get_ray(double u, double v) const;
+	camera_raster(const camera& cam, int width, int height);
+
+	/*
+		The ray of one sample of pixel (x, y). sample holds camera::sample_dimensions() values:
+		the offset in the pixel and, with a lens, the position on it.
+	*/
+	ray get_ray(int x, int y, const double* sample) const;
+
+	// The rays of count samples of pixel (x, y), their values one after another in samples, into out[0, count).
+	void generate(int x, int y, const double* samples, int count, ray_batch& out) const;
+
+	int sample_dimensions() const;
+private:
+	point3 origin;
+	vec3 to_corner;   // from the origin to the bottom left pixel corner
+	vec3 pixel_u;     // from one pixel to the next to the right
+	vec3 pixel_v;     // and upwards
+	vec3 lens_u;
+	vec3 lens_v;
+	bool lens;
+	int height;
 };
\ No newline at end of file
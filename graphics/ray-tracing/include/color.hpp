@@ -1,7 +1,9 @@
 #pragma once
 
-#include <iostream>
+#include <cstddef>
+#include <cstdint>
 
 #include "rtweekend.hpp"
 
-void write_color(std::ostream& out, color pixel_color, int samples_per_pixel);
\ No newline at end of file
+// Gamma-corrects (gamma=2.0), clamps and quantizes count linear channel values to [0,255], in one pass over the buffer.
+void quantize_channels(const float* linear, std::uint8_t* out, std::size_t count);
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "device_kernel.hpp"
+
+/*
+	Entry points of cuda_backend.cu, which only exists in builds with RT_ENABLE_CUDA.
+	Everything CUDA stays behind them, so no other translation unit needs the CUDA headers.
+	Compile it with nvcc -std=c++17 -DRT_ENABLE_CUDA, pass RT_ENABLE_CUDA to gpu_backend.cpp as well and link cudart.
+	nvcc contracts multiplies and adds into FMAs by default; --fmad=false keeps the image closest to the CPU's.
+*/
+
+int cuda_device_count();
+std::string cuda_device_name();
+
+/*
+	Copies the scene arrays to the first device, traces one thread per pixel and copies the image back into
+	image (3 floats per pixel, top row first). Returns the rays cast. Throws std::runtime_error on CUDA errors.
+*/
+std::uint64_t cuda_render(const device_scene& scene, std::size_t sphere_count, const device_camera& cam,
+	const device_frame& frame, float* image);
\ No newline at end of file
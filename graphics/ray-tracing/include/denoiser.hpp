@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+
+#include "framebuffer.hpp"
+
+/*
+	Auxiliary outputs (AOVs) of a frame, the same size as its color: the albedo, the world space normal
+	and the distance to the surface each pixel's center sees through the center of the lens.
+	Pixels that see the sky have the sky as albedo, a zero normal and a depth of 0.
+	Depth is stored in all three channels, so every buffer can be written as an image.
+*/
+struct aov_buffers {
+	framebuffer albedo;
+	framebuffer normal;
+	framebuffer depth;
+};
+
+enum class denoiser_type {
+	none,
+	atrous,   // built in, edge-avoiding a-trous wavelet filter guided by the AOVs
+	oidn      // Intel Open Image Denoise, needs a build with RT_ENABLE_OIDN
+};
+
+// Throws std::invalid_argument for unknown names; accepts none, atrous and oidn.
+denoiser_type denoiser_type_from_name(const std::string& name);
+const char* denoiser_type_name(denoiser_type type);
+
+// Whether this build has Open Image Denoise support.
+bool oidn_available();
+
+struct denoise_settings {
+	denoiser_type type = denoiser_type::none;
+	int iterations = 5;          // a-trous passes, the footprint doubles with each to 4 * 2^iterations - 3 pixels
+	double color_sigma = 4;      // edge stop on luminance, in standard deviations of the pixel's noise
+	double normal_sigma = 128;   // exponent of the cosine between normals
+	double depth_sigma = 1;      // edge stop on depth, in multiples of the depth gradient
+	unsigned thread_count = 0;   // rows are filtered in parallel, 0 = one thread per hardware thread
+};
+
+/*
+	Filters noisy into result, which may not alias it. The a-trous filter works on the color divided by the albedo,
+	so the albedo edges the AOVs already know stay sharp, and weights neighbors SVGF-style: by how close their
+	luminance is relative to a spatial estimate of the noise, how well their normals agree and whether their depth
+	continues the pixel's depth gradient. The noise estimate is filtered along and shrinks with every pass.
+	oidn runs Open Image Denoise's ray tracing filter on color, albedo and normal; without it in the build,
+	it falls back to the a-trous filter. Throws std::invalid_argument if the AOVs are not the size of the image
+	and std::runtime_error if Open Image Denoise fails.
+*/
+void denoise(const framebuffer& noisy, const aov_buffers& aovs, const denoise_settings& settings, framebuffer& result);
\ No newline at end of file
@@ -0,0 +1,425 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include "vec3.hpp"
+
+/*
+	The path tracer as one self-contained function per pixel, written so that the same source compiles for the CPU
+	and, through nvcc, for CUDA devices: plain structs of scalars and pointers, no virtual calls, no allocation,
+	no exceptions and no standard library beyond <cmath>. It mirrors the CPU pipeline step by step,
+	camera::get_ray, the packed sphere test of the BVH leaves, the Lambertian bounce, Russian roulette and the sky,
+	and draws the same random numbers in the same order, so both render the same image up to rounding.
+	Everything is defined inline here, since nvcc has to see the device code of every function it launches.
+*/
+
+#if defined(__CUDACC__)
+#define RT_DEVICE __host__ __device__
+#else
+#define RT_DEVICE
+#endif
+
+// Spheres and BVH nodes in the depth-first layout of bvh_node, every leaf a sphere leaf.
+struct device_node {
+	real lower[3];
+	real upper[3];
+	std::uint32_t offset;   // first sphere for leaves, second child for interior nodes
+	std::uint32_t count;    // number of spheres, 0 for interior nodes
+	std::uint32_t axis;
+	std::uint32_t padding;
+};
+
+struct device_scene {
+	const device_node* nodes;
+	std::uint32_t node_count;
+	const real* center[3];   // sphere_soa layout, in BVH leaf order
+	const real* radius;
+};
+
+// The projection of camera: rays start at origin and pass through lower_left + u * horizontal + v * vertical.
+struct device_camera {
+	real origin[3];
+	real lower_left[3];
+	real horizontal[3];
+	real vertical[3];
+};
+
+struct device_frame {
+	int width;
+	int height;
+	int samples_per_pixel;
+	int max_depth;
+	int roulette_depth;   // bounces before Russian roulette, past max_depth to disable it
+	std::uint64_t seed;
+};
+
+namespace device {
+
+	struct vec {
+		real x, y, z;
+	};
+
+	RT_DEVICE inline vec make(real x, real y, real z) { vec v = { x, y, z }; return v; }
+	RT_DEVICE inline vec load(const real* p) { return make(p[0], p[1], p[2]); }
+	RT_DEVICE inline vec operator+(vec a, vec b) { return make(a.x + b.x, a.y + b.y, a.z + b.z); }
+	RT_DEVICE inline vec operator-(vec a, vec b) { return make(a.x - b.x, a.y - b.y, a.z - b.z); }
+	RT_DEVICE inline vec operator-(vec a) { return make(-a.x, -a.y, -a.z); }
+	RT_DEVICE inline vec operator*(real t, vec a) { return make(t * a.x, t * a.y, t * a.z); }
+	RT_DEVICE inline vec operator*(vec a, vec b) { return make(a.x * b.x, a.y * b.y, a.z * b.z); }
+	RT_DEVICE inline real dot(vec a, vec b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+	RT_DEVICE inline real square_root(real x) {
+
+#if defined(__CUDA_ARCH__)
+		return sqrt(x);
+#else
+		return std::sqrt(x);
+#endif
+	}
+
+	RT_DEVICE inline double square_root_double(double x) {
+
+#if defined(__CUDA_ARCH__)
+		return sqrt(x);
+#else
+		return std::sqrt(x);
+#endif
+	}
+
+	// The engines of random_generator.hpp, bit for bit.
+	RT_DEVICE inline std::uint64_t splitmix64(std::uint64_t& state) {
+
+		std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	RT_DEVICE inline double to_unit_double(std::uint64_t bits) {
+
+		return (bits >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+#ifdef RT_RANDOM_PCG32
+	struct rng {
+		std::uint64_t state;
+		std::uint64_t increment;
+
+		RT_DEVICE void seed(std::uint64_t seed, std::uint64_t stream) {
+
+			state = 0;
+			increment = (stream << 1) | 1u;
+			next();
+			state += seed;
+			next();
+		}
+
+		RT_DEVICE std::uint32_t next() {
+
+			const std::uint64_t old = state;
+			state = old * 6364136223846793005ull + increment;
+			const auto xorshifted = static_cast<std::uint32_t>(((old >> 18) ^ old) >> 27);
+			const auto rot = static_cast<std::uint32_t>(old >> 59);
+			return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+		}
+
+		RT_DEVICE double next_double() {
+
+			const std::uint64_t hi = next();
+			const std::uint64_t lo = next();
+			return to_unit_double((hi << 32) | lo);
+		}
+	};
+#else
+	struct rng {
+		std::uint64_t s[4];
+
+		RT_DEVICE void seed(std::uint64_t seed, std::uint64_t stream) {
+
+			std::uint64_t mix = stream;
+			std::uint64_t sm = seed ^ splitmix64(mix);
+			for (int i = 0; i < 4; ++i) {
+
+				s[i] = splitmix64(sm);
+			}
+		}
+
+		RT_DEVICE static std::uint64_t rotl(std::uint64_t x, int k) {
+
+			return (x << k) | (x >> (64 - k));
+		}
+
+		RT_DEVICE std::uint64_t next() {
+
+			const std::uint64_t result = rotl(s[0] + s[3], 23) + s[0];
+			const std::uint64_t t = s[1] << 17;
+			s[2] ^= s[0];
+			s[3] ^= s[1];
+			s[1] ^= s[2];
+			s[0] ^= s[3];
+			s[2] ^= t;
+			s[3] = rotl(s[3], 45);
+			return result;
+		}
+
+		RT_DEVICE double next_double() {
+
+			return to_unit_double(next());
+		}
+	};
+#endif
+
+#ifdef RT_CLOSED_FORM_SAMPLING
+	// sample_in_hemisphere() of vec3.hpp, term for term.
+	RT_DEVICE inline vec random_in_hemisphere(rng& r, vec normal) {
+
+		double d[5];
+		for (int k = 0; k < 5; ++k) {
+
+			d[k] = r.next_double();
+		}
+
+		const double h = 3.14159265358979323846 * (d[1] - 0.5);
+		const double h2 = h * h;
+		double sin_h = 1.0 / 51090942171709440000.0;
+		double cos_h = 1.0 / 2432902008176640000.0;
+		const double sin_terms[10] = { -1.0 / 121645100408832000.0, 1.0 / 355687428096000.0, -1.0 / 1307674368000.0,
+			1.0 / 6227020800.0, -1.0 / 39916800.0, 1.0 / 362880.0, -1.0 / 5040.0, 1.0 / 120.0, -1.0 / 6.0, 1.0 };
+		const double cos_terms[10] = { -1.0 / 6402373705728000.0, 1.0 / 20922789888000.0, -1.0 / 87178291200.0,
+			1.0 / 479001600.0, -1.0 / 3628800.0, 1.0 / 40320.0, -1.0 / 720.0, 1.0 / 24.0, -1.0 / 2.0, 1.0 };
+		for (int k = 0; k < 10; ++k) {
+
+			sin_h = sin_h * h2 + sin_terms[k];
+			cos_h = cos_h * h2 + cos_terms[k];
+		}
+		sin_h *= h;
+
+		const double z = 1 - 2 * d[0];
+		const double radial = 1 - z * z;
+		const double r_xy = square_root_double(radial > 0.0 ? radial : 0.0);
+		const double s = -2 * sin_h * cos_h;
+		const double c = 2 * sin_h * sin_h - 1;
+		double radius = d[3] > d[4] ? d[3] : d[4];
+		radius = d[2] > radius ? d[2] : radius;
+
+		const vec direction = make(static_cast<real>(r_xy * c), static_cast<real>(r_xy * s), static_cast<real>(z));
+		const vec p = static_cast<real>(radius) * direction;
+		return dot(p, normal) < 0 ? -p : p;
+	}
+#else
+	RT_DEVICE inline vec random_in_hemisphere(rng& r, vec normal) {
+
+		while (true) {
+
+			const auto x = static_cast<real>(-1 + 2 * r.next_double());
+			const auto y = static_cast<real>(-1 + 2 * r.next_double());
+			const auto z = static_cast<real>(-1 + 2 * r.next_double());
+			const vec p = make(x, y, z);
+			if (dot(p, p) >= 1) continue;
+			return dot(p, normal) > 0 ? p : -p;
+		}
+	}
+#endif
+
+	RT_DEVICE inline vec sky(vec direction) {
+
+		const vec unit = (1 / square_root(dot(direction, direction))) * direction;
+		const real t = real(0.5) * (unit.y + 1);
+		return (1 - t) * make(1, 1, 1) + t * make(real(0.5), real(0.7), 1);
+	}
+
+	RT_DEVICE inline bool hit_bounds(const device_node& node, vec origin, vec inv_dir, real t_min, real t_max) {
+
+		const real o[3] = { origin.x, origin.y, origin.z };
+		const real inv[3] = { inv_dir.x, inv_dir.y, inv_dir.z };
+		for (int a = 0; a < 3; ++a) {
+
+			real t0 = (node.lower[a] - o[a]) * inv[a];
+			real t1 = (node.upper[a] - o[a]) * inv[a];
+			if (inv[a] < 0) {
+
+				const real swap = t0;
+				t0 = t1;
+				t1 = swap;
+			}
+
+			t_min = t0 > t_min ? t0 : t_min;
+			t_max = t1 < t_max ? t1 : t_max;
+			if (t_max < t_min) {
+
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Closest sphere along the ray in [t_min, t_max], with the tie rules of sphere_soa::hit_range per leaf.
+	RT_DEVICE inline bool closest_hit(const device_scene& scene, vec origin, vec direction, real t_min, real t_max,
+		real& t_hit, std::uint32_t& sphere) {
+
+		if (scene.node_count == 0) {
+
+			return false;
+		}
+
+		const vec inv_dir = make(1 / direction.x, 1 / direction.y, 1 / direction.z);
+		const bool negative[3] = { inv_dir.x < 0, inv_dir.y < 0, inv_dir.z < 0 };
+		const real a = dot(direction, direction);
+
+		std::uint32_t stack[64];
+		int stack_size = 0;
+		std::uint32_t current = 0;
+		bool hit_anything = false;
+		real closest = t_max;
+
+		while (true) {
+
+			const device_node& node = scene.nodes[current];
+			if (hit_bounds(node, origin, inv_dir, t_min, closest)) {
+
+				if (node.count > 0) {
+
+					bool leaf_hit = false;
+					for (std::uint32_t k = node.offset; k < node.offset + node.count; ++k) {
+
+						const vec oc = origin - make(scene.center[0][k], scene.center[1][k], scene.center[2][k]);
+						const real radius = scene.radius[k];
+						// The cancellation-free form of sphere::hit: r^2 minus the squared distance of the ray to the center.
+						const real half_b = oc.x * direction.x + oc.y * direction.y + oc.z * direction.z;
+						const real mid = half_b / a;
+						const vec closest_offset = oc - mid * direction;
+						const real h = radius * radius - dot(closest_offset, closest_offset);
+						if (!(h >= 0)) {
+
+							continue;
+						}
+
+						const real half_chord = square_root(h / a);
+						const real near_root = (0 - mid) - half_chord;
+						const real far_root = (0 - mid) + half_chord;
+						real root;
+						if (near_root >= t_min && near_root <= closest) root = near_root;
+						else if (far_root >= t_min && far_root <= closest) root = far_root;
+						else continue;
+
+						if (leaf_hit ? root < closest : root <= closest) {
+
+							closest = root;
+							sphere = k;
+							leaf_hit = true;
+							hit_anything = true;
+						}
+					}
+				}
+				else {
+
+					if (negative[node.axis]) {
+
+						stack[stack_size++] = current + 1;
+						current = node.offset;
+					}
+					else {
+
+						stack[stack_size++] = node.offset;
+						current = current + 1;
+					}
+					continue;
+				}
+			}
+
+			if (stack_size == 0) {
+
+				break;
+			}
+			current = stack[--stack_size];
+		}
+
+		t_hit = closest;
+		return hit_anything;
+	}
+}
+
+// Traces all samples of pixel (x, y), framebuffer rows top to bottom, and writes their mean to rgb. Returns the rays cast.
+RT_DEVICE inline std::uint64_t trace_pixel(const device_scene& scene, const device_camera& cam, const device_frame& frame,
+	int x, int y, float* rgb) {
+
+	using namespace device;
+
+	const std::uint64_t pixel_index = static_cast<std::uint64_t>(y) * frame.width + x;
+	const int samples = frame.samples_per_pixel > 0 ? frame.samples_per_pixel : 1;
+
+	// The CPU renderer draws all jitter before the first path, so the path stream starts after it.
+	rng jitter;
+	jitter.seed(frame.seed, pixel_index);
+	rng paths = jitter;
+	for (int k = 0; k < 2 * samples; ++k) {
+
+		paths.next_double();
+	}
+
+	const vec cam_origin = load(cam.origin);
+	const vec lower_left = load(cam.lower_left);
+	const vec horizontal = load(cam.horizontal);
+	const vec vertical = load(cam.vertical);
+	const real epsilon = real(0.001);
+	const real albedo = real(0.5);
+
+	vec sum = make(0, 0, 0);
+	std::uint64_t rays = 0;
+	for (int s = 0; s < samples; ++s) {
+
+		const double jitter_u = jitter.next_double();
+		const double jitter_v = jitter.next_double();
+		const int j = frame.height - 1 - y;
+		const auto u = static_cast<real>((x + jitter_u) / (frame.width - 1));
+		const auto v = static_cast<real>((j + jitter_v) / (frame.height - 1));
+
+		vec origin = cam_origin;
+		vec direction = ((lower_left + u * horizontal) + v * vertical) - cam_origin;
+		vec throughput = make(1, 1, 1);
+		vec radiance = make(0, 0, 0);
+
+		for (int depth = 0; depth < frame.max_depth; ++depth) {
+
+			++rays;
+			real t;
+			std::uint32_t k = 0;
+			if (!closest_hit(scene, origin, direction, epsilon, static_cast<real>(INFINITY), t, k)) {
+
+				radiance = throughput * sky(direction);
+				break;
+			}
+
+			const vec p = origin + t * direction;
+			const vec center = make(scene.center[0][k], scene.center[1][k], scene.center[2][k]);
+			const vec outward = (1 / scene.radius[k]) * (p - center);
+			const vec normal = dot(direction, outward) < 0 ? outward : -outward;
+
+			origin = p;
+			direction = random_in_hemisphere(paths, normal);
+			throughput = albedo * throughput;
+
+			if (depth + 1 >= frame.roulette_depth) {
+
+				real survival = throughput.x > throughput.y ? throughput.x : throughput.y;
+				survival = survival > throughput.z ? survival : throughput.z;
+				survival = survival < real(0.95) ? survival : real(0.95);
+				if (survival <= 0 || paths.next_double() >= survival) {
+
+					break;
+				}
+				throughput = (1 / survival) * throughput;
+			}
+		}
+
+		sum = sum + radiance;
+	}
+
+	const vec mean = (1 / static_cast<real>(samples)) * sum;
+	rgb[0] = static_cast<float>(mean.x);
+	rgb[1] = static_cast<float>(mean.y);
+	rgb[2] = static_cast<float>(mean.z);
+	return rays;
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "accumulation.hpp"
+#include "renderer.hpp"
+
+struct distributed_settings {
+	int port = 0;                // 0 picks a free port
+	int task_samples = 0;        // samples per pixel of one task, 0 = all of them
+	int task_tile_size = 64;     // edge length of a task's tile in pixels
+	double task_timeout = 60;    // seconds a worker may take for one task before it is dropped and the task retried
+	int max_attempts = 3;        // failed runs of a task before the render fails
+	int local_workers = 0;       // workers started in this process, connected over the loopback interface
+	unsigned local_threads = 0;  // render threads of every local worker, 0 = one per hardware thread
+};
+
+/*
+	Distributed rendering over TCP. The coordinator splits the frame into tasks, a tile and a range of samples each,
+	ships the scene as a binary scene file once to every worker that connects, hands out tasks as workers go idle
+	and merges the per-pixel sample sums they send back into an accumulation buffer.
+
+	A task that fails, because its worker disconnected or exceeded the task timeout, goes back to the front of the
+	queue until it has failed max_attempts times. A worker that runs out of queued tasks steals the oldest task
+	in flight that has taken longer than the mean task so far and runs it a second time; the first result wins.
+
+	Tasks are the chunks render_progressive() draws, with task_samples as the pass size, and every tile merges
+	its chunks in sample order however late or out of order they arrive. So the image matches a single-node
+	render with --progressive --pass-spp task_samples bit for bit, the same for any number of workers.
+	Workers have to be builds with the same real type and byte order, which the scene file checks.
+*/
+
+// Renders settings' frame of the scene file in scene_bytes into accumulation, which is reset first.
+// Blocks until every task is merged. Throws std::runtime_error if a task fails max_attempts times.
+render_stats coordinate_render(const render_settings& settings, const distributed_settings& distributed,
+	const std::vector<std::uint8_t>& scene_bytes, accumulation_buffer& accumulation);
+
+// Connects to a coordinator and renders its tasks with thread_count threads until it is told to stop.
+// Returns the number of tasks rendered. Throws std::runtime_error on connection or scene errors.
+std::uint64_t run_worker(const std::string& host, int port, unsigned thread_count);
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "rtweekend.hpp"
+
+// Linear RGB image with interleaved float channels, top row first.
+class framebuffer {
+public:
+	framebuffer() {}
+	framebuffer(int width, int height) {
+
+		resize(width, height);
+	}
+
+	int width() const;
+	int height() const;
+	std::size_t pixel_count() const;
+
+	// Resizes to width x height and clears every pixel to black.
+	void resize(int width, int height);
+
+	color get(int x, int y) const;
+	void set(int x, int y, const color& c);
+
+	float* data();
+	const float* data() const;
+private:
+	int w = 0;
+	int h = 0;
+	std::vector<float> pixels;
+};
+
+// Per-channel differences between two images of the same size, in linear units.
+struct image_difference {
+	double rmse = 0;
+	double max_error = 0;
+	double mean_a = 0;   // mean channel value of each image, to spot a global bias
+	double mean_b = 0;
+};
+
+// Throws std::invalid_argument if the sizes differ.
+image_difference compare_images(const framebuffer& a, const framebuffer& b);
\ No newline at end of file
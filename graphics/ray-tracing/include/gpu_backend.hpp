@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "bvh.hpp"
+#include "camera.hpp"
+#include "device_kernel.hpp"
+#include "framebuffer.hpp"
+#include "renderer.hpp"
+
+enum class render_device {
+	cpu,          // the renderer and its integrators
+	cuda,         // device_kernel.hpp on the first CUDA device, needs a build with RT_ENABLE_CUDA
+	host_kernel   // device_kernel.hpp on the CPU threads, to check the kernel without a GPU
+};
+
+// Throws std::invalid_argument for unknown names; accepts cpu, cuda and host-kernel.
+render_device render_device_from_name(const std::string& name);
+const char* render_device_name(render_device device);
+
+// Whether this build has CUDA support and a device is present.
+bool cuda_available();
+
+// Name of the CUDA device frames are rendered on, or why there is none.
+std::string cuda_device_description();
+
+/*
+	The BVH of a scene flattened into the plain arrays the device kernel reads.
+	Only scenes made of spheres can be rendered on a device, so every leaf has to be a sphere leaf.
+*/
+class device_scene_data {
+public:
+	// Throws std::invalid_argument if the BVH has leaves that are not sphere leaves.
+	explicit device_scene_data(const bvh_node& bvh);
+
+	// Pointers into this object and the BVH's spheres, valid as long as both live.
+	device_scene scene() const;
+	std::size_t sphere_count() const;
+private:
+	const sphere_soa& spheres;
+	std::vector<device_node> nodes;
+};
+
+device_camera make_device_camera(const camera& cam);
+
+// Throws std::invalid_argument for settings the kernel does not implement (adaptive sampling, samplers).
+device_frame make_device_frame(const render_settings& settings);
+
+/*
+	Renders a frame with the device kernel, sized like render() would and free of adaptive sampling.
+	Throws std::runtime_error if the device is not available; cpu is not a device here, use renderer::render().
+*/
+render_stats render_on_device(render_device device, const render_settings& settings, const device_scene_data& scene,
+	const camera& cam, framebuffer& image);
\ No newline at end of file
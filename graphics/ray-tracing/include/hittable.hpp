@@ -1,13 +1,25 @@
 #pragma once
 
+#include <cstdint>
+
+#include "aabb.hpp"
 #include "ray.hpp"
 
+class hittable;
+
 struct hit_record {
 	point3 p;
 	vec3 normal;
-	double t;
+	real t;
 	bool front_face;
 
+	// Set by intersect(): the object that completes the surface data, and which of its primitives was hit.
+	const hittable* object = nullptr;
+	std::uint32_t primitive = 0;
+
+	// Index into the scene's material_table, set by finish_hit().
+	std::uint32_t material = 0;
+
 	inline void set_face_normal(const ray& r, const vec3& outward_normal) {
 
 		// If the dot product is negative (normal points against ray), the ray intersects the sphere from the outside.
@@ -17,7 +29,45 @@ struct hit_record {
 	}
 };
 
+/*
+	Three queries of increasing cost:
+	occluded() only answers whether anything lies in [t_min, t_max] and may return on the first intersection found,
+	intersect() finds the closest hit but records only its distance and who to ask for the rest,
+	and hit() also computes the point and normal, once, for the closest hit.
+	Only hit() and bounding_box() have to be implemented, the other two fall back on it.
+	hit() and intersect() leave the record untouched on a miss, so composites can pass theirs straight down.
+*/
 class hittable {
 public:
-	virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const = 0;
+	virtual ~hittable() = default;
+
+	virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const = 0;
+
+	/*
+		Closest hit without the surface data: sets rec.t, rec.object and rec.primitive, so that
+		rec.object->finish_hit(r, rec) can fill in the rest. The fallback already computes everything in hit().
+	*/
+	virtual bool intersect(const ray& r, real t_min, real t_max, hit_record& rec) const {
+
+		if (!hit(r, t_min, t_max, rec)) {
+
+			return false;
+		}
+
+		rec.object = this;
+		return true;
+	}
+
+	// Completes a record found by intersect() on this object with the point and normal.
+	virtual void finish_hit(const ray&, hit_record&) const {}
+
+	// Any-hit query for shadow rays.
+	virtual bool occluded(const ray& r, real t_min, real t_max) const {
+
+		hit_record rec;
+		return intersect(r, t_min, t_max, rec);
+	}
+
+	// Returns false if the object has no finite bounds.
+	virtual bool bounding_box(aabb& output_box) const = 0;
 };
\ No newline at end of file
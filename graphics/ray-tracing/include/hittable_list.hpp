@@ -1,8 +1,10 @@
 #pragma once
 
+#include "arena.hpp"
 #include "hittable.hpp"
 
 #include <memory>
+#include <utility>
 #include <vector>
 
 using std::shared_ptr;
@@ -11,15 +13,46 @@ using std::make_shared;
 class hittable_list : public hittable {
 public:
 	std::vector<shared_ptr<hittable>> objects;
+private:
+	shared_ptr<scene_arena> storage;
 public:
 	hittable_list() {}
 	hittable_list(shared_ptr<hittable> object) {
 
-		add(object);
+		add(std::move(object));
 	}
 
+	// Objects created with emplace() are placed in the arena instead of getting a heap allocation each.
+	explicit hittable_list(shared_ptr<scene_arena> arena) : storage{ std::move(arena) } {}
+
 	void clear();
+	void reserve(std::size_t count);
 	void add(shared_ptr<hittable> object);
 
-	virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const override;
+	/*
+		Constructs an object in place and adds it. With an arena, every pointer shares the arena's control block
+		(the aliasing constructor of shared_ptr), so the object costs one bump allocation and no control block of its own.
+	*/
+	template <typename T, typename... Args>
+	T& emplace(Args&&... args) {
+
+		if (storage) {
+
+			T* object = storage->create<T>(std::forward<Args>(args)...);
+			objects.emplace_back(storage, object);
+			return *object;
+		}
+
+		auto object = make_shared<T>(std::forward<Args>(args)...);
+		T& result = *object;
+		objects.push_back(std::move(object));
+		return result;
+	}
+
+	const shared_ptr<scene_arena>& arena() const;
+
+	virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const override;
+	virtual bool intersect(const ray& r, real t_min, real t_max, hit_record& rec) const override;
+	virtual bool occluded(const ray& r, real t_min, real t_max) const override;
+	virtual bool bounding_box(aabb& output_box) const override;
 };
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "framebuffer.hpp"
+
+enum class image_format {
+	ppm,   // binary P6, 8 bit gamma-corrected
+	png,   // deflate-compressed, 8 bit gamma-corrected
+	pfm,   // portable float map, linear 32 bit float
+	exr    // OpenEXR scanline image, uncompressed linear 32 bit float
+};
+
+// Picks the format from the file extension. Throws std::invalid_argument for unknown extensions.
+image_format image_format_from_path(const std::string& path);
+
+/*
+	Every image is encoded into one contiguous buffer first and then handed to the stream in a single write,
+	so no per-pixel formatting or stream calls remain in the output path.
+*/
+std::vector<std::uint8_t> encode_image(const framebuffer& image, image_format format);
+
+void write_image(std::ostream& out, const framebuffer& image, image_format format);
+
+// Throws std::runtime_error if the file cannot be written.
+void write_image(const std::string& path, const framebuffer& image);
+void write_image(const std::string& path, const framebuffer& image, image_format format);
+
+// Reads a color PFM of either byte order, e.g. a reference image. Throws std::runtime_error if it cannot.
+framebuffer read_pfm(const std::string& path);
+
+/*
+	Writes an image band by band, for frames too large to hold whole: the header when it is opened,
+	then every band of rows as it is handed over, so only the band in hand has to be in memory.
+	PFM stores the bottom row first, so it takes its bands bottom up, every other format top down; see bottom_up().
+	PNG bands are filtered and compressed as they arrive, with the filter and deflate window carried across bands,
+	each band's data in an IDAT chunk of its own. Throws std::runtime_error if the stream fails.
+*/
+class image_stream {
+public:
+	image_stream(std::ostream& out, int width, int height, image_format format);
+	~image_stream();
+
+	image_stream(const image_stream&) = delete;
+	image_stream& operator=(const image_stream&) = delete;
+
+	int width() const;
+	int height() const;
+	bool bottom_up() const;
+
+	// The next band in the stream's row order, its rows top row first. Throws std::invalid_argument if it does not fit.
+	void write(const framebuffer& band);
+
+	// Ends the file. Throws std::logic_error if rows are missing.
+	void finish();
+private:
+	struct png_state;
+
+	void put(const std::vector<std::uint8_t>& bytes);
+private:
+	std::ostream& out;
+	int w;
+	int h;
+	image_format format;
+	int rows_written = 0;
+	std::unique_ptr<png_state> png;
+};
\ No newline at end of file
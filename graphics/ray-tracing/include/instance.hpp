@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "hittable.hpp"
+#include "transform.hpp"
+
+/*
+	A copy of a shared prototype, typically a bvh_node over the spheres of an asset, placed by an affine transform.
+	Rays are mapped into object space once per instance and traced through the prototype's own structure,
+	so a thousand copies cost a thousand transforms and boxes, not a thousand copies of the geometry.
+	A bvh_node over instances makes a two-level structure: a top level over the instance boxes and the bottom
+	levels of the prototypes. Moving instances only changes their boxes, so bvh_node::refit() of the top level
+	is enough to follow them; the prototypes stay as they were built.
+
+	The direction is not renormalized in object space, so hit distances are the same in both spaces.
+	intersect() completes the hit on the prototype, in object space, and finish_hit() only maps the point
+	and normal to world space, once, for the closest hit.
+*/
+class instance : public hittable {
+public:
+	// Throws std::invalid_argument if the prototype has no bounds or the transform is singular.
+	instance(std::shared_ptr<const hittable> prototype, const affine_transform& object_to_world);
+
+	// Not while rendering. Refit or rebuild the structures above afterwards. Throws like the constructor.
+	void set_transform(const affine_transform& object_to_world);
+
+	const affine_transform& transform() const;
+	const std::shared_ptr<const hittable>& prototype() const;
+
+	// The material of every hit on this copy, whatever the prototype's primitives carry.
+	void set_material(std::uint32_t material);
+	std::uint32_t material() const;
+
+	virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const override;
+	virtual bool intersect(const ray& r, real t_min, real t_max, hit_record& rec) const override;
+	virtual void finish_hit(const ray& r, hit_record& rec) const override;
+	virtual bool occluded(const ray& r, real t_min, real t_max) const override;
+	virtual bool bounding_box(aabb& output_box) const override;
+private:
+	ray to_object_space(const ray& r) const;
+private:
+	std::shared_ptr<const hittable> shape;
+	aabb object_box;
+	affine_transform to_world;
+	affine_transform to_object;
+	aabb world_box;
+	std::uint32_t material_id = 0;
+};
\ No newline at end of file
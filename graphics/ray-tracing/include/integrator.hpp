@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "rtweekend.hpp"
+
+#include "hittable.hpp"
+#include "material.hpp"
+#include "sampler.hpp"
+
+class light_list;
+
+// Offset that keeps bounce rays from hitting the surface they start on.
+const real surface_epsilon = real(0.001);
+
+// Fraction of light a surface reflects when the render has no material table.
+const real surface_albedo = real(0.5);
+
+/*
+	Per-sample state threaded through an integrator: the pixel's random stream and a count of the rays it cast.
+	With a sampler, the random decisions along a path take its dimensions in order instead of drawing from the stream.
+	With a material table, surfaces respond as the material of their hit says; without one, every surface
+	is a gray diffuse one that reflects surface_albedo. The light list is what next-event estimation samples.
+*/
+struct sample_context {
+	random_engine& rng;
+	std::uint64_t rays = 0;
+	const sampler* pattern = nullptr;
+	const material_table* materials = nullptr;
+	const light_list* lights = nullptr;
+	int x = 0;
+	int y = 0;
+	std::uint32_t index = 0;       // sample number within the pixel
+	std::uint32_t dimension = 0;   // next dimension of the pattern
+
+	explicit sample_context(random_engine& engine) : rng{ engine } {}
+	sample_context(random_engine& engine, const sampler* samples, int pixel_x, int pixel_y) :
+		rng{ engine }, pattern{ samples }, x{ pixel_x }, y{ pixel_y } {}
+
+	// Starts sample number sample of the pixel, whose first camera_dimensions went to the camera ray.
+	void start_sample(std::uint32_t sample, std::uint32_t camera_dimensions = 2) {
+
+		index = sample;
+		dimension = camera_dimensions;
+	}
+
+	double next_1d() {
+
+		if (!pattern) {
+
+			return rng.next_double();
+		}
+		return pattern->get_1d(x, y, index, dimension++);
+	}
+
+	void next_2d(double& u, double& v) {
+
+		if (!pattern) {
+
+			u = rng.next_double();
+			v = rng.next_double();
+			return;
+		}
+		pattern->get_2d(x, y, index, dimension, u, v);
+		dimension += 2;
+	}
+};
+
+// Direction of a diffuse bounce off a surface with the given normal: rejection sampled from the stream without a sampler,
+// mapped directly from the next two dimensions with one. Both are uniform over the hemisphere.
+vec3 sample_bounce(sample_context& ctx, const vec3& normal);
+
+// Computes the light arriving at the camera along a ray. Implementations must be safe to call from many threads at once.
+class integrator {
+public:
+	virtual ~integrator() = default;
+
+	virtual color li(const ray& r, const hittable& world, sample_context& ctx) const = 0;
+};
+
+// Background light: a vertical gradient from white at the horizon to light blue at the zenith.
+color sky_color(const ray& r);
+
+// The original depth-first recursion, one call per bounce up to max_depth.
+class recursive_integrator : public integrator {
+public:
+	explicit recursive_integrator(int max_depth) : depth_limit{ max_depth } {}
+
+	virtual color li(const ray& r, const hittable& world, sample_context& ctx) const override;
+private:
+	color trace(const ray& r, const hittable& world, int depth, sample_context& ctx) const;
+private:
+	int depth_limit;
+};
+
+/*
+	Iterative path tracer. The product of all surface attenuations along the path so far is carried as an explicit throughput,
+	and from rr_min_depth on, a path only survives with a probability equal to its throughput (at most 0.95).
+	Survivors are reweighted by the inverse of that probability, so the estimate stays unbiased
+	while paths that could only add very little light are cut short.
+*/
+class path_integrator : public integrator {
+public:
+	path_integrator(int max_depth, int rr_min_depth) : depth_limit{ max_depth }, roulette_depth{ rr_min_depth } {}
+
+	virtual color li(const ray& r, const hittable& world, sample_context& ctx) const override;
+private:
+	int depth_limit;
+	int roulette_depth;
+};
+
+/*
+	path_integrator with next-event estimation. At every diffuse hit, a direction toward one of the lights of the sample
+	context is drawn (see lights.hpp) and traced as a shadow ray with the any-hit query, so a small light is found
+	on every bounce instead of only by the rare bounce that hits it. Light found either way is weighted by multiple
+	importance sampling with the power heuristic, which keeps the estimate unbiased and takes each light
+	from the strategy that finds it with the higher density.
+	Without a material table or lights in the sample context, it traces exactly what path_integrator traces.
+*/
+class nee_integrator : public integrator {
+public:
+	nee_integrator(int max_depth, int rr_min_depth) : plain{ max_depth, rr_min_depth }, depth_limit{ max_depth },
+		roulette_depth{ rr_min_depth } {}
+
+	virtual color li(const ray& r, const hittable& world, sample_context& ctx) const override;
+private:
+	path_integrator plain;
+	int depth_limit;
+	int roulette_depth;
+};
+
+enum class integrator_type {
+	path,
+	recursive,
+	nee
+};
+
+// Throws std::invalid_argument for unknown names.
+integrator_type integrator_type_from_name(const std::string& name);
+
+const char* integrator_type_name(integrator_type type);
+
+std::unique_ptr<integrator> make_integrator(integrator_type type, int max_depth, int rr_min_depth);
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Just enough JSON for authoring scenes: a parsed document as a tree of values.
+class json_value {
+public:
+	enum class kind { null, boolean, number, string, array, object };
+public:
+	json_value() {}
+
+	kind type() const { return value_kind; }
+	bool is_null() const { return value_kind == kind::null; }
+
+	// Typed access throws std::runtime_error when the value has another type.
+	bool as_bool() const;
+	double as_number() const;
+	const std::string& as_string() const;
+	const std::vector<json_value>& as_array() const;
+
+	// Object members in document order. find() returns nullptr for missing keys.
+	const std::vector<std::pair<std::string, json_value>>& members() const;
+	const json_value* find(const std::string& key) const;
+private:
+	friend class json_parser;
+
+	kind value_kind = kind::null;
+	bool boolean = false;
+	double number = 0;
+	std::string text;
+	std::vector<json_value> elements;
+	std::vector<std::pair<std::string, json_value>> fields;
+};
+
+// Throws std::runtime_error with the byte offset of the first syntax error.
+json_value parse_json(const std::string& document);
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rtweekend.hpp"
+
+#include "hittable.hpp"
+#include "integrator.hpp"
+#include "sampler.hpp"
+
+/*
+	Integrators compiled for one fixed configuration. The generic integrators take the depth limit as a member,
+	ask the sample context on every bounce whether a sampler is set, and reach the scene and the sampler through
+	virtual calls. A specialized kernel has the depth limit, the concrete sampler and the concrete type of the world
+	as template arguments instead: the bounce loop has a constant trip count (the recursive integrator becomes a chain
+	of inlinable calls), the unused sampling branch is gone and hit() is called directly on the BVH, store or list.
+
+	The scalar type is a build option (RT_USE_FLOAT), so every build carries the kernels of its own precision.
+	Kernels trace exactly what the generic integrators trace, so images are identical either way; with a material table,
+	lambertian hits are shaded inline and the other materials through scatter().
+*/
+
+// The concrete world types kernels are compiled for; any other world is reached through hittable.
+enum class primitive_set {
+	any,
+	bvh,     // bvh_node
+	store,   // primitive_store
+	list     // hittable_list
+};
+
+primitive_set primitive_set_of(const hittable& world);
+
+// The configuration a kernel is selected by.
+struct kernel_key {
+	integrator_type integrator = integrator_type::path;
+	int max_depth = 50;
+	sampler_type sampler = sampler_type::independent;
+	primitive_set primitives = primitive_set::any;
+};
+
+// The depth limits kernels are instantiated for; other limits run on the generic integrators.
+const std::vector<int>& specialized_depths();
+
+bool has_specialized_kernel(const kernel_key& key);
+
+// E.g. "path<50, sobol, bvh, double>".
+std::string kernel_name(const kernel_key& key);
+
+/*
+	The kernel matching key, bound to world and to the sampler the renderer passes in its sample contexts
+	(nullptr for independent sampling), or nullptr if there is none for the key.
+	Called with any other world or sampler, the kernel hands the path to a generic integrator.
+*/
+std::unique_ptr<integrator> make_specialized_integrator(const kernel_key& key, int rr_min_depth, const hittable& world,
+	const sampler* pattern);
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "rtweekend.hpp"
+
+#include "hittable_list.hpp"
+#include "material.hpp"
+#include "sphere_soa.hpp"
+
+// An emissive sphere, in world space.
+struct sphere_light {
+	point3 center;
+	real radius;
+	std::uint32_t material;
+	color radiance;   // emitted(), the same in every direction
+};
+
+// A direction toward a light, drawn by light_list::sample().
+struct light_sample {
+	vec3 direction;      // unit length
+	real distance;       // to the light's surface along direction, where the shadow ray ends
+	real pdf;            // per steradian, including the choice of the light
+	color radiance;
+};
+
+/*
+	The emissive spheres of a scene, for next-event estimation: a light is chosen with a probability proportional
+	to its power, then a direction toward it uniformly over the cone of directions its sphere covers, the solid angle
+	it subtends as seen from the shading point. Emitters inside instances are not listed; they are only found
+	by the paths that happen to hit them.
+*/
+class light_list {
+public:
+	light_list() {}
+
+	// The spheres of world whose material is emissive.
+	light_list(const hittable_list& world, const material_table& materials);
+
+	// The same for a sphere array with its material ids, e.g. the spheres of a mapped scene.
+	light_list(const sphere_soa& spheres, const material_table& materials);
+
+	std::size_t size() const;
+	bool empty() const;
+	const sphere_light& light(std::size_t index) const;
+
+	/*
+		A direction from p toward one of the lights, from three uniforms: u picks the light, v and w the direction.
+		Returns false if the chosen light surrounds p or cannot be reached from it.
+	*/
+	bool sample(const point3& p, double u, double v, double w, light_sample& result) const;
+
+	// Density per steradian with which sample() picks a direction from p that reaches light index first.
+	real pdf(std::size_t index, const point3& p) const;
+
+	// The light whose surface contains the hit point on one of its spheres, or size() if there is none.
+	std::size_t find(const point3& hit_point, std::uint32_t material) const;
+private:
+	void add(const point3& center, real radius, std::uint32_t material, const material_record& m);
+	void finish();
+private:
+	std::vector<sphere_light> lights;
+	std::vector<double> cdf;   // the running sum of the choice probabilities, last entry 1
+};
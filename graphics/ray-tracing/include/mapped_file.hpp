@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file. Pages are loaded by the OS on first touch, nothing is copied up front.
+class mapped_file {
+public:
+	// Throws std::runtime_error if the file cannot be opened or mapped.
+	explicit mapped_file(const std::string& path);
+	~mapped_file();
+
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+
+	const std::uint8_t* data() const;
+	std::size_t size() const;
+private:
+	const std::uint8_t* bytes = nullptr;
+	std::size_t length = 0;
+#ifdef _WIN32
+	void* file_handle = nullptr;
+	void* mapping_handle = nullptr;
+#endif
+};
\ No newline at end of file
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "rtweekend.hpp"
+
+struct hit_record;
+struct sample_context;
+
+// Surface kinds a scene can describe.
+enum class material_type : std::uint32_t {
+	lambertian,
+	metal,
+	dielectric,
+	emissive
+};
+
+// Fixed-size material description, which is also its layout in scene files.
+struct material_record {
+	material_type type = material_type::lambertian;
+	float albedo[3] = { 0.5f, 0.5f, 0.5f };   // emissive: the emitted color
+	float parameter = 0;   // metal: fuzz, dielectric: index of refraction, emissive: intensity
+};
+
+/*
+	The materials of a scene in one flat array, indexed by the 32-bit hit_record::material of a hit,
+	so shading a hit is one indexed load instead of a pointer to a material object and a virtual call.
+	Ids past the end read as the default material, a gray diffuse surface.
+*/
+class material_table {
+public:
+	material_table() {}
+	explicit material_table(std::vector<material_record> records);
+
+	const material_record& get(std::uint32_t id) const {
+
+		return id < records.size() ? records[id] : fallback;
+	}
+
+	std::size_t size() const;
+	bool empty() const;
+private:
+	std::vector<material_record> records;
+	material_record fallback;
+};
+
+inline color material_albedo(const material_record& m) {
+
+	return color(m.albedo[0], m.albedo[1], m.albedo[2]);
+}
+
+/*
+	sample_bounce() draws diffuse bounces uniformly over the hemisphere and weights them by the albedo alone,
+	the estimator of a surface that reflects albedo / 2 pi per steradian toward every direction of the hemisphere.
+	Next-event estimation weighs the light it samples directly with that response and that density.
+*/
+const real diffuse_pdf = static_cast<real>(1 / (2 * pi));
+
+inline color diffuse_response(const material_record& m) {
+
+	return diffuse_pdf * material_albedo(m);
+}
+
+// Radiance the surface emits itself, black but for emissive materials.
+color emitted(const material_record& m);
+
+/*
+	The direction a ray leaves a metal or dielectric surface in without its random part: the mirror direction,
+	and for a dielectric the refraction unless reflection is the likelier or only way. False for other materials.
+	Denoiser guides follow it to see the surfaces behind mirrors and glass.
+*/
+bool specular_direction(const material_record& m, const ray& r_in, const hit_record& rec, vec3& direction);
+
+/*
+	The ray leaving a hit of r_in and the fraction of light it carries, with the random decisions drawn
+	from the sample context. Returns false if the surface absorbs the ray.
+	A lambertian surface takes the same bounce as the integrators without materials (sample_bounce) scaled by its albedo,
+	so the path integrator renders a table of 0.5 gray lambertians exactly as it renders a scene without one.
+*/
+bool scatter(const material_record& m, const ray& r_in, const hit_record& rec, sample_context& ctx,
+	ray& scattered, color& attenuation);
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A connected TCP socket. Move-only; the socket closes with the object.
+class tcp_connection {
+public:
+	tcp_connection() {}
+	~tcp_connection();
+
+	tcp_connection(tcp_connection&& other) noexcept;
+	tcp_connection& operator=(tcp_connection&& other) noexcept;
+	tcp_connection(const tcp_connection&) = delete;
+	tcp_connection& operator=(const tcp_connection&) = delete;
+
+	// Throws std::runtime_error if the host does not resolve or nobody listens on the port.
+	static tcp_connection connect(const std::string& host, int port);
+
+	bool is_open() const;
+	void close();
+
+	// Seconds a receive may wait for data before it fails, 0 = forever.
+	void set_timeout(double seconds);
+
+	// Waits up to timeout seconds for data or the peer closing. Returns false if neither happened.
+	bool wait_readable(double timeout);
+
+	// Both throw std::runtime_error once the connection fails, closes or, for receive_all, times out.
+	void send_all(const void* data, std::size_t size);
+	void receive_all(void* data, std::size_t size);
+private:
+	explicit tcp_connection(std::intptr_t socket);
+	friend class tcp_listener;
+private:
+	std::intptr_t handle = -1;
+};
+
+// A listening TCP socket on all interfaces.
+class tcp_listener {
+public:
+	// Port 0 picks a free port. Throws std::runtime_error if the port cannot be bound.
+	explicit tcp_listener(int port);
+	~tcp_listener();
+
+	tcp_listener(const tcp_listener&) = delete;
+	tcp_listener& operator=(const tcp_listener&) = delete;
+
+	int port() const;
+
+	// Waits up to timeout seconds for the next connection. Returns false if none arrived.
+	bool accept(tcp_connection& connection, double timeout);
+private:
+	std::intptr_t handle = -1;
+	int bound_port = 0;
+};
+
+/*
+	Messages on a connection are a 32 bit type and a 64 bit payload length, little endian, followed by the payload.
+	Both throw std::runtime_error on connection errors; receive_message() also on lengths above max_payload,
+	before allocating anything, and grows the payload as it arrives rather than by the announced length.
+	The default fits control messages, larger ones like scenes have to ask for their size.
+*/
+struct net_message {
+	std::uint32_t type = 0;
+	std::vector<std::uint8_t> payload;
+};
+
+void send_message(tcp_connection& connection, std::uint32_t type, const std::vector<std::uint8_t>& payload);
+const std::uint64_t default_max_payload = std::uint64_t(1) << 16;
+
+net_message receive_message(tcp_connection& connection, std::uint64_t max_payload = default_max_payload);
+
+// Little endian encoding of message payloads.
+class byte_writer {
+public:
+	void put_u32(std::uint32_t v);
+	void put_u64(std::uint64_t v);
+	void put_f32(float v);
+	void put_f64(double v);
+	void put_string(const std::string& s);
+	void put_bytes(const void* data, std::size_t size);
+
+	std::vector<std::uint8_t>& bytes();
+private:
+	std::vector<std::uint8_t> out;
+};
+
+// Reads what byte_writer wrote. Throws std::runtime_error when reading past the end.
+class byte_reader {
+public:
+	explicit byte_reader(const std::vector<std::uint8_t>& bytes);
+
+	std::uint32_t get_u32();
+	std::uint64_t get_u64();
+	float get_f32();
+	double get_f64();
+	std::string get_string();
+	const std::uint8_t* get_bytes(std::size_t size);
+
+	std::size_t remaining() const;
+private:
+	const std::vector<std::uint8_t>& in;
+	std::size_t position = 0;
+};
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+
+#include "animation.hpp"
+#include "camera.hpp"
+#include "denoiser.hpp"
+#include "distributed.hpp"
+#include "gpu_backend.hpp"
+#include "render_service.hpp"
+#include "renderer.hpp"
+
+// Camera placement from the command line, replacing the scene's where set.
+struct camera_overrides {
+	bool set_lookfrom = false;
+	point3 lookfrom;
+	bool set_lookat = false;
+	point3 lookat;
+	real vfov = 0;              // 0 = the scene's
+	real aperture = -1;         // negative = the scene's
+	real focus_distance = -1;
+
+	bool any() const;
+	void apply(camera_settings& view) const;
+};
+
+struct options {
+	render_settings settings;
+	std::string scene = "basic";   // one of scene_names() or a scene file
+	std::string export_path;       // write the scene as a binary scene file instead of rendering
+	std::string output_path;   // empty writes a binary PPM to stdout
+	int image_width = 400;
+	int image_height = 0;      // 0 = 16:9 of the width
+	bool stream = false;       // write bands of tiles as they finish instead of holding the whole frame
+	int stream_bands = 0;      // bands of tiles the stream may hold, 0 = enough for twice the threads
+	std::string heatmap_path;  // empty skips the samples-per-pixel heatmap
+	std::string aov_path;      // non-empty: also write the albedo, normal and depth AOVs, see aov_file_path()
+	denoise_settings denoising;
+	render_device device = render_device::cpu;
+	double verify_rmse = -1;   // device renders: also render on the cpu and fail above this RMSE, negative = off
+	bool progressive = false;
+	progressive_settings progression;
+	std::string checkpoint_path;   // progressive: saved with every snapshot and at the end
+	std::string resume_path;       // progressive: checkpoint to continue from
+	bool coordinator = false;      // hand the frame out to workers instead of rendering it here
+	distributed_settings distribution;
+	std::string worker_host;       // non-empty: render tasks for the coordinator there and exit
+	int worker_port = 0;
+	bool serve = false;            // run the render service until interrupted, see render_service.hpp
+	service_settings service;
+	std::string submit_host;       // non-empty: render the frame on the service there
+	int submit_port = 0;
+	tile region{ 0, 0, 0, 0 };     // --submit: the part of the frame to render, empty = all of it
+	camera_overrides view;
+	animation_settings animation;  // more than one frame: output_path names the frames, see frame_path()
+	bool use_bvh = true;
+	int bvh_leaf_size = 4;
+	bool bvh_stats = false;
+	std::string profile_path;      // non-empty: print the profile counters and write the timeline there (RT_PROFILE builds)
+	bool show_help = false;
+};
+
+// The file of one frame of a sequence: a run of '#' in path becomes the zero-padded frame number,
+// otherwise _0000, _0001 and so on go before the extension.
+std::string frame_path(const std::string& path, int frame);
+
+// The file of one AOV: _albedo, _normal or _depth goes before the extension of path.
+std::string aov_file_path(const std::string& path, const std::string& aov);
+
+// Parses the command line. Throws std::invalid_argument on unknown or malformed options.
+options parse_options(int argc, char* argv[]);
+
+std::string usage(const char* program);
\ No newline at end of file
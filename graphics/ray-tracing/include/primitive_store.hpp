@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "hittable.hpp"
+#include "hittable_list.hpp"
+#include "sphere_soa.hpp"
+
+// The closed set of primitive types the store keeps in arrays of their own.
+enum class primitive_type : std::uint32_t {
+	sphere,
+	custom   // any other hittable, reached through its virtual interface
+};
+
+// Tagged handle of one primitive: which per-type array it lives in and where.
+struct primitive_ref {
+	primitive_type type;
+	std::uint32_t index;
+};
+
+/*
+	Primitives grouped by type into contiguous arrays instead of one list of shared_ptr<hittable>.
+	A ray is intersected type by type: all spheres in one pass of the packed sphere kernel,
+	without a virtual call, a pointer to chase or a reference count to touch per sphere,
+	then whatever custom hittables were added, so the virtual interface stays open for extension.
+	The refs keep the insertion order for callers that need to address single primitives.
+*/
+class primitive_store : public hittable {
+public:
+	primitive_store() {}
+
+	// Spheres of the list are copied into the sphere array, everything else is kept as a custom primitive.
+	explicit primitive_store(const hittable_list& list);
+
+	void reserve(std::size_t count);
+	void clear();
+	void add(const point3& center, real radius, std::uint32_t material = 0);
+	void add(shared_ptr<hittable> object);
+
+	std::size_t size() const;
+	primitive_ref ref(std::size_t index) const;
+	const sphere_soa& spheres() const;
+	const std::vector<shared_ptr<hittable>>& custom() const;
+
+	// Intersects a single primitive, dispatched on its tag.
+	bool hit_primitive(primitive_ref p, const ray& r, real t_min, real t_max, hit_record& rec) const;
+
+	virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const override;
+	virtual bool intersect(const ray& r, real t_min, real t_max, hit_record& rec) const override;
+	virtual bool occluded(const ray& r, real t_min, real t_max) const override;
+	virtual bool bounding_box(aabb& output_box) const override;
+private:
+	std::vector<primitive_ref> refs;
+	sphere_soa sphere_array;
+	std::vector<shared_ptr<hittable>> custom_array;
+};
\ No newline at end of file
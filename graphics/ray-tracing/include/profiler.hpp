@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+
+/*
+	Hot-path instrumentation. Built with RT_PROFILE defined, every render thread counts into a block of its own,
+	so the counters are plain adds without atomics or sharing, and the blocks are only summed at the end of a frame.
+	Without RT_PROFILE the macros below expand to nothing and the hot paths are the same code as before.
+
+	Stages are timed with steady_clock, a few tens of nanoseconds per scope. Short stages such as a single
+	intersection are only summed up per thread; spans (frames, passes, tiles and the batched wavefront stages)
+	are also recorded on a per-thread timeline that write_chrome_trace() exports.
+*/
+
+enum class profile_stage : int {
+	frame,       // one render() or render_progressive() call
+	pass,        // one progressive pass
+	tile,        // one tile of a pass or frame
+	camera,      // camera ray generation
+	intersect,   // closest-hit queries of the integrators and the wavefront intersection stage
+	shade,       // surface response and the next bounce
+	compact,     // wavefront: dropping terminated paths
+	count
+};
+
+const char* profile_stage_name(profile_stage stage);
+
+// Paths are counted by the rays they traced, up to this many; the last bucket holds the longer ones.
+static const int profile_max_path_length = 64;
+
+struct profile_counters {
+	std::uint64_t rays = 0;                  // closest-hit queries traced by the integrators
+	std::uint64_t paths = 0;
+	std::uint64_t shadow_rays = 0;           // any-hit BVH traversals
+	std::uint64_t bvh_nodes = 0;             // nodes visited by every BVH traversal
+	std::uint64_t sphere_tests = 0;          // sphere objects, through their virtual interface
+	std::uint64_t packed_sphere_tests = 0;   // spheres in the ranges the packed sphere kernel searched
+	std::uint64_t custom_tests = 0;          // custom primitives of a primitive_store
+	std::uint64_t path_length[profile_max_path_length + 1] = {};
+	std::uint64_t stage_ns[static_cast<int>(profile_stage::count)] = {};
+	std::uint64_t stage_calls[static_cast<int>(profile_stage::count)] = {};
+
+	void merge(const profile_counters& other);
+};
+
+// Whether this build counts anything, i.e. was compiled with RT_PROFILE.
+bool profiling_compiled_in();
+
+// The calling thread's counters, registered the first time a thread asks.
+profile_counters& profile_thread_counters();
+
+// Nanoseconds since the first use of the profiler, the time base of the timeline.
+std::uint64_t profile_clock();
+
+// Adds count paths of length rays each.
+void profile_paths(std::uint64_t length, std::uint64_t count);
+
+// Adds the time since start to a stage, and to the calling thread's timeline if it is a span.
+void profile_record(profile_stage stage, std::uint64_t start, bool span);
+
+// Clears the counters and timelines of every thread. Only call it while no thread is rendering.
+void profile_reset();
+
+// Sum of every thread's counters so far. Only call it while no thread is rendering.
+profile_counters profile_totals();
+
+// Counters per ray and per path, the path length histogram and the thread time of every stage.
+void write_profile_summary(std::ostream& out, const profile_counters& totals);
+
+/*
+	The spans of every thread since the last reset in the Chrome trace event format, a JSON array of complete events
+	with one track per thread. chrome://tracing and Perfetto open it directly, Tracy through its import-chrome tool.
+	Throws std::runtime_error if the file cannot be written.
+*/
+void write_chrome_trace(const std::string& path);
+
+// Times the enclosing scope into a stage.
+class profile_scope {
+public:
+	profile_scope(profile_stage stage, bool span) : stage{ stage }, span{ span }, start{ profile_clock() } {}
+	~profile_scope() { profile_record(stage, start, span); }
+
+	profile_scope(const profile_scope&) = delete;
+	profile_scope& operator=(const profile_scope&) = delete;
+private:
+	profile_stage stage;
+	bool span;
+	std::uint64_t start;
+};
+
+#ifdef RT_PROFILE
+#define RT_PROFILE_JOIN_(a, b) a##b
+#define RT_PROFILE_SCOPE_NAME_(line) RT_PROFILE_JOIN_(profile_scope_, line)
+#define RT_PROFILE_STAGE(stage) profile_scope RT_PROFILE_SCOPE_NAME_(__LINE__)(stage, false)
+#define RT_PROFILE_SPAN(stage) profile_scope RT_PROFILE_SCOPE_NAME_(__LINE__)(stage, true)
+#define RT_PROFILE_ADD(counter, n) (profile_thread_counters().counter += (n))
+#define RT_PROFILE_PATHS(length, count) profile_paths((length), (count))
+#else
+// The arguments stay in an unevaluated sizeof, so values computed only for the profile do not warn as unused.
+#define RT_PROFILE_STAGE(stage) ((void)0)
+#define RT_PROFILE_SPAN(stage) ((void)0)
+#define RT_PROFILE_ADD(counter, n) ((void)sizeof(n))
+#define RT_PROFILE_PATHS(length, count) ((void)sizeof((length), (count)))
+#endif
+
+/*
+	A progress line on stderr, rewritten in place at most once per interval, however often threads report.
+	Threads that find another one writing skip their update instead of waiting for it.
+*/
+class progress_reporter {
+public:
+	explicit progress_reporter(bool enabled, double interval = 0.25);
+
+	// Writes "label: value" or, with a total, "label: value/total". The final update is always written.
+	void update(const char* label, std::uint64_t value, std::uint64_t total = 0, bool final = false);
+private:
+	bool enabled;
+	std::int64_t interval_ns;
+	std::atomic<std::int64_t> next_ns{ 0 };
+	std::mutex output;
+};
\ No newline at end of file
@@ -1,6 +1,120 @@
 #pragma once
 
-#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
 
-double random_double();
-double random_double(double min, double max);
\ No newline at end of file
+/*
+	Random engines are small value types owned by whoever draws from them, so there is no shared state to lock.
+	An engine is constructed from a (seed, stream) pair; the renderer uses the frame seed and the pixel index,
+	which makes every pixel reproducible on its own no matter which thread, tile or node renders it.
+*/
+
+// SplitMix64 step, used to expand a seed into engine state and to hash seeds together.
+inline std::uint64_t splitmix64(std::uint64_t& state) {
+
+	std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+// Maps the top 53 bits of a 64-bit value to a real in [0,1).
+inline double to_unit_double(std::uint64_t bits) {
+
+	return (bits >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// xoshiro256++ by Blackman and Vigna: 256 bits of state, period 2^256 - 1, a handful of adds, xors and rotates per draw.
+class xoshiro256pp {
+public:
+	using result_type = std::uint64_t;
+public:
+	explicit xoshiro256pp(std::uint64_t seed = 0, std::uint64_t stream = 0);
+
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return ~result_type(0); }
+
+	inline result_type operator()() {
+
+		const std::uint64_t result = rotl(s[0] + s[3], 23) + s[0];
+		const std::uint64_t t = s[1] << 17;
+
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = rotl(s[3], 45);
+
+		return result;
+	}
+
+	inline double next_double() {
+
+		return to_unit_double((*this)());
+	}
+
+	void fill(double* out, std::size_t count);
+private:
+	static inline std::uint64_t rotl(std::uint64_t x, int k) {
+
+		return (x << k) | (x >> (64 - k));
+	}
+private:
+	std::uint64_t s[4];
+};
+
+// PCG32 (XSH-RR) by O'Neill: 64 bits of state, 32-bit output. Two draws make up one double.
+class pcg32 {
+public:
+	using result_type = std::uint32_t;
+public:
+	explicit pcg32(std::uint64_t seed = 0, std::uint64_t stream = 0);
+
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return ~result_type(0); }
+
+	inline result_type operator()() {
+
+		const std::uint64_t old = state;
+		state = old * 6364136223846793005ull + increment;
+
+		const auto xorshifted = static_cast<std::uint32_t>(((old >> 18) ^ old) >> 27);
+		const auto rot = static_cast<std::uint32_t>(old >> 59);
+		return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+	}
+
+	inline double next_double() {
+
+		const std::uint64_t hi = (*this)();
+		const std::uint64_t lo = (*this)();
+		return to_unit_double((hi << 32) | lo);
+	}
+
+	void fill(double* out, std::size_t count);
+private:
+	std::uint64_t state;
+	std::uint64_t increment;
+};
+
+// The engine every sampling routine is written against. Define RT_RANDOM_PCG32 to switch the whole renderer over.
+#ifdef RT_RANDOM_PCG32
+using random_engine = pcg32;
+#else
+using random_engine = xoshiro256pp;
+#endif
+
+inline double random_double(random_engine& rng) {
+
+	// Returns a random real in [0,1).
+	return rng.next_double();
+}
+
+inline double random_double(random_engine& rng, double min, double max) {
+
+	// Returns a random real in [min,max).
+	return min + (max - min) * rng.next_double();
+}
+
+// Fills out[0..count) with reals in [min,max).
+void random_fill(random_engine& rng, double* out, std::size_t count, double min = 0.0, double max = 1.0);
\ No newline at end of file
@@ -10,10 +10,13 @@ public:
 		dir{ direction }
 	{}
 
-	point3 origin() const;
-	vec3 direction() const;
+	point3 origin() const { return orig; }
+	vec3 direction() const { return dir; }
 
-	point3 at(double t) const;
+	point3 at(real t) const {
+
+		return orig + t * dir;
+	}
 public:
 	point3 orig;
 	vec3 dir;
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "camera.hpp"
+#include "net.hpp"
+#include "renderer.hpp"
+#include "sha256.hpp"
+
+struct service_settings {
+	int port = 0;                 // 0 picks a free port
+	std::size_t cache_scenes = 8; // scenes kept loaded, the least recently used one is evicted first
+	unsigned thread_count = 0;    // threads of the pool all jobs share, 0 = one per hardware thread
+	double idle_timeout = 300;    // seconds a client may stay silent between jobs before it is dropped
+	std::uint64_t max_scene_bytes = std::uint64_t(512) << 20;   // larger scene files are refused
+	std::size_t max_clients = 64; // connections served at once, further ones are turned away
+};
+
+/*
+	One render job: the scene by the SHA-256 digest of its scene file, the camera and the render settings.
+	The region is the part of the frame to render, in framebuffer coordinates; an empty one is the whole frame.
+	The camera's aspect ratio is replaced by the resolution's.
+*/
+struct render_job {
+	sha256_digest scene_digest{};
+	camera_settings camera;
+	render_settings settings;   // thread_count and show_progress are the service's
+	tile region{ 0, 0, 0, 0 };
+	int band_rows = 0;          // rows per result message, 0 = one per pool thread and at least 8
+};
+
+// Totals of one job as the service reports them.
+struct job_stats {
+	std::uint64_t samples = 0;
+	std::uint64_t rays = 0;
+	double seconds = 0;        // on the service, from the job's arrival to its last band
+	bool scene_cached = false; // the scene was loaded already and did not have to be sent
+};
+
+/*
+	A long running render service. Scenes arrive as scene files (see scene_file.hpp) and stay mapped, with their
+	BVH, materials and lights, in a cache of service.cache_scenes entries keyed by their SHA-256 digest, so repeated
+	jobs on a scene skip sending and loading it. Clients connect over TCP and send jobs one after another on the
+	same connection; every connection is served by its own thread, and all jobs render on one shared thread pool,
+	band by band, the bands of concurrent jobs taking turns. Each band goes back to the client as soon as it is done.
+
+	A job asks for its scene by digest; only if the service does not have it, the client sends the scene file,
+	whose digest has to match. A band is the per-pixel mean of samples [0, samples_per_pixel), the same pixels as
+	render_progressive() with a single pass, or a distributed render with whole-sample tasks.
+	Errors in a job are reported to its client, which may send the next one; the service keeps running.
+*/
+
+// Serves jobs until stop is set, which is checked a few times a second; jobs in flight finish first.
+// Calls on_listening with the bound port once listening. Throws std::runtime_error if the port cannot be bound.
+void run_render_service(const service_settings& service, const std::atomic<bool>* stop,
+	const std::function<void(int)>& on_listening = {});
+
+// Receives the pixel means of a band of rows of the region, row by row, with the band's bounds in framebuffer coordinates.
+using band_callback = std::function<void(const tile& band, const std::vector<color>& pixels)>;
+
+// Client side of the service: one connection, on which jobs run one after another.
+class render_client {
+public:
+	// Throws std::runtime_error if nobody listens at host:port.
+	render_client(const std::string& host, int port);
+
+	/*
+		Sends job, and scene_bytes if the service asks for them, and calls on_band with every band of the region
+		as it arrives. Throws std::runtime_error on connection errors or if the service rejects the job,
+		which leaves the connection open for the next one.
+	*/
+	job_stats render(const render_job& job, const std::vector<std::uint8_t>& scene_bytes, const band_callback& on_band);
+private:
+	tcp_connection connection;
+	std::string address;
+};
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rtweekend.hpp"
+
+#include "accumulation.hpp"
+#include "camera.hpp"
+#include "denoiser.hpp"
+#include "framebuffer.hpp"
+#include "hittable.hpp"
+#include "image_io.hpp"
+#include "integrator.hpp"
+#include "lights.hpp"
+#include "material.hpp"
+#include "sampler.hpp"
+#include "thread_pool.hpp"
+
+enum class render_engine {
+	tiled,      // every sample is traced to the end, depth first through the integrator, before the next one starts
+	wavefront   // all paths of a tile advance together, one batched stage at a time, see wavefront.hpp
+};
+
+// Throws std::invalid_argument for unknown names.
+render_engine render_engine_from_name(const std::string& name);
+
+enum class render_kernel {
+	generic,      // the integrator as configured, through virtual calls
+	specialized   // a kernel compiled for the depth limit, sampler and world, where there is one; see kernels.hpp
+};
+
+// Throws std::invalid_argument for unknown names.
+render_kernel render_kernel_from_name(const std::string& name);
+
+struct render_settings {
+	int image_width = 400;
+	int image_height = 225;
+	int samples_per_pixel = 100;   // the upper bound in adaptive mode
+	int max_depth = 50;
+	integrator_type integrator = integrator_type::path;
+	int rr_min_depth = 3;   // bounces before Russian roulette may end a path
+	sampler_type sampler = sampler_type::independent;
+	render_engine engine = render_engine::tiled;
+	render_kernel kernel = render_kernel::generic;
+	int tile_size = 16;
+	int wave_tile_size = 64;   // wavefront: edge length of the tiles whose pixels form one wave
+	double adaptive_threshold = 0;   // 0 = fixed sample count, see renderer
+	int min_samples = 16;
+	unsigned thread_count = 0;   // 0 = one thread per hardware thread
+	std::uint64_t seed = 0;
+	bool show_progress = true;   // tile or pass progress on stderr
+};
+
+// A rectangle of pixels, in framebuffer coordinates (row 0 is the top of the image).
+struct tile {
+	int x0, y0;
+	int x1, y1;   // exclusive
+};
+
+// Welford's running mean and sum of squared deviations of a pixel's sample luminance, for adaptive sampling.
+struct luminance_estimate {
+	double mean = 0;
+	double squared_deviations = 0;
+
+	// Adds sample number count (1-based).
+	void add(const color& sample, int count);
+
+	// Whether the standard error of the mean after count samples is below threshold times the mean.
+	bool converged(int count, double threshold) const;
+};
+
+// Totals of one render() call.
+struct render_stats {
+	std::uint64_t samples = 0;
+	std::uint64_t rays = 0;
+	double seconds = 0;
+	bool interrupted = false;   // progressive only: stopped by the time budget or the cancel flag
+};
+
+struct progressive_settings {
+	int pass_samples = 1;          // samples every pixel adds per pass
+	double time_budget = 0;        // seconds, 0 = run until samples_per_pixel
+	double snapshot_interval = 0;  // seconds between on_snapshot calls, 0 = none
+	const std::atomic<bool>* cancel = nullptr;
+	std::function<void(const accumulation_buffer&)> on_snapshot;
+};
+
+/*
+	Splits the image into tiles and traces them on a work-stealing thread pool.
+	Every pixel draws from its own random stream, keyed by the frame seed and the pixel index,
+	so the image is the same no matter how many threads render it or in which order the tiles finish.
+
+	With a positive adaptive_threshold, every pixel tracks the running mean and variance of its sample luminance
+	and, once it has min_samples, stops as soon as the standard error of the mean falls below
+	adaptive_threshold times the mean (with a floor of one 8-bit step, so black pixels converge too).
+	Convergence is checked every min_samples samples, up to samples_per_pixel.
+
+	The wavefront engine renders the same image as the tiled one with either built-in integrator
+	(with a material table, the recursive one up to rounding: the wavefront engine sums the path forward).
+	It only applies to render(); progressive passes, replaced integrators, next-event estimation and samplers other than
+	independent always run on the tiled engine.
+
+	With the specialized kernel, the tiled engine traces with an integrator compiled for the depth limit, sampler
+	and type of the world it is given, where one was instantiated (see kernels.hpp), and renders the same image.
+*/
+class renderer {
+public:
+	explicit renderer(const render_settings& settings);
+
+	// Renders on a pool shared with other renderers, which ignores settings.thread_count and has to outlive this one.
+	// Renders on the same pool may run from different threads; their batches of tiles or rows take turns.
+	renderer(const render_settings& settings, thread_pool& shared_pool);
+
+	const render_settings& settings() const;
+	unsigned thread_count() const;
+
+	/*
+		Adds passes to the accumulation buffer until every pixel has samples_per_pixel samples,
+		the time budget runs out or the cancel flag is set. Tiles check for a stop before they start,
+		so an interrupted pass leaves some pixels one pass ahead, which resolve() accounts for.
+		A buffer of the wrong size is reset, a matching one (e.g. a loaded checkpoint) is continued.
+		Each chunk of samples draws from a stream keyed by the pixel and its sample count so far,
+		so the result only depends on how the passes were split, not on when the render was interrupted.
+	*/
+	render_stats render_progressive(const hittable& world, const camera& cam, accumulation_buffer& accumulation,
+		const progressive_settings& progressive);
+
+	/*
+		Sums of samples [first, first + count) of every pixel of t, row by row, in sums, with the rows spread over the threads.
+		These are the chunks render_progressive() adds to a pixel that already has first samples,
+		so adding them to an accumulation buffer in order reproduces its passes exactly; see distributed.hpp.
+	*/
+	std::uint64_t sample_tile(const tile& t, const hittable& world, const camera& cam, std::uint32_t first, int count,
+		std::vector<color>& sums);
+
+	// Replaces the integrator built from the settings, e.g. with a custom one. Not supported by the wavefront engine.
+	void set_integrator(std::unique_ptr<integrator> replacement);
+	const integrator& current_integrator() const;
+
+	/*
+		The materials the hits of the worlds rendered from now on index, see material.hpp.
+		An empty table, the default, shades every surface as gray diffuse.
+	*/
+	void set_materials(material_table table);
+	const material_table& materials() const;
+
+	// The lights the nee integrator samples, built for the same materials. Empty by default.
+	void set_lights(light_list list);
+	const light_list& lights() const;
+
+	// The kernel the tiled engine traces world with: the name of a specialized one, or "generic".
+	std::string kernel_for(const hittable& world) const;
+
+	// Samples every pixel of the last render took, top row first.
+	const std::vector<std::uint32_t>& samples_taken() const;
+
+	// The sample counts of the last render as an image, from blue at none to red at samples_per_pixel.
+	framebuffer sample_heatmap() const;
+
+	// Resizes the image to the configured resolution and fills it with the mean of every pixel's samples.
+	render_stats render(const hittable& world, const camera& cam, framebuffer& image);
+
+	/*
+		Renders the frame into stream band by band, a band being a row of tiles, for images too large to hold whole.
+		Tiles are claimed in the stream's row order and finished ones wait in a reorder buffer of window_bands bands
+		until every band before them was written, so memory scales with the width of the image times the window
+		instead of with its size; 0 sizes the window to at least twice the thread count in tiles.
+		The tiled engine only; produces the same pixels as render() and finishes the stream, but keeps no sample counts.
+	*/
+	render_stats render_streaming(const hittable& world, const camera& cam, image_stream& stream, int window_bands);
+
+	/*
+		Fills the AOVs of world at the configured resolution with one ray per pixel through the pixel's center
+		and the center of the lens, so the guides of a denoiser are free of noise whatever the engine or device
+		that rendered the color. Albedo comes from the material table, surface_albedo gray without one.
+	*/
+	void render_aovs(const hittable& world, const camera& cam, aov_buffers& aovs);
+private:
+	std::vector<tile> make_tiles(int size) const;
+	// image and sample_counts hold the rows of the frame from first_row on.
+	std::uint64_t render_tile(const tile& t, const hittable& world, const camera_raster& raster, framebuffer& image,
+		std::vector<std::uint32_t>& sample_counts, int first_row) const;
+	std::uint64_t accumulate_tile(const tile& t, const hittable& world, const camera_raster& raster,
+		accumulation_buffer& accumulation, int pass_samples) const;
+	color sample_chunk(const hittable& world, const camera_raster& raster, int i, int y, std::uint32_t done, int count,
+		std::vector<double>& jitter, ray_batch& camera_rays, std::uint64_t& rays) const;
+	void fill_jitter(random_engine& rng, int i, int y, std::uint32_t first, int count, int dimensions,
+		std::vector<double>& jitter) const;
+	const integrator& select_integrator(const hittable& world);
+	const material_table* material_lookup() const;   // nullptr for an empty table
+private:
+	render_settings config;
+	std::unique_ptr<thread_pool> own_pool;   // null on a shared pool
+	thread_pool& pool;
+	std::unique_ptr<integrator> method;
+	std::unique_ptr<sampler> pattern;   // null for independent sampling
+	bool custom_integrator = false;
+	material_table surfaces;
+	light_list emitters;
+	std::unique_ptr<integrator> kernel;   // the specialized kernel of the current render, if any
+	const integrator* active = nullptr;   // what the current render traces with, method or kernel
+	std::vector<std::uint32_t> pixel_samples;
+};
\ No newline at end of file
@@ -14,6 +14,21 @@ using std::sqrt;
 const double infinity = std::numeric_limits<double>::infinity();
 const double pi = 3.1415926535897932385;
 
+/*
+	Builds defining RT_FAST_MATH let the compiler reassociate and contract floating point math and target AVX2:
+	the Release-AVX2 configurations and the CMake option of the same name. Infinities have to stay exact,
+	every ray interval starts out open ended, so GCC and Clang keep -fno-finite-math-only.
+	Single precision is left out: its paths are too sensitive to rounding for the golden check, see CMakeLists.txt.
+*/
+#ifdef RT_FAST_MATH
+#ifdef RT_USE_FLOAT
+#error "RT_FAST_MATH cannot be combined with RT_USE_FLOAT"
+#endif
+constexpr bool fast_math_build = true;
+#else
+constexpr bool fast_math_build = false;
+#endif
+
 // Utility Functions
 inline double degrees_to_radians(double degrees) {
 
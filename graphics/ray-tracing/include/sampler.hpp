@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rtweekend.hpp"
+
+enum class sampler_type {
+	independent,   // white noise from the pixel's random stream, the original behaviour
+	stratified,    // correlated multi-jittered: stratified in 2D and in each 1D projection
+	sobol,         // Owen-scrambled and shuffled Sobol (0,2)-sequence, padded pair by pair
+	blue_noise     // a blue-noise mask tiled over the image, rotating a sequence shared by all pixels
+};
+
+// Throws std::invalid_argument for unknown names; accepts independent, stratified, sobol and blue-noise.
+sampler_type sampler_type_from_name(const std::string& name);
+
+// The name sampler_type_from_name() accepts for type.
+const char* sampler_type_name(sampler_type type);
+
+/*
+	Sample values indexed by pixel, sample number and dimension rather than drawn from a stream,
+	so a pixel's samples fill its dimensions evenly and a progressive chunk picks up where the previous one ended.
+	Dimensions 0 and 1 are the position in the pixel, the integrator takes the following ones in order along the path.
+	Values are in [0,1) and only depend on the arguments and the frame seed. Implementations are safe to share between threads.
+*/
+class sampler {
+public:
+	virtual ~sampler() = default;
+
+	virtual double get_1d(int x, int y, std::uint32_t index, std::uint32_t dimension) const = 0;
+
+	// Dimensions dimension and dimension + 1, sampled as a pair.
+	virtual void get_2d(int x, int y, std::uint32_t index, std::uint32_t dimension, double& u, double& v) const = 0;
+};
+
+/*
+	Kensler's correlated multi-jittered sampling. Every set of samples_per_pixel samples forms an n-rooks pattern
+	on a jittered grid, and each dimension pair shuffles the sample indices with its own permutation,
+	so the dimensions do not correlate with each other.
+*/
+class stratified_sampler : public sampler {
+public:
+	stratified_sampler(int samples_per_pixel, std::uint64_t seed);
+
+	virtual double get_1d(int x, int y, std::uint32_t index, std::uint32_t dimension) const override;
+	virtual void get_2d(int x, int y, std::uint32_t index, std::uint32_t dimension, double& u, double& v) const override;
+private:
+	std::uint32_t count;
+	std::uint64_t frame_seed;
+};
+
+/*
+	The first two dimensions of the Sobol sequence with Burley's hash-based Owen scrambling, which keeps their
+	stratification. Each pixel and dimension pair also scrambles the sample index, so the pairs are independent
+	of each other and the sequence can be padded to any number of dimensions.
+*/
+class sobol_sampler : public sampler {
+public:
+	explicit sobol_sampler(std::uint64_t seed);
+
+	virtual double get_1d(int x, int y, std::uint32_t index, std::uint32_t dimension) const override;
+	virtual void get_2d(int x, int y, std::uint32_t index, std::uint32_t dimension, double& u, double& v) const override;
+private:
+	std::uint64_t frame_seed;
+};
+
+/*
+	Every pixel takes the same scrambled Sobol samples, rotated (toroidally shifted) by the value of a
+	64 x 64 void-and-cluster blue-noise mask at its position, with the mask offset differently per dimension.
+	Neighbouring pixels get well-spread rotations, so the error left at low sample counts is high-frequency noise.
+*/
+class blue_noise_sampler : public sampler {
+public:
+	explicit blue_noise_sampler(std::uint64_t seed);
+
+	virtual double get_1d(int x, int y, std::uint32_t index, std::uint32_t dimension) const override;
+	virtual void get_2d(int x, int y, std::uint32_t index, std::uint32_t dimension, double& u, double& v) const override;
+
+	static const int mask_size = 64;
+
+	// Rank of every mask pixel divided by the pixel count, built once; rows first.
+	static const std::vector<float>& mask();
+private:
+	double rotation(int x, int y, std::uint32_t dimension) const;
+private:
+	std::uint64_t frame_seed;
+	const std::vector<float>& ranks;
+};
+
+// Nullptr for independent sampling, whose draws come from the pixel's random stream.
+std::unique_ptr<sampler> make_sampler(sampler_type type, int samples_per_pixel, std::uint64_t seed);
+
+// Direct mappings of a point in [0,1)^2 to directions around a unit normal, in place of rejection sampling.
+
+// Uniform over the hemisphere, the distribution of random_in_hemisphere().
+vec3 uniform_hemisphere(double u, double v, const vec3& normal);
+
+// Density proportional to the cosine to the normal, for Lambertian reflection.
+vec3 cosine_hemisphere(double u, double v, const vec3& normal);
+
+/*
+	Batches of the closed-form samplers of vec3.hpp: count samples written to structure-of-arrays outputs.
+	The uniforms are drawn a block at a time and then mapped in a branch-free loop the compiler vectorizes.
+	Each batch draws the same numbers in the same order as count calls of the scalar function.
+*/
+void sample_unit_vectors(random_engine& rng, std::size_t count, real* x, real* y, real* z);
+void sample_in_unit_spheres(random_engine& rng, std::size_t count, real* x, real* y, real* z);
+void sample_in_unit_disks(random_engine& rng, std::size_t count, real* x, real* y);
+
+// One normal per sample.
+void sample_in_hemispheres(random_engine& rng, std::size_t count, const real* nx, const real* ny, const real* nz,
+	real* x, real* y, real* z);
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bvh.hpp"
+#include "camera.hpp"
+#include "hittable.hpp"
+#include "mapped_file.hpp"
+#include "material.hpp"
+#include "scenes.hpp"
+
+/*
+	Binary scene files (.rtscene) hold spheres, materials, the camera and the BVH over the spheres,
+	all laid out exactly as the renderer keeps them in memory, so loading maps the file and points into it:
+	  header          magic "RTSCENE1", layout checks, section counts and offsets and the camera
+	  spheres         center x, y and z and radius arrays, in BVH leaf order, each with sphere_soa padding
+	  material ids    one 32 bit index per sphere
+	  materials       material_record array
+	  nodes           bvh_node::linear_node array
+	Sections start on 64 byte boundaries. Files are only portable between builds with the same
+	byte order, real type and vec3 layout, which the header records and the loader checks.
+*/
+void write_scene_file(const std::string& path, const scene_description& scene, int bvh_leaf_size = 4);
+
+// The same file contents in memory, e.g. to send a scene over the network.
+std::vector<std::uint8_t> encode_scene_file(const scene_description& scene, int bvh_leaf_size = 4);
+
+// Largest scene file a peer may send over the network, unless configured otherwise.
+const std::uint64_t default_max_scene_bytes = std::uint64_t(4) << 30;
+
+// A scene file mapped into memory and traced in place. Opening it checks the header, the BVH nodes and the
+// materials, the spheres are only read while tracing.
+class mapped_scene : public hittable {
+public:
+	// Throws std::runtime_error if the file cannot be mapped, is malformed or was written by an incompatible build.
+	explicit mapped_scene(const std::string& path);
+
+	// A scene file received in memory, which the scene keeps; name only appears in error messages.
+	mapped_scene(std::vector<std::uint8_t> bytes, const std::string& name);
+
+	virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const override;
+	virtual bool intersect(const ray& r, real t_min, real t_max, hit_record& rec) const override;
+	virtual bool occluded(const ray& r, real t_min, real t_max) const override;
+	virtual bool bounding_box(aabb& output_box) const override;
+
+	const camera_settings& camera() const;
+	const bvh_node& bvh() const;
+	std::size_t sphere_count() const;
+
+	const material_record* materials() const;
+	std::size_t material_count() const;
+	const std::uint32_t* material_ids() const;   // parallel to the BVH's spheres
+
+	// The materials copied into a table to render with; the hits of the scene carry their ids.
+	material_table copy_materials() const;
+private:
+	void open(const std::uint8_t* data, std::size_t size, const std::string& name);
+private:
+	std::unique_ptr<mapped_file> file;
+	std::vector<std::uint8_t> buffer;
+	camera_settings view;
+	std::unique_ptr<bvh_node> tree;
+	const material_record* material_records = nullptr;
+	std::size_t materials_in_file = 0;
+	const std::uint32_t* ids = nullptr;
+};
+
+/*
+	Text format for authoring, a JSON document with an optional camera and lists of materials and spheres:
+	  {
+	    "camera": { "lookfrom": [13, 2, 3], "lookat": [0, 0, 0], "vup": [0, 1, 0], "vfov": 20 },
+	    "materials": [ { "type": "lambertian", "albedo": [0.5, 0.5, 0.5] },
+	                   { "type": "metal", "albedo": [0.7, 0.6, 0.5], "fuzz": 0.1 },
+	                   { "type": "dielectric", "ior": 1.5 },
+	                   { "type": "emissive", "albedo": [1, 0.9, 0.8], "intensity": 4 } ],
+	    "spheres": [ { "center": [0, -1000, 0], "radius": 1000, "material": 0 } ],
+	    "prototypes": [ { "spheres": [ { "center": [0, 0.5, 0], "radius": 0.5 } ] } ],
+	    "instances": [ { "prototype": 0, "scale": 2, "rotate": { "axis": [0, 1, 0], "degrees": 30 },
+	                     "translate": [1, 0, -2], "material": 1 } ]
+	  }
+	Prototypes are sphere sets that instances place by a scale (a number or a vector), a rotation and a translation,
+	applied in that order; the instance's material applies to all of its spheres.
+	Spheres and instances may also have a "velocity" vector, in units per frame, for frame sequences.
+	The camera also takes "focal_length", and "aperture" and "focus_distance" for a thin lens.
+	Throws std::runtime_error on I/O, syntax or schema errors.
+*/
+scene_description import_scene_json(const std::string& path);
+
+// True for paths ending in .rtscene, which are opened as a mapped_scene rather than loaded.
+bool is_binary_scene_path(const std::string& path);
+
+// A reference scene by name or a .json text scene. Throws std::invalid_argument or std::runtime_error.
+scene_description load_scene(const std::string& name_or_path);
\ No newline at end of file
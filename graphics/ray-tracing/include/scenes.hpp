@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "camera.hpp"
+#include "hittable_list.hpp"
+#include "material.hpp"
+
+// Everything a scene consists of besides the render settings.
+struct scene_description {
+	hittable_list world;
+	std::vector<material_record> materials;
+	std::vector<std::uint32_t> material_ids;   // one per object of world, indexing materials
+	std::vector<vec3> velocities;              // frame sequences: one per object of world in units per frame, or empty
+	camera_settings camera;                    // the aspect ratio is overridden by the image size
+};
+
+/*
+	Reference scenes, shared by the renderer and the benchmark so both measure the same worlds.
+	Random placement draws from a stream keyed by the seed alone, so a scene is identical across runs and machines.
+	  basic           the two spheres the renderer started out with
+	  random-spheres  the "final scene" of Ray Tracing in One Weekend: about 480 small spheres, three large ones and the ground
+	  stress          one million small spheres in a slab in front of the camera
+	  instances       4096 instances of one 200-sphere cluster with its own BVH, 819200 spheres' worth
+	  lit             three spheres under a dome, lit only by three small emissive spheres, for next-event estimation
+*/
+std::vector<std::string> scene_names();
+
+// Throws std::invalid_argument for unknown names.
+scene_description make_scene(const std::string& name, std::uint64_t seed);
+
+/*
+	Copies material_ids into the spheres and instances of world, so that their hits carry the id for the material table.
+	Acceleration structures copy the ids when they are built, so bind first. Scenes from make_scene() and the scene files
+	come bound. Throws std::invalid_argument if there is not one id per object.
+*/
+void bind_materials(scene_description& scene);
\ No newline at end of file
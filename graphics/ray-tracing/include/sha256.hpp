@@ -0,0 +1,14 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+using sha256_digest = std::array<std::uint8_t, 32>;
+
+// SHA-256 (FIPS 180-4) of size bytes, for content that has to be identified by what it is even if a peer picks it.
+sha256_digest sha256(const void* data, std::size_t size);
+
+// Lowercase hexadecimal, for messages.
+std::string to_hex(const sha256_digest& digest);
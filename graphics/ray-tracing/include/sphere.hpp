@@ -1,15 +1,25 @@
 #pragma once
 
+#include <cstdint>
+
 #include "hittable.hpp"
 #include "vec3.hpp"
 
 class sphere : public hittable {
 public:
 	point3 center;
-	double radius;
+	real radius;
+	std::uint32_t material = 0;
 public:
 	sphere() {}
-	sphere(point3 cen, double r) : center{ cen }, radius{ r } {}
+	sphere(point3 cen, real r, std::uint32_t material_id = 0) : center{ cen }, radius{ r }, material{ material_id } {}
 	virtual bool hit(
-		const ray& r, double t_min, double t_max, hit_record& rec) const override;
+		const ray& r, real t_min, real t_max, hit_record& rec) const override;
+	virtual bool intersect(const ray& r, real t_min, real t_max, hit_record& rec) const override;
+	virtual void finish_hit(const ray& r, hit_record& rec) const override;
+	virtual bool occluded(const ray& r, real t_min, real t_max) const override;
+	virtual bool bounding_box(aabb& output_box) const override;
+private:
+	// Nearest root of the ray in [t_min, t_max], if there is one.
+	bool nearest_root(const ray& r, real t_min, real t_max, real& root) const;
 };
\ No newline at end of file
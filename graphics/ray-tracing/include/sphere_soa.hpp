@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "hittable.hpp"
+#include "vec3.hpp"
+
+/*
+	A set of spheres stored as structure of arrays: one array per center coordinate and one for the radius.
+	A ray is intersected with as many spheres at once as the widest available vector unit holds
+	(8 doubles or 16 floats with AVX-512, 4 or 8 with AVX2, 2 or 4 with SSE2 or NEON, 1 otherwise),
+	and only the nearest root is turned into a hit_record. Shadow rays stop at the first step with any root in range.
+	The instruction set is picked at compile time from the architecture flags of the build.
+	A sphere_soa either owns its arrays or is a read-only view of arrays kept elsewhere, e.g. in a mapped scene file.
+*/
+class sphere_soa : public hittable {
+public:
+	sphere_soa() {}
+
+	/*
+		Non-owning view of count spheres. Every array needs padding_slots() readable entries past count,
+		with a NaN radius, and has to outlive the view. A view cannot be modified.
+		materials holds count material ids, or is nullptr for material 0 throughout.
+	*/
+	static sphere_soa view(const real* center_x, const real* center_y, const real* center_z, const real* radii, std::size_t count,
+		const std::uint32_t* materials = nullptr);
+
+	void reserve(std::size_t count);
+	void clear();
+	void add(const point3& center, real radius, std::uint32_t material = 0);
+
+	// Placeholder slot that no ray can hit, keeps indices aligned with another primitive array.
+	void add_empty();
+
+	// Moves or resizes the sphere at index, which has to be below size().
+	void set(std::size_t index, const point3& center, real radius);
+	void set_material(std::size_t index, std::uint32_t material);
+
+	std::size_t size() const;
+	point3 center(std::size_t index) const;
+	real radius(std::size_t index) const;
+	std::uint32_t material(std::size_t index) const;
+
+	virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const override;
+	virtual bool intersect(const ray& r, real t_min, real t_max, hit_record& rec) const override;
+	virtual void finish_hit(const ray& r, hit_record& rec) const override;
+	virtual bool occluded(const ray& r, real t_min, real t_max) const override;
+	virtual bool bounding_box(aabb& output_box) const override;
+
+	// The same queries restricted to the spheres [first, first + count), used by BVH leaves over a shared sphere_soa.
+	bool hit_range(const ray& r, std::size_t first, std::size_t count, real t_min, real t_max, hit_record& rec) const;
+	bool intersect_range(const ray& r, std::size_t first, std::size_t count, real t_min, real t_max, hit_record& rec) const;
+	bool occluded_range(const ray& r, std::size_t first, std::size_t count, real t_min, real t_max) const;
+
+	// Array start of one coordinate (0-2) or of the radii (3), with padding_slots() entries past size().
+	const real* data(int component) const;
+	static std::size_t padding_slots();
+
+	// Name of the instruction set the intersection kernel was compiled for.
+	static const char* simd_backend();
+	static int simd_width();
+private:
+	void pad();
+private:
+	// Every array carries simd padding slots past size(), so a kernel may always load a full vector.
+	std::vector<real> center_x;
+	std::vector<real> center_y;
+	std::vector<real> center_z;
+	std::vector<real> radii;
+	std::vector<std::uint32_t> materials;   // only read by finish_hit(), so without padding
+	std::size_t count = 0;
+	const real* external[4] = {};   // set for views
+	const std::uint32_t* external_materials = nullptr;
+};
\ No newline at end of file
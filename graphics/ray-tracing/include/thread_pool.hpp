@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+	A fixed-size pool of worker threads with one task queue per worker.
+	Tasks are plain indices handed to the job function. Each worker drains its own queue from the front,
+	and once it runs dry it steals from the back of the other queues, so a single expensive task
+	only delays the worker running it instead of the whole batch.
+*/
+class thread_pool {
+public:
+	using task_function = std::function<void(std::size_t)>;
+public:
+	// A thread count of 0 uses one worker per hardware thread.
+	explicit thread_pool(unsigned thread_count = 0);
+	~thread_pool();
+
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	unsigned size() const;
+
+	// Runs task(i) for every i in [0, count) and blocks until all of them have finished.
+	// The first exception thrown by a task is rethrown here once the batch has drained.
+	void parallel_for(std::size_t count, const task_function& task);
+private:
+	struct task_queue {
+		std::mutex mutex;
+		std::deque<std::size_t> tasks;
+	};
+
+	void worker_loop(unsigned index);
+	bool pop_task(unsigned index, std::size_t& task);
+	void run_task(std::size_t task);
+private:
+	std::vector<std::thread> workers;
+	std::vector<task_queue> queues;
+
+	std::mutex submit_mutex;   // serializes parallel_for callers
+
+	std::mutex state_mutex;
+	std::condition_variable wake_workers;
+	std::condition_variable batch_done;
+	unsigned long long generation = 0;
+	bool stopping = false;
+
+	std::atomic<const task_function*> current_task{ nullptr };
+	std::atomic<std::size_t> pending{ 0 };
+	std::exception_ptr first_error;
+};
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "rtweekend.hpp"
+
+#include "aabb.hpp"
+
+/*
+	An affine map x -> A x + b, stored as the 3 x 4 matrix [A | b], row by row.
+	Composition reads right to left like matrix products: (a * b) applies b first.
+*/
+class affine_transform {
+public:
+	real m[3][4];
+public:
+	// The identity.
+	affine_transform();
+
+	static affine_transform translation(const vec3& offset);
+	static affine_transform scaling(const vec3& factors);
+	static affine_transform rotation(const vec3& axis, real degrees);   // counterclockwise looking down the axis
+
+	affine_transform operator*(const affine_transform& other) const;
+
+	// Computed in double. Throws std::invalid_argument for singular transforms.
+	affine_transform inverse() const;
+
+	point3 point(const point3& p) const;
+	vec3 vector(const vec3& v) const;
+
+	// A^T v: applied by the inverse, it maps surface normals, which have to stay perpendicular to the surface.
+	vec3 transposed_vector(const vec3& v) const;
+
+	// The tightest box around the transformed box, from its center and half extents (Arvo's method).
+	aabb box(const aabb& b) const;
+};
\ No newline at end of file
@@ -8,116 +8,289 @@
 
 using std::sqrt;
 
-class vec3 {
+/*
+	Scalar type of all geometry. Define RT_USE_FLOAT to trace in single precision,
+	which halves the memory traffic of vectors, rays and hit records and doubles the lanes of the SIMD kernels.
+*/
+#ifdef RT_USE_FLOAT
+using real = float;
+#else
+using real = double;
+#endif
+
+/*
+	Define RT_VEC3_PADDED to store a fourth, unused component and align every vector to its full width
+	(16 bytes for float, 32 for double), so a vector can move in and out of a SIMD register with one aligned access.
+*/
+#ifdef RT_VEC3_PADDED
+#define RT_VEC3_COMPONENTS 4
+#define RT_VEC3_ALIGNMENT(T) alignas(4 * sizeof(T))
+#else
+#define RT_VEC3_COMPONENTS 3
+#define RT_VEC3_ALIGNMENT(T)
+#endif
+
+// All members and operators are defined inline, so they disappear into the hot loops of every translation unit.
+template <typename T>
+class RT_VEC3_ALIGNMENT(T) vec3_t {
 public:
-	double e[3];
+	using value_type = T;
 public:
-    vec3() : e{ 0,0,0 } {}
-    vec3(double e0, double e1, double e2) : e{ e0, e1, e2 } {}
+	T e[RT_VEC3_COMPONENTS];
+public:
+	constexpr vec3_t() : e{ 0, 0, 0 } {}
+	constexpr vec3_t(T e0, T e1, T e2) : e{ e0, e1, e2 } {}
+
+	// Explicit conversion between precisions, e.g. vec3d(v) for a float vector.
+	template <typename U>
+	constexpr explicit vec3_t(const vec3_t<U>& v) : e{ static_cast<T>(v.e[0]), static_cast<T>(v.e[1]), static_cast<T>(v.e[2]) } {}
+
+	constexpr T x() const { return e[0]; }
+	constexpr T y() const { return e[1]; }
+	constexpr T z() const { return e[2]; }
+
+	constexpr vec3_t operator-() const { return vec3_t(-e[0], -e[1], -e[2]); }
+	constexpr T operator[](int i) const { return e[i]; }
+	T& operator[](int i) { return e[i]; }
+
+	vec3_t& operator+=(const vec3_t& v) {
+
+		e[0] += v.e[0];
+		e[1] += v.e[1];
+		e[2] += v.e[2];
+
+		return *this;
+	}
+
+	vec3_t& operator*=(const T t) {
+
+		e[0] *= t;
+		e[1] *= t;
+		e[2] *= t;
+
+		return *this;
+	}
+
+	vec3_t& operator/=(const T t) {
 
-    double x() const;
-    double y() const;
-    double z() const;
+		return *this *= 1 / t;
+	}
+
+	T length() const {
 
-    vec3 operator-() const;
-    double operator[](int i) const;
-    double& operator[](int i);
+		return std::sqrt(length_squared());
+	}
 
-    vec3& operator+=(const vec3& v);
-    vec3& operator*=(const double t);
-    vec3& operator/=(const double t);
+	constexpr T length_squared() const {
 
-    double length() const;
-    double length_squared() const;
+		return e[0] * e[0] + e[1] * e[1] + e[2] * e[2];
+	}
 
-	inline static vec3 random() {
+	inline static vec3_t random(random_engine& rng) {
 
-		return vec3(random_double(), random_double(), random_double());
+		// Draw in a fixed order, as the evaluation order of constructor arguments is unspecified.
+		auto x = static_cast<T>(random_double(rng));
+		auto y = static_cast<T>(random_double(rng));
+		auto z = static_cast<T>(random_double(rng));
+		return vec3_t(x, y, z);
 	};
 
-	inline static vec3 random(double min, double max) {
+	inline static vec3_t random(random_engine& rng, double min, double max) {
 
-		return vec3(random_double(min, max), random_double(min, max), random_double(min, max));
+		auto x = static_cast<T>(random_double(rng, min, max));
+		auto y = static_cast<T>(random_double(rng, min, max));
+		auto z = static_cast<T>(random_double(rng, min, max));
+		return vec3_t(x, y, z);
 	};
+
+	// Friends rather than templates, so that mixed calls like 0.5 * v convert the scalar instead of failing deduction.
+	inline friend std::ostream& operator<<(std::ostream& out, const vec3_t& v) {
+
+		return out << v.e[0] << ' ' << v.e[1] << ' ' << v.e[2];
+	}
+
+	constexpr friend vec3_t operator+(const vec3_t& u, const vec3_t& v) {
+
+		return vec3_t(u.e[0] + v.e[0], u.e[1] + v.e[1], u.e[2] + v.e[2]);
+	}
+
+	constexpr friend vec3_t operator-(const vec3_t& u, const vec3_t& v) {
+
+		return vec3_t(u.e[0] - v.e[0], u.e[1] - v.e[1], u.e[2] - v.e[2]);
+	}
+
+	constexpr friend vec3_t operator*(const vec3_t& u, const vec3_t& v) {
+
+		return vec3_t(u.e[0] * v.e[0], u.e[1] * v.e[1], u.e[2] * v.e[2]);
+	}
+
+	constexpr friend vec3_t operator*(T t, const vec3_t& v) {
+
+		return vec3_t(t * v.e[0], t * v.e[1], t * v.e[2]);
+	}
+
+	constexpr friend vec3_t operator*(const vec3_t& v, T t) {
+
+		return t * v;
+	}
+
+	constexpr friend vec3_t operator/(const vec3_t& v, T t) {
+
+		return (1 / t) * v;
+	}
+
+	constexpr friend T dot(const vec3_t& u, const vec3_t& v) {
+
+		return u.e[0] * v.e[0]
+			+ u.e[1] * v.e[1]
+			+ u.e[2] * v.e[2];
+	}
+
+	constexpr friend vec3_t cross(const vec3_t& u, const vec3_t& v) {
+
+		return vec3_t(u.e[1] * v.e[2] - u.e[2] * v.e[1],
+			u.e[2] * v.e[0] - u.e[0] * v.e[2],
+			u.e[0] * v.e[1] - u.e[1] * v.e[0]);
+	}
+
+	inline friend vec3_t unit_vector(const vec3_t& v) {
+
+		return v / v.length();
+	}
 };
 
 // Type aliases for vec3
+using vec3f = vec3_t<float>;
+using vec3d = vec3_t<double>;
+using vec3 = vec3_t<real>;
 using point3 = vec3;   // 3D point
 using color = vec3;    // RGB color
 
-inline std::ostream& operator<<(std::ostream& out, const vec3& v) {
+/*
+	Closed-form samplers with the distributions of the rejection samplers below, in a fixed number of draws
+	and without a data-dependent branch, so that batch loops over them vectorize (see sampler.hpp).
+*/
+
+// Sine and cosine of 2 pi t for t in [0,1): Taylor polynomials of the half angle, within a few ulp of double.
+inline void sincos_turns(double t, double& s, double& c) {
+
+	// The angle is 2h + pi with h in [-pi/2, pi/2), so sin = -2 sin(h) cos(h) and cos = 2 sin(h)^2 - 1.
+	const double h = 3.14159265358979323846 * (t - 0.5);
+	const double h2 = h * h;
+	double sin_h = 1.0 / 51090942171709440000.0;
+	double cos_h = 1.0 / 2432902008176640000.0;
+	const double sin_terms[10] = { -1.0 / 121645100408832000.0, 1.0 / 355687428096000.0, -1.0 / 1307674368000.0,
+		1.0 / 6227020800.0, -1.0 / 39916800.0, 1.0 / 362880.0, -1.0 / 5040.0, 1.0 / 120.0, -1.0 / 6.0, 1.0 };
+	const double cos_terms[10] = { -1.0 / 6402373705728000.0, 1.0 / 20922789888000.0, -1.0 / 87178291200.0,
+		1.0 / 479001600.0, -1.0 / 3628800.0, 1.0 / 40320.0, -1.0 / 720.0, 1.0 / 24.0, -1.0 / 2.0, 1.0 };
+	for (int k = 0; k < 10; ++k) {
+
+		sin_h = sin_h * h2 + sin_terms[k];
+		cos_h = cos_h * h2 + cos_terms[k];
+	}
+	sin_h *= h;
 
-    return out << v.e[0] << ' ' << v.e[1] << ' ' << v.e[2];
+	s = -2 * sin_h * cos_h;
+	c = 2 * sin_h * sin_h - 1;
 }
 
-inline vec3 operator+(const vec3& u, const vec3& v) {
+// A uniform direction from two uniforms: z uniform in [-1,1] and a uniform angle around it (Archimedes' hat-box theorem).
+inline vec3 map_unit_vector(double u, double v) {
 
-    return vec3(u.e[0] + v.e[0], u.e[1] + v.e[1], u.e[2] + v.e[2]);
+	const double z = 1 - 2 * u;
+	const double r = std::sqrt(std::fmax(0.0, 1 - z * z));
+	double s, c;
+	sincos_turns(v, s, c);
+	return vec3(static_cast<real>(r * c), static_cast<real>(r * s), static_cast<real>(z));
 }
 
-inline vec3 operator-(const vec3& u, const vec3& v) {
+// A uniform point in the unit ball: a uniform direction times the largest of three uniforms, whose density grows with r^2.
+inline vec3 map_in_unit_sphere(double u, double v, double w0, double w1, double w2) {
 
-    return vec3(u.e[0] - v.e[0], u.e[1] - v.e[1], u.e[2] - v.e[2]);
+	return static_cast<real>(std::fmax(w0, std::fmax(w1, w2))) * map_unit_vector(u, v);
 }
 
-inline vec3 operator*(const vec3& u, const vec3& v) {
+// A uniform point in the unit disk in the xy plane.
+inline vec3 map_in_unit_disk(double u, double v) {
 
-    return vec3(u.e[0] * v.e[0], u.e[1] * v.e[1], u.e[2] * v.e[2]);
+	const double r = std::sqrt(u);
+	double s, c;
+	sincos_turns(v, s, c);
+	return vec3(static_cast<real>(r * c), static_cast<real>(r * s), 0);
 }
 
-inline vec3 operator*(double t, const vec3& v) {
+// Two draws.
+inline vec3 sample_unit_vector(random_engine& rng) {
 
-    return vec3(t * v.e[0], t * v.e[1], t * v.e[2]);
+	const double u = rng.next_double();
+	const double v = rng.next_double();
+	return map_unit_vector(u, v);
 }
 
-inline vec3 operator*(const vec3& v, double t) {
+// Five draws.
+inline vec3 sample_in_unit_sphere(random_engine& rng) {
 
-    return t * v;
+	double d[5];
+	rng.fill(d, 5);
+	return map_in_unit_sphere(d[0], d[1], d[2], d[3], d[4]);
 }
 
-inline vec3 operator/(vec3 v, double t) {
+// Five draws; the point of the unit ball mirrored into the normal's half.
+inline vec3 sample_in_hemisphere(random_engine& rng, const vec3& normal) {
 
-    return (1 / t) * v;
+	const vec3 p = sample_in_unit_sphere(rng);
+	return std::copysign(real(1), dot(p, normal)) * p;
 }
 
-inline double dot(const vec3& u, const vec3& v) {
+// Two draws.
+inline vec3 sample_in_unit_disk(random_engine& rng) {
 
-    return u.e[0] * v.e[0]
-        + u.e[1] * v.e[1]
-        + u.e[2] * v.e[2];
+	const double u = rng.next_double();
+	const double v = rng.next_double();
+	return map_in_unit_disk(u, v);
 }
 
-inline vec3 cross(const vec3& u, const vec3& v) {
+/*
+	The original rejection samplers: about 1.9 tries of three draws each on average.
+	Every engine reproduces their draw sequence (see device_kernel.hpp), so they stay the default;
+	define RT_CLOSED_FORM_SAMPLING to route them to the closed-form samplers above instead.
+*/
+#ifdef RT_CLOSED_FORM_SAMPLING
+inline vec3 random_in_unit_sphere(random_engine& rng) {
 
-    return vec3(u.e[1] * v.e[2] - u.e[2] * v.e[1],
-        u.e[2] * v.e[0] - u.e[0] * v.e[2],
-        u.e[0] * v.e[1] - u.e[1] * v.e[0]);
+	return sample_in_unit_sphere(rng);
 }
 
-inline vec3 unit_vector(vec3 v) {
+inline vec3 random_unit_vector(random_engine& rng) {
 
-    return v / v.length();
+	return sample_unit_vector(rng);
 }
 
-inline vec3 random_in_unit_sphere() {
+inline vec3 random_in_hemisphere(random_engine& rng, const vec3& normal) {
+
+	return sample_in_hemisphere(rng, normal);
+}
+#else
+inline vec3 random_in_unit_sphere(random_engine& rng) {
 
 	while (true) {
 
-		auto p = vec3::random(-1, 1);
+		auto p = vec3::random(rng, -1, 1);
 		if (p.length_squared() >= 1) continue;
 		return p;
 	}
 }
 
-inline vec3 random_unit_vector() {
+inline vec3 random_unit_vector(random_engine& rng) {
 
-	return unit_vector(random_in_unit_sphere());
+	return unit_vector(random_in_unit_sphere(rng));
 }
 
-inline vec3 random_in_hemisphere(const vec3& normal) {
+inline vec3 random_in_hemisphere(random_engine& rng, const vec3& normal) {
 
-	vec3 in_unit_sphere = random_in_unit_sphere();
+	vec3 in_unit_sphere = random_in_unit_sphere(rng);
 
 	// In the same hemisphere as the normal
 	return dot(in_unit_sphere, normal) > 0.0 ? in_unit_sphere : -in_unit_sphere;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "rtweekend.hpp"
+
+#include "camera.hpp"
+#include "framebuffer.hpp"
+#include "hittable.hpp"
+#include "material.hpp"
+#include "renderer.hpp"
+
+/*
+	Paths in flight, stored as structure of arrays so that every stage streams through just the arrays it touches.
+	Slot i holds one path: its current ray, its throughput, the wave pixel it contributes to,
+	and what the intersection stage found along the ray.
+	The queue is plain arrays of scalars and indices, the layout a GPU version of the stages would copy over as is.
+*/
+struct path_queue {
+	std::vector<real> origin[3];
+	std::vector<real> direction[3];
+	std::vector<real> throughput[3];
+	std::vector<std::uint32_t> pixel;   // index into the wave's pixels
+
+	std::vector<real> hit_t;            // infinity for a miss
+	std::vector<real> hit_point[3];
+	std::vector<real> hit_normal[3];
+	std::vector<std::uint32_t> hit_material;
+	std::vector<std::uint8_t> hit_front;
+	std::vector<std::uint8_t> alive;    // cleared by the stages that end a path, dropped by compact_paths
+
+	std::size_t size() const;
+	void reserve(std::size_t count);
+	void clear();
+
+	// Appends a path with unit throughput.
+	void push(const ray& r, std::uint32_t pixel_index);
+
+	ray path_ray(std::size_t i) const;
+};
+
+// State of one pixel across all waves of a tile.
+struct wave_pixel {
+	int x = 0;
+	int y = 0;
+	random_engine rng;      // the pixel's path stream
+	random_engine jitter;   // the same stream from its start, where the tiled engine draws all jitter up front
+	color sum;
+	color radiance;         // of the path traced in the current wave
+	luminance_estimate estimate;
+	int samples = 0;
+	bool sampling = true;   // false once the pixel has all its samples or converged
+};
+
+/*
+	The stages of one bounce, each a batched pass over the whole queue.
+	Together they trace the same estimator as path_integrator, drawing the same random numbers in the same order.
+	Without a material table a bounce is shade_paths and bounce_paths, with one it is shade_paths and scatter_paths.
+*/
+
+// Closest hit of every path. Returns the number of rays traced.
+std::uint64_t intersect_paths(const hittable& world, path_queue& paths);
+
+/*
+	Paths that missed add their throughput times the sky to their pixel and end. Without materials the others are attenuated
+	by the surface, with materials they add the light their surface emits and scatter_paths attenuates them.
+*/
+void shade_paths(path_queue& paths, std::vector<wave_pixel>& pixels, const material_table* materials);
+
+// Samples the next direction of every surviving path, followed by Russian roulette if roulette is set.
+void bounce_paths(path_queue& paths, std::vector<wave_pixel>& pixels, bool roulette);
+
+/*
+	bounce_paths for surfaces with materials: the surviving paths are counting-sorted by the material id of their hit
+	and every material's run is scattered together, so the shading of one material streams through its paths
+	with its record in cache and its branch predicted. Each path draws from its own pixel's stream, so the order
+	does not change the result. Followed by Russian roulette if roulette is set.
+*/
+void scatter_paths(path_queue& paths, std::vector<wave_pixel>& pixels, const material_table& materials, bool roulette);
+
+// Moves the paths still alive to the front of the queue, in order, and drops the rest.
+void compact_paths(path_queue& paths);
+
+/*
+	Wavefront engine. Instead of tracing one sample after another to the end, a tile generates one camera ray
+	for every pixel still sampling, then runs intersection, shading and bounce generation over all of them as
+	separate batched stages, compacting away the terminated paths before every bounce, until the wave is empty.
+	Each pixel keeps its random stream from wave to wave, so the image matches the tiled engine sample for sample.
+	Adaptive sampling works per wave: a pixel that converged no longer generates camera rays.
+*/
+class wavefront_engine {
+public:
+	// Without materials (nullptr) every surface is gray diffuse. The table has to outlive the engine.
+	explicit wavefront_engine(const render_settings& settings, const material_table* materials = nullptr);
+
+	// Renders the pixels of t into image and their sample counts, safe to call for disjoint tiles in parallel.
+	std::uint64_t render_tile(const tile& t, const hittable& world, const camera_raster& raster, framebuffer& image,
+		std::vector<std::uint32_t>& sample_counts) const;
+private:
+	void generate_camera_rays(const camera_raster& raster, std::vector<wave_pixel>& pixels, path_queue& paths) const;
+private:
+	render_settings config;
+	int roulette_depth;
+	const material_table* surfaces;
+};
\ No newline at end of file
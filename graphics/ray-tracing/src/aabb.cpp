@@ -0,0 +1,93 @@
+#include "aabb.hpp"
+
+#include <algorithm>
+
+point3 aabb::min() const {
+
+	return minimum;
+}
+
+point3 aabb::max() const {
+
+	return maximum;
+}
+
+bool aabb::empty() const {
+
+	return minimum.x() > maximum.x() || minimum.y() > maximum.y() || minimum.z() > maximum.z();
+}
+
+point3 aabb::centroid() const {
+
+	return 0.5 * (minimum + maximum);
+}
+
+real aabb::surface_area() const {
+
+	if (empty()) {
+
+		return 0;
+	}
+
+	auto d = maximum - minimum;
+	return 2 * (d.x() * d.y() + d.y() * d.z() + d.z() * d.x());
+}
+
+int aabb::longest_axis() const {
+
+	auto d = maximum - minimum;
+	if (d.x() > d.y() && d.x() > d.z()) return 0;
+	return d.y() > d.z() ? 1 : 2;
+}
+
+void aabb::expand(const aabb& box) {
+
+	for (int a = 0; a < 3; ++a) {
+
+		minimum[a] = std::min(minimum[a], box.minimum[a]);
+		maximum[a] = std::max(maximum[a], box.maximum[a]);
+	}
+}
+
+void aabb::expand(const point3& p) {
+
+	for (int a = 0; a < 3; ++a) {
+
+		minimum[a] = std::min(minimum[a], p[a]);
+		maximum[a] = std::max(maximum[a], p[a]);
+	}
+}
+
+/*
+	Slab test: along every axis the ray is inside the box for t in [(min - A) / b, (max - A) / b],
+	with the bounds swapped when b is negative. The ray hits the box if the three intervals overlap within [t_min, t_max].
+*/
+bool aabb::hit(const ray& r, real t_min, real t_max) const {
+
+	for (int a = 0; a < 3; ++a) {
+
+		auto inv_d = 1 / r.direction()[a];
+		auto t0 = (minimum[a] - r.origin()[a]) * inv_d;
+		auto t1 = (maximum[a] - r.origin()[a]) * inv_d;
+		if (inv_d < 0) {
+
+			std::swap(t0, t1);
+		}
+
+		t_min = t0 > t_min ? t0 : t_min;
+		t_max = t1 < t_max ? t1 : t_max;
+		if (t_max <= t_min) {
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+aabb surrounding_box(const aabb& box0, const aabb& box1) {
+
+	aabb box = box0;
+	box.expand(box1);
+	return box;
+}
\ No newline at end of file
@@ -0,0 +1,185 @@
+#include "accumulation.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+static const char checkpoint_magic[8] = { 'R', 'T', 'A', 'C', 'C', 'U', 'M', '1' };
+
+static void put_u32_le(std::vector<std::uint8_t>& out, std::uint32_t v) {
+
+	for (int i = 0; i < 4; ++i) {
+
+		out.push_back(static_cast<std::uint8_t>(v >> (8 * i)));
+	}
+}
+
+static void put_u64_le(std::vector<std::uint8_t>& out, std::uint64_t v) {
+
+	for (int i = 0; i < 8; ++i) {
+
+		out.push_back(static_cast<std::uint8_t>(v >> (8 * i)));
+	}
+}
+
+static std::uint32_t get_u32_le(const std::uint8_t* in) {
+
+	std::uint32_t v = 0;
+	for (int i = 0; i < 4; ++i) {
+
+		v |= static_cast<std::uint32_t>(in[i]) << (8 * i);
+	}
+
+	return v;
+}
+
+static std::uint64_t get_u64_le(const std::uint8_t* in) {
+
+	std::uint64_t v = 0;
+	for (int i = 0; i < 8; ++i) {
+
+		v |= static_cast<std::uint64_t>(in[i]) << (8 * i);
+	}
+
+	return v;
+}
+
+int accumulation_buffer::width() const {
+
+	return sums.width();
+}
+
+int accumulation_buffer::height() const {
+
+	return sums.height();
+}
+
+void accumulation_buffer::reset(int width, int height) {
+
+	sums.resize(width, height);
+	counts.assign(sums.pixel_count(), 0);
+}
+
+void accumulation_buffer::add(int x, int y, const color& sum, std::uint32_t samples) {
+
+	sums.set(x, y, sums.get(x, y) + sum);
+	counts[static_cast<std::size_t>(y) * sums.width() + x] += samples;
+}
+
+std::uint32_t accumulation_buffer::samples(int x, int y) const {
+
+	return counts[static_cast<std::size_t>(y) * sums.width() + x];
+}
+
+std::uint32_t accumulation_buffer::min_samples() const {
+
+	return counts.empty() ? 0 : *std::min_element(counts.begin(), counts.end());
+}
+
+std::uint64_t accumulation_buffer::total_samples() const {
+
+	std::uint64_t total = 0;
+	for (auto count : counts) {
+
+		total += count;
+	}
+
+	return total;
+}
+
+void accumulation_buffer::resolve(framebuffer& image) const {
+
+	image.resize(sums.width(), sums.height());
+
+	const float* in = sums.data();
+	float* out = image.data();
+	for (std::size_t i = 0; i < counts.size(); ++i) {
+
+		const float scale = counts[i] > 0 ? 1.0f / static_cast<float>(counts[i]) : 0.0f;
+		out[3 * i + 0] = in[3 * i + 0] * scale;
+		out[3 * i + 1] = in[3 * i + 1] * scale;
+		out[3 * i + 2] = in[3 * i + 2] * scale;
+	}
+}
+
+void accumulation_buffer::save(const std::string& path, std::uint64_t seed) const {
+
+	std::vector<std::uint8_t> out(checkpoint_magic, checkpoint_magic + sizeof(checkpoint_magic));
+	out.reserve(out.size() + 16 + 16 * counts.size());
+	put_u32_le(out, static_cast<std::uint32_t>(sums.width()));
+	put_u32_le(out, static_cast<std::uint32_t>(sums.height()));
+	put_u64_le(out, seed);
+
+	const float* in = sums.data();
+	for (std::size_t i = 0; i < counts.size(); ++i) {
+
+		for (int c = 0; c < 3; ++c) {
+
+			std::uint32_t bits;
+			std::memcpy(&bits, &in[3 * i + c], sizeof(bits));
+			put_u32_le(out, bits);
+		}
+		put_u32_le(out, counts[i]);
+	}
+
+	const std::string temporary = path + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+		if (!file) {
+
+			throw std::runtime_error("cannot write " + temporary);
+		}
+	}
+
+	// std::rename does not replace an existing file everywhere, so the old checkpoint goes first.
+	std::remove(path.c_str());
+	if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+
+		throw std::runtime_error("cannot rename " + temporary + " to " + path);
+	}
+}
+
+accumulation_buffer accumulation_buffer::load(const std::string& path, std::uint64_t& seed) {
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+
+		throw std::runtime_error("cannot read " + path);
+	}
+	const std::vector<std::uint8_t> in((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	const std::size_t header_size = sizeof(checkpoint_magic) + 16;
+	if (in.size() < header_size || std::memcmp(in.data(), checkpoint_magic, sizeof(checkpoint_magic)) != 0) {
+
+		throw std::runtime_error(path + " is not a checkpoint");
+	}
+
+	const auto width = get_u32_le(&in[8]);
+	const auto height = get_u32_le(&in[12]);
+	seed = get_u64_le(&in[16]);
+
+	const auto pixels = static_cast<std::uint64_t>(width) * height;
+	if (width > 1u << 16 || height > 1u << 16 || in.size() != header_size + 16 * pixels) {
+
+		throw std::runtime_error(path + " is truncated or corrupt");
+	}
+
+	accumulation_buffer buffer(static_cast<int>(width), static_cast<int>(height));
+	float* sums = buffer.sums.data();
+	const std::uint8_t* p = &in[header_size];
+	for (std::size_t i = 0; i < pixels; ++i, p += 16) {
+
+		for (int c = 0; c < 3; ++c) {
+
+			const std::uint32_t bits = get_u32_le(p + 4 * c);
+			std::memcpy(&sums[3 * i + c], &bits, sizeof(bits));
+		}
+		buffer.counts[i] = get_u32_le(p + 12);
+	}
+
+	return buffer;
+}
\ No newline at end of file
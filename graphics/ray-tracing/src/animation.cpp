@@ -0,0 +1,99 @@
+#include "animation.hpp"
+
+#include <chrono>
+#include <stdexcept>
+
+scene_animation::scene_animation(hittable_list& world, const std::vector<vec3>& velocities, const point3& pivot,
+	real turntable_degrees) :
+	pivot{ pivot },
+	degrees_per_frame{ turntable_degrees }
+{
+	if (!velocities.empty() && velocities.size() != world.objects.size()) {
+
+		throw std::invalid_argument("scene_animation: one velocity per object");
+	}
+
+	for (std::size_t i = 0; i < world.objects.size(); ++i) {
+
+		const vec3 velocity = velocities.empty() ? vec3(0, 0, 0) : velocities[i];
+		if (velocity.length_squared() == 0 && turntable_degrees == 0) {
+
+			continue;
+		}
+
+		if (auto* s = dynamic_cast<sphere*>(world.objects[i].get())) {
+
+			spheres.push_back({ s, s->center, velocity });
+		}
+		else if (auto* copy = dynamic_cast<instance*>(world.objects[i].get())) {
+
+			instances.push_back({ copy, copy->transform(), velocity });
+		}
+	}
+}
+
+bool scene_animation::moves() const {
+
+	return !spheres.empty() || !instances.empty();
+}
+
+void scene_animation::set_frame(int frame) {
+
+	const auto f = static_cast<real>(frame);
+	const auto turn = affine_transform::translation(pivot) * affine_transform::rotation(vec3(0, 1, 0), f * degrees_per_frame)
+		* affine_transform::translation(-pivot);
+
+	for (auto& s : spheres) {
+
+		s.object->center = turn.point(s.start + f * s.velocity);
+	}
+	for (auto& i : instances) {
+
+		i.object->set_transform(turn * affine_transform::translation(f * i.velocity) * i.start);
+	}
+}
+
+animated_bvh::animated_bvh(const hittable_list& world, int max_leaf_size, double rebuild_threshold) :
+	objects{ world },
+	leaf_size{ max_leaf_size },
+	threshold{ rebuild_threshold }
+{
+	rebuild();
+}
+
+void animated_bvh::rebuild() {
+
+	tree = std::make_unique<bvh_node>(objects, leaf_size);
+	built_cost = tree->build_stats().sah_cost;
+}
+
+bvh_update animated_bvh::update() {
+
+	// The refit is also what measures the cost, so a rebuild's time includes the refit that triggered it.
+	bvh_update result;
+	result.milliseconds = tree->refit();
+	result.sah_cost = tree->build_stats().sah_cost;
+	result.cost_ratio = built_cost > 0 ? result.sah_cost / built_cost : 1;
+
+	if (result.cost_ratio > threshold) {
+
+		const auto start = std::chrono::steady_clock::now();
+		rebuild();
+		result.rebuilt = true;
+		result.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		result.sah_cost = built_cost;
+		result.cost_ratio = 1;
+	}
+
+	return result;
+}
+
+const bvh_node& animated_bvh::bvh() const {
+
+	return *tree;
+}
+
+bvh_node& animated_bvh::bvh() {
+
+	return *tree;
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+// Blocks grow geometrically up to this size, so a million small objects need only a few dozen allocations.
+static const std::size_t max_block_size = 16 * 1024 * 1024;
+
+scene_arena::scene_arena(std::size_t first_block_size) :
+	next_block_size{ std::max<std::size_t>(first_block_size, 256) }
+{}
+
+scene_arena::~scene_arena() {
+
+	run_destructors();
+}
+
+void* scene_arena::allocate(std::size_t size, std::size_t alignment) {
+
+	if (!blocks.empty()) {
+
+		auto& current = blocks.back();
+		const auto base = reinterpret_cast<std::uintptr_t>(current.memory.get());
+		const std::size_t aligned = ((base + offset + alignment - 1) & ~(alignment - 1)) - base;
+		if (aligned + size <= current.size) {
+
+			offset = aligned + size;
+			used += size;
+			return current.memory.get() + aligned;
+		}
+	}
+
+	add_block(size + alignment);
+	return allocate(size, alignment);
+}
+
+void scene_arena::reset() {
+
+	run_destructors();
+
+	if (!blocks.empty()) {
+
+		auto largest = std::max_element(blocks.begin(), blocks.end(), [](const block& a, const block& b) { return a.size < b.size; });
+		block keep = std::move(*largest);
+		blocks.clear();
+		blocks.push_back(std::move(keep));
+	}
+	offset = 0;
+	used = 0;
+}
+
+std::size_t scene_arena::bytes_used() const {
+
+	return used;
+}
+
+std::size_t scene_arena::bytes_reserved() const {
+
+	std::size_t total = 0;
+	for (const auto& b : blocks) {
+
+		total += b.size;
+	}
+
+	return total;
+}
+
+void scene_arena::register_destructor(void* object, void (*destroy)(void*)) {
+
+	// The record lives in the arena too, so destructible objects cost no extra heap allocation either.
+	auto* record = static_cast<destructor_record*>(allocate(sizeof(destructor_record), alignof(destructor_record)));
+	record->destroy = destroy;
+	record->object = object;
+	record->next = destructors;
+	destructors = record;
+}
+
+void scene_arena::run_destructors() {
+
+	while (destructors) {
+
+		auto* record = destructors;
+		destructors = record->next;
+		record->destroy(record->object);
+	}
+}
+
+void scene_arena::add_block(std::size_t min_size) {
+
+	const std::size_t size = std::max(next_block_size, min_size);
+	blocks.push_back({ std::unique_ptr<unsigned char[]>(new unsigned char[size]), size });
+	offset = 0;
+	next_block_size = std::min(next_block_size * 2, max_block_size);
+}
\ No newline at end of file
@@ -0,0 +1,580 @@
+#include "bvh.hpp"
+
+#include "profiler.hpp"
+#include "sphere.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+// Relative costs of visiting a node and of testing a primitive, as used by the surface area heuristic.
+static const double traversal_cost = 1.0;
+static const double intersection_cost = 1.0;
+
+static const int sah_bins = 16;
+
+// Beyond this depth splits fall back to the object median, which bounds the tree height for the traversal stack.
+static const int sah_depth_limit = 32;
+static const int traversal_stack_size = 64;
+
+bvh_node::bvh_node(const hittable_list& list, int max_leaf_size) :
+	leaf_size_limit{ std::max(1, max_leaf_size) }
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	std::vector<build_primitive> prims;
+	prims.reserve(list.objects.size());
+	for (std::size_t i = 0; i < list.objects.size(); ++i) {
+
+		aabb box;
+		if (!list.objects[i]->bounding_box(box)) {
+
+			throw std::invalid_argument("bvh_node: every object needs a bounding box");
+		}
+		prims.push_back({ box, box.centroid(), i });
+	}
+
+	nodes.reserve(prims.empty() ? 0 : 2 * prims.size() - 1);
+	if (!prims.empty()) {
+
+		build(prims, 0, prims.size(), 0);
+	}
+
+	// Reorder the objects, so every leaf covers a contiguous range.
+	primitives.reserve(prims.size());
+	order.reserve(prims.size());
+	for (const auto& prim : prims) {
+
+		primitives.push_back(list.objects[prim.index]);
+		order.push_back(static_cast<std::uint32_t>(prim.index));
+	}
+	pack_sphere_leaves();
+
+	node_array = nodes.data();
+	node_total = nodes.size();
+	summarize();
+	stats.primitives = primitives.size();
+	stats.build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bvh_node::bvh_node(const linear_node* external_nodes, std::size_t node_count, const sphere_soa& spheres) :
+	node_array{ external_nodes },
+	node_total{ node_count },
+	packed_spheres{ spheres }
+{
+	// Only the counts: walking the nodes would page in all of a mapped scene up front.
+	stats.nodes = node_total;
+	stats.primitives = packed_spheres.size();
+}
+
+bool bvh_node::valid_layout(const linear_node* external_nodes, std::size_t node_count, std::size_t sphere_count) {
+
+	// Children come after their parent, so a forward pass has seen every node's parent by the time it gets there.
+	std::vector<std::uint8_t> referenced(node_count, 0);
+	std::vector<std::uint8_t> depth(node_count, 0);
+	for (std::size_t i = 0; i < node_count; ++i) {
+
+		const auto& node = external_nodes[i];
+		if (i > 0 && !referenced[i]) {
+
+			return false;
+		}
+		if (node.flags & sphere_leaf) {
+
+			if (std::uint64_t(node.offset) + node.count > sphere_count) {
+
+				return false;
+			}
+			continue;
+		}
+		if (node.count > 0) {
+
+			return false;
+		}
+
+		// An interior node at depth d pushes at most the d-th entry of the traversal stack.
+		const std::size_t second = node.offset;
+		if (node.axis >= 3 || depth[i] >= traversal_stack_size || second <= i + 1 || second >= node_count
+			|| referenced[i + 1] || referenced[second]) {
+
+			return false;
+		}
+		referenced[i + 1] = referenced[second] = 1;
+		depth[i + 1] = depth[second] = static_cast<std::uint8_t>(depth[i] + 1);
+	}
+
+	return true;
+}
+
+void bvh_node::summarize() {
+
+	stats.nodes = node_total;
+
+	const double root_area = node_total == 0 ? 0.0 : node_array[0].bounds.surface_area();
+	for (std::size_t i = 0; i < node_total; ++i) {
+
+		const auto& node = node_array[i];
+		const double area_ratio = root_area > 0.0 ? node.bounds.surface_area() / root_area : 1.0;
+		if (node.count > 0) {
+
+			++stats.leaves;
+			stats.sphere_leaves += (node.flags & sphere_leaf) ? 1 : 0;
+			stats.max_leaf_size = std::max<std::size_t>(stats.max_leaf_size, node.count);
+			stats.sah_cost += area_ratio * node.count * intersection_cost;
+		}
+		else {
+
+			stats.sah_cost += area_ratio * traversal_cost;
+		}
+	}
+}
+
+std::uint32_t bvh_node::build(std::vector<build_primitive>& prims, std::size_t begin, std::size_t end, int depth) {
+
+	const auto node_index = static_cast<std::uint32_t>(nodes.size());
+	nodes.push_back({});
+	stats.max_depth = std::max(stats.max_depth, depth);
+
+	aabb bounds;
+	aabb centroid_bounds;
+	for (std::size_t i = begin; i < end; ++i) {
+
+		bounds.expand(prims[i].bounds);
+		centroid_bounds.expand(prims[i].centroid);
+	}
+	nodes[node_index].bounds = bounds;
+
+	const std::size_t count = end - begin;
+	auto make_leaf = [&]() {
+
+		nodes[node_index].offset = static_cast<std::uint32_t>(begin);
+		nodes[node_index].count = static_cast<std::uint32_t>(count);
+		return node_index;
+	};
+
+	if (count == 1) {
+
+		return make_leaf();
+	}
+
+	// Bin the centroids along every axis and sweep the bin boundaries for the cheapest split.
+	int best_axis = -1;
+	int best_split = 0;
+	double best_cost = infinity;
+	const double parent_area = bounds.surface_area();
+	if (depth < sah_depth_limit && parent_area > 0.0) {
+
+		for (int axis = 0; axis < 3; ++axis) {
+
+			const double axis_min = centroid_bounds.minimum.e[axis];
+			const double extent = centroid_bounds.maximum.e[axis] - axis_min;
+			if (extent <= 0.0) {
+
+				continue;
+			}
+
+			aabb bin_bounds[sah_bins];
+			std::size_t bin_counts[sah_bins] = {};
+			for (std::size_t i = begin; i < end; ++i) {
+
+				int b = static_cast<int>(sah_bins * ((prims[i].centroid.e[axis] - axis_min) / extent));
+				b = std::min(b, sah_bins - 1);
+				++bin_counts[b];
+				bin_bounds[b].expand(prims[i].bounds);
+			}
+
+			// right_area[i] and right_count[i] describe bins [i, sah_bins).
+			double right_area[sah_bins];
+			std::size_t right_count[sah_bins];
+			aabb accumulated;
+			std::size_t accumulated_count = 0;
+			for (int b = sah_bins - 1; b > 0; --b) {
+
+				accumulated.expand(bin_bounds[b]);
+				accumulated_count += bin_counts[b];
+				right_area[b] = accumulated.surface_area();
+				right_count[b] = accumulated_count;
+			}
+
+			accumulated = aabb();
+			accumulated_count = 0;
+			for (int split = 1; split < sah_bins; ++split) {
+
+				accumulated.expand(bin_bounds[split - 1]);
+				accumulated_count += bin_counts[split - 1];
+				if (accumulated_count == 0 || right_count[split] == 0) {
+
+					continue;
+				}
+
+				const double cost = traversal_cost + intersection_cost *
+					(accumulated.surface_area() * accumulated_count + right_area[split] * right_count[split]) / parent_area;
+				if (cost < best_cost) {
+
+					best_cost = cost;
+					best_axis = axis;
+					best_split = split;
+				}
+			}
+		}
+	}
+
+	if (count <= static_cast<std::size_t>(leaf_size_limit) && (best_axis < 0 || count * intersection_cost <= best_cost)) {
+
+		return make_leaf();
+	}
+
+	std::size_t mid = begin;
+	if (best_axis >= 0) {
+
+		const int axis = best_axis;
+		const double axis_min = centroid_bounds.minimum.e[axis];
+		const double extent = centroid_bounds.maximum.e[axis] - axis_min;
+		auto split_point = std::partition(prims.begin() + begin, prims.begin() + end, [&](const build_primitive& prim) {
+
+			int b = static_cast<int>(sah_bins * ((prim.centroid.e[axis] - axis_min) / extent));
+			return std::min(b, sah_bins - 1) < best_split;
+		});
+		mid = static_cast<std::size_t>(split_point - prims.begin());
+	}
+
+	if (mid == begin || mid == end) {
+
+		// Coincident centroids or the depth limit: split at the object median of the longest axis.
+		const int axis = centroid_bounds.longest_axis();
+		mid = begin + count / 2;
+		std::nth_element(prims.begin() + begin, prims.begin() + mid, prims.begin() + end,
+			[axis](const build_primitive& a, const build_primitive& b) { return a.centroid.e[axis] < b.centroid.e[axis]; });
+		best_axis = axis;
+	}
+
+	build(prims, begin, mid, depth + 1);
+	const auto second_child = build(prims, mid, end, depth + 1);
+
+	nodes[node_index].offset = second_child;
+	nodes[node_index].count = 0;
+	nodes[node_index].axis = static_cast<std::uint32_t>(best_axis);
+	return node_index;
+}
+
+void bvh_node::pack_sphere_leaves() {
+
+	std::vector<const sphere*> spheres(primitives.size());
+	bool any_sphere = false;
+	for (std::size_t i = 0; i < primitives.size(); ++i) {
+
+		spheres[i] = dynamic_cast<const sphere*>(primitives[i].get());
+		any_sphere = any_sphere || spheres[i];
+	}
+	if (!any_sphere) {
+
+		return;
+	}
+
+	packed_spheres.reserve(primitives.size());
+	for (const auto* s : spheres) {
+
+		if (s) {
+
+			packed_spheres.add(s->center, s->radius, s->material);
+		}
+		else {
+
+			packed_spheres.add_empty();
+		}
+	}
+
+	for (auto& node : nodes) {
+
+		if (node.count == 0) {
+
+			continue;
+		}
+
+		const auto first = spheres.begin() + node.offset;
+		if (std::all_of(first, first + node.count, [](const sphere* s) { return s != nullptr; })) {
+
+			node.flags |= sphere_leaf;
+		}
+	}
+}
+
+// Slab test against precomputed reciprocal directions, see aabb::hit.
+static inline bool hit_bounds(const aabb& box, const point3& origin, const vec3& inv_dir, real t_min, real t_max) {
+
+	for (int a = 0; a < 3; ++a) {
+
+		auto t0 = (box.minimum.e[a] - origin.e[a]) * inv_dir.e[a];
+		auto t1 = (box.maximum.e[a] - origin.e[a]) * inv_dir.e[a];
+		if (inv_dir.e[a] < 0) {
+
+			std::swap(t0, t1);
+		}
+
+		t_min = t0 > t_min ? t0 : t_min;
+		t_max = t1 < t_max ? t1 : t_max;
+		if (t_max < t_min) {
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+	One traversal for both queries. The closest-hit search only records distances and lets the final primitive
+	compute its point and normal, the any-hit search returns from the first leaf with an intersection.
+*/
+template <bool any_hit>
+bool bvh_node::traverse(const ray& r, real t_min, real t_max, hit_record& rec) const {
+
+	if (node_total == 0) {
+
+		return false;
+	}
+
+	const point3 origin = r.origin();
+	const vec3 direction = r.direction();
+	const vec3 inv_dir(1 / direction.e[0], 1 / direction.e[1], 1 / direction.e[2]);
+	const bool dir_is_negative[3] = { inv_dir.e[0] < 0, inv_dir.e[1] < 0, inv_dir.e[2] < 0 };
+
+	std::uint32_t stack[traversal_stack_size];
+	int stack_size = 0;
+	std::uint32_t current = 0;
+
+	bool hit_anything = false;
+	auto closest_so_far = t_max;
+	std::uint64_t visited = 0;
+	std::uint64_t tests = 0;
+
+	while (true) {
+
+		const auto& node = node_array[current];
+		++visited;
+		if (hit_bounds(node.bounds, origin, inv_dir, t_min, closest_so_far)) {
+
+			if (node.flags & sphere_leaf) {
+
+				tests += node.count;
+				if (any_hit) {
+
+					if (packed_spheres.occluded_range(r, node.offset, node.count, t_min, closest_so_far)) {
+
+						hit_anything = true;
+						break;
+					}
+				}
+				else if (packed_spheres.intersect_range(r, node.offset, node.count, t_min, closest_so_far, rec)) {
+
+					hit_anything = true;
+					closest_so_far = rec.t;
+				}
+			}
+			else if (node.count > 0) {
+
+				for (std::uint32_t i = 0; i < node.count; ++i) {
+
+					++tests;
+					const auto& object = primitives[node.offset + i];
+					if (any_hit) {
+
+						if (object->occluded(r, t_min, closest_so_far)) {
+
+							hit_anything = true;
+							break;
+						}
+					}
+					else if (object->intersect(r, t_min, closest_so_far, rec)) {
+
+						hit_anything = true;
+						closest_so_far = rec.t;
+					}
+				}
+				if (any_hit && hit_anything) {
+
+					break;
+				}
+			}
+			else {
+
+				// Visit the child on the near side of the split plane first, so closest_so_far shrinks sooner.
+				if (dir_is_negative[node.axis]) {
+
+					stack[stack_size++] = current + 1;
+					current = node.offset;
+				}
+				else {
+
+					stack[stack_size++] = node.offset;
+					current = current + 1;
+				}
+				continue;
+			}
+		}
+
+		if (stack_size == 0) {
+
+			break;
+		}
+		current = stack[--stack_size];
+	}
+
+	RT_PROFILE_ADD(bvh_nodes, visited);
+	if (any_hit) {
+
+		RT_PROFILE_ADD(shadow_rays, 1);
+	}
+
+	if (stats_enabled) {
+
+		rays_traced.fetch_add(1, std::memory_order_relaxed);
+		nodes_visited.fetch_add(visited, std::memory_order_relaxed);
+		primitive_tests.fetch_add(tests, std::memory_order_relaxed);
+	}
+
+	return hit_anything;
+}
+
+bool bvh_node::hit(const ray& r, real t_min, real t_max, hit_record& rec) const {
+
+	if (!traverse<false>(r, t_min, t_max, rec)) {
+
+		return false;
+	}
+
+	rec.object->finish_hit(r, rec);
+	return true;
+}
+
+bool bvh_node::intersect(const ray& r, real t_min, real t_max, hit_record& rec) const {
+
+	return traverse<false>(r, t_min, t_max, rec);
+}
+
+bool bvh_node::occluded(const ray& r, real t_min, real t_max) const {
+
+	hit_record unused;
+	return traverse<true>(r, t_min, t_max, unused);
+}
+
+bool bvh_node::bounding_box(aabb& output_box) const {
+
+	if (node_total == 0) {
+
+		return false;
+	}
+
+	output_box = node_array[0].bounds;
+	return true;
+}
+
+double bvh_node::refit() {
+
+	if (node_array != nodes.data()) {
+
+		throw std::logic_error("bvh_node: a view over external nodes cannot be refit");
+	}
+	const auto start = std::chrono::steady_clock::now();
+
+	// Children follow their parent in the array, so a backwards sweep meets them first.
+	for (std::size_t i = nodes.size(); i-- > 0;) {
+
+		auto& node = nodes[i];
+		if (node.count == 0) {
+
+			node.bounds = surrounding_box(nodes[i + 1].bounds, nodes[node.offset].bounds);
+			continue;
+		}
+
+		aabb bounds;
+		for (std::uint32_t k = node.offset; k < node.offset + node.count; ++k) {
+
+			aabb box;
+			if (!primitives[k]->bounding_box(box)) {
+
+				throw std::invalid_argument("bvh_node: every object needs a bounding box");
+			}
+			bounds.expand(box);
+
+			if (node.flags & sphere_leaf) {
+
+				const auto& s = static_cast<const sphere&>(*primitives[k]);
+				packed_spheres.set(k, s.center, s.radius);
+			}
+		}
+		node.bounds = bounds;
+	}
+
+	stats.leaves = 0;
+	stats.sphere_leaves = 0;
+	stats.max_leaf_size = 0;
+	stats.sah_cost = 0.0;
+	summarize();
+
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+const bvh_build_stats& bvh_node::build_stats() const {
+
+	return stats;
+}
+
+void bvh_node::collect_traversal_stats(bool enable) {
+
+	stats_enabled = enable;
+}
+
+bvh_traversal_stats bvh_node::traversal_stats() const {
+
+	bvh_traversal_stats result;
+	result.rays = rays_traced.load();
+	result.nodes_visited = nodes_visited.load();
+	result.primitive_tests = primitive_tests.load();
+	return result;
+}
+
+void bvh_node::reset_traversal_stats() {
+
+	rays_traced = 0;
+	nodes_visited = 0;
+	primitive_tests = 0;
+}
+
+const bvh_node::linear_node* bvh_node::node_data() const {
+
+	return node_array;
+}
+
+std::size_t bvh_node::node_count() const {
+
+	return node_total;
+}
+
+const sphere_soa& bvh_node::spheres() const {
+
+	return packed_spheres;
+}
+
+const std::vector<std::uint32_t>& bvh_node::primitive_order() const {
+
+	return order;
+}
+
+void bvh_node::print_report(std::ostream& out) const {
+
+	out << "BVH build: " << stats.primitives << " primitives, " << stats.nodes << " nodes, "
+		<< stats.leaves << " leaves (max " << stats.max_leaf_size << " primitives, "
+		<< stats.sphere_leaves << " packed " << sphere_soa::simd_backend() << "), depth " << stats.max_depth
+		<< ", SAH cost " << stats.sah_cost << ", " << stats.build_ms << " ms\n";
+
+	const auto traversal = traversal_stats();
+	if (traversal.rays > 0) {
+
+		const double rays = static_cast<double>(traversal.rays);
+		out << "BVH traversal: " << traversal.rays << " rays, "
+			<< traversal.nodes_visited / rays << " nodes/ray, "
+			<< traversal.primitive_tests / rays << " primitive tests/ray\n";
+	}
+}
\ No newline at end of file
@@ -1,6 +1,179 @@
 #include "camera.hpp"
 
-ray camera::get_ray(double u, double v) const {
+#include <stdexcept>
+
+void ray_batch::resize(std::size_t count) {
+
+	origin_x.resize(count);
+	origin_y.resize(count);
+	origin_z.resize(count);
+	direction_x.resize(count);
+	direction_y.resize(count);
+	direction_z.resize(count);
+}
+
+std::size_t ray_batch::size() const {
+
+	return origin_x.size();
+}
+
+ray ray_batch::get(std::size_t i) const {
+
+	return ray(point3(origin_x[i], origin_y[i], origin_z[i]), vec3(direction_x[i], direction_y[i], direction_z[i]));
+}
+
+camera::camera(const camera_settings& settings) {
+
+	if (settings.aperture < 0 || settings.focus_distance < 0) {
+
+		throw std::invalid_argument("camera: negative aperture or focus distance");
+	}
+
+	// The viewport lies in the plane in focus, which is the projection plane unless a focus distance is given.
+	const real plane_distance = settings.focus_distance > 0 ? settings.focus_distance : settings.focal_length;
+	const auto theta = static_cast<real>(degrees_to_radians(settings.vfov));
+	const real viewport_height = 2 * plane_distance * std::tan(theta / 2);
+	const real viewport_width = settings.aspect_ratio * viewport_height;
+
+	// Orthonormal camera frame: w points backwards, u to the right and v up.
+	const vec3 w = unit_vector(settings.lookfrom - settings.lookat);
+	const vec3 u = unit_vector(cross(settings.vup, w));
+	const vec3 v = cross(w, u);
+
+	origin = settings.lookfrom;
+	horizontal = viewport_width * u;
+	vertical = viewport_height * v;
+	lower_left_corner = origin - (horizontal / 2) - (vertical / 2) - plane_distance * w;
+
+	lens = settings.aperture > 0;
+	lens_u = (settings.aperture / 2) * u;
+	lens_v = (settings.aperture / 2) * v;
+}
+
+ray camera::get_ray(real u, real v) const {
 
 	return ray(origin, lower_left_corner + u * horizontal + v * vertical - origin);
+}
+
+ray camera::get_ray(real u, real v, double lens_s, double lens_t) const {
+
+	const vec3 disk = map_in_unit_disk(lens_s, lens_t);
+	const vec3 offset = disk.x() * lens_u + disk.y() * lens_v;
+	return ray(origin + offset, lower_left_corner + u * horizontal + v * vertical - origin - offset);
+}
+
+bool camera::has_lens() const {
+
+	return lens;
+}
+
+int camera::sample_dimensions() const {
+
+	return lens ? 4 : 2;
+}
+
+point3 camera::position() const {
+
+	return origin;
+}
+
+point3 camera::viewport_corner() const {
+
+	return lower_left_corner;
+}
+
+vec3 camera::viewport_horizontal() const {
+
+	return horizontal;
+}
+
+vec3 camera::viewport_vertical() const {
+
+	return vertical;
+}
+
+vec3 camera::lens_horizontal() const {
+
+	return lens_u;
+}
+
+vec3 camera::lens_vertical() const {
+
+	return lens_v;
+}
+
+camera_raster::camera_raster(const camera& cam, int width, int height) :
+	origin{ cam.position() },
+	to_corner{ cam.viewport_corner() - cam.position() },
+	pixel_u{ cam.viewport_horizontal() / static_cast<real>(width > 1 ? width - 1 : 1) },
+	pixel_v{ cam.viewport_vertical() / static_cast<real>(height > 1 ? height - 1 : 1) },
+	lens_u{ cam.lens_horizontal() },
+	lens_v{ cam.lens_vertical() },
+	lens{ cam.has_lens() },
+	height{ height }
+{}
+
+ray camera_raster::get_ray(int x, int y, const double* sample) const {
+
+	// Image rows run top to bottom, while v runs bottom to top. The same sums in the same order as generate().
+	const vec3 base = to_corner + static_cast<real>(x) * pixel_u + static_cast<real>(height - 1 - y) * pixel_v;
+	const vec3 direction = base + static_cast<real>(sample[0]) * pixel_u + static_cast<real>(sample[1]) * pixel_v;
+	if (!lens) {
+
+		return ray(origin, direction);
+	}
+
+	const vec3 disk = map_in_unit_disk(sample[2], sample[3]);
+	const vec3 offset = disk.x() * lens_u + disk.y() * lens_v;
+	return ray(origin + offset, direction - offset);
+}
+
+void camera_raster::generate(int x, int y, const double* samples, int count, ray_batch& out) const {
+
+	if (out.size() < static_cast<std::size_t>(count)) {
+
+		out.resize(static_cast<std::size_t>(count));
+	}
+
+	real* ox = out.origin_x.data();
+	real* oy = out.origin_y.data();
+	real* oz = out.origin_z.data();
+	real* dx = out.direction_x.data();
+	real* dy = out.direction_y.data();
+	real* dz = out.direction_z.data();
+	const auto row = static_cast<real>(height - 1 - y);
+
+	if (!lens) {
+
+		// One multiply-add per axis and sample, with no branch in the loop so it vectorizes.
+		const vec3 base = to_corner + static_cast<real>(x) * pixel_u + row * pixel_v;
+		for (int i = 0; i < count; ++i) {
+
+			const auto s = static_cast<real>(samples[2 * i]);
+			const auto t = static_cast<real>(samples[2 * i + 1]);
+			ox[i] = origin.x();
+			oy[i] = origin.y();
+			oz[i] = origin.z();
+			dx[i] = base.x() + s * pixel_u.x() + t * pixel_v.x();
+			dy[i] = base.y() + s * pixel_u.y() + t * pixel_v.y();
+			dz[i] = base.z() + s * pixel_u.z() + t * pixel_v.z();
+		}
+		return;
+	}
+
+	for (int i = 0; i < count; ++i) {
+
+		const ray r = get_ray(x, y, samples + 4 * i);
+		ox[i] = r.origin().x();
+		oy[i] = r.origin().y();
+		oz[i] = r.origin().z();
+		dx[i] = r.direction().x();
+		dy[i] = r.direction().y();
+		dz[i] = r.direction().z();
+	}
+}
+
+int camera_raster::sample_dimensions() const {
+
+	return lens ? 4 : 2;
 }
\ No newline at end of file
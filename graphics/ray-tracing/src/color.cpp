@@ -1,19 +1,47 @@
 #include "color.hpp"
 
-void write_color(std::ostream& out, color pixel_color, int samples_per_pixel) {
-
-	auto r = pixel_color.x();
-	auto g = pixel_color.y();
-	auto b = pixel_color.z();
-
-	// Divide the color by the number of samples and gamma-correct for gamma=2.0.
-	auto scale = 1.0 / samples_per_pixel;
-	r = sqrt(scale * r);
-	g = sqrt(scale * g);
-	b = sqrt(scale * b);
-
-	// Write the translated [0,255] value of each color component.
-	out << static_cast<int>(256 * clamp(r, 0.0, 0.999)) << ' '
-		<< static_cast<int>(256 * clamp(g, 0.0, 0.999)) << ' '
-		<< static_cast<int>(256 * clamp(b, 0.0, 0.999)) << '\n';
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RT_COLOR_SSE2
+#endif
+
+static inline std::uint8_t quantize(float linear) {
+
+	// Gamma-correct for gamma=2.0, then write the translated [0,255] value.
+	// Written so that NaN maps to 0, like the max in the SSE2 path.
+	const float v = std::sqrt(linear > 0.0f ? linear : 0.0f);
+	return static_cast<std::uint8_t>(256.0f * std::min(v, 0.999f));
+}
+
+void quantize_channels(const float* linear, std::uint8_t* out, std::size_t count) {
+
+	std::size_t i = 0;
+
+#ifdef RT_COLOR_SSE2
+	// 16 channels per iteration: four float vectors are converted and then narrowed to one vector of bytes.
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 upper = _mm_set1_ps(0.999f);
+	const __m128 scale = _mm_set1_ps(256.0f);
+	for (; i + 16 <= count; i += 16) {
+
+		__m128i q[4];
+		for (int k = 0; k < 4; ++k) {
+
+			__m128 v = _mm_loadu_ps(linear + i + 4 * k);
+			v = _mm_min_ps(_mm_sqrt_ps(_mm_max_ps(v, zero)), upper);
+			q[k] = _mm_cvttps_epi32(_mm_mul_ps(v, scale));
+		}
+
+		const __m128i lo = _mm_packs_epi32(q[0], q[1]);
+		const __m128i hi = _mm_packs_epi32(q[2], q[3]);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(lo, hi));
+	}
+#endif
+
+	for (; i < count; ++i) {
+
+		out[i] = quantize(linear[i]);
+	}
 }
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include "cuda_backend.hpp"
+
+#include <stdexcept>
+#include <vector>
+
+#include <cuda_runtime.h>
+
+static void check(cudaError_t status, const char* what) {
+
+	if (status != cudaSuccess) {
+
+		throw std::runtime_error(std::string(what) + ": " + cudaGetErrorString(status));
+	}
+}
+
+// Device allocation that is released on every path out of cuda_render.
+template <typename T>
+class device_buffer {
+public:
+	explicit device_buffer(std::size_t count) {
+
+		check(cudaMalloc(&pointer, count * sizeof(T)), "cudaMalloc");
+	}
+
+	~device_buffer() {
+
+		cudaFree(pointer);
+	}
+
+	device_buffer(const device_buffer&) = delete;
+	device_buffer& operator=(const device_buffer&) = delete;
+
+	T* get() const { return pointer; }
+
+	void upload(const T* source, std::size_t count) {
+
+		check(cudaMemcpy(pointer, source, count * sizeof(T), cudaMemcpyHostToDevice), "cudaMemcpy to device");
+	}
+
+	void download(T* target, std::size_t count) const {
+
+		check(cudaMemcpy(target, pointer, count * sizeof(T), cudaMemcpyDeviceToHost), "cudaMemcpy to host");
+	}
+private:
+	T* pointer = nullptr;
+};
+
+__global__ void render_kernel(device_scene scene, device_camera cam, device_frame frame, float* image, unsigned long long* rays) {
+
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+	if (x >= frame.width || y >= frame.height) {
+
+		return;
+	}
+
+	float* rgb = image + 3 * (static_cast<std::size_t>(y) * frame.width + x);
+	const auto cast = trace_pixel(scene, cam, frame, x, y, rgb);
+	atomicAdd(rays, static_cast<unsigned long long>(cast));
+}
+
+int cuda_device_count() {
+
+	int count = 0;
+	if (cudaGetDeviceCount(&count) != cudaSuccess) {
+
+		return 0;
+	}
+
+	return count;
+}
+
+std::string cuda_device_name() {
+
+	cudaDeviceProp properties;
+	check(cudaGetDeviceProperties(&properties, 0), "cudaGetDeviceProperties");
+	return properties.name;
+}
+
+std::uint64_t cuda_render(const device_scene& scene, std::size_t sphere_count, const device_camera& cam,
+	const device_frame& frame, float* image) {
+
+	check(cudaSetDevice(0), "cudaSetDevice");
+
+	device_buffer<device_node> nodes(scene.node_count);
+	nodes.upload(scene.nodes, scene.node_count);
+
+	// The kernel does not read past a leaf, so the spheres need no padding on the device.
+	device_buffer<real> centers_x(sphere_count), centers_y(sphere_count), centers_z(sphere_count), radii(sphere_count);
+	centers_x.upload(scene.center[0], sphere_count);
+	centers_y.upload(scene.center[1], sphere_count);
+	centers_z.upload(scene.center[2], sphere_count);
+	radii.upload(scene.radius, sphere_count);
+
+	device_scene on_device = scene;
+	on_device.nodes = nodes.get();
+	on_device.center[0] = centers_x.get();
+	on_device.center[1] = centers_y.get();
+	on_device.center[2] = centers_z.get();
+	on_device.radius = radii.get();
+
+	const std::size_t pixels = static_cast<std::size_t>(frame.width) * frame.height;
+	device_buffer<float> pixels_on_device(3 * pixels);
+	device_buffer<unsigned long long> rays(1);
+	check(cudaMemset(rays.get(), 0, sizeof(unsigned long long)), "cudaMemset");
+
+	// Paths are long and divergent, deep traversal stacks live in local memory anyway, so small blocks schedule best.
+	const dim3 block(8, 8);
+	const dim3 grid((frame.width + block.x - 1) / block.x, (frame.height + block.y - 1) / block.y);
+	render_kernel<<<grid, block>>>(on_device, cam, frame, pixels_on_device.get(), rays.get());
+	check(cudaGetLastError(), "render_kernel launch");
+	check(cudaDeviceSynchronize(), "render_kernel");
+
+	pixels_on_device.download(image, 3 * pixels);
+	unsigned long long total = 0;
+	rays.download(&total, 1);
+
+	return total;
+}
\ No newline at end of file
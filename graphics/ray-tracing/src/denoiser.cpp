@@ -0,0 +1,315 @@
+#include "denoiser.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+#ifdef RT_ENABLE_OIDN
+#include <OpenImageDenoise/oidn.hpp>
+#endif
+
+denoiser_type denoiser_type_from_name(const std::string& name) {
+
+	if (name == "none") return denoiser_type::none;
+	if (name == "atrous") return denoiser_type::atrous;
+	if (name == "oidn") return denoiser_type::oidn;
+
+	throw std::invalid_argument("unknown denoiser " + name);
+}
+
+const char* denoiser_type_name(denoiser_type type) {
+
+	switch (type) {
+	case denoiser_type::atrous: return "atrous";
+	case denoiser_type::oidn: return "oidn";
+	case denoiser_type::none:
+	default: return "none";
+	}
+}
+
+bool oidn_available() {
+
+#ifdef RT_ENABLE_OIDN
+	return true;
+#else
+	return false;
+#endif
+}
+
+namespace {
+
+// Below this albedo, a channel is filtered as it is instead of divided by the albedo.
+const float min_albedo = 0.01f;
+
+// The guides of one pixel, gathered from the AOVs once.
+struct guide {
+	float normal[3];
+	float depth;
+	float depth_gradient;   // the larger of the depth steps to the neighbors, per pixel
+};
+
+float luminance(const float* c) {
+
+	return 0.2126f * c[0] + 0.7152f * c[1] + 0.0722f * c[2];
+}
+
+std::vector<guide> make_guides(const aov_buffers& aovs) {
+
+	const int width = aovs.depth.width();
+	const int height = aovs.depth.height();
+	std::vector<guide> guides(aovs.depth.pixel_count());
+	const float* normal = aovs.normal.data();
+	const float* depth = aovs.depth.data();
+	auto depth_at = [&](int x, int y) { return depth[3 * (static_cast<std::size_t>(y) * width + x)]; };
+
+	for (int y = 0; y < height; ++y) {
+
+		for (int x = 0; x < width; ++x) {
+
+			const std::size_t i = static_cast<std::size_t>(y) * width + x;
+			guide& g = guides[i];
+			std::copy(normal + 3 * i, normal + 3 * i + 3, g.normal);
+			g.depth = depth_at(x, y);
+
+			// Central differences where both neighbors are surfaces, so silhouettes do not count as slopes.
+			float gradient = 0;
+			const int xs[] = { std::max(x - 1, 0), std::min(x + 1, width - 1) };
+			const int ys[] = { std::max(y - 1, 0), std::min(y + 1, height - 1) };
+			const float dx[] = { depth_at(xs[0], y), depth_at(xs[1], y) };
+			const float dy[] = { depth_at(x, ys[0]), depth_at(x, ys[1]) };
+			if (dx[0] > 0 && dx[1] > 0) gradient = std::max(gradient, std::fabs(dx[1] - dx[0]) / std::max(xs[1] - xs[0], 1));
+			if (dy[0] > 0 && dy[1] > 0) gradient = std::max(gradient, std::fabs(dy[1] - dy[0]) / std::max(ys[1] - ys[0], 1));
+			g.depth_gradient = gradient;
+		}
+	}
+
+	return guides;
+}
+
+/*
+	Weight of neighbor q for pixel p by the guides alone, distance the number of pixels between them.
+	Sky and surface never mix; two sky pixels only differ by their color.
+*/
+float guide_weight(const guide& p, const guide& q, float distance, const denoise_settings& settings) {
+
+	if ((p.depth > 0) != (q.depth > 0)) {
+
+		return 0;
+	}
+	if (p.depth == 0) {
+
+		return 1;
+	}
+
+	const float cosine = p.normal[0] * q.normal[0] + p.normal[1] * q.normal[1] + p.normal[2] * q.normal[2];
+	const float w_normal = std::pow(std::max(cosine, 0.0f), static_cast<float>(settings.normal_sigma));
+	const float w_depth = std::exp(-std::fabs(p.depth - q.depth)
+		/ (static_cast<float>(settings.depth_sigma) * p.depth_gradient * distance + 1e-3f * p.depth));
+	return w_normal * w_depth;
+}
+
+/*
+	Initial noise estimate: the luminance variance over the 5x5 neighborhood of every pixel,
+	weighted by the guides so that the other side of an edge does not count as noise.
+*/
+std::vector<float> spatial_variance(const std::vector<float>& irradiance, const std::vector<guide>& guides,
+	int width, int height, const denoise_settings& settings, thread_pool& pool) {
+
+	std::vector<float> variance(guides.size());
+	pool.parallel_for(static_cast<std::size_t>(height), [&](std::size_t row) {
+
+		const int y = static_cast<int>(row);
+		for (int x = 0; x < width; ++x) {
+
+			const std::size_t p = static_cast<std::size_t>(y) * width + x;
+			float weights = 0, sum = 0, squares = 0;
+			for (int dy = -2; dy <= 2; ++dy) {
+
+				for (int dx = -2; dx <= 2; ++dx) {
+
+					const int qx = x + dx, qy = y + dy;
+					if (qx < 0 || qx >= width || qy < 0 || qy >= height) {
+
+						continue;
+					}
+					const std::size_t q = static_cast<std::size_t>(qy) * width + qx;
+					const float w = guide_weight(guides[p], guides[q], std::sqrt(static_cast<float>(dx * dx + dy * dy)), settings);
+					const float l = luminance(&irradiance[3 * q]);
+					weights += w;
+					sum += w * l;
+					squares += w * l * l;
+				}
+			}
+			const float mean = weights > 0 ? sum / weights : 0;
+			variance[p] = weights > 0 ? std::max(squares / weights - mean * mean, 0.0f) : 0;
+		}
+	});
+
+	return variance;
+}
+
+// One a-trous pass with taps step pixels apart, filtering the variance along with squared weights.
+void atrous_pass(const std::vector<float>& in, const std::vector<float>& variance_in, const std::vector<guide>& guides,
+	int width, int height, int step, const denoise_settings& settings, thread_pool& pool, std::vector<float>& out,
+	std::vector<float>& variance_out) {
+
+	// The B3 spline, the a-trous scaling kernel.
+	static const float kernel[] = { 1.0f / 16, 1.0f / 4, 3.0f / 8, 1.0f / 4, 1.0f / 16 };
+
+	pool.parallel_for(static_cast<std::size_t>(height), [&](std::size_t row) {
+
+		const int y = static_cast<int>(row);
+		for (int x = 0; x < width; ++x) {
+
+			const std::size_t p = static_cast<std::size_t>(y) * width + x;
+			const float l_p = luminance(&in[3 * p]);
+
+			// The noise of the pixel, blurred over its 3x3 neighborhood so a single outlier does not stop the filter.
+			float blurred = 0, blur_weights = 0;
+			for (int dy = -1; dy <= 1; ++dy) {
+
+				for (int dx = -1; dx <= 1; ++dx) {
+
+					const int qx = x + dx, qy = y + dy;
+					if (qx >= 0 && qx < width && qy >= 0 && qy < height) {
+
+						const float w = (dx == 0 ? 0.5f : 0.25f) * (dy == 0 ? 0.5f : 0.25f);
+						blurred += w * variance_in[static_cast<std::size_t>(qy) * width + qx];
+						blur_weights += w;
+					}
+				}
+			}
+			const float luminance_scale = static_cast<float>(settings.color_sigma) * std::sqrt(blurred / blur_weights) + 1e-4f;
+
+			float sum[3] = { 0, 0, 0 };
+			float weights = 0, variance = 0;
+			for (int j = -2; j <= 2; ++j) {
+
+				for (int i = -2; i <= 2; ++i) {
+
+					const int qx = x + i * step, qy = y + j * step;
+					if (qx < 0 || qx >= width || qy < 0 || qy >= height) {
+
+						continue;
+					}
+					const std::size_t q = static_cast<std::size_t>(qy) * width + qx;
+					const float distance = static_cast<float>(step) * std::sqrt(static_cast<float>(i * i + j * j));
+					const float w_luminance = std::exp(-std::fabs(l_p - luminance(&in[3 * q])) / luminance_scale);
+					const float w = kernel[i + 2] * kernel[j + 2] * w_luminance * guide_weight(guides[p], guides[q], distance, settings);
+
+					sum[0] += w * in[3 * q];
+					sum[1] += w * in[3 * q + 1];
+					sum[2] += w * in[3 * q + 2];
+					weights += w;
+					variance += w * w * variance_in[q];
+				}
+			}
+
+			// The center tap has a weight by the guides of 1, unless the pixel's normal is missing.
+			if (weights <= 0) {
+
+				std::copy(&in[3 * p], &in[3 * p] + 3, &out[3 * p]);
+				variance_out[p] = variance_in[p];
+				continue;
+			}
+			for (int c = 0; c < 3; ++c) {
+
+				out[3 * p + c] = sum[c] / weights;
+			}
+			variance_out[p] = variance / (weights * weights);
+		}
+	});
+}
+
+void denoise_atrous(const framebuffer& noisy, const aov_buffers& aovs, const denoise_settings& settings, framebuffer& result) {
+
+	const int width = noisy.width();
+	const int height = noisy.height();
+	const std::size_t count = 3 * noisy.pixel_count();
+	const float* albedo = aovs.albedo.data();
+
+	// Demodulate: filter the light arriving at the surface, not the texture of the surface.
+	std::vector<float> irradiance(count);
+	for (std::size_t i = 0; i < count; ++i) {
+
+		irradiance[i] = albedo[i] > min_albedo ? noisy.data()[i] / albedo[i] : noisy.data()[i];
+	}
+
+	thread_pool pool(settings.thread_count);
+	const auto guides = make_guides(aovs);
+	auto variance = spatial_variance(irradiance, guides, width, height, settings, pool);
+
+	std::vector<float> filtered(count);
+	std::vector<float> filtered_variance(variance.size());
+	for (int pass = 0; pass < settings.iterations; ++pass) {
+
+		atrous_pass(irradiance, variance, guides, width, height, 1 << pass, settings, pool, filtered, filtered_variance);
+		irradiance.swap(filtered);
+		variance.swap(filtered_variance);
+	}
+
+	result.resize(width, height);
+	for (std::size_t i = 0; i < count; ++i) {
+
+		result.data()[i] = albedo[i] > min_albedo ? irradiance[i] * albedo[i] : irradiance[i];
+	}
+}
+
+#ifdef RT_ENABLE_OIDN
+void denoise_oidn(const framebuffer& noisy, const aov_buffers& aovs, framebuffer& result) {
+
+	const auto width = static_cast<std::size_t>(noisy.width());
+	const auto height = static_cast<std::size_t>(noisy.height());
+	result.resize(noisy.width(), noisy.height());
+
+	oidn::DeviceRef device = oidn::newDevice();
+	device.commit();
+
+	// The filter only reads its inputs, the API takes them as non-const pointers.
+	oidn::FilterRef filter = device.newFilter("RT");
+	filter.setImage("color", const_cast<float*>(noisy.data()), oidn::Format::Float3, width, height);
+	filter.setImage("albedo", const_cast<float*>(aovs.albedo.data()), oidn::Format::Float3, width, height);
+	filter.setImage("normal", const_cast<float*>(aovs.normal.data()), oidn::Format::Float3, width, height);
+	filter.setImage("output", result.data(), oidn::Format::Float3, width, height);
+	filter.set("hdr", true);
+	filter.commit();
+	filter.execute();
+
+	const char* message = nullptr;
+	if (device.getError(message) != oidn::Error::None) {
+
+		throw std::runtime_error(std::string("Open Image Denoise: ") + (message ? message : "unknown error"));
+	}
+}
+#endif
+
+}
+
+void denoise(const framebuffer& noisy, const aov_buffers& aovs, const denoise_settings& settings, framebuffer& result) {
+
+	for (const framebuffer* aov : { &aovs.albedo, &aovs.normal, &aovs.depth }) {
+
+		if (aov->width() != noisy.width() || aov->height() != noisy.height()) {
+
+			throw std::invalid_argument("denoise: the AOVs differ in size from the image");
+		}
+	}
+
+	switch (settings.type) {
+	case denoiser_type::none:
+		result = noisy;
+		return;
+	case denoiser_type::oidn:
+#ifdef RT_ENABLE_OIDN
+		denoise_oidn(noisy, aovs, result);
+		return;
+#endif
+	case denoiser_type::atrous:
+	default:
+		denoise_atrous(noisy, aovs, settings, result);
+		return;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,578 @@
+#include "distributed.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "camera.hpp"
+#include "net.hpp"
+#include "scene_file.hpp"
+
+namespace {
+
+	const std::uint32_t protocol_version = 2;
+
+	enum message_type : std::uint32_t {
+		hello_message = 1,    // worker: protocol version
+		scene_message = 2,    // coordinator: render settings and the scene file
+		ready_message = 3,    // worker: scene loaded
+		failure_message = 4,  // worker: why it cannot render the scene
+		task_message = 5,     // coordinator: task id, tile and sample range
+		result_message = 6,   // worker: task id, rays traced and the sample sums of the tile's pixels
+		done_message = 7      // coordinator: no tasks left
+	};
+
+	// Payload limits besides results, whose size the coordinator knows from the task.
+	const std::uint64_t max_reply_size = 1 << 12;   // ready, or failure and its reason
+	const std::uint64_t max_settings_size = 64;     // render settings ahead of the scene file
+
+	using clock = std::chrono::steady_clock;
+
+	struct render_task {
+		tile area;
+		std::size_t tile_index;
+		std::uint32_t first;   // samples every pixel of the tile already has when this task is merged
+		int count;
+		int attempts = 0;
+		int running = 0;       // two while a stolen copy is in flight
+		bool done = false;
+		clock::time_point started;
+	};
+
+	/*
+		The coordinator's task queue and reorder buffer, shared by the threads serving the workers.
+		Task ids run chunk by chunk over all tiles, so the task after id on the same tile is id + tile_count.
+	*/
+	class task_board {
+	public:
+		task_board(std::vector<render_task> all_tasks, std::size_t tiles, int attempts, accumulation_buffer& target) :
+			tasks{ std::move(all_tasks) },
+			tile_count{ tiles },
+			max_attempts{ std::max(attempts, 1) },
+			accumulation{ target },
+			next_task(tiles)
+		{
+			for (std::size_t id = 0; id < tasks.size(); ++id) {
+
+				pending.push_back(id);
+			}
+			for (std::size_t t = 0; t < tile_count; ++t) {
+
+				next_task[t] = t;
+			}
+		}
+
+		// Waits for the next task a worker should run. Returns false once the render is complete or has failed.
+		bool acquire(std::size_t& id) {
+
+			std::unique_lock<std::mutex> lock(mutex);
+			while (true) {
+
+				if (!error.empty() || merged == tasks.size()) {
+
+					return false;
+				}
+
+				if (!pending.empty()) {
+
+					id = pending.front();
+					pending.pop_front();
+					start(id);
+					return true;
+				}
+
+				if (steal(id)) {
+
+					return true;
+				}
+				changed.wait_for(lock, std::chrono::milliseconds(100));
+			}
+		}
+
+		// Merges a result. Only the first of a task's runs counts, later copies are dropped.
+		void complete(std::size_t id, std::uint64_t task_rays, std::vector<color> sums) {
+
+			std::lock_guard<std::mutex> lock(mutex);
+			auto& task = tasks[id];
+			--task.running;
+			if (task.done) {
+
+				return;
+			}
+
+			task.done = true;
+			rays += task_rays;
+			task_seconds += std::chrono::duration<double>(clock::now() - task.started).count();
+			++completed;
+
+			// Chunks of a tile are merged in sample order, later ones wait here for the ones before them.
+			waiting.emplace(id, std::move(sums));
+			const std::size_t t = task.tile_index;
+			while (next_task[t] < tasks.size()) {
+
+				auto found = waiting.find(next_task[t]);
+				if (found == waiting.end()) {
+
+					break;
+				}
+				merge(tasks[found->first], found->second);
+				waiting.erase(found);
+				next_task[t] += tile_count;
+				++merged;
+			}
+			changed.notify_all();
+		}
+
+		// A run of the task failed. It is queued again unless another copy is still running or it has run out of attempts.
+		void fail(std::size_t id) {
+
+			std::lock_guard<std::mutex> lock(mutex);
+			auto& task = tasks[id];
+			--task.running;
+			if (task.done || task.running > 0) {
+
+				return;
+			}
+
+			if (task.attempts >= max_attempts) {
+
+				error = "task " + std::to_string(id) + " failed " + std::to_string(task.attempts) + " times";
+			}
+			else {
+
+				pending.push_front(id);
+			}
+			changed.notify_all();
+		}
+
+		const render_task& task(std::size_t id) const {
+
+			return tasks[id];
+		}
+
+		bool finished() const {
+
+			std::lock_guard<std::mutex> lock(mutex);
+			return !error.empty() || merged == tasks.size();
+		}
+
+		std::string failure() const {
+
+			std::lock_guard<std::mutex> lock(mutex);
+			return error;
+		}
+
+		std::size_t merged_count() const {
+
+			std::lock_guard<std::mutex> lock(mutex);
+			return merged;
+		}
+
+		std::size_t size() const {
+
+			return tasks.size();
+		}
+
+		std::uint64_t rays_traced() const {
+
+			std::lock_guard<std::mutex> lock(mutex);
+			return rays;
+		}
+
+		std::size_t steal_count() const {
+
+			std::lock_guard<std::mutex> lock(mutex);
+			return steals;
+		}
+	private:
+		void start(std::size_t id) {
+
+			auto& task = tasks[id];
+			++task.attempts;
+			++task.running;
+			task.started = clock::now();
+		}
+
+		// The oldest task in flight that has run longer than the mean, if it is not running twice already.
+		bool steal(std::size_t& id) {
+
+			if (completed == 0) {
+
+				return false;
+			}
+			const double mean_seconds = task_seconds / static_cast<double>(completed);
+			const auto now = clock::now();
+
+			bool found = false;
+			for (std::size_t candidate = 0; candidate < tasks.size(); ++candidate) {
+
+				const auto& task = tasks[candidate];
+				if (task.done || task.running != 1 || std::chrono::duration<double>(now - task.started).count() <= mean_seconds) {
+
+					continue;
+				}
+				if (!found || task.started < tasks[id].started) {
+
+					id = candidate;
+					found = true;
+				}
+			}
+
+			if (found) {
+
+				// A stolen copy counts as a run but keeps the original's start time, steals should not reset the clock.
+				++tasks[id].attempts;
+				++tasks[id].running;
+				++steals;
+			}
+			return found;
+		}
+
+		void merge(const render_task& task, const std::vector<color>& sums) {
+
+			const int width = task.area.x1 - task.area.x0;
+			for (int y = task.area.y0; y < task.area.y1; ++y) {
+
+				for (int x = task.area.x0; x < task.area.x1; ++x) {
+
+					const auto& sum = sums[static_cast<std::size_t>(y - task.area.y0) * width + (x - task.area.x0)];
+					accumulation.add(x, y, sum, static_cast<std::uint32_t>(task.count));
+				}
+			}
+		}
+	private:
+		mutable std::mutex mutex;
+		std::condition_variable changed;
+		std::vector<render_task> tasks;
+		std::size_t tile_count;
+		int max_attempts;
+		accumulation_buffer& accumulation;
+
+		std::deque<std::size_t> pending;
+		std::vector<std::size_t> next_task;   // per tile, the next task to merge
+		std::map<std::size_t, std::vector<color>> waiting;
+		std::size_t merged = 0;
+		std::size_t completed = 0;
+		double task_seconds = 0;
+		std::uint64_t rays = 0;
+		std::size_t steals = 0;
+		std::string error;
+	};
+
+	std::mutex log_mutex;
+
+	void log(const std::string& line) {
+
+		std::lock_guard<std::mutex> lock(log_mutex);
+		std::cerr << line << '\n';
+	}
+
+	std::vector<std::uint8_t> encode_scene_message(const render_settings& settings, const std::vector<std::uint8_t>& scene_bytes) {
+
+		byte_writer out;
+		out.put_u32(static_cast<std::uint32_t>(settings.image_width));
+		out.put_u32(static_cast<std::uint32_t>(settings.image_height));
+		out.put_u32(static_cast<std::uint32_t>(settings.samples_per_pixel));
+		out.put_u32(static_cast<std::uint32_t>(settings.max_depth));
+		out.put_u32(static_cast<std::uint32_t>(settings.integrator));
+		out.put_u32(static_cast<std::uint32_t>(settings.rr_min_depth));
+		out.put_u32(static_cast<std::uint32_t>(settings.sampler));
+		out.put_u64(settings.seed);
+		out.put_u64(scene_bytes.size());
+		out.put_bytes(scene_bytes.data(), scene_bytes.size());
+		return std::move(out.bytes());
+	}
+
+	std::vector<std::uint8_t> encode_task(std::size_t id, const render_task& task) {
+
+		byte_writer out;
+		out.put_u64(id);
+		out.put_u32(static_cast<std::uint32_t>(task.area.x0));
+		out.put_u32(static_cast<std::uint32_t>(task.area.y0));
+		out.put_u32(static_cast<std::uint32_t>(task.area.x1));
+		out.put_u32(static_cast<std::uint32_t>(task.area.y1));
+		out.put_u32(task.first);
+		out.put_u32(static_cast<std::uint32_t>(task.count));
+		return std::move(out.bytes());
+	}
+
+	// Sums go over the wire as doubles, which hold a real of either precision exactly.
+	std::vector<std::uint8_t> encode_result(std::uint64_t id, std::uint64_t rays, const std::vector<color>& sums) {
+
+		byte_writer out;
+		out.put_u64(id);
+		out.put_u64(rays);
+		for (const auto& sum : sums) {
+
+			for (int c = 0; c < 3; ++c) {
+
+				out.put_f64(static_cast<double>(sum[c]));
+			}
+		}
+		return std::move(out.bytes());
+	}
+
+	// Talks to one worker until there are no tasks left or the worker fails, whose task then goes back to the board.
+	void serve_worker(tcp_connection connection, int worker, task_board& board, const std::vector<std::uint8_t>& scene,
+		double task_timeout) {
+
+		bool holding = false;
+		std::size_t id = 0;
+		try {
+
+			connection.set_timeout(task_timeout);
+			const auto hello = receive_message(connection, 64);
+			byte_reader version(hello.payload);
+			if (hello.type != hello_message || version.get_u32() != protocol_version) {
+
+				throw std::runtime_error("not a worker of this version");
+			}
+
+			send_message(connection, scene_message, scene);
+			const auto reply = receive_message(connection, max_reply_size);
+			if (reply.type == failure_message) {
+
+				byte_reader why(reply.payload);
+				throw std::runtime_error(why.get_string());
+			}
+			if (reply.type != ready_message) {
+
+				throw std::runtime_error("unexpected reply to the scene");
+			}
+			log("Worker " + std::to_string(worker) + " ready");
+
+			while (board.acquire(id)) {
+
+				holding = true;
+				const auto& task = board.task(id);
+				send_message(connection, task_message, encode_task(id, task));
+
+				const auto pixels = static_cast<std::size_t>(task.area.x1 - task.area.x0) * (task.area.y1 - task.area.y0);
+				const auto result = receive_message(connection, 16 + 24 * std::uint64_t(pixels));
+				byte_reader fields(result.payload);
+				if (result.type != result_message || fields.get_u64() != id || fields.remaining() != 8 + 24 * pixels) {
+
+					throw std::runtime_error("malformed result for task " + std::to_string(id));
+				}
+
+				const auto rays = fields.get_u64();
+				std::vector<color> sums(pixels);
+				for (auto& sum : sums) {
+
+					const auto r = fields.get_f64();
+					const auto g = fields.get_f64();
+					const auto b = fields.get_f64();
+					sum = color(static_cast<real>(r), static_cast<real>(g), static_cast<real>(b));
+				}
+				holding = false;
+				board.complete(id, rays, std::move(sums));
+			}
+
+			send_message(connection, done_message, {});
+		}
+		catch (const std::exception& e) {
+
+			if (holding) {
+
+				board.fail(id);
+			}
+			log("\nWorker " + std::to_string(worker) + " dropped: " + e.what());
+		}
+	}
+}
+
+render_stats coordinate_render(const render_settings& settings, const distributed_settings& distributed,
+	const std::vector<std::uint8_t>& scene_bytes, accumulation_buffer& accumulation) {
+
+	const auto start = clock::now();
+	accumulation.reset(settings.image_width, settings.image_height);
+
+	std::vector<tile> tiles;
+	const int size = distributed.task_tile_size > 0 ? distributed.task_tile_size : 64;
+	for (int y = 0; y < settings.image_height; y += size) {
+
+		for (int x = 0; x < settings.image_width; x += size) {
+
+			tiles.push_back({ x, y, std::min(x + size, settings.image_width), std::min(y + size, settings.image_height) });
+		}
+	}
+
+	const int target = std::max(settings.samples_per_pixel, 1);
+	const int chunk = distributed.task_samples > 0 ? std::min(distributed.task_samples, target) : target;
+	std::vector<render_task> tasks;
+	for (int first = 0; first < target; first += chunk) {
+
+		for (std::size_t t = 0; t < tiles.size(); ++t) {
+
+			render_task task;
+			task.area = tiles[t];
+			task.tile_index = t;
+			task.first = static_cast<std::uint32_t>(first);
+			task.count = std::min(chunk, target - first);
+			tasks.push_back(task);
+		}
+	}
+
+	task_board board(std::move(tasks), tiles.size(), distributed.max_attempts, accumulation);
+	const auto scene = encode_scene_message(settings, scene_bytes);
+
+	tcp_listener listener(distributed.port);
+	log("Coordinating " + std::to_string(board.size()) + " tasks on port " + std::to_string(listener.port()));
+
+	std::vector<std::thread> local_workers;
+	for (int w = 0; w < distributed.local_workers; ++w) {
+
+		const int port = listener.port();
+		const unsigned threads = distributed.local_threads;
+		local_workers.emplace_back([port, threads]() {
+
+			try {
+
+				run_worker("127.0.0.1", port, threads);
+			}
+			catch (const std::exception& e) {
+
+				log(std::string("Local worker stopped: ") + e.what());
+			}
+		});
+	}
+
+	std::vector<std::thread> serving;
+	std::size_t reported = 0;
+	while (!board.finished()) {
+
+		tcp_connection connection;
+		if (listener.accept(connection, 0.1)) {
+
+			const int worker = static_cast<int>(serving.size()) + 1;
+			serving.emplace_back(serve_worker, std::move(connection), worker, std::ref(board), std::cref(scene), distributed.task_timeout);
+		}
+
+		const auto merged = board.merged_count();
+		if (settings.show_progress && merged != reported) {
+
+			std::lock_guard<std::mutex> lock(log_mutex);
+			std::cerr << "\rTasks merged: " << merged << '/' << board.size() << ' ' << std::flush;
+			reported = merged;
+		}
+	}
+
+	for (auto& thread : serving) {
+
+		thread.join();
+	}
+	for (auto& thread : local_workers) {
+
+		thread.join();
+	}
+
+	const auto error = board.failure();
+	if (!error.empty()) {
+
+		throw std::runtime_error("distributed render failed: " + error);
+	}
+	if (board.steal_count() > 0) {
+
+		log("\nStole " + std::to_string(board.steal_count()) + " tasks from slow workers");
+	}
+
+	render_stats stats;
+	stats.samples = accumulation.total_samples();
+	stats.rays = board.rays_traced();
+	stats.seconds = std::chrono::duration<double>(clock::now() - start).count();
+	return stats;
+}
+
+std::uint64_t run_worker(const std::string& host, int port, unsigned thread_count) {
+
+	auto connection = tcp_connection::connect(host, port);
+	byte_writer hello;
+	hello.put_u32(protocol_version);
+	send_message(connection, hello_message, hello.bytes());
+
+	const auto scene = receive_message(connection, max_settings_size + default_max_scene_bytes);
+	if (scene.type != scene_message) {
+
+		throw std::runtime_error("expected a scene from " + host);
+	}
+
+	byte_reader fields(scene.payload);
+	render_settings settings;
+	settings.image_width = static_cast<int>(fields.get_u32());
+	settings.image_height = static_cast<int>(fields.get_u32());
+	settings.samples_per_pixel = static_cast<int>(fields.get_u32());
+	settings.max_depth = static_cast<int>(fields.get_u32());
+	settings.integrator = static_cast<integrator_type>(fields.get_u32());
+	settings.rr_min_depth = static_cast<int>(fields.get_u32());
+	settings.sampler = static_cast<sampler_type>(fields.get_u32());
+	settings.seed = fields.get_u64();
+	settings.thread_count = thread_count;
+	settings.show_progress = false;
+
+	std::unique_ptr<mapped_scene> world;
+	try {
+
+		const auto size = static_cast<std::size_t>(fields.get_u64());
+		const auto* bytes = fields.get_bytes(size);
+		world = std::make_unique<mapped_scene>(std::vector<std::uint8_t>(bytes, bytes + size), "the scene from " + host);
+	}
+	catch (const std::exception& e) {
+
+		byte_writer why;
+		why.put_string(e.what());
+		send_message(connection, failure_message, why.bytes());
+		throw;
+	}
+
+	camera_settings view = world->camera();
+	view.aspect_ratio = static_cast<real>(settings.image_width) / static_cast<real>(settings.image_height);
+	const camera cam(view);
+	renderer tracer(settings);
+	tracer.set_materials(world->copy_materials());
+	if (settings.integrator == integrator_type::nee) {
+
+		tracer.set_lights(light_list(world->bvh().spheres(), tracer.materials()));
+	}
+	send_message(connection, ready_message, {});
+
+	std::uint64_t tasks = 0;
+	std::vector<color> sums;
+	while (true) {
+
+		const auto message = receive_message(connection);
+		if (message.type == done_message) {
+
+			return tasks;
+		}
+		if (message.type != task_message) {
+
+			throw std::runtime_error("unexpected message from " + host);
+		}
+
+		byte_reader task(message.payload);
+		const auto id = task.get_u64();
+		tile area;
+		area.x0 = static_cast<int>(task.get_u32());
+		area.y0 = static_cast<int>(task.get_u32());
+		area.x1 = static_cast<int>(task.get_u32());
+		area.y1 = static_cast<int>(task.get_u32());
+		const auto first = task.get_u32();
+		const auto count = static_cast<int>(task.get_u32());
+		if (area.x0 < 0 || area.y0 < 0 || area.x1 > settings.image_width || area.y1 > settings.image_height
+			|| area.x0 >= area.x1 || area.y0 >= area.y1) {
+
+			throw std::runtime_error("task outside the image");
+		}
+
+		const auto rays = tracer.sample_tile(area, *world, cam, first, count, sums);
+		send_message(connection, result_message, encode_result(id, rays, sums));
+		++tasks;
+	}
+}
\ No newline at end of file
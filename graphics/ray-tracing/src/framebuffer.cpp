@@ -0,0 +1,81 @@
+#include "framebuffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+int framebuffer::width() const {
+
+	return w;
+}
+
+int framebuffer::height() const {
+
+	return h;
+}
+
+std::size_t framebuffer::pixel_count() const {
+
+	return static_cast<std::size_t>(w) * h;
+}
+
+void framebuffer::resize(int width, int height) {
+
+	w = width;
+	h = height;
+	pixels.assign(3 * pixel_count(), 0.0f);
+}
+
+color framebuffer::get(int x, int y) const {
+
+	const float* p = &pixels[3 * (static_cast<std::size_t>(y) * w + x)];
+	return color(p[0], p[1], p[2]);
+}
+
+void framebuffer::set(int x, int y, const color& c) {
+
+	float* p = &pixels[3 * (static_cast<std::size_t>(y) * w + x)];
+	p[0] = static_cast<float>(c.x());
+	p[1] = static_cast<float>(c.y());
+	p[2] = static_cast<float>(c.z());
+}
+
+float* framebuffer::data() {
+
+	return pixels.data();
+}
+
+const float* framebuffer::data() const {
+
+	return pixels.data();
+}
+
+image_difference compare_images(const framebuffer& a, const framebuffer& b) {
+
+	if (a.width() != b.width() || a.height() != b.height()) {
+
+		throw std::invalid_argument("compare_images: the images differ in size");
+	}
+
+	image_difference result;
+	const std::size_t count = 3 * a.pixel_count();
+	if (count == 0) {
+
+		return result;
+	}
+
+	double squared = 0;
+	for (std::size_t i = 0; i < count; ++i) {
+
+		const double error = std::fabs(static_cast<double>(a.data()[i]) - b.data()[i]);
+		squared += error * error;
+		result.max_error = std::max(result.max_error, error);
+		result.mean_a += a.data()[i];
+		result.mean_b += b.data()[i];
+	}
+	result.rmse = std::sqrt(squared / count);
+	result.mean_a /= count;
+	result.mean_b /= count;
+
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,190 @@
+#include "gpu_backend.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+#include "thread_pool.hpp"
+
+#ifdef RT_ENABLE_CUDA
+#include "cuda_backend.hpp"
+#endif
+
+render_device render_device_from_name(const std::string& name) {
+
+	if (name == "cpu") return render_device::cpu;
+	if (name == "cuda") return render_device::cuda;
+	if (name == "host-kernel") return render_device::host_kernel;
+
+	throw std::invalid_argument("unknown device " + name);
+}
+
+const char* render_device_name(render_device device) {
+
+	switch (device) {
+	case render_device::cuda: return "cuda";
+	case render_device::host_kernel: return "host-kernel";
+	case render_device::cpu:
+	default: return "cpu";
+	}
+}
+
+bool cuda_available() {
+
+#ifdef RT_ENABLE_CUDA
+	return cuda_device_count() > 0;
+#else
+	return false;
+#endif
+}
+
+std::string cuda_device_description() {
+
+#ifdef RT_ENABLE_CUDA
+	if (cuda_device_count() == 0) {
+
+		return "no CUDA device found";
+	}
+	return cuda_device_name();
+#else
+	return "built without CUDA support (RT_ENABLE_CUDA)";
+#endif
+}
+
+device_scene_data::device_scene_data(const bvh_node& bvh) :
+	spheres{ bvh.spheres() }
+{
+	const auto* source = bvh.node_data();
+	nodes.reserve(bvh.node_count());
+	for (std::size_t i = 0; i < bvh.node_count(); ++i) {
+
+		const auto& node = source[i];
+		if (node.count > 0 && !(node.flags & bvh_node::sphere_leaf)) {
+
+			throw std::invalid_argument("only scenes made of spheres can be rendered on a device");
+		}
+
+		device_node flat;
+		for (int a = 0; a < 3; ++a) {
+
+			flat.lower[a] = node.bounds.minimum.e[a];
+			flat.upper[a] = node.bounds.maximum.e[a];
+		}
+		flat.offset = node.offset;
+		flat.count = node.count;
+		flat.axis = node.axis;
+		flat.padding = 0;
+		nodes.push_back(flat);
+	}
+}
+
+device_scene device_scene_data::scene() const {
+
+	device_scene result;
+	result.nodes = nodes.data();
+	result.node_count = static_cast<std::uint32_t>(nodes.size());
+	for (int a = 0; a < 3; ++a) {
+
+		result.center[a] = spheres.data(a);
+	}
+	result.radius = spheres.data(3);
+
+	return result;
+}
+
+std::size_t device_scene_data::sphere_count() const {
+
+	return spheres.size();
+}
+
+device_camera make_device_camera(const camera& cam) {
+
+	if (cam.has_lens()) {
+
+		throw std::invalid_argument("the device kernel only has a pinhole camera, set no aperture");
+	}
+
+	device_camera result;
+	for (int a = 0; a < 3; ++a) {
+
+		result.origin[a] = cam.position()[a];
+		result.lower_left[a] = cam.viewport_corner()[a];
+		result.horizontal[a] = cam.viewport_horizontal()[a];
+		result.vertical[a] = cam.viewport_vertical()[a];
+	}
+
+	return result;
+}
+
+device_frame make_device_frame(const render_settings& settings) {
+
+	if (settings.adaptive_threshold > 0) {
+
+		throw std::invalid_argument("adaptive sampling only runs on the cpu device");
+	}
+	if (settings.sampler != sampler_type::independent) {
+
+		throw std::invalid_argument("the device kernel only implements independent sampling");
+	}
+
+	device_frame frame;
+	frame.width = settings.image_width;
+	frame.height = settings.image_height;
+	frame.samples_per_pixel = std::max(settings.samples_per_pixel, 1);
+	frame.max_depth = settings.max_depth;
+	// The recursive integrator is the path estimator without Russian roulette.
+	frame.roulette_depth = settings.integrator == integrator_type::recursive ? settings.max_depth + 1 : settings.rr_min_depth;
+	frame.seed = settings.seed;
+
+	return frame;
+}
+
+render_stats render_on_device(render_device device, const render_settings& settings, const device_scene_data& scene,
+	const camera& cam, framebuffer& image) {
+
+	const auto start = std::chrono::steady_clock::now();
+	const auto frame = make_device_frame(settings);
+	const auto dev_scene = scene.scene();
+	const auto dev_camera = make_device_camera(cam);
+	image.resize(frame.width, frame.height);
+
+	render_stats stats;
+	switch (device) {
+	case render_device::cuda:
+#ifdef RT_ENABLE_CUDA
+		if (!cuda_available()) {
+
+			throw std::runtime_error("cuda: " + cuda_device_description());
+		}
+		stats.rays = cuda_render(dev_scene, scene.sphere_count(), dev_camera, frame, image.data());
+		break;
+#else
+		throw std::runtime_error("cuda: " + cuda_device_description());
+#endif
+	case render_device::host_kernel: {
+
+		thread_pool pool(settings.thread_count);
+		std::vector<std::uint64_t> row_rays(static_cast<std::size_t>(frame.height), 0);
+		pool.parallel_for(row_rays.size(), [&](std::size_t y) {
+
+			for (int x = 0; x < frame.width; ++x) {
+
+				float* rgb = image.data() + 3 * (y * frame.width + x);
+				row_rays[y] += trace_pixel(dev_scene, dev_camera, frame, x, static_cast<int>(y), rgb);
+			}
+		});
+		for (auto rays : row_rays) {
+
+			stats.rays += rays;
+		}
+		break;
+	}
+	case render_device::cpu:
+	default:
+		throw std::invalid_argument("the cpu device renders through renderer::render()");
+	}
+
+	stats.samples = image.pixel_count() * static_cast<std::uint64_t>(frame.samples_per_pixel);
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return stats;
+}
\ No newline at end of file
@@ -5,26 +5,80 @@ void hittable_list::clear() {
 	objects.clear();
 }
 
+void hittable_list::reserve(std::size_t count) {
+
+	objects.reserve(count);
+}
+
 void hittable_list::add(shared_ptr<hittable> object) {
 
-	objects.push_back(object);
+	objects.push_back(std::move(object));
 }
 
-bool hittable_list::hit(const ray& r, double t_min, double t_max, hit_record& rec) const {
+const shared_ptr<scene_arena>& hittable_list::arena() const {
+
+	return storage;
+}
+
+bool hittable_list::hit(const ray& r, real t_min, real t_max, hit_record& rec) const {
+
+	if (!intersect(r, t_min, t_max, rec)) {
+
+		return false;
+	}
 
-	hit_record temp_rec;
+	rec.object->finish_hit(r, rec);
+	return true;
+}
+
+bool hittable_list::intersect(const ray& r, real t_min, real t_max, hit_record& rec) const {
+
+	// intersect() only writes on success, so candidates can go straight into rec.
 	bool hit_anything = false;
 	auto closest_so_far = t_max;
 
 	for (const auto& object : objects) {
 
-		if (object->hit(r, t_min, closest_so_far, temp_rec)) {
+		if (object->intersect(r, t_min, closest_so_far, rec)) {
 
 			hit_anything = true;
-			closest_so_far = temp_rec.t;
-			rec = temp_rec;
+			closest_so_far = rec.t;
 		}
 	}
 
 	return hit_anything;
+}
+
+bool hittable_list::occluded(const ray& r, real t_min, real t_max) const {
+
+	for (const auto& object : objects) {
+
+		if (object->occluded(r, t_min, t_max)) {
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool hittable_list::bounding_box(aabb& output_box) const {
+
+	if (objects.empty()) {
+
+		return false;
+	}
+
+	aabb temp_box;
+	output_box = aabb();
+	for (const auto& object : objects) {
+
+		if (!object->bounding_box(temp_box)) {
+
+			return false;
+		}
+		output_box.expand(temp_box);
+	}
+
+	return true;
 }
\ No newline at end of file
@@ -0,0 +1,795 @@
+#include "image_io.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+
+#include "color.hpp"
+
+using byte_buffer = std::vector<std::uint8_t>;
+
+static void put_u8(byte_buffer& out, std::uint32_t v) {
+
+	out.push_back(static_cast<std::uint8_t>(v));
+}
+
+static void put_u32_le(byte_buffer& out, std::uint32_t v) {
+
+	for (int i = 0; i < 4; ++i) {
+
+		out.push_back(static_cast<std::uint8_t>(v >> (8 * i)));
+	}
+}
+
+static void put_u64_le(byte_buffer& out, std::uint64_t v) {
+
+	for (int i = 0; i < 8; ++i) {
+
+		out.push_back(static_cast<std::uint8_t>(v >> (8 * i)));
+	}
+}
+
+static void put_u32_be(byte_buffer& out, std::uint32_t v) {
+
+	for (int i = 3; i >= 0; --i) {
+
+		out.push_back(static_cast<std::uint8_t>(v >> (8 * i)));
+	}
+}
+
+static void put_f32_le(byte_buffer& out, float f) {
+
+	std::uint32_t bits;
+	std::memcpy(&bits, &f, sizeof(bits));
+	put_u32_le(out, bits);
+}
+
+static void put_string(byte_buffer& out, const std::string& s, bool terminate) {
+
+	out.insert(out.end(), s.begin(), s.end());
+	if (terminate) {
+
+		out.push_back(0);
+	}
+}
+
+static byte_buffer quantized_pixels(const framebuffer& image) {
+
+	byte_buffer rgb(3 * image.pixel_count());
+	quantize_channels(image.data(), rgb.data(), rgb.size());
+	return rgb;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// PPM / PFM
+// ---------------------------------------------------------------------------------------------------------------------
+
+static std::string ppm_header(int width, int height) {
+
+	return "P6\n" + std::to_string(width) + ' ' + std::to_string(height) + "\n255\n";
+}
+
+static byte_buffer encode_ppm(const framebuffer& image) {
+
+	byte_buffer out;
+	put_string(out, ppm_header(image.width(), image.height()), false);
+
+	const auto rgb = quantized_pixels(image);
+	out.insert(out.end(), rgb.begin(), rgb.end());
+	return out;
+}
+
+static std::string pfm_header(int width, int height) {
+
+	// A negative scale marks little-endian data.
+	return "PF\n" + std::to_string(width) + ' ' + std::to_string(height) + "\n-1.0\n";
+}
+
+// PFM stores the bottom row first, so the rows of image go out bottom up.
+static void put_pfm_rows(byte_buffer& out, const framebuffer& image) {
+
+	const std::size_t row_floats = 3 * static_cast<std::size_t>(image.width());
+	for (int y = image.height() - 1; y >= 0; --y) {
+
+		const float* row = image.data() + y * row_floats;
+		for (std::size_t i = 0; i < row_floats; ++i) {
+
+			put_f32_le(out, row[i]);
+		}
+	}
+}
+
+static byte_buffer encode_pfm(const framebuffer& image) {
+
+	byte_buffer out;
+	put_string(out, pfm_header(image.width(), image.height()), false);
+	out.reserve(out.size() + 12 * image.pixel_count());
+	put_pfm_rows(out, image);
+	return out;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// OpenEXR
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void put_exr_attribute(byte_buffer& out, const std::string& name, const std::string& type, const byte_buffer& value) {
+
+	put_string(out, name, true);
+	put_string(out, type, true);
+	put_u32_le(out, static_cast<std::uint32_t>(value.size()));
+	out.insert(out.end(), value.begin(), value.end());
+}
+
+/*
+	Single-part scanline file without compression. With NO_COMPRESSION every chunk holds one scanline,
+	laid out as the row index, the byte count and then one full row per channel, channels in alphabetical order.
+*/
+static byte_buffer encode_exr_header(int w, int h) {
+
+	byte_buffer out;
+	put_u32_le(out, 20000630);   // magic number
+	put_u32_le(out, 2);          // version 2, single-part scanline
+
+	byte_buffer channels;
+	for (const char* name : { "B", "G", "R" }) {
+
+		put_string(channels, name, true);
+		put_u32_le(channels, 2);   // FLOAT
+		put_u32_le(channels, 0);   // pLinear + reserved
+		put_u32_le(channels, 1);   // xSampling
+		put_u32_le(channels, 1);   // ySampling
+	}
+	put_u8(channels, 0);
+	put_exr_attribute(out, "channels", "chlist", channels);
+
+	put_exr_attribute(out, "compression", "compression", { 0 });
+
+	byte_buffer window;
+	put_u32_le(window, 0);
+	put_u32_le(window, 0);
+	put_u32_le(window, static_cast<std::uint32_t>(w - 1));
+	put_u32_le(window, static_cast<std::uint32_t>(h - 1));
+	put_exr_attribute(out, "dataWindow", "box2i", window);
+	put_exr_attribute(out, "displayWindow", "box2i", window);
+
+	put_exr_attribute(out, "lineOrder", "lineOrder", { 0 });
+
+	byte_buffer one;
+	put_f32_le(one, 1.0f);
+	put_exr_attribute(out, "pixelAspectRatio", "float", one);
+
+	byte_buffer center;
+	put_f32_le(center, 0.0f);
+	put_f32_le(center, 0.0f);
+	put_exr_attribute(out, "screenWindowCenter", "v2f", center);
+	put_exr_attribute(out, "screenWindowWidth", "float", one);
+
+	put_u8(out, 0);   // end of header
+
+	// Uncompressed chunks all have the same size, so the offset table is known before any row is.
+	const std::uint32_t row_bytes = 3u * 4u * static_cast<std::uint32_t>(w);
+	const std::uint64_t chunk_bytes = 8 + row_bytes;
+	const std::uint64_t first_chunk = out.size() + 8ull * h;
+	for (int y = 0; y < h; ++y) {
+
+		put_u64_le(out, first_chunk + y * chunk_bytes);
+	}
+
+	return out;
+}
+
+// The rows of image as the chunks of image rows first_y on.
+static void put_exr_rows(byte_buffer& out, const framebuffer& image, int first_y) {
+
+	const int w = image.width();
+	const std::uint32_t row_bytes = 3u * 4u * static_cast<std::uint32_t>(w);
+	for (int y = 0; y < image.height(); ++y) {
+
+		put_u32_le(out, static_cast<std::uint32_t>(first_y + y));
+		put_u32_le(out, row_bytes);
+
+		const float* row = image.data() + 3 * static_cast<std::size_t>(y) * w;
+		for (int channel = 2; channel >= 0; --channel) {
+
+			for (int x = 0; x < w; ++x) {
+
+				put_f32_le(out, row[3 * x + channel]);
+			}
+		}
+	}
+}
+
+static byte_buffer encode_exr(const framebuffer& image) {
+
+	byte_buffer out = encode_exr_header(image.width(), image.height());
+	out.reserve(out.size() + static_cast<std::size_t>(image.height()) * (8 + 12 * static_cast<std::size_t>(image.width())));
+	put_exr_rows(out, image, 0);
+	return out;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// PNG
+// ---------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+	// Writes deflate bits, least significant bit first. Bits short of a byte can be carried over to the next writer.
+	class bit_writer {
+	public:
+		explicit bit_writer(byte_buffer& output, std::uint64_t pending = 0, int pending_count = 0) :
+			out{ output }, bits{ pending }, bit_count{ pending_count } {}
+
+		void put(std::uint32_t value, int count) {
+
+			bits |= static_cast<std::uint64_t>(value) << bit_count;
+			bit_count += count;
+			while (bit_count >= 8) {
+
+				out.push_back(static_cast<std::uint8_t>(bits));
+				bits >>= 8;
+				bit_count -= 8;
+			}
+		}
+
+		// Huffman codes are defined most significant bit first, so they go out reversed.
+		void put_code(std::uint32_t code, int length) {
+
+			std::uint32_t reversed = 0;
+			for (int i = 0; i < length; ++i) {
+
+				reversed |= ((code >> i) & 1u) << (length - 1 - i);
+			}
+			put(reversed, length);
+		}
+
+		void flush() {
+
+			if (bit_count > 0) {
+
+				out.push_back(static_cast<std::uint8_t>(bits));
+			}
+			bits = 0;
+			bit_count = 0;
+		}
+
+		void save(std::uint64_t& pending, int& pending_count) const {
+
+			pending = bits;
+			pending_count = bit_count;
+		}
+	private:
+		byte_buffer& out;
+		std::uint64_t bits = 0;
+		int bit_count = 0;
+	};
+
+	const std::uint16_t length_base[29] = {
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const std::uint8_t length_extra[29] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const std::uint16_t distance_base[30] = {
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+		1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const std::uint8_t distance_extra[30] = {
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	// Fixed literal/length code of RFC 1951, section 3.2.6.
+	void put_literal_length(bit_writer& bw, std::uint32_t symbol) {
+
+		if (symbol < 144) bw.put_code(0x30 + symbol, 8);
+		else if (symbol < 256) bw.put_code(0x190 + (symbol - 144), 9);
+		else if (symbol < 280) bw.put_code(symbol - 256, 7);
+		else bw.put_code(0xC0 + (symbol - 280), 8);
+	}
+
+	void put_match(bit_writer& bw, int length, int distance) {
+
+		int code = 28;
+		while (length_base[code] > length) --code;
+		put_literal_length(bw, 257 + code);
+		bw.put(length - length_base[code], length_extra[code]);
+
+		code = 29;
+		while (distance_base[code] > distance) --code;
+		bw.put_code(code, 5);
+		bw.put(distance - distance_base[code], distance_extra[code]);
+	}
+}
+
+namespace {
+
+	/*
+		zlib stream of fixed-Huffman deflate blocks, one per write(). Matches are found with a hash chain over 3-byte
+		prefixes in the 32 KiB window, which is plenty for filtered scanlines and keeps the encoder small.
+		The window reaches back into earlier writes, so data written in parts compresses about as well as in one.
+	*/
+	class zlib_deflater {
+	public:
+		// Appends the compressed data to out; the last write, which may be empty, also ends the stream.
+		void write(const std::uint8_t* data, std::size_t size, bool final, byte_buffer& out);
+	private:
+		static const int window = 32768;
+
+		byte_buffer history;   // the last window bytes of the earlier writes
+		std::uint32_t adler_a = 1;
+		std::uint32_t adler_b = 0;
+		std::uint64_t pending_bits = 0;
+		int pending_count = 0;
+		bool started = false;
+	};
+
+	void zlib_deflater::write(const std::uint8_t* data, std::size_t size, bool final, byte_buffer& out) {
+
+		const int hash_bits = 15;
+		const int max_chain = 32;
+		const int min_match = 3;
+		const int max_match = 258;
+
+		if (!started) {
+
+			put_u8(out, 0x78);   // deflate, 32 KiB window
+			put_u8(out, 0x01);   // no dictionary, fastest level, check bits
+			started = true;
+		}
+
+		bit_writer bw(out, pending_bits, pending_count);
+		bw.put(final ? 1 : 0, 1);   // final block
+		bw.put(1, 2);               // fixed Huffman codes
+
+		// The window in front of the new data, so matches can reach into it.
+		const int start = static_cast<int>(history.size());
+		byte_buffer buffer(history);
+		buffer.insert(buffer.end(), data, data + size);
+		const int n = static_cast<int>(buffer.size());
+
+		std::vector<int> head(1 << hash_bits, -1);
+		std::vector<int> prev(window, -1);
+		auto hash_at = [&](int i) {
+
+			const std::uint32_t v = buffer[i] | (buffer[i + 1] << 8) | (buffer[i + 2] << 16);
+			return static_cast<int>((v * 2654435761u) >> (32 - hash_bits));
+		};
+		auto insert = [&](int i) {
+
+			if (i + min_match <= n) {
+
+				const int h = hash_at(i);
+				prev[i & (window - 1)] = head[h];
+				head[h] = i;
+			}
+		};
+		for (int i = 0; i < start; ++i) {
+
+			insert(i);
+		}
+
+		int i = start;
+		while (i < n) {
+
+			int best_length = 0;
+			int best_distance = 0;
+			if (i + min_match <= n) {
+
+				int candidate = head[hash_at(i)];
+				const int limit = std::min(max_match, n - i);
+				for (int chain = 0; candidate >= 0 && i - candidate <= window && chain < max_chain; ++chain) {
+
+					int length = 0;
+					while (length < limit && buffer[candidate + length] == buffer[i + length]) {
+
+						++length;
+					}
+					if (length > best_length) {
+
+						best_length = length;
+						best_distance = i - candidate;
+						if (length == limit) {
+
+							break;
+						}
+					}
+
+					const int next = prev[candidate & (window - 1)];
+					if (next >= candidate) {
+
+						break;   // the slot has been reused by a newer position
+					}
+					candidate = next;
+				}
+			}
+
+			if (best_length >= min_match) {
+
+				put_match(bw, best_length, best_distance);
+				for (int k = 0; k < best_length; ++k) {
+
+					insert(i + k);
+				}
+				i += best_length;
+			}
+			else {
+
+				put_literal_length(bw, buffer[i]);
+				insert(i);
+				++i;
+			}
+		}
+
+		put_literal_length(bw, 256);   // end of block
+
+		for (std::size_t k = 0; k < size; ++k) {
+
+			adler_a = (adler_a + data[k]) % 65521;
+			adler_b = (adler_b + adler_a) % 65521;
+		}
+
+		if (final) {
+
+			bw.flush();
+			put_u32_be(out, (adler_b << 16) | adler_a);
+			return;
+		}
+		bw.save(pending_bits, pending_count);
+		history.assign(buffer.end() - std::min(n, static_cast<int>(window)), buffer.end());
+	}
+}
+
+static void deflate_zlib(const byte_buffer& data, byte_buffer& out) {
+
+	zlib_deflater deflater;
+	deflater.write(data.data(), data.size(), true, out);
+}
+
+static std::uint32_t crc32(const std::uint8_t* data, std::size_t size) {
+
+	static const auto table = [] {
+
+		std::vector<std::uint32_t> t(256);
+		for (std::uint32_t n = 0; n < 256; ++n) {
+
+			std::uint32_t c = n;
+			for (int k = 0; k < 8; ++k) {
+
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			}
+			t[n] = c;
+		}
+		return t;
+	}();
+
+	std::uint32_t crc = 0xFFFFFFFFu;
+	for (std::size_t i = 0; i < size; ++i) {
+
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return crc ^ 0xFFFFFFFFu;
+}
+
+static void put_png_chunk(byte_buffer& out, const char* type, const byte_buffer& payload) {
+
+	put_u32_be(out, static_cast<std::uint32_t>(payload.size()));
+	const std::size_t type_offset = out.size();
+	out.insert(out.end(), type, type + 4);
+	out.insert(out.end(), payload.begin(), payload.end());
+	put_u32_be(out, crc32(out.data() + type_offset, out.size() - type_offset));
+}
+
+static int paeth(int a, int b, int c) {
+
+	const int p = a + b - c;
+	const int pa = std::abs(p - a);
+	const int pb = std::abs(p - b);
+	const int pc = std::abs(p - c);
+	if (pa <= pb && pa <= pc) return a;
+	return pb <= pc ? b : c;
+}
+
+/*
+	Appends a quantized RGB row to filtered, led by the filter with the smallest sum of absolute residuals,
+	the usual heuristic from libpng. up is the row above, all zero for the first one.
+*/
+static void put_filtered_row(byte_buffer& filtered, const std::uint8_t* row, const std::uint8_t* up, std::size_t stride,
+	byte_buffer& candidate, byte_buffer& best) {
+
+	int best_filter = 0;
+	long best_score = -1;
+	for (int filter = 0; filter < 5; ++filter) {
+
+		long score = 0;
+		for (std::size_t x = 0; x < stride; ++x) {
+
+			const int left = x >= 3 ? row[x - 3] : 0;
+			const int upper_left = x >= 3 ? up[x - 3] : 0;
+			int predicted = 0;
+			switch (filter) {
+			case 1: predicted = left; break;
+			case 2: predicted = up[x]; break;
+			case 3: predicted = (left + up[x]) / 2; break;
+			case 4: predicted = paeth(left, up[x], upper_left); break;
+			default: break;
+			}
+
+			const auto residual = static_cast<std::uint8_t>(row[x] - predicted);
+			candidate[x] = residual;
+			score += residual < 128 ? residual : 256 - residual;
+		}
+
+		if (best_score < 0 || score < best_score) {
+
+			best_score = score;
+			best_filter = filter;
+			best.swap(candidate);
+		}
+	}
+
+	filtered.push_back(static_cast<std::uint8_t>(best_filter));
+	filtered.insert(filtered.end(), best.begin(), best.end());
+}
+
+static byte_buffer encode_png_header(int w, int h) {
+
+	byte_buffer out = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	byte_buffer header;
+	put_u32_be(header, static_cast<std::uint32_t>(w));
+	put_u32_be(header, static_cast<std::uint32_t>(h));
+	header.insert(header.end(), { 8, 2, 0, 0, 0 });   // 8 bit RGB, deflate, adaptive filtering, no interlace
+	put_png_chunk(out, "IHDR", header);
+
+	return out;
+}
+
+static byte_buffer encode_png(const framebuffer& image) {
+
+	const int w = image.width();
+	const int h = image.height();
+	const std::size_t stride = 3 * static_cast<std::size_t>(w);
+	const auto rgb = quantized_pixels(image);
+
+	byte_buffer filtered;
+	filtered.reserve((stride + 1) * h);
+	byte_buffer candidate(stride);
+	byte_buffer best(stride);
+	const byte_buffer zero_row(stride, 0);
+	for (int y = 0; y < h; ++y) {
+
+		const std::uint8_t* row = rgb.data() + y * stride;
+		put_filtered_row(filtered, row, y > 0 ? row - stride : zero_row.data(), stride, candidate, best);
+	}
+
+	byte_buffer out = encode_png_header(w, h);
+
+	byte_buffer compressed;
+	deflate_zlib(filtered, compressed);
+	put_png_chunk(out, "IDAT", compressed);
+	put_png_chunk(out, "IEND", {});
+
+	return out;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+image_format image_format_from_path(const std::string& path) {
+
+	const auto dot = path.find_last_of('.');
+	std::string extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+	if (extension == "ppm") return image_format::ppm;
+	if (extension == "png") return image_format::png;
+	if (extension == "pfm") return image_format::pfm;
+	if (extension == "exr") return image_format::exr;
+
+	throw std::invalid_argument("unsupported image format: " + path);
+}
+
+std::vector<std::uint8_t> encode_image(const framebuffer& image, image_format format) {
+
+	switch (format) {
+	case image_format::png: return encode_png(image);
+	case image_format::pfm: return encode_pfm(image);
+	case image_format::exr: return encode_exr(image);
+	case image_format::ppm:
+	default: return encode_ppm(image);
+	}
+}
+
+void write_image(std::ostream& out, const framebuffer& image, image_format format) {
+
+	const auto bytes = encode_image(image, format);
+	out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+	out.flush();
+}
+
+void write_image(const std::string& path, const framebuffer& image) {
+
+	write_image(path, image, image_format_from_path(path));
+}
+
+void write_image(const std::string& path, const framebuffer& image, image_format format) {
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file) {
+
+		throw std::runtime_error("cannot open " + path + " for writing");
+	}
+
+	write_image(file, image, format);
+	if (!file) {
+
+		throw std::runtime_error("failed to write " + path);
+	}
+}
+
+framebuffer read_pfm(const std::string& path) {
+
+	std::ifstream file(path, std::ios::binary);
+	std::string magic;
+	int width = 0, height = 0;
+	double scale = 0;
+	file >> magic >> width >> height >> scale;
+	if (!file || magic != "PF" || width <= 0 || height <= 0 || scale == 0 || !std::isspace(file.get())) {
+
+		throw std::runtime_error("cannot read " + path + " as a color PFM");
+	}
+
+	const std::size_t row_floats = 3 * static_cast<std::size_t>(width);
+	std::vector<std::uint8_t> bytes(4 * row_floats * height);
+	if (!file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()))) {
+
+		throw std::runtime_error(path + " is truncated");
+	}
+
+	// Rows are stored bottom up, in the byte order the sign of the scale gives.
+	framebuffer image(width, height);
+	const bool little_endian = scale < 0;
+	const std::uint8_t* in = bytes.data();
+	for (int y = height - 1; y >= 0; --y) {
+
+		float* row = image.data() + y * row_floats;
+		for (std::size_t i = 0; i < row_floats; ++i, in += 4) {
+
+			std::uint32_t bits = 0;
+			for (int b = 0; b < 4; ++b) {
+
+				bits |= static_cast<std::uint32_t>(in[little_endian ? b : 3 - b]) << (8 * b);
+			}
+			std::memcpy(&row[i], &bits, sizeof(bits));
+		}
+	}
+	return image;
+}
+
+struct image_stream::png_state {
+	zlib_deflater deflater;
+	byte_buffer previous_row;   // quantized, all zero before the first
+	byte_buffer candidate;
+	byte_buffer best;
+};
+
+image_stream::image_stream(std::ostream& stream, int width, int height, image_format type) :
+	out{ stream }, w{ width }, h{ height }, format{ type }
+{
+	switch (format) {
+	case image_format::png:
+		png = std::make_unique<png_state>();
+		png->previous_row.assign(3 * static_cast<std::size_t>(w), 0);
+		png->candidate.resize(png->previous_row.size());
+		png->best.resize(png->previous_row.size());
+		put(encode_png_header(w, h));
+		break;
+	case image_format::pfm: {
+
+		byte_buffer header;
+		put_string(header, pfm_header(w, h), false);
+		put(header);
+		break;
+	}
+	case image_format::exr:
+		put(encode_exr_header(w, h));
+		break;
+	case image_format::ppm:
+	default: {
+
+		byte_buffer header;
+		put_string(header, ppm_header(w, h), false);
+		put(header);
+		break;
+	}
+	}
+}
+
+image_stream::~image_stream() {}
+
+int image_stream::width() const {
+
+	return w;
+}
+
+int image_stream::height() const {
+
+	return h;
+}
+
+bool image_stream::bottom_up() const {
+
+	return format == image_format::pfm;
+}
+
+void image_stream::put(const byte_buffer& bytes) {
+
+	out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+	if (!out) {
+
+		throw std::runtime_error("failed to write the image stream");
+	}
+}
+
+void image_stream::write(const framebuffer& band) {
+
+	if (band.width() != w || rows_written + band.height() > h) {
+
+		throw std::invalid_argument("image_stream: the band does not fit the image");
+	}
+
+	byte_buffer bytes;
+	switch (format) {
+	case image_format::png: {
+
+		const std::size_t stride = 3 * static_cast<std::size_t>(w);
+		const auto rgb = quantized_pixels(band);
+		byte_buffer filtered;
+		filtered.reserve((stride + 1) * band.height());
+		for (int y = 0; y < band.height(); ++y) {
+
+			const std::uint8_t* row = rgb.data() + y * stride;
+			put_filtered_row(filtered, row, png->previous_row.data(), stride, png->candidate, png->best);
+			std::copy(row, row + stride, png->previous_row.begin());
+		}
+
+		byte_buffer compressed;
+		png->deflater.write(filtered.data(), filtered.size(), false, compressed);
+		if (!compressed.empty()) {
+
+			put_png_chunk(bytes, "IDAT", compressed);
+		}
+		break;
+	}
+	case image_format::pfm:
+		put_pfm_rows(bytes, band);
+		break;
+	case image_format::exr:
+		put_exr_rows(bytes, band, rows_written);
+		break;
+	case image_format::ppm:
+	default:
+		bytes = quantized_pixels(band);
+		break;
+	}
+
+	rows_written += band.height();
+	put(bytes);
+}
+
+void image_stream::finish() {
+
+	if (rows_written != h) {
+
+		throw std::logic_error("image_stream: finished before every row was written");
+	}
+
+	if (format == image_format::png) {
+
+		byte_buffer compressed;
+		png->deflater.write(nullptr, 0, true, compressed);
+		byte_buffer bytes;
+		put_png_chunk(bytes, "IDAT", compressed);
+		put_png_chunk(bytes, "IEND", {});
+		put(bytes);
+	}
+	out.flush();
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "instance.hpp"
+
+#include <stdexcept>
+
+instance::instance(std::shared_ptr<const hittable> prototype, const affine_transform& object_to_world) :
+	shape{ std::move(prototype) }
+{
+	if (!shape || !shape->bounding_box(object_box)) {
+
+		throw std::invalid_argument("instance: the prototype needs a bounding box");
+	}
+	set_transform(object_to_world);
+}
+
+void instance::set_transform(const affine_transform& object_to_world) {
+
+	to_object = object_to_world.inverse();
+	to_world = object_to_world;
+	world_box = to_world.box(object_box);
+}
+
+const affine_transform& instance::transform() const {
+
+	return to_world;
+}
+
+const std::shared_ptr<const hittable>& instance::prototype() const {
+
+	return shape;
+}
+
+void instance::set_material(std::uint32_t material) {
+
+	material_id = material;
+}
+
+std::uint32_t instance::material() const {
+
+	return material_id;
+}
+
+ray instance::to_object_space(const ray& r) const {
+
+	return ray(to_object.point(r.origin()), to_object.vector(r.direction()));
+}
+
+bool instance::hit(const ray& r, real t_min, real t_max, hit_record& rec) const {
+
+	if (!intersect(r, t_min, t_max, rec)) {
+
+		return false;
+	}
+
+	finish_hit(r, rec);
+	return true;
+}
+
+bool instance::intersect(const ray& r, real t_min, real t_max, hit_record& rec) const {
+
+	hit_record local;
+	if (!shape->hit(to_object_space(r), t_min, t_max, local)) {
+
+		return false;
+	}
+
+	// The object space point and normal wait in the record until finish_hit(), if this hit stays the closest.
+	rec.t = local.t;
+	rec.p = local.p;
+	rec.normal = local.normal;
+	rec.front_face = local.front_face;
+	rec.object = this;
+	rec.primitive = local.primitive;
+	return true;
+}
+
+void instance::finish_hit(const ray& r, hit_record& rec) const {
+
+	// The inverse transpose keeps the normal perpendicular under non-uniform scaling; it also preserves
+	// the sign of the normal's dot product with the ray direction, so the face found in object space still holds.
+	rec.p = r.at(rec.t);
+	rec.normal = unit_vector(to_object.transposed_vector(rec.normal));
+	rec.material = material_id;
+}
+
+bool instance::occluded(const ray& r, real t_min, real t_max) const {
+
+	return shape->occluded(to_object_space(r), t_min, t_max);
+}
+
+bool instance::bounding_box(aabb& output_box) const {
+
+	output_box = world_box;
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,281 @@
+#include "integrator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "lights.hpp"
+#include "profiler.hpp"
+
+color sky_color(const ray& r) {
+
+	vec3 unit_direction = unit_vector(r.direction());
+	auto t = real(0.5) * (unit_direction.y() + 1);
+
+	return (1 - t) * color(1, 1, 1) + t * color(real(0.5), real(0.7), 1);
+}
+
+vec3 sample_bounce(sample_context& ctx, const vec3& normal) {
+
+	if (!ctx.pattern) {
+
+		return random_in_hemisphere(ctx.rng, normal);
+	}
+
+	double u, v;
+	ctx.next_2d(u, v);
+	return uniform_hemisphere(u, v, normal);
+}
+
+color recursive_integrator::li(const ray& r, const hittable& world, sample_context& ctx) const {
+
+	return trace(r, world, depth_limit, ctx);
+}
+
+color recursive_integrator::trace(const ray& r, const hittable& world, int depth, sample_context& ctx) const {
+
+	hit_record rec;
+
+	// If we've exceeded the ray bounce limit, no more light is gathered.
+	if (depth <= 0) {
+
+		return color(0, 0, 0);
+	}
+
+	++ctx.rays;
+	bool found;
+	{
+		RT_PROFILE_STAGE(profile_stage::intersect);
+		found = world.hit(r, surface_epsilon, infinity, rec);
+	}
+	if (found) {
+
+		if (ctx.materials) {
+
+			const material_record& m = ctx.materials->get(rec.material);
+			ray scattered;
+			color attenuation;
+			bool continues;
+			{
+				RT_PROFILE_STAGE(profile_stage::shade);
+				continues = scatter(m, r, rec, ctx, scattered, attenuation);
+			}
+			if (!continues) {
+
+				return emitted(m);
+			}
+			return emitted(m) + attenuation * trace(scattered, world, depth - 1, ctx);
+		}
+
+		// Pick random points on the surface of the unit sphere, offset along the surface normal.
+		// We do this by picking random points in the unit sphere and normalizing them.
+		// This is done to achieve a Lambertian distribution.
+		point3 target;
+		{
+			// Timed apart from the recursion, which would otherwise count into it again.
+			RT_PROFILE_STAGE(profile_stage::shade);
+			target = rec.p + sample_bounce(ctx, rec.normal);
+		}
+		return surface_albedo * trace(ray(rec.p, target - rec.p), world, depth - 1, ctx);
+	}
+
+	return sky_color(r);
+}
+
+color path_integrator::li(const ray& r, const hittable& world, sample_context& ctx) const {
+
+	color throughput(1, 1, 1);
+	color radiance(0, 0, 0);   // emitted light gathered so far
+	ray current = r;
+	hit_record rec;
+
+	for (int depth = 0; depth < depth_limit; ++depth) {
+
+		++ctx.rays;
+		bool found;
+		{
+			RT_PROFILE_STAGE(profile_stage::intersect);
+			found = world.hit(current, surface_epsilon, infinity, rec);
+		}
+		if (!found) {
+
+			return radiance + throughput * sky_color(current);
+		}
+
+		RT_PROFILE_STAGE(profile_stage::shade);
+
+		if (ctx.materials) {
+
+			const material_record& m = ctx.materials->get(rec.material);
+			radiance += throughput * emitted(m);
+			ray scattered;
+			color attenuation;
+			if (!scatter(m, current, rec, ctx, scattered, attenuation)) {
+
+				break;
+			}
+			current = scattered;
+			throughput = throughput * attenuation;
+		}
+		else {
+
+			// Same Lambertian bounce as the recursive integrator.
+			current = ray(rec.p, sample_bounce(ctx, rec.normal));
+			throughput *= surface_albedo;
+		}
+
+		if (depth + 1 >= roulette_depth) {
+
+			const real survival = std::min(std::max({ throughput.x(), throughput.y(), throughput.z() }), real(0.95));
+			if (survival <= 0 || ctx.next_1d() >= survival) {
+
+				break;
+			}
+			throughput /= survival;
+		}
+	}
+
+	return radiance;
+}
+
+// Weight of a strategy that found a direction with density a, where the other one had density b.
+static real power_heuristic(real a, real b) {
+
+	return a * a / (a * a + b * b);
+}
+
+/*
+	Light arriving at a diffuse hit straight from a sampled light, weighted against finding it by a bounce.
+	Always takes three dimensions, so that the sampler's dimensions stay aligned whether or not the light is seen.
+*/
+static color direct_light(const hittable& world, const light_list& lights, const hit_record& rec, const material_record& m,
+	sample_context& ctx) {
+
+	const double u = ctx.next_1d();
+	double v, w;
+	ctx.next_2d(v, w);
+
+	light_sample s;
+	if (!lights.sample(rec.p, u, v, w, s) || dot(s.direction, rec.normal) <= 0) {
+
+		return color(0, 0, 0);
+	}
+
+	++ctx.rays;
+	bool blocked;
+	{
+		RT_PROFILE_STAGE(profile_stage::intersect);
+		blocked = world.occluded(ray(rec.p, s.direction), surface_epsilon, s.distance - surface_epsilon);
+	}
+	if (blocked) {
+
+		return color(0, 0, 0);
+	}
+	return (power_heuristic(s.pdf, diffuse_pdf) / s.pdf) * diffuse_response(m) * s.radiance;
+}
+
+color nee_integrator::li(const ray& r, const hittable& world, sample_context& ctx) const {
+
+	if (!ctx.materials || !ctx.lights || ctx.lights->empty()) {
+
+		return plain.li(r, world, ctx);
+	}
+
+	const light_list& lights = *ctx.lights;
+	color throughput(1, 1, 1);
+	color radiance(0, 0, 0);
+	ray current = r;
+	hit_record rec;
+
+	// Whether the current ray left a diffuse hit, where the lights were already sampled, and where.
+	bool after_diffuse = false;
+	point3 diffuse_point;
+
+	for (int depth = 0; depth < depth_limit; ++depth) {
+
+		++ctx.rays;
+		bool found;
+		{
+			RT_PROFILE_STAGE(profile_stage::intersect);
+			found = world.hit(current, surface_epsilon, infinity, rec);
+		}
+		if (!found) {
+
+			return radiance + throughput * sky_color(current);
+		}
+
+		const material_record& m = ctx.materials->get(rec.material);
+		if (m.type == material_type::emissive) {
+
+			// Emitters absorb, so the path ends here either way.
+			real weight = 1;
+			if (after_diffuse) {
+
+				const std::size_t index = lights.find(rec.p, rec.material);
+				if (index < lights.size()) {
+
+					weight = power_heuristic(diffuse_pdf, lights.pdf(index, diffuse_point));
+				}
+			}
+			radiance += weight * throughput * emitted(m);
+			break;
+		}
+
+		if (m.type == material_type::lambertian) {
+
+			radiance += throughput * direct_light(world, lights, rec, m, ctx);
+		}
+
+		RT_PROFILE_STAGE(profile_stage::shade);
+		ray scattered;
+		color attenuation;
+		if (!scatter(m, current, rec, ctx, scattered, attenuation)) {
+
+			break;
+		}
+		after_diffuse = m.type == material_type::lambertian;
+		diffuse_point = rec.p;
+		current = scattered;
+		throughput = throughput * attenuation;
+
+		if (depth + 1 >= roulette_depth) {
+
+			const real survival = std::min(std::max({ throughput.x(), throughput.y(), throughput.z() }), real(0.95));
+			if (survival <= 0 || ctx.next_1d() >= survival) {
+
+				break;
+			}
+			throughput /= survival;
+		}
+	}
+
+	return radiance;
+}
+
+integrator_type integrator_type_from_name(const std::string& name) {
+
+	if (name == "path") return integrator_type::path;
+	if (name == "recursive") return integrator_type::recursive;
+	if (name == "nee") return integrator_type::nee;
+
+	throw std::invalid_argument("unknown integrator " + name);
+}
+
+const char* integrator_type_name(integrator_type type) {
+
+	switch (type) {
+	case integrator_type::recursive: return "recursive";
+	case integrator_type::nee: return "nee";
+	case integrator_type::path:
+	default: return "path";
+	}
+}
+
+std::unique_ptr<integrator> make_integrator(integrator_type type, int max_depth, int rr_min_depth) {
+
+	switch (type) {
+	case integrator_type::recursive: return std::make_unique<recursive_integrator>(max_depth);
+	case integrator_type::nee: return std::make_unique<nee_integrator>(max_depth, rr_min_depth);
+	case integrator_type::path:
+	default: return std::make_unique<path_integrator>(max_depth, rr_min_depth);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,278 @@
+#include "json.hpp"
+
+#include <cstdlib>
+#include <stdexcept>
+
+class json_parser {
+public:
+	explicit json_parser(const std::string& document) : in{ document } {}
+
+	json_value parse_document() {
+
+		json_value result = parse_value(0);
+		skip_whitespace();
+		if (pos != in.size()) {
+
+			fail("trailing characters");
+		}
+
+		return result;
+	}
+private:
+	// Deeper documents are rejected, so a malicious input cannot overflow the stack.
+	static const int max_depth = 256;
+
+	[[noreturn]] void fail(const std::string& message) const {
+
+		throw std::runtime_error("JSON: " + message + " at offset " + std::to_string(pos));
+	}
+
+	void skip_whitespace() {
+
+		while (pos < in.size() && (in[pos] == ' ' || in[pos] == '\t' || in[pos] == '\n' || in[pos] == '\r')) {
+
+			++pos;
+		}
+	}
+
+	bool consume(char c) {
+
+		skip_whitespace();
+		if (pos < in.size() && in[pos] == c) {
+
+			++pos;
+			return true;
+		}
+
+		return false;
+	}
+
+	void expect(char c) {
+
+		if (!consume(c)) {
+
+			fail(std::string("expected '") + c + "'");
+		}
+	}
+
+	bool consume_word(const char* word) {
+
+		const std::string w(word);
+		if (in.compare(pos, w.size(), w) == 0) {
+
+			pos += w.size();
+			return true;
+		}
+
+		return false;
+	}
+
+	json_value parse_value(int depth) {
+
+		if (depth > max_depth) {
+
+			fail("nesting too deep");
+		}
+
+		skip_whitespace();
+		if (pos >= in.size()) {
+
+			fail("unexpected end");
+		}
+
+		json_value v;
+		const char c = in[pos];
+		if (c == '{') {
+
+			++pos;
+			v.value_kind = json_value::kind::object;
+			if (consume('}')) {
+
+				return v;
+			}
+			do {
+
+				skip_whitespace();
+				std::string key = parse_string();
+				expect(':');
+				v.fields.emplace_back(std::move(key), parse_value(depth + 1));
+			} while (consume(','));
+			expect('}');
+		}
+		else if (c == '[') {
+
+			++pos;
+			v.value_kind = json_value::kind::array;
+			if (consume(']')) {
+
+				return v;
+			}
+			do {
+
+				v.elements.push_back(parse_value(depth + 1));
+			} while (consume(','));
+			expect(']');
+		}
+		else if (c == '"') {
+
+			v.value_kind = json_value::kind::string;
+			v.text = parse_string();
+		}
+		else if (consume_word("true") || consume_word("false")) {
+
+			v.value_kind = json_value::kind::boolean;
+			v.boolean = c == 't';
+		}
+		else if (consume_word("null")) {
+
+			v.value_kind = json_value::kind::null;
+		}
+		else {
+
+			v.value_kind = json_value::kind::number;
+			v.number = parse_number();
+		}
+
+		return v;
+	}
+
+	double parse_number() {
+
+		const char* start = in.c_str() + pos;
+		char* end = nullptr;
+		const double result = std::strtod(start, &end);
+		if (end == start) {
+
+			fail("invalid value");
+		}
+		pos += static_cast<std::size_t>(end - start);
+
+		return result;
+	}
+
+	std::string parse_string() {
+
+		if (pos >= in.size() || in[pos] != '"') {
+
+			fail("expected a string");
+		}
+		++pos;
+
+		std::string result;
+		while (pos < in.size() && in[pos] != '"') {
+
+			char c = in[pos++];
+			if (c == '\\') {
+
+				if (pos >= in.size()) {
+
+					break;
+				}
+				c = in[pos++];
+				switch (c) {
+				case 'n': c = '\n'; break;
+				case 't': c = '\t'; break;
+				case 'r': c = '\r'; break;
+				case 'b': c = '\b'; break;
+				case 'f': c = '\f'; break;
+				case 'u': append_code_point(result); continue;
+				default: break;   // '"', '\\' and '/' stand for themselves
+				}
+			}
+			result += c;
+		}
+		if (pos >= in.size()) {
+
+			fail("unterminated string");
+		}
+		++pos;
+
+		return result;
+	}
+
+	// \uXXXX escapes, encoded as UTF-8. Surrogate pairs are not combined.
+	void append_code_point(std::string& out) {
+
+		if (pos + 4 > in.size()) {
+
+			fail("truncated escape");
+		}
+		const unsigned long code = std::strtoul(in.substr(pos, 4).c_str(), nullptr, 16);
+		pos += 4;
+
+		if (code < 0x80) {
+
+			out += static_cast<char>(code);
+		}
+		else if (code < 0x800) {
+
+			out += static_cast<char>(0xC0 | (code >> 6));
+			out += static_cast<char>(0x80 | (code & 0x3F));
+		}
+		else {
+
+			out += static_cast<char>(0xE0 | (code >> 12));
+			out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (code & 0x3F));
+		}
+	}
+private:
+	const std::string& in;
+	std::size_t pos = 0;
+};
+
+static void require(bool ok, const char* expected) {
+
+	if (!ok) {
+
+		throw std::runtime_error(std::string("JSON: expected ") + expected);
+	}
+}
+
+bool json_value::as_bool() const {
+
+	require(value_kind == kind::boolean, "a boolean");
+	return boolean;
+}
+
+double json_value::as_number() const {
+
+	require(value_kind == kind::number, "a number");
+	return number;
+}
+
+const std::string& json_value::as_string() const {
+
+	require(value_kind == kind::string, "a string");
+	return text;
+}
+
+const std::vector<json_value>& json_value::as_array() const {
+
+	require(value_kind == kind::array, "an array");
+	return elements;
+}
+
+const std::vector<std::pair<std::string, json_value>>& json_value::members() const {
+
+	require(value_kind == kind::object, "an object");
+	return fields;
+}
+
+const json_value* json_value::find(const std::string& key) const {
+
+	for (const auto& field : members()) {
+
+		if (field.first == key) {
+
+			return &field.second;
+		}
+	}
+
+	return nullptr;
+}
+
+json_value parse_json(const std::string& document) {
+
+	return json_parser(document).parse_document();
+}
\ No newline at end of file
@@ -0,0 +1,331 @@
+#include "kernels.hpp"
+
+#include <algorithm>
+#include <type_traits>
+
+#include "bvh.hpp"
+#include "hittable_list.hpp"
+#include "primitive_store.hpp"
+#include "profiler.hpp"
+
+primitive_set primitive_set_of(const hittable& world) {
+
+	if (dynamic_cast<const bvh_node*>(&world)) return primitive_set::bvh;
+	if (dynamic_cast<const primitive_store*>(&world)) return primitive_set::store;
+	if (dynamic_cast<const hittable_list*>(&world)) return primitive_set::list;
+	return primitive_set::any;
+}
+
+const std::vector<int>& specialized_depths() {
+
+	static const std::vector<int> depths = { 8, 16, 32, 50 };
+	return depths;
+}
+
+bool has_specialized_kernel(const kernel_key& key) {
+
+	// Next-event estimation runs on the generic integrator.
+	if (key.integrator == integrator_type::nee) {
+
+		return false;
+	}
+	const auto& depths = specialized_depths();
+	return std::find(depths.begin(), depths.end(), key.max_depth) != depths.end();
+}
+
+std::string kernel_name(const kernel_key& key) {
+
+	static const char* worlds[] = { "any", "bvh", "store", "list" };
+
+	return std::string(integrator_type_name(key.integrator)) + "<" + std::to_string(key.max_depth) + ", " + sampler_type_name(key.sampler) + ", "
+		+ worlds[static_cast<int>(key.primitives)] + ", " + (sizeof(real) == sizeof(float) ? "float" : "double") + ">";
+}
+
+namespace {
+
+	// The sampler argument of independent sampling, which draws from the pixel's stream.
+	struct no_pattern {};
+
+	// Closest hit of the camera and bounce rays, a direct call unless the world type is unknown.
+	template <class World>
+	inline bool closest_hit(const World& world, const ray& r, hit_record& rec) {
+
+		if constexpr (std::is_same<World, hittable>::value) {
+
+			return world.hit(r, surface_epsilon, infinity, rec);
+		}
+		else {
+
+			return world.World::hit(r, surface_epsilon, infinity, rec);
+		}
+	}
+
+	// sample_context::next_1d() and sample_bounce() with the sampler known at compile time.
+	template <class Pattern>
+	inline double next_1d(sample_context& ctx) {
+
+		if constexpr (std::is_same<Pattern, no_pattern>::value) {
+
+			return ctx.rng.next_double();
+		}
+		else {
+
+			return static_cast<const Pattern*>(ctx.pattern)->Pattern::get_1d(ctx.x, ctx.y, ctx.index, ctx.dimension++);
+		}
+	}
+
+	template <class Pattern>
+	inline vec3 bounce(sample_context& ctx, const vec3& normal) {
+
+		if constexpr (std::is_same<Pattern, no_pattern>::value) {
+
+			return random_in_hemisphere(ctx.rng, normal);
+		}
+		else {
+
+			double u, v;
+			static_cast<const Pattern*>(ctx.pattern)->Pattern::get_2d(ctx.x, ctx.y, ctx.index, ctx.dimension, u, v);
+			ctx.dimension += 2;
+			return uniform_hemisphere(u, v, normal);
+		}
+	}
+
+	/*
+		The surface response with a material table. Lambertian hits, the common case, take the bounce
+		with the sampler known at compile time; everything else goes through scatter().
+	*/
+	template <class Pattern>
+	inline bool respond(const material_record& m, const ray& r, const hit_record& rec, sample_context& ctx,
+		ray& scattered, color& attenuation) {
+
+		if (m.type == material_type::lambertian) {
+
+			scattered = ray(rec.p, bounce<Pattern>(ctx, rec.normal));
+			attenuation = material_albedo(m);
+			return true;
+		}
+		return scatter(m, r, rec, ctx, scattered, attenuation);
+	}
+
+	// The binding every kernel checks before it takes the fast path.
+	class bound_kernel : public integrator {
+	protected:
+		bound_kernel(std::unique_ptr<integrator> generic, const hittable& world, const sampler* pattern) :
+			generic{ std::move(generic) }, target{ &world }, samples{ pattern } {}
+
+		bool bound_to(const hittable& world, const sample_context& ctx) const {
+
+			return &world == target && ctx.pattern == samples;
+		}
+	protected:
+		std::unique_ptr<integrator> generic;
+	private:
+		const hittable* target;
+		const sampler* samples;
+	};
+
+	// path_integrator with a constant depth limit.
+	template <int MaxDepth, class Pattern, class World>
+	class fixed_path_integrator : public bound_kernel {
+	public:
+		fixed_path_integrator(int rr_min_depth, const hittable& world, const sampler* pattern) :
+			bound_kernel(std::make_unique<path_integrator>(MaxDepth, rr_min_depth), world, pattern),
+			roulette_depth{ rr_min_depth } {}
+
+		virtual color li(const ray& r, const hittable& world, sample_context& ctx) const override {
+
+			if (!bound_to(world, ctx)) {
+
+				return generic->li(r, world, ctx);
+			}
+
+			const World& scene = static_cast<const World&>(world);
+			color throughput(1, 1, 1);
+			color radiance(0, 0, 0);
+			ray current = r;
+			hit_record rec;
+
+			for (int depth = 0; depth < MaxDepth; ++depth) {
+
+				++ctx.rays;
+				bool found;
+				{
+					RT_PROFILE_STAGE(profile_stage::intersect);
+					found = closest_hit(scene, current, rec);
+				}
+				if (!found) {
+
+					return radiance + throughput * sky_color(current);
+				}
+
+				RT_PROFILE_STAGE(profile_stage::shade);
+				if (ctx.materials) {
+
+					const material_record& m = ctx.materials->get(rec.material);
+					radiance += throughput * emitted(m);
+					ray scattered;
+					color attenuation;
+					if (!respond<Pattern>(m, current, rec, ctx, scattered, attenuation)) {
+
+						break;
+					}
+					current = scattered;
+					throughput = throughput * attenuation;
+				}
+				else {
+
+					current = ray(rec.p, bounce<Pattern>(ctx, rec.normal));
+					throughput *= surface_albedo;
+				}
+
+				if (depth + 1 >= roulette_depth) {
+
+					const real survival = std::min(std::max({ throughput.x(), throughput.y(), throughput.z() }), real(0.95));
+					if (survival <= 0 || next_1d<Pattern>(ctx) >= survival) {
+
+						break;
+					}
+					throughput /= survival;
+				}
+			}
+
+			return radiance;
+		}
+	private:
+		int roulette_depth;
+	};
+
+	// recursive_integrator with the recursion unrolled into one function per remaining depth.
+	template <int MaxDepth, class Pattern, class World>
+	class fixed_recursive_integrator : public bound_kernel {
+	public:
+		fixed_recursive_integrator(const hittable& world, const sampler* pattern) :
+			bound_kernel(std::make_unique<recursive_integrator>(MaxDepth), world, pattern) {}
+
+		virtual color li(const ray& r, const hittable& world, sample_context& ctx) const override {
+
+			if (!bound_to(world, ctx)) {
+
+				return generic->li(r, world, ctx);
+			}
+			return trace<MaxDepth>(r, static_cast<const World&>(world), ctx);
+		}
+	private:
+		template <int Depth>
+		static color trace(const ray& r, const World& world, sample_context& ctx) {
+
+			if constexpr (Depth <= 0) {
+
+				return color(0, 0, 0);
+			}
+			else {
+
+				hit_record rec;
+				++ctx.rays;
+				bool found;
+				{
+					RT_PROFILE_STAGE(profile_stage::intersect);
+					found = closest_hit(world, r, rec);
+				}
+				if (!found) {
+
+					return sky_color(r);
+				}
+
+				if (ctx.materials) {
+
+					const material_record& m = ctx.materials->get(rec.material);
+					ray scattered;
+					color attenuation;
+					bool continues;
+					{
+						RT_PROFILE_STAGE(profile_stage::shade);
+						continues = respond<Pattern>(m, r, rec, ctx, scattered, attenuation);
+					}
+					if (!continues) {
+
+						return emitted(m);
+					}
+					return emitted(m) + attenuation * trace<Depth - 1>(scattered, world, ctx);
+				}
+
+				point3 target;
+				{
+					RT_PROFILE_STAGE(profile_stage::shade);
+					target = rec.p + bounce<Pattern>(ctx, rec.normal);
+				}
+				return surface_albedo * trace<Depth - 1>(ray(rec.p, target - rec.p), world, ctx);
+			}
+		}
+	};
+
+	// The selector, one switch per template argument.
+
+	template <int MaxDepth, class Pattern, class World>
+	std::unique_ptr<integrator> make_kernel(const kernel_key& key, int rr_min_depth, const hittable& world, const sampler* pattern) {
+
+		if constexpr (!std::is_same<Pattern, no_pattern>::value) {
+
+			if (!dynamic_cast<const Pattern*>(pattern)) {
+
+				return nullptr;
+			}
+		}
+		if (key.integrator == integrator_type::recursive) {
+
+			return std::make_unique<fixed_recursive_integrator<MaxDepth, Pattern, World>>(world, pattern);
+		}
+		return std::make_unique<fixed_path_integrator<MaxDepth, Pattern, World>>(rr_min_depth, world, pattern);
+	}
+
+	template <int MaxDepth, class Pattern>
+	std::unique_ptr<integrator> select_world(const kernel_key& key, int rr_min_depth, const hittable& world, const sampler* pattern) {
+
+		switch (key.primitives) {
+		case primitive_set::bvh: return make_kernel<MaxDepth, Pattern, bvh_node>(key, rr_min_depth, world, pattern);
+		case primitive_set::store: return make_kernel<MaxDepth, Pattern, primitive_store>(key, rr_min_depth, world, pattern);
+		case primitive_set::list: return make_kernel<MaxDepth, Pattern, hittable_list>(key, rr_min_depth, world, pattern);
+		case primitive_set::any:
+		default: return make_kernel<MaxDepth, Pattern, hittable>(key, rr_min_depth, world, pattern);
+		}
+	}
+
+	template <int MaxDepth>
+	std::unique_ptr<integrator> select_sampler(const kernel_key& key, int rr_min_depth, const hittable& world, const sampler* pattern) {
+
+		switch (key.sampler) {
+		case sampler_type::stratified: return select_world<MaxDepth, stratified_sampler>(key, rr_min_depth, world, pattern);
+		case sampler_type::sobol: return select_world<MaxDepth, sobol_sampler>(key, rr_min_depth, world, pattern);
+		case sampler_type::blue_noise: return select_world<MaxDepth, blue_noise_sampler>(key, rr_min_depth, world, pattern);
+		case sampler_type::independent:
+		default: return select_world<MaxDepth, no_pattern>(key, rr_min_depth, world, pattern);
+		}
+	}
+}
+
+std::unique_ptr<integrator> make_specialized_integrator(const kernel_key& key, int rr_min_depth, const hittable& world,
+	const sampler* pattern) {
+
+	if (!has_specialized_kernel(key)) {
+
+		return nullptr;
+	}
+	// The world and sampler are cast to the types the key names, so the key has to describe them.
+	if (primitive_set_of(world) != key.primitives && key.primitives != primitive_set::any) {
+
+		return nullptr;
+	}
+	if ((key.sampler == sampler_type::independent) != (pattern == nullptr)) {
+
+		return nullptr;
+	}
+
+	// Keep in sync with specialized_depths().
+	switch (key.max_depth) {
+	case 8: return select_sampler<8>(key, rr_min_depth, world, pattern);
+	case 16: return select_sampler<16>(key, rr_min_depth, world, pattern);
+	case 32: return select_sampler<32>(key, rr_min_depth, world, pattern);
+	case 50: return select_sampler<50>(key, rr_min_depth, world, pattern);
+	default: return nullptr;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include "lights.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "sphere.hpp"
+
+static double luminance(const color& c) {
+
+	return 0.2126 * c.x() + 0.7152 * c.y() + 0.0722 * c.z();
+}
+
+light_list::light_list(const hittable_list& world, const material_table& materials) {
+
+	for (const auto& object : world.objects) {
+
+		const auto* s = dynamic_cast<const sphere*>(object.get());
+		if (s && materials.get(s->material).type == material_type::emissive) {
+
+			add(s->center, s->radius, s->material, materials.get(s->material));
+		}
+	}
+	finish();
+}
+
+light_list::light_list(const sphere_soa& spheres, const material_table& materials) {
+
+	for (std::size_t i = 0; i < spheres.size(); ++i) {
+
+		const auto id = spheres.material(i);
+		if (materials.get(id).type == material_type::emissive) {
+
+			add(spheres.center(i), spheres.radius(i), id, materials.get(id));
+		}
+	}
+	finish();
+}
+
+void light_list::add(const point3& center, real radius, std::uint32_t material, const material_record& m) {
+
+	const color radiance = emitted(m);
+	if (radius > 0 && luminance(radiance) > 0) {
+
+		lights.push_back({ center, radius, material, radiance });
+	}
+}
+
+void light_list::finish() {
+
+	// Power is radiance times surface area, the 4 pi is the same for every sphere.
+	double total = 0;
+	cdf.clear();
+	for (const auto& l : lights) {
+
+		total += luminance(l.radiance) * l.radius * l.radius;
+		cdf.push_back(total);
+	}
+	for (auto& c : cdf) {
+
+		c /= total;
+	}
+	if (!cdf.empty()) {
+
+		cdf.back() = 1;
+	}
+}
+
+std::size_t light_list::size() const {
+
+	return lights.size();
+}
+
+bool light_list::empty() const {
+
+	return lights.empty();
+}
+
+const sphere_light& light_list::light(std::size_t index) const {
+
+	return lights[index];
+}
+
+/*
+	Cosine of the half angle of the cone a sphere covers from a point at distance_squared from its center and one minus it,
+	which is also the solid angle over 2 pi. Computed as sin^2 / (1 + cos), without the cancellation of 1 - cos for small
+	or distant lights. Returns false from inside the sphere.
+*/
+static bool light_cone(real radius, real distance_squared, real& cos_max, real& one_minus_cos) {
+
+	const real sin2 = radius * radius / distance_squared;
+	if (sin2 >= 1) {
+
+		return false;
+	}
+	cos_max = std::sqrt(1 - sin2);
+	one_minus_cos = sin2 / (1 + cos_max);
+	return one_minus_cos > 0;
+}
+
+static double choice_probability(const std::vector<double>& cdf, std::size_t index) {
+
+	return index == 0 ? cdf[0] : cdf[index] - cdf[index - 1];
+}
+
+bool light_list::sample(const point3& p, double u, double v, double w, light_sample& result) const {
+
+	if (lights.empty()) {
+
+		return false;
+	}
+
+	const auto index = std::min<std::size_t>(std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin(), lights.size() - 1);
+	const auto& l = lights[index];
+	const vec3 to_center = l.center - p;
+	const real distance_squared = to_center.length_squared();
+	real cos_max, one_minus_cos;
+	if (!light_cone(l.radius, distance_squared, cos_max, one_minus_cos)) {
+
+		return false;
+	}
+
+	// Uniform in the cone: the cosine uniform in [cos_max, 1], around an orthonormal basis of the cone axis.
+	const vec3 axis = to_center / std::sqrt(distance_squared);
+	const real sign = std::copysign(real(1), axis.z());
+	const real a = -1 / (sign + axis.z());
+	const real b = axis.x() * axis.y() * a;
+	const vec3 tangent(1 + sign * axis.x() * axis.x() * a, sign * b, -sign * axis.x());
+	const vec3 bitangent(b, sign + axis.y() * axis.y() * a, -axis.y());
+
+	const real cos_theta = 1 - static_cast<real>(v) * one_minus_cos;
+	const real sin_theta = std::sqrt(std::max(real(0), 1 - cos_theta * cos_theta));
+	double s, c;
+	sincos_turns(w, s, c);
+	result.direction = unit_vector(static_cast<real>(c) * sin_theta * tangent + static_cast<real>(s) * sin_theta * bitangent
+		+ cos_theta * axis);
+
+	// The nearer root of the sphere along the sampled direction; inside the cone there always is one, up to rounding.
+	// As in sphere::hit, r^2 minus the squared distance of the ray to the center, which keeps small lights exact.
+	const real half_b = dot(-to_center, result.direction);
+	const vec3 closest_offset = -to_center - half_b * result.direction;
+	const real h = l.radius * l.radius - closest_offset.length_squared();
+	result.distance = -half_b - std::sqrt(std::max(real(0), h));
+	if (result.distance <= 0) {
+
+		return false;
+	}
+
+	result.pdf = static_cast<real>(choice_probability(cdf, index)) / (2 * static_cast<real>(pi) * one_minus_cos);
+	result.radiance = l.radiance;
+	return true;
+}
+
+real light_list::pdf(std::size_t index, const point3& p) const {
+
+	const auto& l = lights[index];
+	real cos_max, one_minus_cos;
+	if (!light_cone(l.radius, (l.center - p).length_squared(), cos_max, one_minus_cos)) {
+
+		return 0;
+	}
+	return static_cast<real>(choice_probability(cdf, index)) / (2 * static_cast<real>(pi) * one_minus_cos);
+}
+
+std::size_t light_list::find(const point3& hit_point, std::uint32_t material) const {
+
+	// Hit points lie on the sphere up to the rounding of the intersection.
+	for (std::size_t i = 0; i < lights.size(); ++i) {
+
+		const auto& l = lights[i];
+		if (l.material == material
+			&& std::fabs((hit_point - l.center).length() - l.radius) <= real(1e-3) * std::max(l.radius, real(1))) {
+
+			return i;
+		}
+	}
+	return lights.size();
+}
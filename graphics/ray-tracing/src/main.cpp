@@ -1,75 +1,586 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <fstream>
 #include <iostream>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
 
 #include "rtweekend.hpp"
 
+#include "animation.hpp"
+#include "bvh.hpp"
 #include "camera.hpp"
-#include "color.hpp"
+#include "denoiser.hpp"
+#include "distributed.hpp"
+#include "framebuffer.hpp"
+#include "gpu_backend.hpp"
 #include "hittable_list.hpp"
-#include "sphere.hpp"
+#include "image_io.hpp"
+#include "mapped_file.hpp"
+#include "options.hpp"
+#include "primitive_store.hpp"
+#include "profiler.hpp"
+#include "render_service.hpp"
+#include "renderer.hpp"
+#include "scene_file.hpp"
+#include "scenes.hpp"
+
+// Set by Ctrl+C during a progressive render, which then stops after the tiles in flight.
+static std::atomic<bool> interrupt_requested{ false };
 
-color ray_color(const ray& r, const hittable& world, int depth) {
+extern "C" void request_interrupt(int) {
+
+	interrupt_requested = true;
+}
 
-	hit_record rec;
+/*
+	--aov and --denoise: renders the AOVs of the frame, writes them next to aov_path if it is set and replaces the image
+	with its denoised version if a denoiser is. Returns the milliseconds it took, 0 if there was nothing to do.
+*/
+static double finish_frame(renderer& tracer, const hittable& world, const camera& cam, const options& opts,
+	const std::string& aov_path, framebuffer& image) {
 
-	// If we've exceeded the ray bounce limit, no more light is gathered.
-	if (depth <= 0) {
+	if (opts.denoising.type == denoiser_type::none && aov_path.empty()) {
 
-		return color(0, 0, 0);
+		return 0;
 	}
 
-	if (world.hit(r, 0.001, infinity, rec)) {
+	const auto start = std::chrono::steady_clock::now();
+	aov_buffers aovs;
+	tracer.render_aovs(world, cam, aovs);
+	if (!aov_path.empty()) {
 
-		// Pick random points on the surface of the unit sphere, offset along the surface normal.
-		// We do this by picking random points in the unit sphere and normalizing them.
-		// This is done to achieve a Lambertian distribution.
-		point3 target = rec.p + random_in_hemisphere(rec.normal);
-		return 0.5 * ray_color(ray(rec.p, target - rec.p), world, depth - 1);
+		write_image(aov_file_path(aov_path, "albedo"), aovs.albedo);
+		write_image(aov_file_path(aov_path, "normal"), aovs.normal);
+		write_image(aov_file_path(aov_path, "depth"), aovs.depth);
 	}
+	if (opts.denoising.type != denoiser_type::none) {
+
+		const framebuffer noisy = image;
+		denoise(noisy, aovs, opts.denoising, image);
+	}
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// --stream: the frame goes out band by band while it renders, to the output file or as a binary PPM to stdout.
+static render_stats render_stream(renderer& tracer, const hittable& world, const camera& cam, const options& opts) {
+
+	const auto& settings = tracer.settings();
+	if (opts.output_path.empty()) {
+
+#ifdef _WIN32
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		image_stream stream(std::cout, settings.image_width, settings.image_height, image_format::ppm);
+		return tracer.render_streaming(world, cam, stream, opts.stream_bands);
+	}
+
+	std::ofstream file(opts.output_path, std::ios::binary);
+	if (!file) {
+
+		throw std::runtime_error("cannot open " + opts.output_path + " for writing");
+	}
+	image_stream stream(file, settings.image_width, settings.image_height, image_format_from_path(opts.output_path));
+	return tracer.render_streaming(world, cam, stream, opts.stream_bands);
+}
+
+/*
+	--frames: the scene moves between frames and keeps its BVH, which is refit, or rebuilt once refits made it
+	too slow, instead of built from scratch. One image per frame, with the acceleration structure time reported.
+*/
+static int render_sequence(const options& opts, scene_description& description) {
+
+	const auto& settings = opts.settings;
+	scene_animation animation(description.world, description.velocities, description.camera.lookat,
+		opts.animation.turntable_degrees);
+	if (!animation.moves()) {
+
+		std::cerr << "Nothing in the scene moves, every frame is the same\n";
+	}
+
+	camera_settings view = description.camera;
+	view.aspect_ratio = static_cast<real>(settings.image_width) / static_cast<real>(settings.image_height);
+	const camera cam(view);
+	renderer tracer(settings);
+	const material_table materials(description.materials);
+	tracer.set_materials(materials);
+	std::cerr << "Rendering " << opts.animation.frames << " frames on " << tracer.thread_count() << " threads\n";
+
+	animated_bvh sequence(description.world, opts.bvh_leaf_size, opts.animation.rebuild_threshold);
+	double structure_ms = sequence.bvh().build_stats().build_ms;
+	double render_seconds = 0;
+	int rebuilds = 0;
+
+	framebuffer image;
+	for (int frame = 0; frame < opts.animation.frames; ++frame) {
+
+		bvh_update update;
+		update.rebuilt = true;
+		update.milliseconds = sequence.bvh().build_stats().build_ms;
+		update.sah_cost = sequence.bvh().build_stats().sah_cost;
+		if (frame > 0) {
+
+			animation.set_frame(frame);
+			update = sequence.update();
+			structure_ms += update.milliseconds;
+			rebuilds += update.rebuilt ? 1 : 0;
+		}
+
+		// Lights move with their spheres.
+		if (settings.integrator == integrator_type::nee) {
+
+			tracer.set_lights(light_list(description.world, materials));
+		}
+		const auto stats = tracer.render(sequence.bvh(), cam, image);
+		render_seconds += stats.seconds;
+		const std::string path = frame_path(opts.output_path, frame);
+		try {
+
+			finish_frame(tracer, sequence.bvh(), cam, opts, opts.aov_path.empty() ? "" : frame_path(opts.aov_path, frame), image);
+			write_image(path, image);
+		}
+		catch (const std::exception& e) {
+
+			std::cerr << '\n' << e.what() << '\n';
+			return 1;
+		}
+
+		std::cerr << "\rFrame " << frame << ": " << (update.rebuilt ? "build " : "refit ") << update.milliseconds << " ms, SAH cost "
+			<< update.sah_cost << " (" << update.cost_ratio << "x the last build), render " << stats.seconds << " s, " << path << '\n';
+	}
+
+	std::cerr << "Done in " << render_seconds << " s of rendering and " << structure_ms << " ms of BVH builds and refits, "
+		<< rebuilds << " rebuilds after the first frame\n";
+	return 0;
+}
+
+// A scene as a scene file, to send to workers or the render service. A mapped one is sent as it is.
+static std::vector<std::uint8_t> scene_file_bytes(const options& opts, const scene_description& description, bool mapped) {
+
+	if (!mapped) {
+
+		return encode_scene_file(description, opts.bvh_leaf_size);
+	}
+	const mapped_file file(opts.scene);
+	return std::vector<std::uint8_t>(file.data(), file.data() + file.size());
+}
+
+/*
+	--submit: renders the frame, or its region, on the render service and writes the bands into the image as they arrive.
+	The camera goes with the job, so overrides apply to mapped scenes too.
+*/
+static void render_remote(const options& opts, const scene_description& description, bool mapped, framebuffer& image) {
+
+	render_job job;
+	job.settings = opts.settings;
+	job.camera = description.camera;
+	job.region = opts.region;
+	if (job.region.x1 == 0) {
+
+		job.region = { 0, 0, job.settings.image_width, job.settings.image_height };
+	}
+
+	const auto scene_bytes = scene_file_bytes(opts, description, mapped);
+	job.scene_digest = sha256(scene_bytes.data(), scene_bytes.size());
+
+	image.resize(job.region.x1 - job.region.x0, job.region.y1 - job.region.y0);
+	render_client client(opts.submit_host, opts.submit_port);
+	const auto stats = client.render(job, scene_bytes, [&](const tile& band, const std::vector<color>& pixels) {
+
+		const int width = band.x1 - band.x0;
+		for (int y = band.y0; y < band.y1; ++y) {
+
+			for (int x = band.x0; x < band.x1; ++x) {
 
-	vec3 unit_direction = unit_vector(r.direction());
-	auto t = 0.5 * (unit_direction.y() + 1.0);
+				image.set(x - job.region.x0, y - job.region.y0, pixels[static_cast<std::size_t>(y - band.y0) * width + (x - band.x0)]);
+			}
+		}
+		if (opts.settings.show_progress) {
+
+			std::cerr << "\rRows received: " << band.y1 - job.region.y0 << '/' << job.region.y1 - job.region.y0 << ' ' << std::flush;
+		}
+	});
 
-	return (1.0 - t) * color(1.0, 1.0, 1.0) + t * color(0.5, 0.7, 1.0);
+	const double pixel_count = static_cast<double>(image.pixel_count());
+	std::cerr << "\nDone in " << stats.seconds << " s on the service, which " << (stats.scene_cached ? "had the scene cached" : "loaded the scene")
+		<< ", " << static_cast<double>(stats.samples) / pixel_count << " samples per pixel, "
+		<< static_cast<double>(stats.rays) / static_cast<double>(stats.samples) << " rays per sample.\n";
 }
 
-int main() {
+// The image to the output file, or as a binary PPM to stdout.
+static void write_output(const options& opts, const framebuffer& image) {
+
+	if (opts.output_path.empty()) {
+
+#ifdef _WIN32
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		write_image(std::cout, image, image_format::ppm);
+	}
+	else {
 
-    // Image
-    const auto aspect_ratio = 16.0 / 9.0;
-    const int image_width = 400;
-    const int image_height = static_cast<int>(image_width / aspect_ratio);
-	const int samples_per_pixel = 100;
-	const int max_depth = 50;
+		write_image(opts.output_path, image);
+	}
+}
+
+int main(int argc, char* argv[]) {
+
+	options opts;
+	try {
+
+		opts = parse_options(argc, argv);
+	}
+	catch (const std::invalid_argument& e) {
+
+		std::cerr << e.what() << '\n' << usage(argv[0]);
+		return 1;
+	}
+
+	if (opts.show_help) {
+
+		std::cerr << usage(argv[0]);
+		return 0;
+	}
+
+	if (opts.denoising.type == denoiser_type::oidn && !oidn_available()) {
+
+		std::cerr << "Open Image Denoise unavailable (built without RT_ENABLE_OIDN), denoising with the a-trous filter\n";
+		opts.denoising.type = denoiser_type::atrous;
+	}
+
+	if (!opts.worker_host.empty()) {
+
+		try {
+
+			const auto tasks = run_worker(opts.worker_host, opts.worker_port, opts.settings.thread_count);
+			std::cerr << "Rendered " << tasks << " tasks\n";
+			return 0;
+		}
+		catch (const std::exception& e) {
+
+			std::cerr << e.what() << '\n';
+			return 1;
+		}
+	}
+
+	if (opts.serve) {
+
+		try {
+
+			std::signal(SIGINT, request_interrupt);
+			run_render_service(opts.service, &interrupt_requested);
+			std::cerr << "Stopped serving\n";
+			return 0;
+		}
+		catch (const std::exception& e) {
+
+			std::cerr << e.what() << '\n';
+			return 1;
+		}
+	}
+
+	// Image
+	auto& settings = opts.settings;
+	const auto aspect_ratio = 16.0 / 9.0;
+	settings.image_width = opts.image_width;
+	settings.image_height = opts.image_height > 0 ? opts.image_height
+		: std::max(static_cast<int>(settings.image_width / aspect_ratio), 1);
+	settings.max_depth = 50;
 
 	// World
-	hittable_list world;
-	world.add(make_shared<sphere>(point3(0, 0, -1), 0.5));
-	world.add(make_shared<sphere>(point3(0, -100.5, -1), 100));
+	scene_description description;
+	std::unique_ptr<mapped_scene> mapped;
+	try {
+
+		if (is_binary_scene_path(opts.scene)) {
+
+			mapped = std::make_unique<mapped_scene>(opts.scene);
+			description.camera = mapped->camera();
+			std::cerr << "Mapped " << mapped->sphere_count() << " spheres from " << opts.scene << '\n';
+		}
+		else {
+
+			description = load_scene(opts.scene);
+		}
+		opts.view.apply(description.camera);
+
+		if (!opts.export_path.empty()) {
+
+			if (mapped) {
+
+				throw std::invalid_argument(opts.scene + " already is a scene file");
+			}
+			write_scene_file(opts.export_path, description, opts.bvh_leaf_size);
+			std::cerr << "Wrote " << description.world.objects.size() << " spheres to " << opts.export_path << '\n';
+			return 0;
+		}
+	}
+	catch (const std::exception& e) {
+
+		std::cerr << e.what() << '\n';
+		return 1;
+	}
+
+	if (opts.animation.frames > 1) {
+
+		try {
+
+			return render_sequence(opts, description);
+		}
+		catch (const std::exception& e) {
+
+			std::cerr << e.what() << '\n';
+			return 1;
+		}
+	}
+
+	// The service brings its own acceleration structure and threads.
+	if (!opts.submit_host.empty()) {
+
+		try {
+
+			framebuffer image;
+			render_remote(opts, description, mapped != nullptr, image);
+			write_output(opts, image);
+			return 0;
+		}
+		catch (const std::exception& e) {
+
+			std::cerr << '\n' << e.what() << '\n';
+			return 1;
+		}
+	}
+
+	// Acceleration structure, a mapped scene brings its own
+	std::unique_ptr<bvh_node> world_bvh;
+	std::unique_ptr<primitive_store> world_store;
+	if (!mapped && opts.use_bvh) {
+
+		world_bvh = std::make_unique<bvh_node>(description.world, opts.bvh_leaf_size);
+		world_bvh->collect_traversal_stats(opts.bvh_stats);
+	}
+	else if (!mapped) {
+
+		world_store = std::make_unique<primitive_store>(description.world);
+	}
+	const hittable& scene = mapped ? static_cast<const hittable&>(*mapped)
+		: world_bvh ? static_cast<const hittable&>(*world_bvh) : *world_store;
 
 	// Camera
-	camera cam;
+	camera_settings view = description.camera;
+	view.aspect_ratio = static_cast<real>(settings.image_width) / static_cast<real>(settings.image_height);
+	camera cam(view);
 
-    // Render
-	std::cout << "P3\n" << image_width << ' ' << image_height << "\n255\n";
-	for (int j = image_height - 1; j >= 0; --j) {
+	// Render
+	renderer tracer(settings);
+	std::cerr << "Rendering on " << tracer.thread_count() << " threads\n";
 
-		std::cerr << "\rScanlines remaining: " << j << ' ' << std::flush;
-		for (int i = 0; i < image_width; ++i) {
+	// The device kernels shade every surface as gray diffuse, and so does the cpu reference they are verified against.
+	if (opts.device == render_device::cpu || (opts.device == render_device::cuda && !cuda_available())) {
+
+		tracer.set_materials(mapped ? mapped->copy_materials() : material_table(description.materials));
+		if (settings.integrator == integrator_type::nee) {
+
+			tracer.set_lights(mapped ? light_list(mapped->bvh().spheres(), tracer.materials())
+				: light_list(description.world, tracer.materials()));
+			std::cerr << "Sampling " << tracer.lights().size() << " lights\n";
+		}
+	}
+	if (settings.kernel == render_kernel::specialized && !opts.coordinator) {
+
+		std::cerr << "Kernel " << tracer.kernel_for(scene) << '\n';
+	}
 
-			color pixel_color(0, 0, 0);
-			for (int s = 0; s < samples_per_pixel; ++s) {
+	framebuffer image;
+	render_stats stats;
+	profile_reset();
+	if (opts.coordinator) {
 
-				// RGB range from 0.0 to 1.0
-				auto u = (i + random_double()) / (image_width - 1);
-				auto v = (j + random_double()) / (image_height - 1);
+		try {
 
-				ray r = cam.get_ray(u, v);
-				pixel_color += ray_color(r, world, max_depth);
+			if (mapped && opts.view.any()) {
+
+				throw std::runtime_error("workers take the camera of a mapped scene from the file, export it with the new camera");
+			}
+			const auto scene_bytes = scene_file_bytes(opts, description, mapped != nullptr);
+
+			accumulation_buffer accumulation;
+			stats = coordinate_render(settings, opts.distribution, scene_bytes, accumulation);
+			accumulation.resolve(image);
+		}
+		catch (const std::exception& e) {
+
+			std::cerr << e.what() << '\n';
+			return 1;
+		}
+	}
+	else if (opts.progressive) {
+
+		accumulation_buffer accumulation;
+		try {
+
+			if (!opts.resume_path.empty()) {
+
+				std::uint64_t checkpoint_seed = 0;
+				accumulation = accumulation_buffer::load(opts.resume_path, checkpoint_seed);
+				if (accumulation.width() != settings.image_width || accumulation.height() != settings.image_height
+					|| checkpoint_seed != settings.seed) {
+
+					throw std::runtime_error(opts.resume_path + " was rendered with another resolution or seed");
+				}
+				std::cerr << "Resuming at " << accumulation.min_samples() << " samples per pixel\n";
+			}
+
+			auto save = [&](const accumulation_buffer& samples) {
+
+				if (!opts.output_path.empty()) {
+
+					samples.resolve(image);
+					write_image(opts.output_path, image);
+				}
+				if (!opts.checkpoint_path.empty()) {
+
+					samples.save(opts.checkpoint_path, settings.seed);
+				}
+			};
+
+			auto progression = opts.progression;
+			progression.cancel = &interrupt_requested;
+			progression.on_snapshot = save;
+			std::signal(SIGINT, request_interrupt);
+
+			stats = tracer.render_progressive(scene, cam, accumulation, progression);
+
+			std::signal(SIGINT, SIG_DFL);
+			accumulation.resolve(image);
+			if (!opts.checkpoint_path.empty()) {
+
+				accumulation.save(opts.checkpoint_path, settings.seed);
 			}
+		}
+		catch (const std::exception& e) {
+
+			std::cerr << e.what() << '\n';
+			return 1;
+		}
+
+		if (stats.interrupted) {
 
-			write_color(std::cout, pixel_color, samples_per_pixel);
+			std::cerr << "\nStopped early";
 		}
 	}
+	else if (opts.device == render_device::cuda && !cuda_available()) {
 
-	std::cerr << "\nDone.\n";
+		std::cerr << "CUDA unavailable (" << cuda_device_description() << "), rendering on the CPU\n";
+		stats = tracer.render(scene, cam, image);
+	}
+	else if (opts.device != render_device::cpu) {
+
+		try {
+
+			const device_scene_data device_scene(mapped ? mapped->bvh() : *world_bvh);
+			if (opts.device == render_device::cuda) {
+
+				std::cerr << "Rendering on " << cuda_device_description() << '\n';
+			}
+			stats = render_on_device(opts.device, settings, device_scene, cam, image);
+
+			if (opts.verify_rmse >= 0) {
+
+				framebuffer reference;
+				tracer.render(scene, cam, reference);
+				const auto difference = compare_images(image, reference);
+				std::cerr << "\n" << render_device_name(opts.device) << " vs cpu: RMSE " << difference.rmse
+					<< ", max error " << difference.max_error << ", means " << difference.mean_a << " / " << difference.mean_b << '\n';
+				if (difference.rmse > opts.verify_rmse) {
+
+					throw std::runtime_error("device image differs from the cpu image by more than RMSE " + std::to_string(opts.verify_rmse));
+				}
+			}
+		}
+		catch (const std::exception& e) {
+
+			std::cerr << e.what() << '\n';
+			return 1;
+		}
+	}
+	else if (opts.stream) {
+
+		try {
+
+			stats = render_stream(tracer, scene, cam, opts);
+		}
+		catch (const std::exception& e) {
+
+			std::cerr << e.what() << '\n';
+			return 1;
+		}
+	}
+	else {
+
+		stats = tracer.render(scene, cam, image);
+	}
+	const double pixel_count = static_cast<double>(settings.image_width) * settings.image_height;
+	std::cerr << "\nDone in " << stats.seconds << " s, "
+		<< static_cast<double>(stats.samples) / pixel_count << " new samples per pixel, "
+		<< static_cast<double>(stats.rays) / static_cast<double>(stats.samples) << " rays per sample.\n";
+
+	try {
+
+		const double denoise_ms = finish_frame(tracer, scene, cam, opts, opts.aov_path, image);
+		if (opts.denoising.type != denoiser_type::none) {
+
+			std::cerr << "Denoised with " << denoiser_type_name(opts.denoising.type) << " in " << denoise_ms << " ms\n";
+		}
+	}
+	catch (const std::exception& e) {
+
+		std::cerr << e.what() << '\n';
+		return 1;
+	}
+
+	if (!opts.profile_path.empty()) {
+
+		try {
+
+			write_profile_summary(std::cerr, profile_totals());
+			write_chrome_trace(opts.profile_path);
+			std::cerr << "Wrote the timeline to " << opts.profile_path << '\n';
+		}
+		catch (const std::exception& e) {
+
+			std::cerr << e.what() << '\n';
+			return 1;
+		}
+	}
+
+	// Output
+	try {
+
+		if (!opts.stream) {   // Written while rendering.
+
+			write_output(opts, image);
+		}
+
+		if (!opts.heatmap_path.empty()) {
+
+			write_image(opts.heatmap_path, tracer.sample_heatmap());
+		}
+	}
+	catch (const std::exception& e) {
+
+		std::cerr << e.what() << '\n';
+		return 1;
+	}
+
+	if (world_bvh && opts.bvh_stats) {
+
+		world_bvh->print_report(std::cerr);
+	}
 }
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "mapped_file.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+mapped_file::mapped_file(const std::string& path) {
+
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+
+		throw std::runtime_error("cannot open " + path);
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+
+		CloseHandle(file);
+		throw std::runtime_error("cannot map empty file " + path);
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!view) {
+
+		if (mapping) CloseHandle(mapping);
+		CloseHandle(file);
+		throw std::runtime_error("cannot map " + path);
+	}
+
+	file_handle = file;
+	mapping_handle = mapping;
+	bytes = static_cast<const std::uint8_t*>(view);
+	length = static_cast<std::size_t>(file_size.QuadPart);
+}
+
+mapped_file::~mapped_file() {
+
+	UnmapViewOfFile(bytes);
+	CloseHandle(mapping_handle);
+	CloseHandle(file_handle);
+}
+#else
+mapped_file::mapped_file(const std::string& path) {
+
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+
+		throw std::runtime_error("cannot open " + path);
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+
+		close(fd);
+		throw std::runtime_error("cannot map empty file " + path);
+	}
+
+	void* view = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED) {
+
+		throw std::runtime_error("cannot map " + path);
+	}
+
+	bytes = static_cast<const std::uint8_t*>(view);
+	length = static_cast<std::size_t>(info.st_size);
+}
+
+mapped_file::~mapped_file() {
+
+	munmap(const_cast<std::uint8_t*>(bytes), length);
+}
+#endif
+
+const std::uint8_t* mapped_file::data() const {
+
+	return bytes;
+}
+
+std::size_t mapped_file::size() const {
+
+	return length;
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "material.hpp"
+
+#include <cmath>
+
+#include "hittable.hpp"
+#include "integrator.hpp"
+
+material_table::material_table(std::vector<material_record> records) : records{ std::move(records) } {}
+
+std::size_t material_table::size() const {
+
+	return records.size();
+}
+
+bool material_table::empty() const {
+
+	return records.empty();
+}
+
+color emitted(const material_record& m) {
+
+	if (m.type != material_type::emissive) {
+
+		return color(0, 0, 0);
+	}
+	return m.parameter * material_albedo(m);
+}
+
+static vec3 reflect(const vec3& v, const vec3& n) {
+
+	return v - 2 * dot(v, n) * n;
+}
+
+// Snell's law for a unit direction, split into the parts perpendicular and parallel to the normal.
+static vec3 refract(const vec3& uv, const vec3& n, real eta_ratio) {
+
+	const real cos_theta = std::fmin(dot(-uv, n), real(1));
+	const vec3 perpendicular = eta_ratio * (uv + cos_theta * n);
+	const vec3 parallel = -std::sqrt(std::fabs(1 - perpendicular.length_squared())) * n;
+	return perpendicular + parallel;
+}
+
+// Schlick's approximation of the Fresnel reflectance.
+static real reflectance(real cosine, real eta_ratio) {
+
+	real r0 = (1 - eta_ratio) / (1 + eta_ratio);
+	r0 = r0 * r0;
+	return r0 + (1 - r0) * std::pow(1 - cosine, real(5));
+}
+
+// A point in the unit ball: rejection sampled from the stream without a sampler, mapped from three dimensions with one.
+static vec3 ball_sample(sample_context& ctx) {
+
+	if (!ctx.pattern) {
+
+		return random_in_unit_sphere(ctx.rng);
+	}
+
+	double u, v;
+	ctx.next_2d(u, v);
+	return static_cast<real>(std::cbrt(ctx.next_1d())) * map_unit_vector(u, v);
+}
+
+bool specular_direction(const material_record& m, const ray& r_in, const hit_record& rec, vec3& direction) {
+
+	const vec3 unit_direction = unit_vector(r_in.direction());
+	if (m.type == material_type::metal) {
+
+		direction = reflect(unit_direction, rec.normal);
+		return true;
+	}
+	if (m.type != material_type::dielectric) {
+
+		return false;
+	}
+
+	const real eta_ratio = rec.front_face ? 1 / m.parameter : m.parameter;
+	const real cos_theta = std::fmin(dot(-unit_direction, rec.normal), real(1));
+	const real sin_theta = std::sqrt(1 - cos_theta * cos_theta);
+	const bool reflects = eta_ratio * sin_theta > 1 || reflectance(cos_theta, eta_ratio) > real(0.5);
+	direction = reflects ? reflect(unit_direction, rec.normal) : refract(unit_direction, rec.normal, eta_ratio);
+	return true;
+}
+
+bool scatter(const material_record& m, const ray& r_in, const hit_record& rec, sample_context& ctx,
+	ray& scattered, color& attenuation) {
+
+	switch (m.type) {
+	case material_type::lambertian: {
+
+		scattered = ray(rec.p, sample_bounce(ctx, rec.normal));
+		attenuation = material_albedo(m);
+		return true;
+	}
+	case material_type::metal: {
+
+		const vec3 reflected = reflect(unit_vector(r_in.direction()), rec.normal);
+		scattered = ray(rec.p, reflected + m.parameter * ball_sample(ctx));
+		attenuation = material_albedo(m);
+		return dot(scattered.direction(), rec.normal) > 0;
+	}
+	case material_type::dielectric: {
+
+		const real ior = m.parameter;
+		const real eta_ratio = rec.front_face ? 1 / ior : ior;
+		const vec3 unit_direction = unit_vector(r_in.direction());
+		const real cos_theta = std::fmin(dot(-unit_direction, rec.normal), real(1));
+		const real sin_theta = std::sqrt(1 - cos_theta * cos_theta);
+
+		// Total internal reflection, or a reflection chosen with the Fresnel probability.
+		const bool cannot_refract = eta_ratio * sin_theta > 1;
+		const bool reflects = cannot_refract || reflectance(cos_theta, eta_ratio) > ctx.next_1d();
+		scattered = ray(rec.p, reflects ? reflect(unit_direction, rec.normal) : refract(unit_direction, rec.normal, eta_ratio));
+		attenuation = material_albedo(m);
+		return true;
+	}
+	case material_type::emissive:
+	default:
+		return false;
+	}
+}
\ No newline at end of file
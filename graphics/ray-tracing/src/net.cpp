@@ -0,0 +1,414 @@
+#include "net.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+using native_socket = SOCKET;
+static const native_socket no_socket = INVALID_SOCKET;
+
+static void start_network() {
+
+	static std::once_flag started;
+	std::call_once(started, []() {
+
+		WSADATA data;
+		if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+
+			throw std::runtime_error("cannot start Winsock");
+		}
+	});
+}
+
+static void close_socket(native_socket s) {
+
+	closesocket(s);
+}
+#else
+using native_socket = int;
+static const native_socket no_socket = -1;
+
+static void start_network() {}
+
+static void close_socket(native_socket s) {
+
+	::close(s);
+}
+#endif
+
+static native_socket to_native(std::intptr_t handle) {
+
+	return handle == -1 ? no_socket : static_cast<native_socket>(handle);
+}
+
+static std::intptr_t from_native(native_socket s) {
+
+	return s == no_socket ? -1 : static_cast<std::intptr_t>(s);
+}
+
+tcp_connection::tcp_connection(std::intptr_t socket) : handle{ socket } {
+
+	// Messages are written header first and then awaited, so Nagle's algorithm would only add latency.
+	int enable = 1;
+	setsockopt(to_native(handle), IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&enable), sizeof(enable));
+}
+
+tcp_connection::~tcp_connection() {
+
+	close();
+}
+
+tcp_connection::tcp_connection(tcp_connection&& other) noexcept : handle{ other.handle } {
+
+	other.handle = -1;
+}
+
+tcp_connection& tcp_connection::operator=(tcp_connection&& other) noexcept {
+
+	if (this != &other) {
+
+		close();
+		handle = other.handle;
+		other.handle = -1;
+	}
+	return *this;
+}
+
+tcp_connection tcp_connection::connect(const std::string& host, int port) {
+
+	start_network();
+
+	addrinfo hints;
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* addresses = nullptr;
+	const std::string address = host + ':' + std::to_string(port);
+	if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0) {
+
+		throw std::runtime_error("cannot resolve " + host);
+	}
+
+	native_socket s = no_socket;
+	for (addrinfo* a = addresses; a; a = a->ai_next) {
+
+		s = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+		if (s == no_socket) continue;
+		if (::connect(s, a->ai_addr, static_cast<int>(a->ai_addrlen)) == 0) break;
+		close_socket(s);
+		s = no_socket;
+	}
+	freeaddrinfo(addresses);
+
+	if (s == no_socket) {
+
+		throw std::runtime_error("cannot connect to " + address);
+	}
+	return tcp_connection(from_native(s));
+}
+
+bool tcp_connection::is_open() const {
+
+	return handle != -1;
+}
+
+void tcp_connection::close() {
+
+	if (handle != -1) {
+
+		close_socket(to_native(handle));
+		handle = -1;
+	}
+}
+
+void tcp_connection::set_timeout(double seconds) {
+
+#ifdef _WIN32
+	const DWORD timeout = static_cast<DWORD>(seconds * 1000);
+#else
+	timeval timeout;
+	timeout.tv_sec = static_cast<long>(seconds);
+	timeout.tv_usec = static_cast<long>((seconds - static_cast<double>(timeout.tv_sec)) * 1e6);
+#endif
+	setsockopt(to_native(handle), SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+}
+
+bool tcp_connection::wait_readable(double timeout) {
+
+	const native_socket s = to_native(handle);
+	fd_set readable;
+	FD_ZERO(&readable);
+	FD_SET(s, &readable);
+	timeval wait;
+	wait.tv_sec = static_cast<long>(timeout);
+	wait.tv_usec = static_cast<long>((timeout - static_cast<double>(wait.tv_sec)) * 1e6);
+	return select(static_cast<int>(s) + 1, &readable, nullptr, nullptr, &wait) > 0;
+}
+
+void tcp_connection::send_all(const void* data, std::size_t size) {
+
+#ifdef _WIN32
+	const int flags = 0;
+#else
+	const int flags = MSG_NOSIGNAL;   // a closed peer is an error here, not a SIGPIPE
+#endif
+	const char* bytes = static_cast<const char*>(data);
+	while (size > 0) {
+
+		const int chunk = static_cast<int>(size < (1u << 30) ? size : (1u << 30));
+		const auto sent = send(to_native(handle), bytes, chunk, flags);
+		if (sent <= 0) {
+
+			throw std::runtime_error("connection lost while sending");
+		}
+		bytes += sent;
+		size -= static_cast<std::size_t>(sent);
+	}
+}
+
+void tcp_connection::receive_all(void* data, std::size_t size) {
+
+	char* bytes = static_cast<char*>(data);
+	while (size > 0) {
+
+		const int chunk = static_cast<int>(size < (1u << 30) ? size : (1u << 30));
+		const auto received = recv(to_native(handle), bytes, chunk, 0);
+		if (received <= 0) {
+
+			throw std::runtime_error(received == 0 ? "connection closed" : "connection lost or timed out while receiving");
+		}
+		bytes += received;
+		size -= static_cast<std::size_t>(received);
+	}
+}
+
+tcp_listener::tcp_listener(int port) {
+
+	start_network();
+
+	const native_socket s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (s == no_socket) {
+
+		throw std::runtime_error("cannot create a socket");
+	}
+
+	int reuse = 1;
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+	sockaddr_in address;
+	std::memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(static_cast<unsigned short>(port));
+	socklen_t length = sizeof(address);
+	if (bind(s, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(s, 16) != 0
+		|| getsockname(s, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+
+		close_socket(s);
+		throw std::runtime_error("cannot listen on port " + std::to_string(port));
+	}
+
+	handle = from_native(s);
+	bound_port = ntohs(address.sin_port);
+}
+
+tcp_listener::~tcp_listener() {
+
+	close_socket(to_native(handle));
+}
+
+int tcp_listener::port() const {
+
+	return bound_port;
+}
+
+bool tcp_listener::accept(tcp_connection& connection, double timeout) {
+
+	const native_socket s = to_native(handle);
+	fd_set readable;
+	FD_ZERO(&readable);
+	FD_SET(s, &readable);
+	timeval wait;
+	wait.tv_sec = static_cast<long>(timeout);
+	wait.tv_usec = static_cast<long>((timeout - static_cast<double>(wait.tv_sec)) * 1e6);
+	if (select(static_cast<int>(s) + 1, &readable, nullptr, nullptr, &wait) <= 0) {
+
+		return false;
+	}
+
+	const native_socket accepted = ::accept(s, nullptr, nullptr);
+	if (accepted == no_socket) {
+
+		return false;
+	}
+	connection = tcp_connection(from_native(accepted));
+	return true;
+}
+
+void send_message(tcp_connection& connection, std::uint32_t type, const std::vector<std::uint8_t>& payload) {
+
+	byte_writer header;
+	header.put_u32(type);
+	header.put_u64(payload.size());
+	connection.send_all(header.bytes().data(), header.bytes().size());
+	if (!payload.empty()) {
+
+		connection.send_all(payload.data(), payload.size());
+	}
+}
+
+net_message receive_message(tcp_connection& connection, std::uint64_t max_payload) {
+
+	std::vector<std::uint8_t> header(12);
+	connection.receive_all(header.data(), header.size());
+
+	byte_reader fields(header);
+	net_message message;
+	message.type = fields.get_u32();
+	const auto length = fields.get_u64();
+	if (length > max_payload) {
+
+		throw std::runtime_error("message of " + std::to_string(length) + " bytes is too large");
+	}
+
+	// The buffer grows with the bytes that actually arrive, so announcing a large payload costs the sender as much.
+	const std::uint64_t chunk_size = std::uint64_t(1) << 20;
+	std::uint64_t received = 0;
+	while (received < length) {
+
+		const auto chunk = std::min(length - received, chunk_size);
+		message.payload.resize(static_cast<std::size_t>(received + chunk));
+		connection.receive_all(message.payload.data() + received, static_cast<std::size_t>(chunk));
+		received += chunk;
+	}
+	return message;
+}
+
+void byte_writer::put_u32(std::uint32_t v) {
+
+	for (int i = 0; i < 4; ++i) {
+
+		out.push_back(static_cast<std::uint8_t>(v >> (8 * i)));
+	}
+}
+
+void byte_writer::put_u64(std::uint64_t v) {
+
+	for (int i = 0; i < 8; ++i) {
+
+		out.push_back(static_cast<std::uint8_t>(v >> (8 * i)));
+	}
+}
+
+void byte_writer::put_f32(float v) {
+
+	std::uint32_t bits;
+	std::memcpy(&bits, &v, sizeof(bits));
+	put_u32(bits);
+}
+
+void byte_writer::put_f64(double v) {
+
+	std::uint64_t bits;
+	std::memcpy(&bits, &v, sizeof(bits));
+	put_u64(bits);
+}
+
+void byte_writer::put_string(const std::string& s) {
+
+	put_u32(static_cast<std::uint32_t>(s.size()));
+	put_bytes(s.data(), s.size());
+}
+
+void byte_writer::put_bytes(const void* data, std::size_t size) {
+
+	const auto* bytes = static_cast<const std::uint8_t*>(data);
+	out.insert(out.end(), bytes, bytes + size);
+}
+
+std::vector<std::uint8_t>& byte_writer::bytes() {
+
+	return out;
+}
+
+byte_reader::byte_reader(const std::vector<std::uint8_t>& bytes) : in{ bytes } {}
+
+std::uint32_t byte_reader::get_u32() {
+
+	const auto* bytes = get_bytes(4);
+	std::uint32_t v = 0;
+	for (int i = 0; i < 4; ++i) {
+
+		v |= static_cast<std::uint32_t>(bytes[i]) << (8 * i);
+	}
+
+	return v;
+}
+
+std::uint64_t byte_reader::get_u64() {
+
+	const auto* bytes = get_bytes(8);
+	std::uint64_t v = 0;
+	for (int i = 0; i < 8; ++i) {
+
+		v |= static_cast<std::uint64_t>(bytes[i]) << (8 * i);
+	}
+
+	return v;
+}
+
+float byte_reader::get_f32() {
+
+	const std::uint32_t bits = get_u32();
+	float v;
+	std::memcpy(&v, &bits, sizeof(v));
+	return v;
+}
+
+double byte_reader::get_f64() {
+
+	const std::uint64_t bits = get_u64();
+	double v;
+	std::memcpy(&v, &bits, sizeof(v));
+	return v;
+}
+
+std::string byte_reader::get_string() {
+
+	const auto size = get_u32();
+	const auto* bytes = get_bytes(size);
+	return std::string(reinterpret_cast<const char*>(bytes), size);
+}
+
+const std::uint8_t* byte_reader::get_bytes(std::size_t size) {
+
+	if (size > remaining()) {
+
+		throw std::runtime_error("truncated message");
+	}
+	const auto* bytes = in.data() + position;
+	position += size;
+	return bytes;
+}
+
+std::size_t byte_reader::remaining() const {
+
+	return in.size() - position;
+}
\ No newline at end of file
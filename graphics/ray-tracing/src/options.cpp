@@ -0,0 +1,582 @@
+#include "options.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "image_io.hpp"
+#include "profiler.hpp"
+#include "scene_file.hpp"
+#include "scenes.hpp"
+
+static std::string option_value(int argc, char* argv[], int& i) {
+
+	if (i + 1 >= argc) {
+
+		throw std::invalid_argument(std::string("missing value for ") + argv[i]);
+	}
+
+	return argv[++i];
+}
+
+static long long parse_integer(const std::string& name, const std::string& value, long long min) {
+
+	std::size_t consumed = 0;
+	long long result = 0;
+	try {
+
+		result = std::stoll(value, &consumed);
+	}
+	catch (const std::exception&) {
+
+		consumed = 0;
+	}
+
+	if (consumed != value.size() || value.empty() || result < min) {
+
+		throw std::invalid_argument("invalid value '" + value + "' for " + name);
+	}
+
+	return result;
+}
+
+static double parse_real(const std::string& name, const std::string& value, double min) {
+
+	std::size_t consumed = 0;
+	double result = 0;
+	try {
+
+		result = std::stod(value, &consumed);
+	}
+	catch (const std::exception&) {
+
+		consumed = 0;
+	}
+
+	if (consumed != value.size() || value.empty() || !(result >= min)) {
+
+		throw std::invalid_argument("invalid value '" + value + "' for " + name);
+	}
+
+	return result;
+}
+
+// Three comma-separated numbers, e.g. 0,2,-5.
+static point3 parse_point(const std::string& name, const std::string& value) {
+
+	double xyz[3];
+	std::size_t start = 0;
+	for (int a = 0; a < 3; ++a) {
+
+		const auto end = a < 2 ? value.find(',', start) : value.size();
+		if (end == std::string::npos) {
+
+			throw std::invalid_argument("invalid value '" + value + "' for " + name + ", expected x,y,z");
+		}
+		xyz[a] = parse_real(name, value.substr(start, end - start), -std::numeric_limits<double>::max());
+		start = end + 1;
+	}
+
+	return point3(static_cast<real>(xyz[0]), static_cast<real>(xyz[1]), static_cast<real>(xyz[2]));
+}
+
+// host:port, e.g. render-07:7000.
+static void parse_address(const std::string& name, const std::string& value, std::string& host, int& port) {
+
+	const auto colon = value.rfind(':');
+	if (colon == std::string::npos || colon == 0) {
+
+		throw std::invalid_argument("expected host:port for " + name);
+	}
+	host = value.substr(0, colon);
+	port = static_cast<int>(parse_integer(name, value.substr(colon + 1), 1));
+}
+
+// Four comma-separated pixel coordinates x0,y0,x1,y1, the last two exclusive.
+static tile parse_region(const std::string& name, const std::string& value) {
+
+	int xy[4];
+	std::size_t start = 0;
+	for (int a = 0; a < 4; ++a) {
+
+		const auto end = a < 3 ? value.find(',', start) : value.size();
+		if (end == std::string::npos) {
+
+			throw std::invalid_argument("invalid value '" + value + "' for " + name + ", expected x0,y0,x1,y1");
+		}
+		xy[a] = static_cast<int>(parse_integer(name, value.substr(start, end - start), 0));
+		start = end + 1;
+	}
+	if (xy[2] <= xy[0] || xy[3] <= xy[1]) {
+
+		throw std::invalid_argument("empty region '" + value + "' for " + name);
+	}
+
+	return { xy[0], xy[1], xy[2], xy[3] };
+}
+
+bool camera_overrides::any() const {
+
+	return set_lookfrom || set_lookat || vfov > 0 || aperture >= 0 || focus_distance >= 0;
+}
+
+void camera_overrides::apply(camera_settings& view) const {
+
+	if (set_lookfrom) view.lookfrom = lookfrom;
+	if (set_lookat) view.lookat = lookat;
+	if (vfov > 0) view.vfov = vfov;
+	if (aperture >= 0) view.aperture = aperture;
+	if (focus_distance >= 0) view.focus_distance = focus_distance;
+}
+
+options parse_options(int argc, char* argv[]) {
+
+	options opts;
+	for (int i = 1; i < argc; ++i) {
+
+		const std::string arg = argv[i];
+		if (arg == "-h" || arg == "--help") {
+
+			opts.show_help = true;
+		}
+		else if (arg == "-o" || arg == "--output") {
+
+			opts.output_path = option_value(argc, argv, i);
+			image_format_from_path(opts.output_path);
+		}
+		else if (arg == "--scene") {
+
+			opts.scene = option_value(argc, argv, i);
+			const auto names = scene_names();
+			const bool is_file = opts.scene.find('.') != std::string::npos;
+			if (!is_file && std::find(names.begin(), names.end(), opts.scene) == names.end()) {
+
+				throw std::invalid_argument("unknown scene " + opts.scene);
+			}
+		}
+		else if (arg == "--export-scene") {
+
+			opts.export_path = option_value(argc, argv, i);
+		}
+		else if (arg == "--heatmap") {
+
+			opts.heatmap_path = option_value(argc, argv, i);
+			image_format_from_path(opts.heatmap_path);
+		}
+		else if (arg == "--width") {
+
+			opts.image_width = static_cast<int>(parse_integer(arg, option_value(argc, argv, i), 1));
+		}
+		else if (arg == "--height") {
+
+			opts.image_height = static_cast<int>(parse_integer(arg, option_value(argc, argv, i), 1));
+		}
+		else if (arg == "--stream") {
+
+			opts.stream = true;
+		}
+		else if (arg == "--stream-bands") {
+
+			opts.stream_bands = static_cast<int>(parse_integer(arg, option_value(argc, argv, i), 1));
+		}
+		else if (arg == "--aov") {
+
+			opts.aov_path = option_value(argc, argv, i);
+			image_format_from_path(opts.aov_path);
+		}
+		else if (arg == "--denoise") {
+
+			opts.denoising.type = denoiser_type_from_name(option_value(argc, argv, i));
+		}
+		else if (arg == "--denoise-iterations") {
+
+			opts.denoising.iterations = static_cast<int>(parse_integer(arg, option_value(argc, argv, i), 1));
+		}
+		else if (arg == "-s" || arg == "--spp") {
+
+			opts.settings.samples_per_pixel = static_cast<int>(parse_integer(arg, option_value(argc, argv, i), 1));
+		}
+		else if (arg == "--adaptive") {
+
+			opts.settings.adaptive_threshold = parse_real(arg, option_value(argc, argv, i), 0);
+		}
+		else if (arg == "--min-spp") {
+
+			opts.settings.min_samples = static_cast<int>(parse_integer(arg, option_value(argc, argv, i), 1));
+		}
+		else if (arg == "--progressive") {
+
+			opts.progressive = true;
+		}
+		else if (arg == "--pass-spp") {
+
+			opts.progressive = true;
+			opts.progression.pass_samples = static_cast<int>(parse_integer(arg, option_value(argc, argv, i), 1));
+		}
+		else if (arg == "--time-budget") {
+
+			opts.progressive = true;
+			opts.progression.time_budget = parse_real(arg, option_value(argc, argv, i), 0);
+		}
+		else if (arg == "--snapshot-every") {
+
+			opts.progressive = true;
+			opts.progression.snapshot_interval = parse_real(arg, option_value(argc, argv, i), 0);
+		}
+		else if (arg == "--checkpoint") {
+
+			opts.progressive = true;
+			opts.checkpoint_path = option_value(argc, argv, i);
+		}
+		else if (arg == "--resume") {
+
+			opts.progressive = true;
+			opts.resume_path = option_value(argc, argv, i);
+		}
+		else if (arg == "-t" || arg == "--threads") {
+
+			opts.settings.thread_count = static_cast<unsigned>(parse_integer(arg, option_value(argc, argv, i), 0));
+		}
+		else if (arg == "--engine") {
+
+			opts.settings.engine = render_engine_from_name(option_value(argc, argv, i));
+		}
+		else if (arg == "--lookfrom") {
+
+			opts.view.lookfrom = parse_point(arg, option_value(argc, argv, i));
+			opts.view.set_lookfrom = true;
+		}
+		else if (arg == "--lookat") {
+
+			opts.view.lookat = parse_point(arg, option_value(argc, argv, i));
+			opts.view.set_lookat = true;
+		}
+		else if (arg == "--vfov") {
+
+			opts.view.vfov = static_cast<real>(parse_real(arg, option_value(argc, argv, i), 0));
+			if (!(opts.view.vfov > 0 && opts.view.vfov < 180)) {
+
+				throw std::invalid_argument("--vfov takes degrees between 0 and 180");
+			}
+		}
+		else if (arg == "--aperture") {
+
+			opts.view.aperture = static_cast<real>(parse_real(arg, option_value(argc, argv, i), 0));
+		}
+		else if (arg == "--focus-distance") {
+
+			opts.view.focus_distance = static_cast<real>(parse_real(arg, option_value(argc, argv, i), 0));
+		}
+		else if (arg == "--kernel") {
+
+			opts.settings.kernel = render_kernel_from_name(option_value(argc, argv, i));
+		}
+		else if (arg == "--device") {
+
+			opts.device = render_device_from_name(option_value(argc, argv, i));
+		}
+		else if (arg == "--verify-device") {
+
+			opts.verify_rmse = parse_real(arg, option_value(argc, argv, i), 0);
+		}
+		else if (arg == "--coordinator") {
+
+			opts.coordinator = true;
+			opts.distribution.port = static_cast<int>(parse_integer(arg, option_value(argc, argv, i), 0));
+		}
+		else if (arg == "--worker") {
+
+			parse_address(arg, option_value(argc, argv, i), opts.worker_host, opts.worker_port);
+		}
+		else if (arg == "--serve") {
+
+			opts.serve = true;
+			opts.service.port = static_cast<int>(parse_integer(arg, option_value(argc, argv, i), 0));
+		}
+		else if (arg == "--scene-cache") {
+
+			opts.service.cache_scenes = static_cast<std::size_t>(parse_integer(arg, option_value(argc, argv, i), 1));
+		}
+		else if (arg == "--idle-timeout") {
+
+			opts.service.idle_timeout = parse_real(arg, option_value(argc, argv, i), 0);
+		}
+		else if (arg == "--max-scene-mb") {
+
+			opts.service.max_scene_bytes = static_cast<std::uint64_t>(parse_integer(arg, option_value(argc, argv, i), 1)) << 20;
+		}
+		else if (arg == "--max-clients") {
+
+			opts.service.max_clients = static_cast<std::size_t>(parse_integer(arg, option_value(argc, argv, i), 1));
+		}
+		else if (arg == "--submit") {
+
+			parse_address(arg, option_value(argc, argv, i), opts.submit_host, opts.submit_port);
+		}
+		else if (arg == "--region") {
+
+			opts.region = parse_region(arg, option_value(argc, argv, i));
+		}
+		else if (arg == "--task-spp") {
+
+			opts.distribution.task_samples = static_cast<int>(parse_integer(arg, option_value(argc, argv, i), 0));
+		}
+		else if (arg == "--task-tile") {
+
+			opts.distribution.task_tile_size = static_cast<int>(parse_integer(arg, option_value(argc, argv, i), 1));
+		}
+		else if (arg == "--task-timeout") {
+
+			opts.distribution.task_timeout = parse_real(arg, option_value(argc, argv, i), 0);
+		}
+		else if (arg == "--task-attempts") {
+
+			opts.distribution.max_attempts = static_cast<int>(parse_integer(arg, option_value(argc, argv, i), 1));
+		}
+		else if (arg == "--local-workers") {
+
+			opts.distribution.local_workers = static_cast<int>(parse_integer(arg, option_value(argc, argv, i), 0));
+		}
+		else if (arg == "--wave-tile") {
+
+			opts.settings.wave_tile_size = static_cast<int>(parse_integer(arg, option_value(argc, argv, i), 1));
+		}
+		else if (arg == "--tile-size") {
+
+			opts.settings.tile_size = static_cast<int>(parse_integer(arg, option_value(argc, argv, i), 1));
+		}
+		else if (arg == "--frames") {
+
+			opts.animation.frames = static_cast<int>(parse_integer(arg, option_value(argc, argv, i), 1));
+		}
+		else if (arg == "--turntable") {
+
+			opts.animation.turntable_degrees = static_cast<real>(parse_real(arg, option_value(argc, argv, i), -360));
+		}
+		else if (arg == "--rebuild-threshold") {
+
+			opts.animation.rebuild_threshold = parse_real(arg, option_value(argc, argv, i), 1);
+		}
+		else if (arg == "--seed") {
+
+			opts.settings.seed = static_cast<std::uint64_t>(parse_integer(arg, option_value(argc, argv, i), 0));
+		}
+		else if (arg == "--integrator") {
+
+			opts.settings.integrator = integrator_type_from_name(option_value(argc, argv, i));
+		}
+		else if (arg == "--sampler") {
+
+			opts.settings.sampler = sampler_type_from_name(option_value(argc, argv, i));
+		}
+		else if (arg == "--rr-depth") {
+
+			opts.settings.rr_min_depth = static_cast<int>(parse_integer(arg, option_value(argc, argv, i), 0));
+		}
+		else if (arg == "--no-bvh") {
+
+			opts.use_bvh = false;
+		}
+		else if (arg == "--bvh-leaf-size") {
+
+			opts.bvh_leaf_size = static_cast<int>(parse_integer(arg, option_value(argc, argv, i), 1));
+		}
+		else if (arg == "--bvh-stats") {
+
+			opts.bvh_stats = true;
+		}
+		else if (arg == "--profile") {
+
+			opts.profile_path = option_value(argc, argv, i);
+			if (!profiling_compiled_in()) {
+
+				throw std::invalid_argument("--profile needs a build with RT_PROFILE defined");
+			}
+		}
+		else {
+
+			throw std::invalid_argument("unknown option " + arg);
+		}
+	}
+
+	if (opts.progressive && opts.settings.engine == render_engine::wavefront) {
+
+		throw std::invalid_argument("progressive rendering only runs on the tiled engine");
+	}
+	if (opts.settings.sampler != sampler_type::independent && (opts.settings.engine == render_engine::wavefront
+		|| opts.device != render_device::cpu)) {
+
+		throw std::invalid_argument("samplers other than independent only run on the tiled engine and the cpu device");
+	}
+	if (opts.settings.kernel == render_kernel::specialized && (opts.settings.engine == render_engine::wavefront
+		|| opts.device != render_device::cpu)) {
+
+		throw std::invalid_argument("the specialized kernels only run on the tiled engine and the cpu device");
+	}
+	if (opts.settings.integrator == integrator_type::nee && (opts.settings.engine == render_engine::wavefront
+		|| opts.device != render_device::cpu)) {
+
+		throw std::invalid_argument("next-event estimation only runs on the tiled engine and the cpu device");
+	}
+	if (opts.device != render_device::cpu && (opts.progressive || opts.settings.adaptive_threshold > 0 || !opts.use_bvh)) {
+
+		throw std::invalid_argument("progressive, adaptive and --no-bvh rendering only run on the cpu device");
+	}
+
+	if (opts.distribution.port > 65535 || opts.worker_port > 65535 || opts.service.port > 65535 || opts.submit_port > 65535) {
+
+		throw std::invalid_argument("ports run up to 65535");
+	}
+	if (opts.coordinator && !opts.worker_host.empty()) {
+
+		throw std::invalid_argument("--coordinator and --worker exclude each other");
+	}
+	if (opts.coordinator && (opts.progressive || opts.settings.adaptive_threshold > 0 || opts.device != render_device::cpu
+		|| !opts.heatmap_path.empty())) {
+
+		throw std::invalid_argument("distributed rendering does not combine with progressive, adaptive or device rendering or heatmaps");
+	}
+	if (opts.animation.frames > 1 && (opts.output_path.empty() || !opts.heatmap_path.empty() || !opts.export_path.empty()
+		|| opts.progressive || opts.coordinator || !opts.worker_host.empty() || opts.device != render_device::cpu
+		|| !opts.use_bvh || is_binary_scene_path(opts.scene))) {
+
+		throw std::invalid_argument("frame sequences need an output path and render a text or built-in scene "
+			"through a BVH on the cpu, without progressive, distributed, heatmap or export modes");
+	}
+	if (opts.stream && (opts.progressive || opts.coordinator || opts.device != render_device::cpu || opts.animation.frames > 1
+		|| opts.settings.engine != render_engine::tiled || !opts.heatmap_path.empty() || !opts.aov_path.empty()
+		|| opts.denoising.type != denoiser_type::none)) {
+
+		throw std::invalid_argument("streaming output renders a single frame on the tiled engine and the cpu, "
+			"without progressive, distributed, heatmap, AOV or denoising modes, which need the whole frame");
+	}
+	if (opts.serve && (opts.coordinator || !opts.worker_host.empty() || !opts.submit_host.empty())) {
+
+		throw std::invalid_argument("--serve, --submit, --coordinator and --worker exclude each other");
+	}
+	if (!opts.submit_host.empty() && (opts.coordinator || !opts.worker_host.empty() || opts.progressive
+		|| opts.settings.adaptive_threshold > 0 || opts.device != render_device::cpu || opts.animation.frames > 1
+		|| opts.stream || opts.settings.engine != render_engine::tiled || !opts.heatmap_path.empty()
+		|| !opts.aov_path.empty() || opts.denoising.type != denoiser_type::none || !opts.export_path.empty())) {
+
+		throw std::invalid_argument("the render service renders a single frame with a fixed sample count on the tiled engine, "
+			"without progressive, adaptive, distributed, device, stream, heatmap, AOV, denoising or export modes");
+	}
+	if (opts.region.x1 > 0 && opts.submit_host.empty()) {
+
+		throw std::invalid_argument("--region only applies to --submit");
+	}
+	opts.distribution.local_threads = opts.settings.thread_count;
+	opts.service.thread_count = opts.settings.thread_count;
+	opts.denoising.thread_count = opts.settings.thread_count;
+
+	return opts;
+}
+
+// Splits path before the extension of its file name, or at its end if it has none.
+static std::size_t stem_end(const std::string& path) {
+
+	const auto slash = path.find_last_of("/\\");
+	const auto dot = path.find_last_of('.');
+	return dot != std::string::npos && (slash == std::string::npos || dot > slash) ? dot : path.size();
+}
+
+std::string aov_file_path(const std::string& path, const std::string& aov) {
+
+	const auto end = stem_end(path);
+	return path.substr(0, end) + '_' + aov + path.substr(end);
+}
+
+std::string frame_path(const std::string& path, int frame) {
+
+	std::string number = std::to_string(frame);
+	const auto last = path.find_last_of('#');
+	if (last != std::string::npos) {
+
+		auto first = last;
+		while (first > 0 && path[first - 1] == '#') {
+
+			--first;
+		}
+		const std::size_t width = last - first + 1;
+		if (number.size() < width) {
+
+			number.insert(0, width - number.size(), '0');
+		}
+		return path.substr(0, first) + number + path.substr(last + 1);
+	}
+
+	if (number.size() < 4) {
+
+		number.insert(0, 4 - number.size(), '0');
+	}
+	const auto end = stem_end(path);
+	return path.substr(0, end) + '_' + number + path.substr(end);
+}
+
+std::string usage(const char* program) {
+
+	std::ostringstream out;
+	out << "Usage: " << program << " [options] [> image.ppm]\n"
+		<< "  -o, --output <path>       image file, .ppm, .png, .pfm or .exr (default: binary PPM to stdout)\n"
+		<< "      --scene <name|path>   basic (default), random-spheres, stress, instances, lit, a .json or a .rtscene file\n"
+		<< "      --export-scene <path> write the scene with its BVH as a .rtscene file and exit\n"
+		<< "      --heatmap <path>      also write the samples taken per pixel as an image\n"
+		<< "      --width <n>           image width (default 400)\n"
+		<< "      --height <n>          image height (default: 16:9 of the width)\n"
+		<< "      --stream              write bands of finished tiles as they complete, memory scales with the width only\n"
+		<< "      --stream-bands <n>    rows of tiles the stream may hold out of order (default: twice the threads in tiles)\n"
+		<< "      --aov <path>          also write the albedo, normal and depth AOVs, as path_albedo.pfm and so on\n"
+		<< "      --denoise <name>      none (default), atrous (built in, edge-avoiding) or oidn (Open Image Denoise)\n"
+		<< "      --denoise-iterations <n>  a-trous passes, each doubling the filter's footprint (default 5)\n"
+		<< "  -s, --spp <n>             samples per pixel, the maximum in adaptive mode (default 100)\n"
+		<< "      --adaptive <e>        stop a pixel once its relative standard error is below e, 0 = off (default 0)\n"
+		<< "      --min-spp <n>         samples before and between adaptive convergence checks (default 16)\n"
+		<< "      --progressive         render in passes, Ctrl+C stops after the current tiles and keeps the image\n"
+		<< "      --pass-spp <n>        samples per pixel and pass (default 1)\n"
+		<< "      --time-budget <s>     stop passes after s seconds, 0 = no limit (default 0)\n"
+		<< "      --snapshot-every <s>  write the image and checkpoint every s seconds (default 0 = off)\n"
+		<< "      --checkpoint <path>   save the accumulated samples there to resume later\n"
+		<< "      --resume <path>       continue from a saved checkpoint\n"
+		<< "  -t, --threads <n>         render threads, 0 = one per hardware thread (default 0)\n"
+		<< "      --engine <name>       tiled (default) or wavefront, which traces a tile's paths in batched stages\n"
+		<< "      --lookfrom <x,y,z>    camera position, replacing the scene's\n"
+		<< "      --lookat <x,y,z>      point the camera looks at\n"
+		<< "      --vfov <degrees>      vertical field of view\n"
+		<< "      --aperture <d>        thin lens diameter for depth of field, 0 = pinhole (cpu device only)\n"
+		<< "      --focus-distance <d>  distance to the plane in focus, 0 = the projection plane\n"
+		<< "      --kernel <name>       generic (default) or specialized, compiled for the depth, sampler and scene type\n"
+		<< "      --device <name>       cpu (default), cuda (falls back to cpu without a device) or host-kernel\n"
+		<< "      --verify-device <e>   also render on the cpu and fail if the device image's RMSE exceeds e\n"
+		<< "      --coordinator <port>  hand tasks to workers connecting on port, 0 = any free port\n"
+		<< "      --worker <host:port>  render tasks for the coordinator there until it is done\n"
+		<< "      --serve <port>        run the render service there, keeping scenes loaded, until Ctrl+C\n"
+		<< "      --scene-cache <n>     scenes the service keeps loaded (default 8)\n"
+		<< "      --idle-timeout <s>    the service drops clients silent for s seconds, 0 = never (default 300)\n"
+		<< "      --max-scene-mb <n>    largest scene file in MiB the service accepts from a client (default 512)\n"
+		<< "      --max-clients <n>     clients the service serves at once, it turns away further ones (default 64)\n"
+		<< "      --submit <host:port>  render the frame on the render service there\n"
+		<< "      --region <x0,y0,x1,y1>  with --submit, render only these pixels of the frame, the image has their size\n"
+		<< "      --task-spp <n>        samples per pixel of a task, 0 = all (default 0)\n"
+		<< "      --task-tile <n>       task tile edge length in pixels (default 64)\n"
+		<< "      --task-timeout <s>    drop a worker and retry its task after s seconds (default 60)\n"
+		<< "      --task-attempts <n>   runs of a task before the render fails (default 3)\n"
+		<< "      --local-workers <n>   workers the coordinator starts itself, over loopback (default 0)\n"
+		<< "      --frames <n>          render a sequence of n frames, moving the scene and refitting its BVH in between\n"
+		<< "      --turntable <deg>     sequences: turn the scene about the vertical through the look-at point per frame\n"
+		<< "      --rebuild-threshold <r>  sequences: rebuild the BVH once refits raised its SAH cost r times (default 1.5)\n"
+		<< "      --tile-size <n>       tile edge length in pixels (default 16)\n"
+		<< "      --wave-tile <n>       wavefront tile edge length in pixels (default 64)\n"
+		<< "      --seed <n>            frame seed (default 0)\n"
+		<< "      --integrator <name>   path (iterative, default), recursive or nee (path with light sampling and MIS)\n"
+		<< "      --sampler <name>      independent (default), stratified, sobol or blue-noise\n"
+		<< "      --rr-depth <n>        bounces before Russian roulette may end a path (default 3)\n"
+		<< "      --no-bvh              test every primitive, type by type, instead of using a BVH\n"
+		<< "      --bvh-leaf-size <n>   maximum primitives per BVH leaf (default 4)\n"
+		<< "      --bvh-stats           print BVH build and traversal statistics\n"
+		<< "      --profile <path>      print hot-path counters and write a Chrome trace there (RT_PROFILE builds)\n"
+		<< "  -h, --help                show this message\n";
+
+	return out.str();
+}
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include "primitive_store.hpp"
+
+#include <typeinfo>
+
+#include "profiler.hpp"
+#include "sphere.hpp"
+
+primitive_store::primitive_store(const hittable_list& list) {
+
+	reserve(list.objects.size());
+	for (const auto& object : list.objects) {
+
+		add(object);
+	}
+}
+
+void primitive_store::reserve(std::size_t count) {
+
+	refs.reserve(count);
+	sphere_array.reserve(count);
+}
+
+void primitive_store::clear() {
+
+	refs.clear();
+	sphere_array.clear();
+	custom_array.clear();
+}
+
+void primitive_store::add(const point3& center, real radius, std::uint32_t material) {
+
+	refs.push_back({ primitive_type::sphere, static_cast<std::uint32_t>(sphere_array.size()) });
+	sphere_array.add(center, radius, material);
+}
+
+void primitive_store::add(shared_ptr<hittable> object) {
+
+	// Only exact spheres are unpacked, a subclass may override hit().
+	if (object && typeid(*object) == typeid(sphere)) {
+
+		const auto& s = static_cast<const sphere&>(*object);
+		add(s.center, s.radius, s.material);
+		return;
+	}
+
+	refs.push_back({ primitive_type::custom, static_cast<std::uint32_t>(custom_array.size()) });
+	custom_array.push_back(object);
+}
+
+std::size_t primitive_store::size() const {
+
+	return refs.size();
+}
+
+primitive_ref primitive_store::ref(std::size_t index) const {
+
+	return refs[index];
+}
+
+const sphere_soa& primitive_store::spheres() const {
+
+	return sphere_array;
+}
+
+const std::vector<shared_ptr<hittable>>& primitive_store::custom() const {
+
+	return custom_array;
+}
+
+bool primitive_store::hit_primitive(primitive_ref p, const ray& r, real t_min, real t_max, hit_record& rec) const {
+
+	switch (p.type) {
+	case primitive_type::sphere: return sphere_array.hit_range(r, p.index, 1, t_min, t_max, rec);
+	case primitive_type::custom: return custom_array[p.index]->hit(r, t_min, t_max, rec);
+	}
+
+	return false;
+}
+
+bool primitive_store::hit(const ray& r, real t_min, real t_max, hit_record& rec) const {
+
+	if (!intersect(r, t_min, t_max, rec)) {
+
+		return false;
+	}
+
+	rec.object->finish_hit(r, rec);
+	return true;
+}
+
+bool primitive_store::intersect(const ray& r, real t_min, real t_max, hit_record& rec) const {
+
+	bool hit_anything = sphere_array.size() > 0 && sphere_array.intersect(r, t_min, t_max, rec);
+	auto closest_so_far = hit_anything ? rec.t : t_max;
+
+	RT_PROFILE_ADD(custom_tests, custom_array.size());
+	for (const auto& object : custom_array) {
+
+		if (object->intersect(r, t_min, closest_so_far, rec)) {
+
+			hit_anything = true;
+			closest_so_far = rec.t;
+		}
+	}
+
+	return hit_anything;
+}
+
+bool primitive_store::occluded(const ray& r, real t_min, real t_max) const {
+
+	if (sphere_array.size() > 0 && sphere_array.occluded(r, t_min, t_max)) {
+
+		return true;
+	}
+
+	RT_PROFILE_ADD(custom_tests, custom_array.size());
+	for (const auto& object : custom_array) {
+
+		if (object->occluded(r, t_min, t_max)) {
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool primitive_store::bounding_box(aabb& output_box) const {
+
+	if (refs.empty()) {
+
+		return false;
+	}
+
+	output_box = aabb();
+	aabb temp_box;
+	if (sphere_array.size() > 0) {
+
+		sphere_array.bounding_box(temp_box);
+		output_box.expand(temp_box);
+	}
+	for (const auto& object : custom_array) {
+
+		if (!object->bounding_box(temp_box)) {
+
+			return false;
+		}
+		output_box.expand(temp_box);
+	}
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,285 @@
+#include "profiler.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+const char* profile_stage_name(profile_stage stage) {
+
+	switch (stage) {
+	case profile_stage::frame: return "frame";
+	case profile_stage::pass: return "pass";
+	case profile_stage::tile: return "tile";
+	case profile_stage::camera: return "camera";
+	case profile_stage::intersect: return "intersect";
+	case profile_stage::shade: return "shade";
+	case profile_stage::compact: return "compact";
+	default: return "unknown";
+	}
+}
+
+void profile_counters::merge(const profile_counters& other) {
+
+	rays += other.rays;
+	paths += other.paths;
+	shadow_rays += other.shadow_rays;
+	bvh_nodes += other.bvh_nodes;
+	sphere_tests += other.sphere_tests;
+	packed_sphere_tests += other.packed_sphere_tests;
+	custom_tests += other.custom_tests;
+	for (int i = 0; i <= profile_max_path_length; ++i) {
+
+		path_length[i] += other.path_length[i];
+	}
+	for (int i = 0; i < static_cast<int>(profile_stage::count); ++i) {
+
+		stage_ns[i] += other.stage_ns[i];
+		stage_calls[i] += other.stage_calls[i];
+	}
+}
+
+bool profiling_compiled_in() {
+
+#ifdef RT_PROFILE
+	return true;
+#else
+	return false;
+#endif
+}
+
+namespace {
+
+	struct profile_event {
+		profile_stage stage;
+		std::uint64_t start;
+		std::uint64_t duration;
+	};
+
+	// Spans a thread keeps per frame before it drops further ones, about 24 MB.
+	const std::size_t max_thread_events = std::size_t(1) << 20;
+
+	struct profile_thread {
+		profile_counters counters;
+		std::vector<profile_event> events;
+		std::uint64_t dropped_events = 0;
+	};
+
+	// Blocks of every thread that ever counted, kept when the thread exits so that its counts still add up.
+	struct profile_registry {
+		std::mutex mutex;
+		std::vector<std::unique_ptr<profile_thread>> threads;
+	};
+
+	profile_registry& registry() {
+
+		static profile_registry instance;
+		return instance;
+	}
+
+	profile_thread& local_thread() {
+
+		thread_local profile_thread* block = nullptr;
+		if (!block) {
+
+			auto& all = registry();
+			std::lock_guard<std::mutex> lock(all.mutex);
+			all.threads.push_back(std::make_unique<profile_thread>());
+			block = all.threads.back().get();
+		}
+		return *block;
+	}
+
+	const std::chrono::steady_clock::time_point& clock_epoch() {
+
+		static const auto epoch = std::chrono::steady_clock::now();
+		return epoch;
+	}
+}
+
+profile_counters& profile_thread_counters() {
+
+	return local_thread().counters;
+}
+
+std::uint64_t profile_clock() {
+
+	const auto since = std::chrono::steady_clock::now() - clock_epoch();
+	return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(since).count());
+}
+
+void profile_paths(std::uint64_t length, std::uint64_t count) {
+
+	auto& counters = local_thread().counters;
+	counters.rays += length * count;
+	counters.paths += count;
+	counters.path_length[length < profile_max_path_length ? length : profile_max_path_length] += count;
+}
+
+void profile_record(profile_stage stage, std::uint64_t start, bool span) {
+
+	const std::uint64_t end = profile_clock();
+	auto& thread = local_thread();
+	thread.counters.stage_ns[static_cast<int>(stage)] += end - start;
+	++thread.counters.stage_calls[static_cast<int>(stage)];
+
+	if (!span) {
+
+		return;
+	}
+	if (thread.events.size() < max_thread_events) {
+
+		thread.events.push_back({ stage, start, end - start });
+	}
+	else {
+
+		++thread.dropped_events;
+	}
+}
+
+void profile_reset() {
+
+	auto& all = registry();
+	std::lock_guard<std::mutex> lock(all.mutex);
+	for (auto& thread : all.threads) {
+
+		thread->counters = profile_counters();
+		thread->events.clear();
+		thread->dropped_events = 0;
+	}
+}
+
+profile_counters profile_totals() {
+
+	auto& all = registry();
+	std::lock_guard<std::mutex> lock(all.mutex);
+	profile_counters totals;
+	for (const auto& thread : all.threads) {
+
+		totals.merge(thread->counters);
+	}
+	return totals;
+}
+
+void write_profile_summary(std::ostream& out, const profile_counters& totals) {
+
+	auto per = [](std::uint64_t count, std::uint64_t base) {
+
+		return base > 0 ? static_cast<double>(count) / static_cast<double>(base) : 0.0;
+	};
+	const std::uint64_t traversals = totals.rays + totals.shadow_rays;
+
+	out << "Profile: " << totals.paths << " paths, " << totals.rays << " rays (" << per(totals.rays, totals.paths)
+		<< " per path), " << totals.shadow_rays << " shadow rays, " << per(totals.bvh_nodes, traversals) << " BVH nodes per ray\n"
+		<< "Primitive tests per ray: sphere " << per(totals.sphere_tests, traversals)
+		<< ", packed sphere " << per(totals.packed_sphere_tests, traversals)
+		<< ", custom " << per(totals.custom_tests, traversals) << '\n';
+
+	out << "Path length:";
+	for (int i = 0; i <= profile_max_path_length; ++i) {
+
+		if (totals.path_length[i] == 0) {
+
+			continue;
+		}
+		out << ' ' << i << (i == profile_max_path_length ? "+" : "") << ' '
+			<< std::fixed << std::setprecision(1) << 100.0 * per(totals.path_length[i], totals.paths) << '%';
+	}
+	out << std::defaultfloat << std::setprecision(6) << '\n';
+
+	out << "Thread time per stage:";
+	for (int i = 0; i < static_cast<int>(profile_stage::count); ++i) {
+
+		if (totals.stage_calls[i] == 0) {
+
+			continue;
+		}
+		out << "\n  " << std::left << std::setw(10) << profile_stage_name(static_cast<profile_stage>(i)) << std::right
+			<< ' ' << static_cast<double>(totals.stage_ns[i]) * 1e-9 << " s, " << totals.stage_calls[i] << " calls, "
+			<< per(totals.stage_ns[i], totals.stage_calls[i]) << " ns each";
+	}
+	out << '\n';
+}
+
+void write_chrome_trace(const std::string& path) {
+
+	std::ofstream file(path);
+	if (!file) {
+
+		throw std::runtime_error("cannot write " + path);
+	}
+
+	auto& all = registry();
+	std::lock_guard<std::mutex> lock(all.mutex);
+
+	// Timestamps are microseconds; three decimals keep the nanoseconds.
+	file << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	std::uint64_t dropped = 0;
+	for (std::size_t t = 0; t < all.threads.size(); ++t) {
+
+		const auto& thread = *all.threads[t];
+		dropped += thread.dropped_events;
+		if (thread.events.empty()) {
+
+			continue;
+		}
+
+		file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t
+			<< ",\"args\":{\"name\":\"thread " << t << "\"}}";
+		first = false;
+		for (const auto& event : thread.events) {
+
+			file << ",\n{\"name\":\"" << profile_stage_name(event.stage) << "\",\"cat\":\"render\",\"ph\":\"X\",\"pid\":1,\"tid\":" << t
+				<< ",\"ts\":" << static_cast<double>(event.start) * 1e-3 << ",\"dur\":" << static_cast<double>(event.duration) * 1e-3 << '}';
+		}
+	}
+	file << "\n],\"otherData\":{\"dropped_events\":" << dropped << "}}\n";
+
+	if (!file) {
+
+		throw std::runtime_error("cannot write " + path);
+	}
+}
+
+progress_reporter::progress_reporter(bool enabled, double interval) :
+	enabled{ enabled },
+	interval_ns{ static_cast<std::int64_t>(interval * 1e9) }
+{}
+
+void progress_reporter::update(const char* label, std::uint64_t value, std::uint64_t total, bool final) {
+
+	if (!enabled) {
+
+		return;
+	}
+
+	const auto now = static_cast<std::int64_t>(profile_clock());
+	if (!final && now < next_ns.load(std::memory_order_relaxed)) {
+
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(output, std::defer_lock);
+	if (final) {
+
+		lock.lock();
+	}
+	else if (!lock.try_lock()) {
+
+		return;
+	}
+	// Nothing is written after the final update, so a late thread cannot overwrite it with an older value.
+	next_ns.store(final ? INT64_MAX : now + interval_ns, std::memory_order_relaxed);
+
+	std::cerr << '\r' << label << ": " << value;
+	if (total > 0) {
+
+		std::cerr << '/' << total;
+	}
+	std::cerr << ' ' << std::flush;
+}
\ No newline at end of file
@@ -1,13 +1,51 @@
 #include "random_generator.hpp"
 
-double random_double() {
+xoshiro256pp::xoshiro256pp(std::uint64_t seed, std::uint64_t stream) {
 
-	// Returns a random real in [0,1).
-	return rand() / (RAND_MAX + 1.0);
+	// Hash the stream into the seed first, so that neighbouring (seed, stream) pairs land far apart.
+	std::uint64_t mix = stream;
+	std::uint64_t sm = seed ^ splitmix64(mix);
+	for (auto& word : s) {
+
+		word = splitmix64(sm);
+	}
+}
+
+void xoshiro256pp::fill(double* out, std::size_t count) {
+
+	for (std::size_t i = 0; i < count; ++i) {
+
+		out[i] = next_double();
+	}
+}
+
+pcg32::pcg32(std::uint64_t seed, std::uint64_t stream) {
+
+	// Every stream gets its own, necessarily odd, increment.
+	state = 0;
+	increment = (stream << 1) | 1u;
+	(*this)();
+	state += seed;
+	(*this)();
 }
 
-double random_double(double min, double max) {
+void pcg32::fill(double* out, std::size_t count) {
+
+	for (std::size_t i = 0; i < count; ++i) {
+
+		out[i] = next_double();
+	}
+}
+
+void random_fill(random_engine& rng, double* out, std::size_t count, double min, double max) {
+
+	rng.fill(out, count);
+	if (min != 0.0 || max != 1.0) {
+
+		const double range = max - min;
+		for (std::size_t i = 0; i < count; ++i) {
 
-	// Returns a random real in [min,max).
-	return min + (max - min) * random_double();
+			out[i] = min + range * out[i];
+		}
+	}
 }
\ No newline at end of file
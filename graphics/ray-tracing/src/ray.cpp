@@ -1,16 +0,0 @@
-#include "ray.hpp"
-
-point3 ray::origin() const {
-
-	return orig;
-}
-
-vec3 ray::direction() const {
-
-	return dir;
-}
-
-point3 ray::at(double t) const {
-
-	return orig + t * dir;
-}
\ No newline at end of file
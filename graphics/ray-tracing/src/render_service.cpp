@@ -0,0 +1,504 @@
+#include "render_service.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "lights.hpp"
+#include "scene_file.hpp"
+#include "sha256.hpp"
+
+namespace {
+
+	const std::uint32_t protocol_version = 2;
+
+	enum message_type : std::uint32_t {
+		job_message = 1,          // client: protocol version and the job
+		need_scene_message = 2,   // service: the job's scene is not cached, send it
+		scene_message = 3,        // client: the scene file
+		band_message = 4,         // service: rows of the region and the means of their pixels
+		done_message = 5,         // service: the job's totals
+		failure_message = 6       // service: why the job failed
+	};
+
+	// Seconds between checks of the stop flag while waiting for connections or jobs.
+	const double poll_interval = 0.25;
+
+	// Upper bounds a job has to stay within, so a malformed one cannot ask for absurd amounts of memory or time.
+	const std::uint32_t max_resolution = 1 << 16;
+	const std::uint32_t max_samples = 1 << 20;
+	const std::uint32_t max_depth = 1 << 12;
+
+	// Payload of a job message: version, scene digest, 13 camera values, 8 settings, the seed, the region and band rows.
+	const std::uint64_t job_size = 4 + 32 + 13 * 8 + 8 * 4 + 8 + 5 * 4;
+
+	using clock = std::chrono::steady_clock;
+
+	// A scene ready to render: mapped with its BVH, and the material table and lights built from it once.
+	struct cached_scene {
+		cached_scene(std::vector<std::uint8_t> bytes, const std::string& name) :
+			world{ std::move(bytes), name },
+			materials{ world.copy_materials() },
+			lights{ world.bvh().spheres(), materials }
+		{}
+
+		mapped_scene world;
+		material_table materials;
+		light_list lights;
+	};
+
+	/*
+		Scenes by the SHA-256 digest of their file, most recently used first. A client cannot make up a scene
+		with another scene's digest, so it only ever gets its own scene back. Jobs hold on to their scene,
+		so evicting one that is still rendering only drops it from the cache.
+	*/
+	class scene_cache {
+	public:
+		explicit scene_cache(std::size_t capacity) : capacity{ std::max<std::size_t>(capacity, 1) } {}
+
+		std::shared_ptr<const cached_scene> find(const sha256_digest& digest) {
+
+			std::lock_guard<std::mutex> lock(mutex);
+			for (auto entry = entries.begin(); entry != entries.end(); ++entry) {
+
+				if (entry->first == digest) {
+
+					entries.splice(entries.begin(), entries, entry);
+					return entry->second;
+				}
+			}
+			return nullptr;
+		}
+
+		// Loads the scene outside the lock; if another connection inserted it meanwhile, that copy wins.
+		std::shared_ptr<const cached_scene> insert(const sha256_digest& digest, std::vector<std::uint8_t> bytes) {
+
+			auto loaded = std::make_shared<const cached_scene>(std::move(bytes), "scene " + to_hex(digest));
+			if (auto existing = find(digest)) {
+
+				return existing;
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+			entries.emplace_front(digest, loaded);
+			while (entries.size() > capacity) {
+
+				entries.pop_back();
+			}
+			return loaded;
+		}
+	private:
+		std::mutex mutex;
+		std::list<std::pair<sha256_digest, std::shared_ptr<const cached_scene>>> entries;
+		std::size_t capacity;
+	};
+
+	std::mutex log_mutex;
+
+	void log(const std::string& line) {
+
+		std::lock_guard<std::mutex> lock(log_mutex);
+		std::cerr << line << '\n';
+	}
+
+	void put_vec3(byte_writer& out, const vec3& v) {
+
+		for (int a = 0; a < 3; ++a) {
+
+			out.put_f64(static_cast<double>(v[a]));
+		}
+	}
+
+	vec3 get_vec3(byte_reader& in) {
+
+		const auto x = in.get_f64();
+		const auto y = in.get_f64();
+		const auto z = in.get_f64();
+		return vec3(static_cast<real>(x), static_cast<real>(y), static_cast<real>(z));
+	}
+
+	std::vector<std::uint8_t> encode_job(const render_job& job) {
+
+		byte_writer out;
+		out.put_u32(protocol_version);
+		out.put_bytes(job.scene_digest.data(), job.scene_digest.size());
+
+		put_vec3(out, job.camera.lookfrom);
+		put_vec3(out, job.camera.lookat);
+		put_vec3(out, job.camera.vup);
+		out.put_f64(static_cast<double>(job.camera.vfov));
+		out.put_f64(static_cast<double>(job.camera.focal_length));
+		out.put_f64(static_cast<double>(job.camera.aperture));
+		out.put_f64(static_cast<double>(job.camera.focus_distance));
+
+		const auto& settings = job.settings;
+		out.put_u32(static_cast<std::uint32_t>(settings.image_width));
+		out.put_u32(static_cast<std::uint32_t>(settings.image_height));
+		out.put_u32(static_cast<std::uint32_t>(settings.samples_per_pixel));
+		out.put_u32(static_cast<std::uint32_t>(settings.max_depth));
+		out.put_u32(static_cast<std::uint32_t>(settings.integrator));
+		out.put_u32(static_cast<std::uint32_t>(settings.rr_min_depth));
+		out.put_u32(static_cast<std::uint32_t>(settings.sampler));
+		out.put_u32(static_cast<std::uint32_t>(settings.kernel));
+		out.put_u64(settings.seed);
+
+		out.put_u32(static_cast<std::uint32_t>(job.region.x0));
+		out.put_u32(static_cast<std::uint32_t>(job.region.y0));
+		out.put_u32(static_cast<std::uint32_t>(job.region.x1));
+		out.put_u32(static_cast<std::uint32_t>(job.region.y1));
+		out.put_u32(static_cast<std::uint32_t>(job.band_rows));
+		return std::move(out.bytes());
+	}
+
+	// Throws std::runtime_error for another protocol version or values outside what a job may ask for.
+	render_job decode_job(const std::vector<std::uint8_t>& payload) {
+
+		byte_reader in(payload);
+		if (in.get_u32() != protocol_version) {
+
+			throw std::runtime_error("not a client of this protocol version");
+		}
+
+		render_job job;
+		const auto* digest = in.get_bytes(job.scene_digest.size());
+		std::copy(digest, digest + job.scene_digest.size(), job.scene_digest.begin());
+		job.camera.lookfrom = get_vec3(in);
+		job.camera.lookat = get_vec3(in);
+		job.camera.vup = get_vec3(in);
+		job.camera.vfov = static_cast<real>(in.get_f64());
+		job.camera.focal_length = static_cast<real>(in.get_f64());
+		job.camera.aperture = static_cast<real>(in.get_f64());
+		job.camera.focus_distance = static_cast<real>(in.get_f64());
+
+		const auto width = in.get_u32();
+		const auto height = in.get_u32();
+		const auto samples = in.get_u32();
+		const auto depth = in.get_u32();
+		const auto integrator = in.get_u32();
+		const auto rr_min_depth = in.get_u32();
+		const auto sampler = in.get_u32();
+		const auto kernel = in.get_u32();
+		if (width == 0 || height == 0 || width > max_resolution || height > max_resolution || samples == 0
+			|| samples > max_samples || depth > max_depth || rr_min_depth > max_depth
+			|| integrator > static_cast<std::uint32_t>(integrator_type::nee)
+			|| sampler > static_cast<std::uint32_t>(sampler_type::blue_noise)
+			|| kernel > static_cast<std::uint32_t>(render_kernel::specialized)) {
+
+			throw std::runtime_error("job settings out of range");
+		}
+
+		auto& settings = job.settings;
+		settings.image_width = static_cast<int>(width);
+		settings.image_height = static_cast<int>(height);
+		settings.samples_per_pixel = static_cast<int>(samples);
+		settings.max_depth = static_cast<int>(depth);
+		settings.integrator = static_cast<integrator_type>(integrator);
+		settings.rr_min_depth = static_cast<int>(rr_min_depth);
+		settings.sampler = static_cast<sampler_type>(sampler);
+		settings.kernel = static_cast<render_kernel>(kernel);
+		settings.seed = in.get_u64();
+		settings.show_progress = false;
+
+		auto& region = job.region;
+		region.x0 = static_cast<int>(in.get_u32());
+		region.y0 = static_cast<int>(in.get_u32());
+		region.x1 = static_cast<int>(in.get_u32());
+		region.y1 = static_cast<int>(in.get_u32());
+		if (region.x1 == 0 && region.y1 == 0) {
+
+			region = { 0, 0, settings.image_width, settings.image_height };
+		}
+		if (region.x0 < 0 || region.y0 < 0 || region.x1 > settings.image_width || region.y1 > settings.image_height
+			|| region.x0 >= region.x1 || region.y0 >= region.y1) {
+
+			throw std::runtime_error("region outside the image");
+		}
+		job.band_rows = static_cast<int>(std::min(in.get_u32(), max_resolution));
+		return job;
+	}
+
+	std::vector<std::uint8_t> failure_payload(const std::string& why) {
+
+		byte_writer out;
+		out.put_string(why);
+		return std::move(out.bytes());
+	}
+
+	// Everything the connections of one service share.
+	struct service_state {
+		service_state(const service_settings& service) :
+			pool{ service.thread_count },
+			cache{ service.cache_scenes },
+			max_scene_bytes{ service.max_scene_bytes }
+		{}
+
+		thread_pool pool;
+		scene_cache cache;
+		std::uint64_t max_scene_bytes;
+	};
+
+	// Runs one job that was received on connection, answering with its bands and totals.
+	void run_job(tcp_connection& connection, const render_job& job, service_state& state) {
+
+		const auto start = clock::now();
+		job_stats stats;
+		auto scene = state.cache.find(job.scene_digest);
+		stats.scene_cached = scene != nullptr;
+		if (!scene) {
+
+			send_message(connection, need_scene_message, {});
+			auto reply = receive_message(connection, state.max_scene_bytes);
+			if (reply.type != scene_message) {
+
+				throw std::runtime_error("expected the scene");
+			}
+			if (sha256(reply.payload.data(), reply.payload.size()) != job.scene_digest) {
+
+				throw std::runtime_error("the scene does not match its digest");
+			}
+			// The digest only tells the scene is the one the job names; opening it checks that it is safe to trace.
+			scene = state.cache.insert(job.scene_digest, std::move(reply.payload));
+		}
+
+		camera_settings view = job.camera;
+		view.aspect_ratio = static_cast<real>(job.settings.image_width) / static_cast<real>(job.settings.image_height);
+		const camera cam(view);
+		renderer tracer(job.settings, state.pool);
+		tracer.set_materials(scene->materials);
+		if (job.settings.integrator == integrator_type::nee) {
+
+			tracer.set_lights(scene->lights);
+		}
+
+		const int band_rows = job.band_rows > 0 ? job.band_rows : std::max(8, static_cast<int>(state.pool.size()));
+		const auto samples = static_cast<std::uint64_t>(job.settings.samples_per_pixel);
+		const real scale = real(1) / static_cast<real>(samples);
+		std::vector<color> sums;
+		for (int y = job.region.y0; y < job.region.y1; y += band_rows) {
+
+			const tile band{ job.region.x0, y, job.region.x1, std::min(y + band_rows, job.region.y1) };
+			stats.rays += tracer.sample_tile(band, scene->world, cam, 0, job.settings.samples_per_pixel, sums);
+			stats.samples += samples * sums.size();
+
+			byte_writer out;
+			out.put_u32(static_cast<std::uint32_t>(band.y0));
+			out.put_u32(static_cast<std::uint32_t>(band.y1));
+			for (const auto& sum : sums) {
+
+				for (int c = 0; c < 3; ++c) {
+
+					out.put_f32(static_cast<float>(sum[c] * scale));
+				}
+			}
+			send_message(connection, band_message, out.bytes());
+		}
+
+		stats.seconds = std::chrono::duration<double>(clock::now() - start).count();
+		byte_writer done;
+		done.put_u64(stats.samples);
+		done.put_u64(stats.rays);
+		done.put_f64(stats.seconds);
+		done.put_u32(stats.scene_cached ? 1 : 0);
+		send_message(connection, done_message, done.bytes());
+	}
+
+	/*
+		Serves the jobs of one client until it disconnects, stays idle past the timeout or the service stops.
+		A job that fails is reported to the client, only connection errors end the connection.
+	*/
+	void serve_client(tcp_connection connection, int client, service_state& state, const service_settings& service,
+		const std::atomic<bool>* stop) {
+
+		try {
+
+			double idle = 0;
+			while (!(stop && *stop)) {
+
+				if (!connection.wait_readable(poll_interval)) {
+
+					idle += poll_interval;
+					if (service.idle_timeout > 0 && idle >= service.idle_timeout) {
+
+						break;
+					}
+					continue;
+				}
+				idle = 0;
+
+				// A job and its scene have to arrive promptly once they started.
+				connection.set_timeout(service.idle_timeout);
+				const auto message = receive_message(connection, job_size);
+				if (message.type != job_message) {
+
+					throw std::runtime_error("expected a job");
+				}
+
+				render_job job;
+				try {
+
+					job = decode_job(message.payload);
+				}
+				catch (const std::exception& e) {
+
+					send_message(connection, failure_message, failure_payload(e.what()));
+					continue;
+				}
+
+				try {
+
+					run_job(connection, job, state);
+				}
+				catch (const std::exception& e) {
+
+					// Bands already sent are not taken back, the client drops them with the failure.
+					send_message(connection, failure_message, failure_payload(e.what()));
+					log("Client " + std::to_string(client) + ": job failed: " + e.what());
+				}
+			}
+		}
+		catch (const std::exception& e) {
+
+			log("Client " + std::to_string(client) + " disconnected: " + e.what());
+		}
+	}
+}
+
+void run_render_service(const service_settings& service, const std::atomic<bool>* stop,
+	const std::function<void(int)>& on_listening) {
+
+	tcp_listener listener(service.port);
+	service_state state(service);
+	log("Serving renders on port " + std::to_string(listener.port()) + " with " + std::to_string(state.pool.size())
+		+ " threads, caching " + std::to_string(service.cache_scenes) + " scenes");
+	if (on_listening) {
+
+		on_listening(listener.port());
+	}
+
+	// One thread per connection, joined as soon as its client is done so a long running service does not pile them up.
+	struct client_thread {
+		std::thread thread;
+		std::atomic<bool> finished{ false };
+	};
+	std::list<client_thread> serving;
+	int clients = 0;
+	while (!(stop && *stop)) {
+
+		tcp_connection connection;
+		const bool accepted = listener.accept(connection, poll_interval);
+		for (auto entry = serving.begin(); entry != serving.end();) {
+
+			if (entry->finished) {
+
+				entry->thread.join();
+				entry = serving.erase(entry);
+			}
+			else {
+
+				++entry;
+			}
+		}
+		if (!accepted) {
+
+			continue;
+		}
+
+		++clients;
+		if (serving.size() >= std::max<std::size_t>(service.max_clients, 1)) {
+
+			// The client reads this as the answer to its first job.
+			log("Client " + std::to_string(clients) + " turned away, " + std::to_string(serving.size()) + " clients connected");
+			try {
+
+				connection.set_timeout(poll_interval);
+				send_message(connection, failure_message, failure_payload("the service is busy, try again later"));
+			}
+			catch (const std::exception&) {
+
+				// Gone already, nothing to tell it.
+			}
+			continue;
+		}
+
+		serving.emplace_back();
+		auto& entry = serving.back();
+		entry.thread = std::thread([&entry, &state, &service, stop, client = clients, connection = std::move(connection)]() mutable {
+
+			serve_client(std::move(connection), client, state, service, stop);
+			entry.finished = true;
+		});
+	}
+
+	for (auto& entry : serving) {
+
+		entry.thread.join();
+	}
+}
+
+render_client::render_client(const std::string& host, int port) :
+	connection{ tcp_connection::connect(host, port) },
+	address{ host + ':' + std::to_string(port) }
+{}
+
+job_stats render_client::render(const render_job& job, const std::vector<std::uint8_t>& scene_bytes, const band_callback& on_band) {
+
+	send_message(connection, job_message, encode_job(job));
+
+	const tile region = job.region.x1 == 0 && job.region.y1 == 0
+		? tile{ 0, 0, job.settings.image_width, job.settings.image_height } : job.region;
+	const auto width = static_cast<std::size_t>(std::max(region.x1 - region.x0, 0));
+	const auto height = static_cast<std::size_t>(std::max(region.y1 - region.y0, 0));
+	const auto max_band_size = std::max<std::uint64_t>(default_max_payload, 8 + 12 * std::uint64_t(width) * height);
+	std::vector<color> pixels;
+	while (true) {
+
+		const auto message = receive_message(connection, max_band_size);
+		byte_reader in(message.payload);
+		switch (message.type) {
+		case need_scene_message:
+			send_message(connection, scene_message, scene_bytes);
+			break;
+		case band_message: {
+			tile band = region;
+			band.y0 = static_cast<int>(in.get_u32());
+			band.y1 = static_cast<int>(in.get_u32());
+			if (band.y0 < region.y0 || band.y1 > region.y1 || band.y0 >= band.y1
+				|| in.remaining() != 12 * width * static_cast<std::size_t>(band.y1 - band.y0)) {
+
+				throw std::runtime_error("malformed band from " + address);
+			}
+			pixels.resize(width * static_cast<std::size_t>(band.y1 - band.y0));
+			for (auto& pixel : pixels) {
+
+				const auto r = in.get_f32();
+				const auto g = in.get_f32();
+				const auto b = in.get_f32();
+				pixel = color(static_cast<real>(r), static_cast<real>(g), static_cast<real>(b));
+			}
+			if (on_band) {
+
+				on_band(band, pixels);
+			}
+			break;
+		}
+		case done_message: {
+			job_stats stats;
+			stats.samples = in.get_u64();
+			stats.rays = in.get_u64();
+			stats.seconds = in.get_f64();
+			stats.scene_cached = in.get_u32() != 0;
+			return stats;
+		}
+		case failure_message:
+			throw std::runtime_error(address + " failed the job: " + in.get_string());
+		default:
+			throw std::runtime_error("unexpected message from " + address);
+		}
+	}
+}
@@ -0,0 +1,725 @@
+#include "renderer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+
+#include "kernels.hpp"
+#include "profiler.hpp"
+#include "wavefront.hpp"
+
+render_engine render_engine_from_name(const std::string& name) {
+
+	if (name == "tiled") return render_engine::tiled;
+	if (name == "wavefront") return render_engine::wavefront;
+
+	throw std::invalid_argument("unknown engine " + name);
+}
+
+render_kernel render_kernel_from_name(const std::string& name) {
+
+	if (name == "generic") return render_kernel::generic;
+	if (name == "specialized") return render_kernel::specialized;
+
+	throw std::invalid_argument("unknown kernel " + name);
+}
+
+// Luminance of a linear RGB color, Rec. 709 weights.
+static double luminance(const color& c) {
+
+	return 0.2126 * c.x() + 0.7152 * c.y() + 0.0722 * c.z();
+}
+
+void luminance_estimate::add(const color& sample, int count) {
+
+	const double y_sample = luminance(sample);
+	const double delta = y_sample - mean;
+	mean += delta / count;
+	squared_deviations += delta * (y_sample - mean);
+}
+
+bool luminance_estimate::converged(int count, double threshold) const {
+
+	// A floor of one 8-bit step, so black pixels converge too.
+	const double error_floor = 1.0 / 256;
+	const double standard_error = std::sqrt(squared_deviations / (count - 1) / count);
+	return standard_error <= threshold * std::max(mean, error_floor);
+}
+
+renderer::renderer(const render_settings& settings) :
+	config{ settings },
+	own_pool{ std::make_unique<thread_pool>(settings.thread_count) },
+	pool{ *own_pool },
+	method{ make_integrator(settings.integrator, settings.max_depth, settings.rr_min_depth) },
+	pattern{ make_sampler(settings.sampler, settings.samples_per_pixel, settings.seed) }
+{}
+
+renderer::renderer(const render_settings& settings, thread_pool& shared_pool) :
+	config{ settings },
+	pool{ shared_pool },
+	method{ make_integrator(settings.integrator, settings.max_depth, settings.rr_min_depth) },
+	pattern{ make_sampler(settings.sampler, settings.samples_per_pixel, settings.seed) }
+{}
+
+const render_settings& renderer::settings() const {
+
+	return config;
+}
+
+unsigned renderer::thread_count() const {
+
+	return pool.size();
+}
+
+void renderer::set_integrator(std::unique_ptr<integrator> replacement) {
+
+	if (replacement) {
+
+		method = std::move(replacement);
+		custom_integrator = true;
+	}
+}
+
+const integrator& renderer::current_integrator() const {
+
+	return *method;
+}
+
+void renderer::set_materials(material_table table) {
+
+	surfaces = std::move(table);
+}
+
+const material_table& renderer::materials() const {
+
+	return surfaces;
+}
+
+const material_table* renderer::material_lookup() const {
+
+	return surfaces.empty() ? nullptr : &surfaces;
+}
+
+void renderer::set_lights(light_list list) {
+
+	emitters = std::move(list);
+}
+
+const light_list& renderer::lights() const {
+
+	return emitters;
+}
+
+static kernel_key make_kernel_key(const render_settings& config, const hittable& world) {
+
+	kernel_key key;
+	key.integrator = config.integrator;
+	key.max_depth = config.max_depth;
+	key.sampler = config.sampler;
+	key.primitives = primitive_set_of(world);
+	return key;
+}
+
+std::string renderer::kernel_for(const hittable& world) const {
+
+	const auto key = make_kernel_key(config, world);
+	if (config.kernel != render_kernel::specialized || custom_integrator || !has_specialized_kernel(key)) {
+
+		return "generic";
+	}
+	return kernel_name(key);
+}
+
+const integrator& renderer::select_integrator(const hittable& world) {
+
+	if (config.kernel != render_kernel::specialized || custom_integrator) {
+
+		return *method;
+	}
+
+	// Made again for every render: a world at the address of the last one need not have its type.
+	kernel = make_specialized_integrator(make_kernel_key(config, world), config.rr_min_depth, world, pattern.get());
+	return kernel ? *kernel : *method;
+}
+
+const std::vector<std::uint32_t>& renderer::samples_taken() const {
+
+	return pixel_samples;
+}
+
+framebuffer renderer::sample_heatmap() const {
+
+	framebuffer heatmap(config.image_width, config.image_height);
+	if (pixel_samples.size() != heatmap.pixel_count()) {
+
+		return heatmap;
+	}
+
+	const auto limit = static_cast<real>(std::max(config.samples_per_pixel, 1));
+	for (int y = 0; y < config.image_height; ++y) {
+
+		for (int x = 0; x < config.image_width; ++x) {
+
+			const auto t = std::min(pixel_samples[static_cast<std::size_t>(y) * config.image_width + x] / limit, real(1));
+			heatmap.set(x, y, (1 - t) * color(0, 0, 1) + t * color(1, 0, 0));
+		}
+	}
+
+	return heatmap;
+}
+
+// The integrator's estimate along one camera ray; profiled builds also count the path by the rays it traced.
+static color trace_path(const integrator& method, const ray& r, const hittable& world, sample_context& ctx) {
+
+#ifdef RT_PROFILE
+	const auto rays_before = ctx.rays;
+	const color radiance = method.li(r, world, ctx);
+	profile_paths(ctx.rays - rays_before, 1);
+	return radiance;
+#else
+	return method.li(r, world, ctx);
+#endif
+}
+
+render_stats renderer::render(const hittable& world, const camera& cam, framebuffer& image) {
+
+	RT_PROFILE_SPAN(profile_stage::frame);
+	const auto start = std::chrono::steady_clock::now();
+	image.resize(config.image_width, config.image_height);
+	pixel_samples.assign(image.pixel_count(), 0);
+
+	const bool wavefront = config.engine == render_engine::wavefront;
+	if (wavefront && (custom_integrator || pattern || config.integrator == integrator_type::nee)) {
+
+		throw std::logic_error("the wavefront engine only runs the path and recursive integrators with independent sampling");
+	}
+	active = wavefront ? method.get() : &select_integrator(world);
+	const wavefront_engine waves(config, material_lookup());
+	const camera_raster raster(cam, config.image_width, config.image_height);
+
+	const auto tiles = make_tiles(wavefront ? config.wave_tile_size : config.tile_size);
+	std::atomic<std::size_t> tiles_remaining{ tiles.size() };
+	std::atomic<std::uint64_t> rays{ 0 };
+	progress_reporter progress(config.show_progress);
+
+	pool.parallel_for(tiles.size(), [&](std::size_t index) {
+
+		{
+			RT_PROFILE_SPAN(profile_stage::tile);
+			rays += wavefront ? waves.render_tile(tiles[index], world, raster, image, pixel_samples)
+				: render_tile(tiles[index], world, raster, image, pixel_samples, 0);
+		}
+
+		const auto remaining = --tiles_remaining;
+		progress.update("Tiles remaining", remaining, 0, remaining == 0);
+	});
+
+	render_stats stats;
+	for (auto count : pixel_samples) {
+
+		stats.samples += count;
+	}
+	stats.rays = rays;
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	return stats;
+}
+
+render_stats renderer::render_streaming(const hittable& world, const camera& cam, image_stream& stream, int window_bands) {
+
+	RT_PROFILE_SPAN(profile_stage::frame);
+	const auto start = std::chrono::steady_clock::now();
+	if (config.engine != render_engine::tiled) {
+
+		throw std::logic_error("streaming output only runs on the tiled engine");
+	}
+	if (stream.width() != config.image_width || stream.height() != config.image_height) {
+
+		throw std::invalid_argument("the image stream differs in size from the render");
+	}
+	pixel_samples.clear();
+	active = &select_integrator(world);
+	const camera_raster raster(cam, config.image_width, config.image_height);
+
+	const int size = config.tile_size > 0 ? config.tile_size : 16;
+	const int band_count = (config.image_height + size - 1) / size;
+	const int tiles_per_band = (config.image_width + size - 1) / size;
+	if (window_bands <= 0) {
+
+		window_bands = std::max(2, static_cast<int>((2 * pool.size() + tiles_per_band - 1) / tiles_per_band));
+	}
+	window_bands = std::min(window_bands, band_count);
+
+	// Band k of the stream, in the image: its first row and its row count.
+	auto band_rows = [&](int k, int& y0, int& rows) {
+
+		const int band = stream.bottom_up() ? band_count - 1 - k : k;
+		y0 = band * size;
+		rows = std::min(size, config.image_height - y0);
+	};
+
+	// The reorder buffer: stream band k is gathered in slot k % window_bands until every band before it was written.
+	struct band_slot {
+		framebuffer pixels;
+		std::vector<std::uint32_t> samples;
+		int remaining = 0;   // tiles still to finish
+	};
+	std::vector<band_slot> slots(static_cast<std::size_t>(window_bands));
+	auto open_slot = [&](int k) {
+
+		int y0, rows;
+		band_rows(k, y0, rows);
+		band_slot& slot = slots[k % window_bands];
+		slot.pixels.resize(config.image_width, rows);
+		slot.samples.assign(slot.pixels.pixel_count(), 0);
+		slot.remaining = tiles_per_band;
+	};
+	for (int k = 0; k < window_bands; ++k) {
+
+		open_slot(k);
+	}
+
+	std::mutex state;
+	std::condition_variable advanced;
+	int written = 0;   // bands of the stream written so far
+	bool writing = false;
+	bool failed = false;
+	std::uint64_t samples = 0;
+	std::atomic<std::size_t> next_tile{ 0 };
+	std::atomic<std::uint64_t> rays{ 0 };
+	const std::size_t tile_count = static_cast<std::size_t>(band_count) * tiles_per_band;
+	progress_reporter progress(config.show_progress);
+
+	/*
+		Every worker claims tiles in stream order and waits before one that is window_bands or more bands ahead
+		of the first band not written. All tiles before it are claimed by workers that are not waiting,
+		so the first band always completes. Whoever completes the first band writes it, and any complete ones behind it,
+		outside the lock, while the others keep rendering.
+	*/
+	pool.parallel_for(pool.size(), [&](std::size_t) {
+
+		try {
+
+			while (true) {
+
+				const std::size_t index = next_tile++;
+				if (index >= tile_count) {
+
+					return;
+				}
+				const int k = static_cast<int>(index / tiles_per_band);
+				{
+					std::unique_lock<std::mutex> lock(state);
+					advanced.wait(lock, [&] { return failed || k < written + window_bands; });
+					if (failed) {
+
+						return;
+					}
+				}
+
+				int y0, rows;
+				band_rows(k, y0, rows);
+				const int x0 = static_cast<int>(index % tiles_per_band) * size;
+				const tile t{ x0, y0, std::min(x0 + size, config.image_width), y0 + rows };
+				band_slot& slot = slots[k % window_bands];
+				{
+					RT_PROFILE_SPAN(profile_stage::tile);
+					rays += render_tile(t, world, raster, slot.pixels, slot.samples, y0);
+				}
+
+				std::unique_lock<std::mutex> lock(state);
+				if (--slot.remaining > 0 || writing) {
+
+					continue;
+				}
+				writing = true;
+				while (written < band_count && slots[written % window_bands].remaining == 0) {
+
+					band_slot& done = slots[written % window_bands];
+					lock.unlock();
+					stream.write(done.pixels);
+					std::uint64_t band_samples = 0;
+					for (auto count : done.samples) {
+
+						band_samples += count;
+					}
+					lock.lock();
+
+					samples += band_samples;
+					if (written + window_bands < band_count) {
+
+						open_slot(written + window_bands);
+					}
+					++written;
+					advanced.notify_all();
+					progress.update("Bands written", static_cast<std::uint64_t>(written), static_cast<std::uint64_t>(band_count),
+						written == band_count);
+				}
+				writing = false;
+			}
+		}
+		catch (...) {
+
+			std::lock_guard<std::mutex> lock(state);
+			failed = true;
+			advanced.notify_all();
+			throw;
+		}
+	});
+
+	stream.finish();
+
+	render_stats stats;
+	stats.samples = samples;
+	stats.rays = rays;
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	return stats;
+}
+
+// Mirror and glass surfaces the AOVs look through before they take a surface as it is.
+static const int max_specular_bounces = 4;
+
+// The albedo is averaged over a grid of this many rays squared per pixel, antialiased like the color it divides.
+static const int aov_albedo_grid = 4;
+
+/*
+	The guides along one camera ray: the albedo of the first surface that scatters diffusely, seen through mirrors
+	and glass and tinted by them, and its normal. Returns the distance to the first surface, 0 for the sky.
+*/
+static real trace_guides(const hittable& world, const material_table* lookup, ray r, color& albedo, vec3& normal) {
+
+	hit_record rec;
+	normal = vec3(0, 0, 0);
+	if (!world.hit(r, surface_epsilon, infinity, rec)) {
+
+		albedo = sky_color(r);
+		return 0;
+	}
+	const real depth = rec.t * r.direction().length();
+
+	albedo = color(surface_albedo, surface_albedo, surface_albedo);
+	normal = rec.normal;
+	color tint(1, 1, 1);
+	for (int bounce = 0; lookup; ++bounce) {
+
+		const material_record& m = lookup->get(rec.material);
+		vec3 direction;
+		if (bounce == max_specular_bounces || !specular_direction(m, r, rec, direction)) {
+
+			albedo = tint * (m.type == material_type::emissive ? color(1, 1, 1) : material_albedo(m));
+			normal = rec.normal;
+			break;
+		}
+		tint = tint * material_albedo(m);
+		r = ray(rec.p, direction);
+		if (!world.hit(r, surface_epsilon, infinity, rec)) {
+
+			albedo = tint * sky_color(r);
+			break;
+		}
+	}
+	return depth;
+}
+
+void renderer::render_aovs(const hittable& world, const camera& cam, aov_buffers& aovs) {
+
+	aovs.albedo.resize(config.image_width, config.image_height);
+	aovs.normal.resize(config.image_width, config.image_height);
+	aovs.depth.resize(config.image_width, config.image_height);
+	const camera_raster raster(cam, config.image_width, config.image_height);
+	const material_table* lookup = material_lookup();
+
+	pool.parallel_for(static_cast<std::size_t>(config.image_height), [&](std::size_t row) {
+
+		const int y = static_cast<int>(row);
+		for (int x = 0; x < config.image_width; ++x) {
+
+			const double center[] = { 0.5, 0.5, 0, 0 };
+			color albedo;
+			vec3 normal;
+			const real depth = trace_guides(world, lookup, raster.get_ray(x, y, center), albedo, normal);
+			aovs.normal.set(x, y, normal);
+			aovs.depth.set(x, y, color(depth, depth, depth));
+
+			color albedo_sum(0, 0, 0);
+			for (int j = 0; j < aov_albedo_grid; ++j) {
+
+				for (int i = 0; i < aov_albedo_grid; ++i) {
+
+					const double offset[] = { (i + 0.5) / aov_albedo_grid, (j + 0.5) / aov_albedo_grid, 0, 0 };
+					trace_guides(world, lookup, raster.get_ray(x, y, offset), albedo, normal);
+					albedo_sum += albedo;
+				}
+			}
+			aovs.albedo.set(x, y, albedo_sum / static_cast<real>(aov_albedo_grid * aov_albedo_grid));
+		}
+	});
+}
+
+std::vector<tile> renderer::make_tiles(int size) const {
+
+	std::vector<tile> tiles;
+	size = size > 0 ? size : 16;
+	for (int y = 0; y < config.image_height; y += size) {
+
+		for (int x = 0; x < config.image_width; x += size) {
+
+			tiles.push_back({ x, y, std::min(x + size, config.image_width), std::min(y + size, config.image_height) });
+		}
+	}
+
+	return tiles;
+}
+
+std::uint64_t renderer::render_tile(const tile& t, const hittable& world, const camera_raster& raster, framebuffer& image,
+	std::vector<std::uint32_t>& sample_counts, int first_row) const {
+
+	const bool adaptive = config.adaptive_threshold > 0;
+	const int max_samples = std::max(config.samples_per_pixel, 1);
+	const int check_interval = std::min(std::max(config.min_samples, 1), max_samples);
+	const int dimensions = raster.sample_dimensions();
+
+	std::uint64_t rays = 0;
+	std::vector<double> jitter(dimensions * static_cast<std::size_t>(max_samples));
+	ray_batch camera_rays;
+
+	for (int y = t.y0; y < t.y1; ++y) {
+
+		for (int i = t.x0; i < t.x1; ++i) {
+
+			// One stream per pixel: the result does not depend on the tile size or on which thread runs the tile.
+			const auto pixel_index = static_cast<std::uint64_t>(y) * config.image_width + i;
+			random_engine rng(config.seed, pixel_index);
+			fill_jitter(rng, i, y, 0, max_samples, dimensions, jitter);
+			{
+				RT_PROFILE_STAGE(profile_stage::camera);
+				raster.generate(i, y, jitter.data(), max_samples, camera_rays);
+			}
+			sample_context ctx(rng, pattern.get(), i, y);
+			ctx.materials = material_lookup();
+			ctx.lights = &emitters;
+
+			color pixel_color(0, 0, 0);
+
+			luminance_estimate estimate;
+
+			int s = 0;
+			while (s < max_samples) {
+
+				ctx.start_sample(static_cast<std::uint32_t>(s), static_cast<std::uint32_t>(dimensions));
+				const color sample = trace_path(*active, camera_rays.get(s), world, ctx);
+				pixel_color += sample;
+				++s;
+
+				if (!adaptive) {
+
+					continue;
+				}
+
+				estimate.add(sample, s);
+				if (s % check_interval == 0 && s > 1 && estimate.converged(s, config.adaptive_threshold)) {
+
+					break;
+				}
+			}
+
+			image.set(i, y - first_row, pixel_color / static_cast<real>(s));
+			sample_counts[static_cast<std::size_t>(y - first_row) * config.image_width + i] = static_cast<std::uint32_t>(s);
+			rays += ctx.rays;
+		}
+	}
+
+	return rays;
+}
+
+render_stats renderer::render_progressive(const hittable& world, const camera& cam, accumulation_buffer& accumulation,
+	const progressive_settings& progressive) {
+
+	RT_PROFILE_SPAN(profile_stage::frame);
+	using clock = std::chrono::steady_clock;
+	const auto start = clock::now();
+	auto last_snapshot = start;
+	auto elapsed = [&](clock::time_point since) { return std::chrono::duration<double>(clock::now() - since).count(); };
+
+	if (accumulation.width() != config.image_width || accumulation.height() != config.image_height) {
+
+		accumulation.reset(config.image_width, config.image_height);
+	}
+
+	const auto target = static_cast<std::uint32_t>(std::max(config.samples_per_pixel, 1));
+	const int pass_samples = std::max(progressive.pass_samples, 1);
+	const auto samples_before = accumulation.total_samples();
+
+	std::atomic<bool> stopped{ false };
+	auto should_stop = [&]() {
+
+		if (progressive.cancel && progressive.cancel->load()) return true;
+		if (progressive.time_budget > 0 && elapsed(start) >= progressive.time_budget) return true;
+		return false;
+	};
+
+	const auto tiles = make_tiles(config.tile_size);
+	std::atomic<std::uint64_t> rays{ 0 };
+	progress_reporter progress(config.show_progress);
+	const camera_raster raster(cam, config.image_width, config.image_height);
+	active = &select_integrator(world);
+
+	while (accumulation.min_samples() < target && !stopped) {
+
+		{
+			RT_PROFILE_SPAN(profile_stage::pass);
+			pool.parallel_for(tiles.size(), [&](std::size_t index) {
+
+				if (stopped || should_stop()) {
+
+					stopped = true;
+					return;
+				}
+				RT_PROFILE_SPAN(profile_stage::tile);
+				rays += accumulate_tile(tiles[index], world, raster, accumulation, pass_samples);
+			});
+		}
+
+		const auto samples = accumulation.min_samples();
+		progress.update("Samples per pixel", samples, target, samples >= target || stopped);
+
+		if (progressive.on_snapshot && progressive.snapshot_interval > 0 && elapsed(last_snapshot) >= progressive.snapshot_interval) {
+
+			progressive.on_snapshot(accumulation);
+			last_snapshot = clock::now();
+		}
+	}
+
+	pixel_samples.assign(accumulation.width() * static_cast<std::size_t>(accumulation.height()), 0);
+	for (int y = 0; y < accumulation.height(); ++y) {
+
+		for (int x = 0; x < accumulation.width(); ++x) {
+
+			pixel_samples[static_cast<std::size_t>(y) * accumulation.width() + x] = accumulation.samples(x, y);
+		}
+	}
+
+	render_stats stats;
+	stats.samples = accumulation.total_samples() - samples_before;
+	stats.rays = rays;
+	stats.seconds = elapsed(start);
+	stats.interrupted = stopped;
+
+	return stats;
+}
+
+std::uint64_t renderer::accumulate_tile(const tile& t, const hittable& world, const camera_raster& raster,
+	accumulation_buffer& accumulation, int pass_samples) const {
+
+	const auto target = static_cast<std::uint32_t>(std::max(config.samples_per_pixel, 1));
+
+	std::uint64_t rays = 0;
+	std::vector<double> jitter(raster.sample_dimensions() * static_cast<std::size_t>(pass_samples));
+	ray_batch camera_rays;
+
+	for (int y = t.y0; y < t.y1; ++y) {
+
+		for (int i = t.x0; i < t.x1; ++i) {
+
+			const auto done = accumulation.samples(i, y);
+			if (done >= target) {
+
+				continue;
+			}
+			const int count = static_cast<int>(std::min<std::uint32_t>(pass_samples, target - done));
+
+			accumulation.add(i, y, sample_chunk(world, raster, i, y, done, count, jitter, camera_rays, rays), static_cast<std::uint32_t>(count));
+		}
+	}
+
+	return rays;
+}
+
+std::uint64_t renderer::sample_tile(const tile& t, const hittable& world, const camera& cam, std::uint32_t first, int count,
+	std::vector<color>& sums) {
+
+	const int width = t.x1 - t.x0;
+	sums.assign(static_cast<std::size_t>(width) * (t.y1 - t.y0), color(0, 0, 0));
+	if (count <= 0) {
+
+		return 0;
+	}
+
+	active = &select_integrator(world);
+	const camera_raster raster(cam, config.image_width, config.image_height);
+	std::atomic<std::uint64_t> rays{ 0 };
+	pool.parallel_for(static_cast<std::size_t>(t.y1 - t.y0), [&](std::size_t row) {
+
+		const int y = t.y0 + static_cast<int>(row);
+		std::uint64_t row_rays = 0;
+		std::vector<double> jitter(raster.sample_dimensions() * static_cast<std::size_t>(count));
+		ray_batch camera_rays;
+		for (int i = t.x0; i < t.x1; ++i) {
+
+			sums[row * width + (i - t.x0)] = sample_chunk(world, raster, i, y, first, count, jitter, camera_rays, row_rays);
+		}
+		rays += row_rays;
+	});
+
+	return rays;
+}
+
+color renderer::sample_chunk(const hittable& world, const camera_raster& raster, int i, int y, std::uint32_t done, int count,
+	std::vector<double>& jitter, ray_batch& camera_rays, std::uint64_t& rays) const {
+
+	// The first chunk uses the frame seed itself, so a single pass draws the same samples as render().
+	std::uint64_t chunk_seed = config.seed;
+	if (done > 0) {
+
+		std::uint64_t state = config.seed + 0x9E3779B97F4A7C15ull * done;
+		chunk_seed = splitmix64(state);
+	}
+
+	const auto pixel_index = static_cast<std::uint64_t>(y) * config.image_width + i;
+	random_engine rng(chunk_seed, pixel_index);
+	const int dimensions = raster.sample_dimensions();
+	fill_jitter(rng, i, y, done, count, dimensions, jitter);
+	{
+		RT_PROFILE_STAGE(profile_stage::camera);
+		raster.generate(i, y, jitter.data(), count, camera_rays);
+	}
+	sample_context ctx(rng, pattern.get(), i, y);
+	ctx.materials = material_lookup();
+	ctx.lights = &emitters;
+
+	color sum(0, 0, 0);
+	for (int s = 0; s < count; ++s) {
+
+		ctx.start_sample(done + static_cast<std::uint32_t>(s), static_cast<std::uint32_t>(dimensions));
+		sum += trace_path(*active, camera_rays.get(s), world, ctx);
+	}
+
+	rays += ctx.rays;
+	return sum;
+}
+
+void renderer::fill_jitter(random_engine& rng, int i, int y, std::uint32_t first, int count, int dimensions,
+	std::vector<double>& jitter) const {
+
+	if (!pattern) {
+
+		rng.fill(jitter.data(), dimensions * static_cast<std::size_t>(count));
+		return;
+	}
+
+	for (int s = 0; s < count; ++s) {
+
+		double* sample = &jitter[dimensions * static_cast<std::size_t>(s)];
+		const auto index = first + static_cast<std::uint32_t>(s);
+		pattern->get_2d(i, y, index, 0, sample[0], sample[1]);
+		if (dimensions > 2) {
+
+			pattern->get_2d(i, y, index, 2, sample[2], sample[3]);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,472 @@
+#include "sampler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+sampler_type sampler_type_from_name(const std::string& name) {
+
+	if (name == "independent") return sampler_type::independent;
+	if (name == "stratified") return sampler_type::stratified;
+	if (name == "sobol") return sampler_type::sobol;
+	if (name == "blue-noise") return sampler_type::blue_noise;
+
+	throw std::invalid_argument("unknown sampler " + name);
+}
+
+const char* sampler_type_name(sampler_type type) {
+
+	switch (type) {
+	case sampler_type::stratified: return "stratified";
+	case sampler_type::sobol: return "sobol";
+	case sampler_type::blue_noise: return "blue-noise";
+	case sampler_type::independent:
+	default: return "independent";
+	}
+}
+
+// A 32 bit seed from three values, one SplitMix64 step per value.
+static std::uint32_t hash_seed(std::uint64_t a, std::uint64_t b, std::uint64_t c) {
+
+	std::uint64_t state = a;
+	std::uint64_t h = splitmix64(state);
+	state = h ^ b;
+	h = splitmix64(state);
+	state = h ^ c;
+	h = splitmix64(state);
+	return static_cast<std::uint32_t>(h >> 32);
+}
+
+static std::uint64_t pixel_key(int x, int y) {
+
+	return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32) | static_cast<std::uint32_t>(y);
+}
+
+static double to_unit(std::uint32_t bits) {
+
+	return bits * (1.0 / 4294967296.0);
+}
+
+// Kensler, "Correlated Multi-Jittered Sampling": a hashed permutation of [0, l) picked by p, by cycle walking.
+static std::uint32_t permute(std::uint32_t i, std::uint32_t l, std::uint32_t p) {
+
+	std::uint32_t w = l - 1;
+	w |= w >> 1;
+	w |= w >> 2;
+	w |= w >> 4;
+	w |= w >> 8;
+	w |= w >> 16;
+	do {
+
+		i ^= p; i *= 0xe170893d;
+		i ^= p >> 16;
+		i ^= (i & w) >> 4;
+		i ^= p >> 8; i *= 0x0929eb3f;
+		i ^= p >> 23;
+		i ^= (i & w) >> 1; i *= 1 | p >> 27;
+		i *= 0x6935fa69;
+		i ^= (i & w) >> 11; i *= 0x74dcb303;
+		i ^= (i & w) >> 2; i *= 0x9e501cc3;
+		i ^= (i & w) >> 2; i *= 0xc860a3df;
+		i &= w;
+		i ^= i >> 5;
+	} while (i >= l);
+
+	return (i + p) % l;
+}
+
+// The matching hash of i and p to [0,1).
+static double random_unit(std::uint32_t i, std::uint32_t p) {
+
+	i ^= p;
+	i ^= i >> 17;
+	i ^= i >> 10; i *= 0xb36534e5;
+	i ^= i >> 12;
+	i ^= i >> 21; i *= 0x93fc4795;
+	i ^= 0xdf6e307f;
+	i ^= i >> 17; i *= 1 | p >> 18;
+	return to_unit(i);
+}
+
+stratified_sampler::stratified_sampler(int samples_per_pixel, std::uint64_t seed) :
+	count{ static_cast<std::uint32_t>(std::max(samples_per_pixel, 1)) },
+	frame_seed{ seed }
+{}
+
+double stratified_sampler::get_1d(int x, int y, std::uint32_t index, std::uint32_t dimension) const {
+
+	// Every further set of count samples is a fresh pattern.
+	const std::uint32_t p = hash_seed(frame_seed ^ pixel_key(x, y), dimension, index / count);
+	const std::uint32_t s = index % count;
+	const std::uint32_t stratum = permute(s, count, p * 0x68bc21eb);
+	return (stratum + random_unit(s, p * 0x967a889b)) / count;
+}
+
+void stratified_sampler::get_2d(int x, int y, std::uint32_t index, std::uint32_t dimension, double& u, double& v) const {
+
+	const std::uint32_t p = hash_seed(frame_seed ^ pixel_key(x, y), dimension, index / count);
+	const auto m = std::max(static_cast<std::uint32_t>(std::sqrt(static_cast<double>(count))), 1u);
+	const std::uint32_t n = (count + m - 1) / m;
+
+	const std::uint32_t s = permute(index % count, count, p * 0x51633e2d);
+	const std::uint32_t sx = permute(s % m, m, p * 0x68bc21eb);
+	const std::uint32_t sy = permute(s / m, n, p * 0x02e5be93);
+	const double jx = random_unit(s, p * 0x967a889b);
+	const double jy = random_unit(s, p * 0x368cc8b7);
+	u = (s % m + (sy + jx) / n) / m;
+	v = (s / m + (sx + jy) / m) / n;
+}
+
+static std::uint32_t reverse_bits(std::uint32_t x) {
+
+	x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+	x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+	x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+	x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+	return (x >> 16) | (x << 16);
+}
+
+// Burley, "Practical Hash-based Owen Scrambling": an Owen scramble of the bits of x, highest bit first.
+static std::uint32_t nested_uniform_scramble(std::uint32_t x, std::uint32_t seed) {
+
+	x = reverse_bits(x);
+	x += seed;
+	x ^= x * 0x6c50b47cu;
+	x ^= x * 0xb82f1e52u;
+	x ^= x * 0xc7afe638u;
+	x ^= x * 0x8d22f6e6u;
+	return reverse_bits(x);
+}
+
+static std::uint32_t hash_combine(std::uint32_t seed, std::uint32_t v) {
+
+	return seed ^ (v + (seed << 6) + (seed >> 2));
+}
+
+// XORs of the (1, 1) direction numbers of the second Sobol dimension for every value of each byte of the index.
+struct sobol_byte_tables {
+	std::uint32_t entries[4][256];
+
+	sobol_byte_tables() {
+
+		std::uint32_t directions[32];
+		directions[0] = 1u << 31;
+		for (int bit = 1; bit < 32; ++bit) {
+
+			directions[bit] = directions[bit - 1] ^ (directions[bit - 1] >> 1);
+		}
+
+		for (int byte = 0; byte < 4; ++byte) {
+
+			for (std::uint32_t value = 0; value < 256; ++value) {
+
+				std::uint32_t sum = 0;
+				for (int bit = 0; bit < 8; ++bit) {
+
+					if (value & (1u << bit)) {
+
+						sum ^= directions[8 * byte + bit];
+					}
+				}
+				entries[byte][value] = sum;
+			}
+		}
+	}
+};
+
+static const sobol_byte_tables sobol_tables;
+
+// The second Sobol dimension of sample index; the first is the van der Corput sequence, reverse_bits(index).
+static std::uint32_t sobol_second(std::uint32_t index) {
+
+	return sobol_tables.entries[0][index & 0xff] ^ sobol_tables.entries[1][(index >> 8) & 0xff]
+		^ sobol_tables.entries[2][(index >> 16) & 0xff] ^ sobol_tables.entries[3][index >> 24];
+}
+
+// Owen-scrambled and shuffled Sobol point number index for the stream picked by seed, one or both dimensions.
+static std::uint32_t scrambled_sobol_1d(std::uint32_t index, std::uint32_t seed) {
+
+	return nested_uniform_scramble(reverse_bits(nested_uniform_scramble(index, seed)), hash_combine(seed, 0));
+}
+
+static void scrambled_sobol_2d(std::uint32_t index, std::uint32_t seed, std::uint32_t& first, std::uint32_t& second) {
+
+	const std::uint32_t shuffled = nested_uniform_scramble(index, seed);
+	first = nested_uniform_scramble(reverse_bits(shuffled), hash_combine(seed, 0));
+	second = nested_uniform_scramble(sobol_second(shuffled), hash_combine(seed, 1));
+}
+
+sobol_sampler::sobol_sampler(std::uint64_t seed) : frame_seed{ seed } {}
+
+double sobol_sampler::get_1d(int x, int y, std::uint32_t index, std::uint32_t dimension) const {
+
+	return to_unit(scrambled_sobol_1d(index, hash_seed(frame_seed, pixel_key(x, y), dimension)));
+}
+
+void sobol_sampler::get_2d(int x, int y, std::uint32_t index, std::uint32_t dimension, double& u, double& v) const {
+
+	std::uint32_t first, second;
+	scrambled_sobol_2d(index, hash_seed(frame_seed, pixel_key(x, y), dimension), first, second);
+	u = to_unit(first);
+	v = to_unit(second);
+}
+
+// Adds (on) or removes the Gaussian footprint of point p of the pattern to the energy of every pixel, toroidally.
+static void toggle_point(std::vector<std::uint8_t>& pattern, std::vector<double>& energy, const std::vector<double>& kernel,
+	int size, int p, bool on) {
+
+	pattern[p] = on ? 1 : 0;
+	const double sign = on ? 1 : -1;
+	const int px = p % size;
+	const int py = p / size;
+	for (int y = 0; y < size; ++y) {
+
+		const int dy = (y - py + size) % size;
+		for (int x = 0; x < size; ++x) {
+
+			const int dx = (x - px + size) % size;
+			energy[y * size + x] += sign * kernel[dy * size + dx];
+		}
+	}
+}
+
+// The set point with the most energy (tightest cluster), or the empty one with the least (largest void).
+static int extreme_point(const std::vector<std::uint8_t>& pattern, const std::vector<double>& energy, bool cluster) {
+
+	int best = -1;
+	for (int p = 0; p < static_cast<int>(pattern.size()); ++p) {
+
+		if ((pattern[p] != 0) != cluster) {
+
+			continue;
+		}
+		if (best < 0 || (cluster ? energy[p] > energy[best] : energy[p] < energy[best])) {
+
+			best = p;
+		}
+	}
+
+	return best;
+}
+
+/*
+	Ulichney's void-and-cluster method: relax a random initial pattern until its tightest cluster is its
+	largest void, rank its points by removing tightest clusters, then rank the rest by filling largest voids.
+	The energy is a Gaussian with sigma 1.5 on the torus, so the mask tiles seamlessly.
+*/
+static std::vector<float> build_blue_noise_mask(int size) {
+
+	const int n = size * size;
+	std::vector<double> kernel(n);
+	for (int y = 0; y < size; ++y) {
+
+		for (int x = 0; x < size; ++x) {
+
+			const int dx = std::min(x, size - x);
+			const int dy = std::min(y, size - y);
+			kernel[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2 * 1.5 * 1.5));
+		}
+	}
+
+	std::vector<std::uint8_t> pattern(n, 0);
+	std::vector<double> energy(n, 0);
+	random_engine rng(0x626c7565ull, 0);
+	int ones = 0;
+	while (ones < n / 10) {
+
+		const int p = static_cast<int>(rng.next_double() * n);
+		if (!pattern[p]) {
+
+			toggle_point(pattern, energy, kernel, size, p, true);
+			++ones;
+		}
+	}
+
+	while (true) {
+
+		const int cluster = extreme_point(pattern, energy, true);
+		toggle_point(pattern, energy, kernel, size, cluster, false);
+		const int void_point = extreme_point(pattern, energy, false);
+		toggle_point(pattern, energy, kernel, size, void_point, true);
+		if (void_point == cluster) {
+
+			break;
+		}
+	}
+
+	std::vector<int> rank(n, 0);
+	auto removing = pattern;
+	auto removing_energy = energy;
+	for (int r = ones - 1; r >= 0; --r) {
+
+		const int cluster = extreme_point(removing, removing_energy, true);
+		rank[cluster] = r;
+		toggle_point(removing, removing_energy, kernel, size, cluster, false);
+	}
+
+	for (int r = ones; r < n; ++r) {
+
+		const int void_point = extreme_point(pattern, energy, false);
+		rank[void_point] = r;
+		toggle_point(pattern, energy, kernel, size, void_point, true);
+	}
+
+	std::vector<float> mask(n);
+	for (int p = 0; p < n; ++p) {
+
+		mask[p] = static_cast<float>(rank[p]) / static_cast<float>(n);
+	}
+	return mask;
+}
+
+const std::vector<float>& blue_noise_sampler::mask() {
+
+	static const std::vector<float> ranks = build_blue_noise_mask(mask_size);
+	return ranks;
+}
+
+blue_noise_sampler::blue_noise_sampler(std::uint64_t seed) : frame_seed{ seed }, ranks{ mask() } {}
+
+double blue_noise_sampler::rotation(int x, int y, std::uint32_t dimension) const {
+
+	const std::uint32_t offset = hash_seed(frame_seed, dimension, 0x6d61736bull);
+	const int mx = (x + static_cast<int>(offset & (mask_size - 1))) & (mask_size - 1);
+	const int my = (y + static_cast<int>((offset >> 8) & (mask_size - 1))) & (mask_size - 1);
+	return ranks[my * mask_size + mx];
+}
+
+static double wrap_add(double a, double b) {
+
+	const double sum = a + b;
+	return sum >= 1 ? sum - 1 : sum;
+}
+
+double blue_noise_sampler::get_1d(int x, int y, std::uint32_t index, std::uint32_t dimension) const {
+
+	return wrap_add(to_unit(scrambled_sobol_1d(index, hash_seed(frame_seed, 0, dimension))), rotation(x, y, dimension));
+}
+
+void blue_noise_sampler::get_2d(int x, int y, std::uint32_t index, std::uint32_t dimension, double& u, double& v) const {
+
+	std::uint32_t first, second;
+	scrambled_sobol_2d(index, hash_seed(frame_seed, 0, dimension), first, second);
+	u = wrap_add(to_unit(first), rotation(x, y, dimension));
+	v = wrap_add(to_unit(second), rotation(x, y, dimension + 1));
+}
+
+std::unique_ptr<sampler> make_sampler(sampler_type type, int samples_per_pixel, std::uint64_t seed) {
+
+	switch (type) {
+	case sampler_type::stratified: return std::make_unique<stratified_sampler>(samples_per_pixel, seed);
+	case sampler_type::sobol: return std::make_unique<sobol_sampler>(seed);
+	case sampler_type::blue_noise: return std::make_unique<blue_noise_sampler>(seed);
+	case sampler_type::independent:
+	default: return nullptr;
+	}
+}
+
+// Frisvad's orthonormal basis as revised by Duff et al., without a branch on the normal.
+static void tangent_frame(const vec3& n, vec3& b1, vec3& b2) {
+
+	const real sign = std::copysign(real(1), n.z());
+	const real a = -1 / (sign + n.z());
+	const real b = n.x() * n.y() * a;
+	b1 = vec3(1 + sign * n.x() * n.x() * a, sign * b, -sign * n.x());
+	b2 = vec3(b, sign + n.y() * n.y() * a, -n.y());
+}
+
+static vec3 to_world(real r, double v, real z, const vec3& normal) {
+
+	vec3 b1, b2;
+	tangent_frame(normal, b1, b2);
+	const double phi = 2 * pi * v;
+	return static_cast<real>(r * std::cos(phi)) * b1 + static_cast<real>(r * std::sin(phi)) * b2 + z * normal;
+}
+
+vec3 uniform_hemisphere(double u, double v, const vec3& normal) {
+
+	// 1 - u in (0, 1], so no direction lies in the surface itself.
+	const auto z = static_cast<real>(1 - u);
+	return to_world(std::sqrt(std::max(real(0), 1 - z * z)), v, z, normal);
+}
+
+vec3 cosine_hemisphere(double u, double v, const vec3& normal) {
+
+	const auto z = static_cast<real>(std::sqrt(1 - u));
+	return to_world(static_cast<real>(std::sqrt(u)), v, z, normal);
+}
+
+// Samples per block of uniforms, small enough for the stack.
+static const std::size_t batch_block = 256;
+
+void sample_unit_vectors(random_engine& rng, std::size_t count, real* x, real* y, real* z) {
+
+	double draws[2 * batch_block];
+	for (std::size_t first = 0; first < count; first += batch_block) {
+
+		const std::size_t n = std::min(batch_block, count - first);
+		rng.fill(draws, 2 * n);
+		for (std::size_t i = 0; i < n; ++i) {
+
+			const vec3 p = map_unit_vector(draws[2 * i], draws[2 * i + 1]);
+			x[first + i] = p.x();
+			y[first + i] = p.y();
+			z[first + i] = p.z();
+		}
+	}
+}
+
+void sample_in_unit_spheres(random_engine& rng, std::size_t count, real* x, real* y, real* z) {
+
+	double draws[5 * batch_block];
+	for (std::size_t first = 0; first < count; first += batch_block) {
+
+		const std::size_t n = std::min(batch_block, count - first);
+		rng.fill(draws, 5 * n);
+		for (std::size_t i = 0; i < n; ++i) {
+
+			const double* d = draws + 5 * i;
+			const vec3 p = map_in_unit_sphere(d[0], d[1], d[2], d[3], d[4]);
+			x[first + i] = p.x();
+			y[first + i] = p.y();
+			z[first + i] = p.z();
+		}
+	}
+}
+
+void sample_in_unit_disks(random_engine& rng, std::size_t count, real* x, real* y) {
+
+	double draws[2 * batch_block];
+	for (std::size_t first = 0; first < count; first += batch_block) {
+
+		const std::size_t n = std::min(batch_block, count - first);
+		rng.fill(draws, 2 * n);
+		for (std::size_t i = 0; i < n; ++i) {
+
+			const vec3 p = map_in_unit_disk(draws[2 * i], draws[2 * i + 1]);
+			x[first + i] = p.x();
+			y[first + i] = p.y();
+		}
+	}
+}
+
+void sample_in_hemispheres(random_engine& rng, std::size_t count, const real* nx, const real* ny, const real* nz,
+	real* x, real* y, real* z) {
+
+	double draws[5 * batch_block];
+	for (std::size_t first = 0; first < count; first += batch_block) {
+
+		const std::size_t n = std::min(batch_block, count - first);
+		rng.fill(draws, 5 * n);
+		for (std::size_t i = 0; i < n; ++i) {
+
+			const double* d = draws + 5 * i;
+			const vec3 p = map_in_unit_sphere(d[0], d[1], d[2], d[3], d[4]);
+			const std::size_t k = first + i;
+			const real side = std::copysign(real(1), p.x() * nx[k] + p.y() * ny[k] + p.z() * nz[k]);
+			x[k] = side * p.x();
+			y[k] = side * p.y();
+			z[k] = side * p.z();
+		}
+	}
+}
\ No newline at end of file
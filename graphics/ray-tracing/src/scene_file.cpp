@@ -0,0 +1,518 @@
+#include "scene_file.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+#include "bvh.hpp"
+#include "instance.hpp"
+#include "json.hpp"
+#include "sphere.hpp"
+
+static const char scene_magic[8] = { 'R', 'T', 'S', 'C', 'E', 'N', 'E', '1' };
+static const std::uint32_t scene_version = 1;
+static const std::uint32_t byte_order_mark = 0x01020304;
+static const std::size_t section_alignment = 64;
+
+struct scene_file_header {
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t byte_order;    // byte_order_mark as written
+	std::uint32_t real_size;     // sizeof(real)
+	std::uint32_t vec3_size;     // sizeof(vec3), differs with RT_VEC3_PADDED
+	std::uint32_t node_size;     // sizeof(bvh_node::linear_node)
+	std::uint32_t material_size; // sizeof(material_record)
+	std::uint64_t sphere_count;
+	std::uint64_t sphere_stride; // entries per sphere array, sphere_count plus padding
+	std::uint64_t material_count;
+	std::uint64_t node_count;
+	std::uint64_t spheres_offset;
+	std::uint64_t material_ids_offset;
+	std::uint64_t materials_offset;
+	std::uint64_t nodes_offset;
+	double camera[12];           // lookfrom, lookat, vup, vfov, distance of the projection plane, aperture
+};
+
+static_assert(sizeof(scene_file_header) == 192, "the scene file header layout is fixed");
+
+static std::uint64_t align_up(std::uint64_t offset) {
+
+	return (offset + section_alignment - 1) / section_alignment * section_alignment;
+}
+
+static void write_section(std::vector<std::uint8_t>& out, std::uint64_t offset, const void* data, std::size_t size) {
+
+	out.resize(static_cast<std::size_t>(offset), 0);
+	const auto* bytes = static_cast<const std::uint8_t*>(data);
+	out.insert(out.end(), bytes, bytes + size);
+}
+
+std::vector<std::uint8_t> encode_scene_file(const scene_description& scene, int bvh_leaf_size) {
+
+	if (scene.material_ids.size() != scene.world.objects.size()) {
+
+		throw std::invalid_argument("write_scene_file: every object needs a material id");
+	}
+	for (const auto id : scene.material_ids) {
+
+		if (id >= scene.materials.size()) {
+
+			throw std::invalid_argument("write_scene_file: material id out of range");
+		}
+	}
+
+	const bvh_node tree(scene.world, bvh_leaf_size);
+	const auto& stats = tree.build_stats();
+	if (stats.sphere_leaves != stats.leaves) {
+
+		throw std::invalid_argument("write_scene_file: scene files can only hold spheres");
+	}
+
+	const sphere_soa& spheres = tree.spheres();
+	const std::size_t sphere_count = spheres.size();
+	if (sphere_count == 0) {
+
+		throw std::invalid_argument("write_scene_file: the scene is empty");
+	}
+	const std::size_t stride = sphere_count + sphere_soa::padding_slots();
+
+	std::vector<std::uint32_t> ids(sphere_count);
+	for (std::size_t i = 0; i < sphere_count; ++i) {
+
+		ids[i] = scene.material_ids[tree.primitive_order()[i]];
+	}
+
+	scene_file_header header = {};
+	std::memcpy(header.magic, scene_magic, sizeof(scene_magic));
+	header.version = scene_version;
+	header.byte_order = byte_order_mark;
+	header.real_size = sizeof(real);
+	header.vec3_size = sizeof(vec3);
+	header.node_size = sizeof(bvh_node::linear_node);
+	header.material_size = sizeof(material_record);
+	header.sphere_count = sphere_count;
+	header.sphere_stride = stride;
+	header.material_count = scene.materials.size();
+	header.node_count = tree.node_count();
+	header.spheres_offset = align_up(sizeof(header));
+	header.material_ids_offset = align_up(header.spheres_offset + 4 * stride * sizeof(real));
+	header.materials_offset = align_up(header.material_ids_offset + sphere_count * sizeof(std::uint32_t));
+	header.nodes_offset = align_up(header.materials_offset + scene.materials.size() * sizeof(material_record));
+
+	const auto& cam = scene.camera;
+	const double camera[12] = {
+		cam.lookfrom.x(), cam.lookfrom.y(), cam.lookfrom.z(),
+		cam.lookat.x(), cam.lookat.y(), cam.lookat.z(),
+		cam.vup.x(), cam.vup.y(), cam.vup.z(),
+		// The projection plane is the plane in focus, which describes every camera in the two numbers.
+		cam.vfov, cam.focus_distance > 0 ? cam.focus_distance : cam.focal_length, cam.aperture
+	};
+	std::memcpy(header.camera, camera, sizeof(camera));
+
+	std::vector<std::uint8_t> out;
+	out.reserve(static_cast<std::size_t>(header.nodes_offset + tree.node_count() * sizeof(bvh_node::linear_node)));
+	write_section(out, 0, &header, sizeof(header));
+	for (int component = 0; component < 4; ++component) {
+
+		write_section(out, header.spheres_offset + component * stride * sizeof(real), spheres.data(component), stride * sizeof(real));
+	}
+	write_section(out, header.material_ids_offset, ids.data(), ids.size() * sizeof(std::uint32_t));
+	write_section(out, header.materials_offset, scene.materials.data(), scene.materials.size() * sizeof(material_record));
+	write_section(out, header.nodes_offset, tree.node_data(), tree.node_count() * sizeof(bvh_node::linear_node));
+
+	return out;
+}
+
+void write_scene_file(const std::string& path, const scene_description& scene, int bvh_leaf_size) {
+
+	const auto bytes = encode_scene_file(scene, bvh_leaf_size);
+	std::ofstream out(path, std::ios::binary);
+	out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+	if (!out) {
+
+		throw std::runtime_error("cannot write " + path);
+	}
+}
+
+mapped_scene::mapped_scene(const std::string& path) :
+	file{ std::make_unique<mapped_file>(path) }
+{
+	open(file->data(), file->size(), path);
+}
+
+mapped_scene::mapped_scene(std::vector<std::uint8_t> bytes, const std::string& name) :
+	buffer{ std::move(bytes) }
+{
+	open(buffer.data(), buffer.size(), name);
+}
+
+void mapped_scene::open(const std::uint8_t* base, std::size_t size, const std::string& path) {
+
+	scene_file_header header;
+	if (size < sizeof(header)) {
+
+		throw std::runtime_error(path + " is not a scene file");
+	}
+	std::memcpy(&header, base, sizeof(header));
+
+	if (std::memcmp(header.magic, scene_magic, sizeof(scene_magic)) != 0 || header.version != scene_version) {
+
+		throw std::runtime_error(path + " is not a version " + std::to_string(scene_version) + " scene file");
+	}
+	if (header.byte_order != byte_order_mark || header.real_size != sizeof(real) || header.vec3_size != sizeof(vec3)
+		|| header.node_size != sizeof(bvh_node::linear_node) || header.material_size != sizeof(material_record)) {
+
+		throw std::runtime_error(path + " was written by a build with another byte order, real type or vec3 layout");
+	}
+
+	// Every section has to lie inside the file and be aligned, and whatever indexes into another section has to stay in it.
+	auto check_section = [&](std::uint64_t offset, std::uint64_t count, std::uint64_t element_size) {
+
+		if (offset % section_alignment != 0 || offset > size || count > (size - offset) / element_size) {
+
+			throw std::runtime_error(path + " is truncated or corrupt");
+		}
+	};
+	if (header.sphere_stride < header.sphere_count + sphere_soa::padding_slots() || header.sphere_stride > size) {
+
+		throw std::runtime_error(path + " is truncated or corrupt");
+	}
+	check_section(header.spheres_offset, 4 * header.sphere_stride, sizeof(real));
+	check_section(header.material_ids_offset, header.sphere_count, sizeof(std::uint32_t));
+	check_section(header.materials_offset, header.material_count, sizeof(material_record));
+	check_section(header.nodes_offset, header.node_count, sizeof(bvh_node::linear_node));
+
+	const auto* sphere_arrays = reinterpret_cast<const real*>(base + header.spheres_offset);
+	const auto stride = static_cast<std::size_t>(header.sphere_stride);
+	ids = reinterpret_cast<const std::uint32_t*>(base + header.material_ids_offset);
+	material_records = reinterpret_cast<const material_record*>(base + header.materials_offset);
+	materials_in_file = static_cast<std::size_t>(header.material_count);
+	const auto* nodes = reinterpret_cast<const bvh_node::linear_node*>(base + header.nodes_offset);
+
+	for (std::size_t i = 0; i < header.sphere_count; ++i) {
+
+		if (ids[i] >= materials_in_file) {
+
+			throw std::runtime_error(path + " is truncated or corrupt");
+		}
+	}
+	for (std::size_t i = 0; i < materials_in_file; ++i) {
+
+		if (static_cast<std::uint32_t>(material_records[i].type) > static_cast<std::uint32_t>(material_type::emissive)) {
+
+			throw std::runtime_error(path + " is truncated or corrupt");
+		}
+	}
+	if (!bvh_node::valid_layout(nodes, static_cast<std::size_t>(header.node_count), static_cast<std::size_t>(header.sphere_count))) {
+
+		throw std::runtime_error(path + " is truncated or corrupt");
+	}
+	const auto spheres = sphere_soa::view(sphere_arrays, sphere_arrays + stride, sphere_arrays + 2 * stride, sphere_arrays + 3 * stride,
+		static_cast<std::size_t>(header.sphere_count), ids);
+
+	tree = std::make_unique<bvh_node>(nodes, static_cast<std::size_t>(header.node_count), spheres);
+
+	const double* c = header.camera;
+	view.lookfrom = point3(static_cast<real>(c[0]), static_cast<real>(c[1]), static_cast<real>(c[2]));
+	view.lookat = point3(static_cast<real>(c[3]), static_cast<real>(c[4]), static_cast<real>(c[5]));
+	view.vup = vec3(static_cast<real>(c[6]), static_cast<real>(c[7]), static_cast<real>(c[8]));
+	view.vfov = static_cast<real>(c[9]);
+	view.focal_length = static_cast<real>(c[10]);
+	view.aperture = static_cast<real>(c[11]);
+}
+
+bool mapped_scene::hit(const ray& r, real t_min, real t_max, hit_record& rec) const {
+
+	return tree->hit(r, t_min, t_max, rec);
+}
+
+bool mapped_scene::intersect(const ray& r, real t_min, real t_max, hit_record& rec) const {
+
+	return tree->intersect(r, t_min, t_max, rec);
+}
+
+bool mapped_scene::occluded(const ray& r, real t_min, real t_max) const {
+
+	return tree->occluded(r, t_min, t_max);
+}
+
+bool mapped_scene::bounding_box(aabb& output_box) const {
+
+	return tree->bounding_box(output_box);
+}
+
+const camera_settings& mapped_scene::camera() const {
+
+	return view;
+}
+
+const bvh_node& mapped_scene::bvh() const {
+
+	return *tree;
+}
+
+std::size_t mapped_scene::sphere_count() const {
+
+	return tree->spheres().size();
+}
+
+const material_record* mapped_scene::materials() const {
+
+	return material_records;
+}
+
+std::size_t mapped_scene::material_count() const {
+
+	return materials_in_file;
+}
+
+const std::uint32_t* mapped_scene::material_ids() const {
+
+	return ids;
+}
+
+material_table mapped_scene::copy_materials() const {
+
+	return material_table(std::vector<material_record>(material_records, material_records + materials_in_file));
+}
+
+static real json_real(const json_value& value) {
+
+	return static_cast<real>(value.as_number());
+}
+
+static vec3 json_vec3(const json_value& value) {
+
+	const auto& e = value.as_array();
+	if (e.size() != 3) {
+
+		throw std::runtime_error("scene: expected a vector of 3 numbers");
+	}
+
+	return vec3(json_real(e[0]), json_real(e[1]), json_real(e[2]));
+}
+
+static material_record json_material(const json_value& value) {
+
+	material_record m;
+	const auto* type = value.find("type");
+	const std::string name = type ? type->as_string() : "lambertian";
+	if (name == "lambertian") {
+
+		m.type = material_type::lambertian;
+	}
+	else if (name == "metal") {
+
+		m.type = material_type::metal;
+		if (const auto* fuzz = value.find("fuzz")) m.parameter = static_cast<float>(fuzz->as_number());
+	}
+	else if (name == "dielectric") {
+
+		m.type = material_type::dielectric;
+		m.albedo[0] = m.albedo[1] = m.albedo[2] = 1;
+		m.parameter = 1.5f;
+		if (const auto* ior = value.find("ior")) m.parameter = static_cast<float>(ior->as_number());
+	}
+	else if (name == "emissive") {
+
+		m.type = material_type::emissive;
+		m.albedo[0] = m.albedo[1] = m.albedo[2] = 1;
+		m.parameter = 1;
+		if (const auto* intensity = value.find("intensity")) m.parameter = static_cast<float>(intensity->as_number());
+	}
+	else {
+
+		throw std::runtime_error("scene: unknown material type " + name);
+	}
+
+	if (const auto* albedo = value.find("albedo")) {
+
+		const auto a = json_vec3(*albedo);
+		m.albedo[0] = static_cast<float>(a.x());
+		m.albedo[1] = static_cast<float>(a.y());
+		m.albedo[2] = static_cast<float>(a.z());
+	}
+
+	return m;
+}
+
+static void add_json_sphere(hittable_list& list, const json_value& value) {
+
+	const auto* center = value.find("center");
+	const auto* radius = value.find("radius");
+	if (!center || !radius) {
+
+		throw std::runtime_error("scene: a sphere needs a center and a radius");
+	}
+
+	list.emplace<sphere>(json_vec3(*center), json_real(*radius));
+}
+
+// Scale, then rotation, then translation, each optional.
+static affine_transform json_placement(const json_value& value) {
+
+	affine_transform placement;
+	if (const auto* scale = value.find("scale")) {
+
+		const vec3 factors = scale->type() == json_value::kind::number ? vec3(1, 1, 1) * json_real(*scale) : json_vec3(*scale);
+		placement = affine_transform::scaling(factors);
+	}
+	if (const auto* rotate = value.find("rotate")) {
+
+		const auto* axis = rotate->find("axis");
+		const auto* degrees = rotate->find("degrees");
+		if (!axis || !degrees) {
+
+			throw std::runtime_error("scene: a rotation needs an axis and degrees");
+		}
+		placement = affine_transform::rotation(json_vec3(*axis), json_real(*degrees)) * placement;
+	}
+	if (const auto* translate = value.find("translate")) {
+
+		placement = affine_transform::translation(json_vec3(*translate)) * placement;
+	}
+
+	return placement;
+}
+
+scene_description import_scene_json(const std::string& path) {
+
+	std::ifstream in(path, std::ios::binary);
+	if (!in) {
+
+		throw std::runtime_error("cannot read " + path);
+	}
+	const std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	const json_value document = parse_json(text);
+
+	scene_description scene{ hittable_list(std::make_shared<scene_arena>()), {}, {}, {}, {} };
+
+	if (const auto* cam = document.find("camera")) {
+
+		if (const auto* v = cam->find("lookfrom")) scene.camera.lookfrom = json_vec3(*v);
+		if (const auto* v = cam->find("lookat")) scene.camera.lookat = json_vec3(*v);
+		if (const auto* v = cam->find("vup")) scene.camera.vup = json_vec3(*v);
+		if (const auto* v = cam->find("vfov")) scene.camera.vfov = json_real(*v);
+		if (const auto* v = cam->find("focal_length")) scene.camera.focal_length = json_real(*v);
+		if (const auto* v = cam->find("aperture")) scene.camera.aperture = json_real(*v);
+		if (const auto* v = cam->find("focus_distance")) scene.camera.focus_distance = json_real(*v);
+	}
+
+	if (const auto* materials = document.find("materials")) {
+
+		for (const auto& m : materials->as_array()) {
+
+			scene.materials.push_back(json_material(m));
+		}
+	}
+	if (scene.materials.empty()) {
+
+		scene.materials.push_back(material_record());
+	}
+
+	auto material_id = [&](const json_value& object) {
+
+		const auto* material = object.find("material");
+		const double id = material ? material->as_number() : 0;
+		if (id < 0 || id >= static_cast<double>(scene.materials.size())) {
+
+			throw std::runtime_error("scene: material index out of range");
+		}
+		return static_cast<std::uint32_t>(id);
+	};
+
+	// Velocities are only kept if something moves, the world's objects get a zero velocity each until then.
+	auto add_velocity = [&](const json_value& object) {
+
+		const auto* velocity = object.find("velocity");
+		if (velocity && scene.velocities.empty()) {
+
+			scene.velocities.assign(scene.world.objects.size() - 1, vec3(0, 0, 0));
+		}
+		if (!scene.velocities.empty()) {
+
+			scene.velocities.push_back(velocity ? json_vec3(*velocity) : vec3(0, 0, 0));
+		}
+	};
+
+	if (const auto* spheres = document.find("spheres")) {
+
+		const auto& list = spheres->as_array();
+		scene.world.reserve(list.size());
+		for (const auto& s : list) {
+
+			add_json_sphere(scene.world, s);
+			scene.material_ids.push_back(material_id(s));
+			add_velocity(s);
+		}
+	}
+
+	// Every prototype gets a BVH of its own, which all of its instances share.
+	std::vector<shared_ptr<bvh_node>> prototypes;
+	if (const auto* list = document.find("prototypes")) {
+
+		for (const auto& p : list->as_array()) {
+
+			const auto* spheres = p.find("spheres");
+			if (!spheres || spheres->as_array().empty()) {
+
+				throw std::runtime_error("scene: a prototype needs spheres");
+			}
+			hittable_list shape;
+			for (const auto& s : spheres->as_array()) {
+
+				add_json_sphere(shape, s);
+			}
+			prototypes.push_back(std::make_shared<bvh_node>(shape));
+		}
+	}
+
+	if (const auto* instances = document.find("instances")) {
+
+		for (const auto& i : instances->as_array()) {
+
+			const auto* prototype = i.find("prototype");
+			const double index = prototype ? prototype->as_number() : -1;
+			if (index < 0 || index >= static_cast<double>(prototypes.size())) {
+
+				throw std::runtime_error("scene: an instance needs the index of a prototype");
+			}
+
+			try {
+
+				scene.world.add(std::make_shared<instance>(prototypes[static_cast<std::size_t>(index)], json_placement(i)));
+			}
+			catch (const std::invalid_argument& e) {
+
+				throw std::runtime_error(std::string("scene: ") + e.what());
+			}
+			scene.material_ids.push_back(material_id(i));
+			add_velocity(i);
+		}
+	}
+
+	bind_materials(scene);
+	return scene;
+}
+
+static bool ends_with(const std::string& s, const std::string& suffix) {
+
+	return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool is_binary_scene_path(const std::string& path) {
+
+	return ends_with(path, ".rtscene");
+}
+
+scene_description load_scene(const std::string& name_or_path) {
+
+	if (ends_with(name_or_path, ".json")) {
+
+		return import_scene_json(name_or_path);
+	}
+
+	return make_scene(name_or_path, 0);
+}
\ No newline at end of file
@@ -0,0 +1,221 @@
+#include "scenes.hpp"
+
+#include <stdexcept>
+
+#include "bvh.hpp"
+#include "instance.hpp"
+#include "sphere.hpp"
+
+static material_record make_material(material_type type, const color& albedo, real parameter = 0) {
+
+	material_record m;
+	m.type = type;
+	m.albedo[0] = static_cast<float>(albedo.x());
+	m.albedo[1] = static_cast<float>(albedo.y());
+	m.albedo[2] = static_cast<float>(albedo.z());
+	m.parameter = static_cast<float>(parameter);
+
+	return m;
+}
+
+static void add_sphere(scene_description& scene, const point3& center, real radius, const material_record& material) {
+
+	scene.world.emplace<sphere>(center, radius);
+	scene.material_ids.push_back(static_cast<std::uint32_t>(scene.materials.size()));
+	scene.materials.push_back(material);
+}
+
+static scene_description basic_scene() {
+
+	const auto gray = make_material(material_type::lambertian, color(real(0.5), real(0.5), real(0.5)));
+
+	scene_description scene;
+	scene.materials.push_back(gray);
+	scene.world.emplace<sphere>(point3(0, 0, -1), real(0.5));
+	scene.world.emplace<sphere>(point3(0, -100.5, -1), real(100));
+	scene.material_ids = { 0, 0 };
+
+	return scene;
+}
+
+static scene_description random_spheres_scene(std::uint64_t seed) {
+
+	random_engine rng(seed, 0);
+
+	scene_description scene{ hittable_list(std::make_shared<scene_arena>()), {}, {}, {}, {} };
+	scene.camera.lookfrom = point3(13, 2, 3);
+	scene.camera.lookat = point3(0, 0, 0);
+	scene.camera.vfov = 20;
+
+	add_sphere(scene, point3(0, -1000, 0), real(1000), make_material(material_type::lambertian, color(real(0.5), real(0.5), real(0.5))));
+
+	for (int a = -11; a < 11; a++) {
+
+		for (int b = -11; b < 11; b++) {
+
+			const auto choose_mat = random_double(rng);
+			const auto x = a + 0.9 * random_double(rng);
+			const auto z = b + 0.9 * random_double(rng);
+			const point3 center(static_cast<real>(x), real(0.2), static_cast<real>(z));
+
+			if ((center - point3(4, real(0.2), 0)).length() <= real(0.9)) {
+
+				continue;
+			}
+
+			if (choose_mat < 0.8) {
+
+				const auto albedo = color::random(rng) * color::random(rng);
+				add_sphere(scene, center, real(0.2), make_material(material_type::lambertian, albedo));
+			}
+			else if (choose_mat < 0.95) {
+
+				const auto albedo = color::random(rng, 0.5, 1);
+				const auto fuzz = static_cast<real>(random_double(rng, 0, 0.5));
+				add_sphere(scene, center, real(0.2), make_material(material_type::metal, albedo, fuzz));
+			}
+			else {
+
+				add_sphere(scene, center, real(0.2), make_material(material_type::dielectric, color(1, 1, 1), real(1.5)));
+			}
+		}
+	}
+
+	add_sphere(scene, point3(0, 1, 0), real(1), make_material(material_type::dielectric, color(1, 1, 1), real(1.5)));
+	add_sphere(scene, point3(-4, 1, 0), real(1), make_material(material_type::lambertian, color(real(0.4), real(0.2), real(0.1))));
+	add_sphere(scene, point3(4, 1, 0), real(1), make_material(material_type::metal, color(real(0.7), real(0.6), real(0.5)), 0));
+
+	return scene;
+}
+
+static scene_description stress_scene(std::uint64_t seed) {
+
+	const int count = 1000000;
+	random_engine rng(seed, 0);
+
+	// A million primitives: one bump allocation each instead of a heap allocation with its own control block.
+	scene_description scene{ hittable_list(std::make_shared<scene_arena>()), {}, {}, {}, {} };
+	scene.materials.push_back(make_material(material_type::lambertian, color(real(0.5), real(0.5), real(0.5))));
+	scene.world.reserve(count);
+	for (int i = 0; i < count; ++i) {
+
+		const auto x = static_cast<real>(random_double(rng, -40, 40));
+		const auto y = static_cast<real>(random_double(rng, -20, 20));
+		const auto z = static_cast<real>(random_double(rng, -60, -5));
+		const auto radius = static_cast<real>(random_double(rng, 0.02, 0.08));
+		scene.world.emplace<sphere>(point3(x, y, z), radius);
+	}
+	scene.material_ids.assign(count, 0);
+
+	return scene;
+}
+
+static scene_description instances_scene(std::uint64_t seed) {
+
+	const int cluster_spheres = 200;
+	const int grid = 64;
+	random_engine rng(seed, 0);
+
+	// The asset: a cluster of spheres in the unit ball with its own BVH, the bottom level of every copy.
+	hittable_list cluster(std::make_shared<scene_arena>());
+	cluster.reserve(cluster_spheres);
+	for (int i = 0; i < cluster_spheres; ++i) {
+
+		const vec3 offset = static_cast<real>(0.85) * sample_in_unit_sphere(rng);
+		cluster.emplace<sphere>(offset, static_cast<real>(random_double(rng, 0.03, 0.12)));
+	}
+	const auto prototype = std::make_shared<bvh_node>(cluster);
+
+	scene_description scene;
+	scene.camera.lookfrom = point3(0, 4, 16);
+	scene.camera.lookat = point3(0, 0, 0);
+	scene.camera.vfov = 35;
+
+	add_sphere(scene, point3(0, -1000, 0), real(1000), make_material(material_type::lambertian, color(real(0.5), real(0.5), real(0.5))));
+	const std::uint32_t first_material = static_cast<std::uint32_t>(scene.materials.size());
+	scene.materials.push_back(make_material(material_type::lambertian, color(real(0.8), real(0.3), real(0.2))));
+	scene.materials.push_back(make_material(material_type::lambertian, color(real(0.2), real(0.5), real(0.8))));
+	scene.materials.push_back(make_material(material_type::metal, color(real(0.8), real(0.8), real(0.7)), real(0.1)));
+
+	// A grid of copies, each turned about the vertical and scaled.
+	scene.world.reserve(1 + grid * grid);
+	for (int a = 0; a < grid; ++a) {
+
+		for (int b = 0; b < grid; ++b) {
+
+			const auto scale = static_cast<real>(random_double(rng, 0.25, 0.45));
+			const auto angle = static_cast<real>(random_double(rng, 0, 360));
+			const point3 position(static_cast<real>(a - grid / 2) + real(0.5), scale, static_cast<real>(b - grid / 2) + real(0.5));
+			const auto placement = affine_transform::translation(position) * affine_transform::rotation(vec3(0, 1, 0), angle)
+				* affine_transform::scaling(vec3(scale, scale, scale));
+
+			scene.world.add(std::make_shared<instance>(prototype, placement));
+			scene.material_ids.push_back(first_material + static_cast<std::uint32_t>((a + b) % 3));
+		}
+	}
+
+	return scene;
+}
+
+static scene_description lit_scene() {
+
+	scene_description scene;
+	scene.camera.lookfrom = point3(0, real(2.5), 9);
+	scene.camera.lookat = point3(0, 1, 0);
+	scene.camera.vfov = 35;
+
+	// A dome around everything keeps the sky out, so all light comes from the small emitters.
+	const auto gray = make_material(material_type::lambertian, color(real(0.5), real(0.5), real(0.5)));
+	add_sphere(scene, point3(0, 0, 0), real(30), gray);
+	add_sphere(scene, point3(0, -1000, 0), real(1000), gray);
+
+	add_sphere(scene, point3(real(-2.5), 1, 0), real(1), make_material(material_type::lambertian, color(real(0.7), real(0.3), real(0.2))));
+	add_sphere(scene, point3(0, 1, 0), real(1), make_material(material_type::dielectric, color(1, 1, 1), real(1.5)));
+	add_sphere(scene, point3(real(2.5), 1, 0), real(1), make_material(material_type::metal, color(real(0.7), real(0.6), real(0.5)), real(0.05)));
+
+	add_sphere(scene, point3(-3, 4, 1), real(0.25), make_material(material_type::emissive, color(1, real(0.85), real(0.7)), 60));
+	add_sphere(scene, point3(3, real(3.5), -1), real(0.2), make_material(material_type::emissive, color(real(0.7), real(0.8), 1), 60));
+	add_sphere(scene, point3(0, real(0.3), 2), real(0.15), make_material(material_type::emissive, color(1, real(0.6), real(0.3)), 40));
+
+	return scene;
+}
+
+std::vector<std::string> scene_names() {
+
+	return { "basic", "random-spheres", "stress", "instances", "lit" };
+}
+
+scene_description make_scene(const std::string& name, std::uint64_t seed) {
+
+	scene_description scene;
+	if (name == "basic") scene = basic_scene();
+	else if (name == "random-spheres") scene = random_spheres_scene(seed);
+	else if (name == "stress") scene = stress_scene(seed);
+	else if (name == "instances") scene = instances_scene(seed);
+	else if (name == "lit") scene = lit_scene();
+	else throw std::invalid_argument("unknown scene " + name);
+
+	bind_materials(scene);
+	return scene;
+}
+
+void bind_materials(scene_description& scene) {
+
+	if (scene.material_ids.size() != scene.world.objects.size()) {
+
+		throw std::invalid_argument("bind_materials: every object needs a material id");
+	}
+
+	for (std::size_t i = 0; i < scene.world.objects.size(); ++i) {
+
+		auto* object = scene.world.objects[i].get();
+		if (auto* s = dynamic_cast<sphere*>(object)) {
+
+			s->material = scene.material_ids[i];
+		}
+		else if (auto* copy = dynamic_cast<instance*>(object)) {
+
+			copy->set_material(scene.material_ids[i]);
+		}
+	}
+}
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "sphere.hpp"
 
+#include "profiler.hpp"
+
 /*
 	For a point P = [x, y, z] of a vector to lie on a sphere with center C = [Cx, Cy, Cz] and radius r,
 	it must satisfy (x - Cx)^2 + (y - Cy)^2 + (z - Cz)^2 = r^2.
@@ -10,7 +12,9 @@
 	The vectors and r are constants and known, thus we can solve the quadratic for t,
 	and determine if the ray intersects the sphere at two points (two roots, discriminant > 0).
 */
-bool sphere::hit(const ray& r, double t_min, double t_max, hit_record& rec) const {
+bool sphere::nearest_root(const ray& r, real t_min, real t_max, real& root) const {
+
+	RT_PROFILE_ADD(sphere_tests, 1);
 
 	vec3 oc = r.origin() - center;
 
@@ -20,34 +24,80 @@ bool sphere::hit(const ray& r, double t_min, double t_max, hit_record& rec) cons
 	*/
 	auto a = r.direction().length_squared(); // equivalent to a = dot(r.direction(), r.direction());
 	auto half_b = dot(oc, r.direction()); // where b = 2.0 * dot(oc, r.direction());
-	auto c = oc.length_squared() - radius * radius; // equivalent to c = dot(oc, oc) - radius * radius
 
 	/*
-		Using half_b, we can extract the 4 from the discriminant square root term
-		in determining the roots. Also then we reduce the fraction by simplifying the 2 out.
-		We look for the nearest root in the acceptable [t_min, t_max] range.
+		The discriminant half_b^2 - a*c, with c = (A-C) * (A-C) - r^2, subtracts numbers of the size of the
+		squared distance to the sphere to get one of the size of r^2, and loses most of it in single precision
+		for small or distant spheres. Divided by a it equals r^2 - ||L||^2, where L = (A-C) - (half_b/a)b is
+		the vector from the center to the point of the ray closest to it, which is computed without that
+		cancellation. The roots are then -half_b/a -+ sqrt((r^2 - ||L||^2) / a).
 	*/
-	auto discriminant = half_b * half_b - a * c;
-	if (discriminant < 0) {
+	auto mid = half_b / a;
+	vec3 closest_offset = oc - mid * r.direction();
+	auto h = radius * radius - closest_offset.length_squared();
+	if (h < 0) {
 
 		return false;
 	}
 
-	auto sqrtd = sqrt(discriminant);
-	auto root = (-half_b - sqrtd) / a;
+	// We look for the nearest root in the acceptable [t_min, t_max] range.
+	auto half_chord = sqrt(h / a);
+	root = -mid - half_chord;
 	if (root < t_min || root > t_max) {
 
-		root = (-half_b + sqrtd) / a;
+		root = -mid + half_chord;
 		if (root < t_min || root > t_max) {
 
 			return false;
 		}
 	}
 
+	return true;
+}
+
+bool sphere::hit(const ray& r, real t_min, real t_max, hit_record& rec) const {
+
+	if (!intersect(r, t_min, t_max, rec)) {
+
+		return false;
+	}
+
+	finish_hit(r, rec);
+	return true;
+}
+
+bool sphere::intersect(const ray& r, real t_min, real t_max, hit_record& rec) const {
+
+	real root;
+	if (!nearest_root(r, t_min, t_max, root)) {
+
+		return false;
+	}
+
 	rec.t = root;
+	rec.object = this;
+	rec.primitive = 0;
+	return true;
+}
+
+void sphere::finish_hit(const ray& r, hit_record& rec) const {
+
 	rec.p = r.at(rec.t);
 	vec3 outward_normal = (rec.p - center) / radius;
 	rec.set_face_normal(r, outward_normal);
+	rec.material = material;
+}
+
+bool sphere::occluded(const ray& r, real t_min, real t_max) const {
+
+	real root;
+	return nearest_root(r, t_min, t_max, root);
+}
+
+bool sphere::bounding_box(aabb& output_box) const {
 
+	auto r = std::fabs(radius);
+	auto extent = vec3(r, r, r);
+	output_box = aabb(center - extent, center + extent);
 	return true;
 }
\ No newline at end of file
@@ -0,0 +1,577 @@
+#include "sphere_soa.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+#include "profiler.hpp"
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#define RT_SPHERE_AVX512
+#elif defined(__AVX2__) || defined(__AVX__)
+#include <immintrin.h>
+#define RT_SPHERE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RT_SPHERE_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define RT_SPHERE_NEON
+#endif
+
+/*
+	Every instruction set is wrapped into the same handful of operations,
+	so the intersection kernel below is written once and instantiated for whichever one the build targets.
+*/
+template <typename T>
+struct simd_ops;
+
+#if defined(RT_SPHERE_AVX512)
+template <>
+struct simd_ops<double> {
+	static constexpr int width = 8;
+	static constexpr const char* name = "AVX-512";
+	using packet = __m512d;
+	using mask = __mmask8;
+
+	static packet load(const double* p) { return _mm512_loadu_pd(p); }
+	static void store(double* p, packet v) { _mm512_storeu_pd(p, v); }
+	static packet set1(double v) { return _mm512_set1_pd(v); }
+	static packet lanes() { return _mm512_set_pd(7, 6, 5, 4, 3, 2, 1, 0); }
+	static packet add(packet a, packet b) { return _mm512_add_pd(a, b); }
+	static packet sub(packet a, packet b) { return _mm512_sub_pd(a, b); }
+	static packet mul(packet a, packet b) { return _mm512_mul_pd(a, b); }
+	static packet div(packet a, packet b) { return _mm512_div_pd(a, b); }
+	static packet sqrt(packet a) { return _mm512_sqrt_pd(a); }
+	static packet max(packet a, packet b) { return _mm512_max_pd(a, b); }
+	static mask ge(packet a, packet b) { return _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ); }
+	static mask le(packet a, packet b) { return _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ); }
+	static mask lt(packet a, packet b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+	static mask both(mask a, mask b) { return static_cast<mask>(a & b); }
+	static bool any(mask m) { return m != 0; }
+	static packet select(mask m, packet a, packet b) { return _mm512_mask_blend_pd(m, b, a); }
+};
+
+template <>
+struct simd_ops<float> {
+	static constexpr int width = 16;
+	static constexpr const char* name = "AVX-512";
+	using packet = __m512;
+	using mask = __mmask16;
+
+	static packet load(const float* p) { return _mm512_loadu_ps(p); }
+	static void store(float* p, packet v) { _mm512_storeu_ps(p, v); }
+	static packet set1(float v) { return _mm512_set1_ps(v); }
+	static packet lanes() { return _mm512_set_ps(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0); }
+	static packet add(packet a, packet b) { return _mm512_add_ps(a, b); }
+	static packet sub(packet a, packet b) { return _mm512_sub_ps(a, b); }
+	static packet mul(packet a, packet b) { return _mm512_mul_ps(a, b); }
+	static packet div(packet a, packet b) { return _mm512_div_ps(a, b); }
+	static packet sqrt(packet a) { return _mm512_sqrt_ps(a); }
+	static packet max(packet a, packet b) { return _mm512_max_ps(a, b); }
+	static mask ge(packet a, packet b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+	static mask le(packet a, packet b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+	static mask lt(packet a, packet b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+	static mask both(mask a, mask b) { return static_cast<mask>(a & b); }
+	static bool any(mask m) { return m != 0; }
+	static packet select(mask m, packet a, packet b) { return _mm512_mask_blend_ps(m, b, a); }
+};
+#elif defined(RT_SPHERE_AVX2)
+template <>
+struct simd_ops<double> {
+	static constexpr int width = 4;
+	static constexpr const char* name = "AVX2";
+	using packet = __m256d;
+	using mask = __m256d;
+
+	static packet load(const double* p) { return _mm256_loadu_pd(p); }
+	static void store(double* p, packet v) { _mm256_storeu_pd(p, v); }
+	static packet set1(double v) { return _mm256_set1_pd(v); }
+	static packet lanes() { return _mm256_set_pd(3, 2, 1, 0); }
+	static packet add(packet a, packet b) { return _mm256_add_pd(a, b); }
+	static packet sub(packet a, packet b) { return _mm256_sub_pd(a, b); }
+	static packet mul(packet a, packet b) { return _mm256_mul_pd(a, b); }
+	static packet div(packet a, packet b) { return _mm256_div_pd(a, b); }
+	static packet sqrt(packet a) { return _mm256_sqrt_pd(a); }
+	static packet max(packet a, packet b) { return _mm256_max_pd(a, b); }
+	static mask ge(packet a, packet b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+	static mask le(packet a, packet b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+	static mask lt(packet a, packet b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+	static mask both(mask a, mask b) { return _mm256_and_pd(a, b); }
+	static bool any(mask m) { return _mm256_movemask_pd(m) != 0; }
+	static packet select(mask m, packet a, packet b) { return _mm256_blendv_pd(b, a, m); }
+};
+
+template <>
+struct simd_ops<float> {
+	static constexpr int width = 8;
+	static constexpr const char* name = "AVX2";
+	using packet = __m256;
+	using mask = __m256;
+
+	static packet load(const float* p) { return _mm256_loadu_ps(p); }
+	static void store(float* p, packet v) { _mm256_storeu_ps(p, v); }
+	static packet set1(float v) { return _mm256_set1_ps(v); }
+	static packet lanes() { return _mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0); }
+	static packet add(packet a, packet b) { return _mm256_add_ps(a, b); }
+	static packet sub(packet a, packet b) { return _mm256_sub_ps(a, b); }
+	static packet mul(packet a, packet b) { return _mm256_mul_ps(a, b); }
+	static packet div(packet a, packet b) { return _mm256_div_ps(a, b); }
+	static packet sqrt(packet a) { return _mm256_sqrt_ps(a); }
+	static packet max(packet a, packet b) { return _mm256_max_ps(a, b); }
+	static mask ge(packet a, packet b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+	static mask le(packet a, packet b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+	static mask lt(packet a, packet b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static mask both(mask a, mask b) { return _mm256_and_ps(a, b); }
+	static bool any(mask m) { return _mm256_movemask_ps(m) != 0; }
+	static packet select(mask m, packet a, packet b) { return _mm256_blendv_ps(b, a, m); }
+};
+#elif defined(RT_SPHERE_SSE2)
+template <>
+struct simd_ops<double> {
+	static constexpr int width = 2;
+	static constexpr const char* name = "SSE2";
+	using packet = __m128d;
+	using mask = __m128d;
+
+	static packet load(const double* p) { return _mm_loadu_pd(p); }
+	static void store(double* p, packet v) { _mm_storeu_pd(p, v); }
+	static packet set1(double v) { return _mm_set1_pd(v); }
+	static packet lanes() { return _mm_set_pd(1, 0); }
+	static packet add(packet a, packet b) { return _mm_add_pd(a, b); }
+	static packet sub(packet a, packet b) { return _mm_sub_pd(a, b); }
+	static packet mul(packet a, packet b) { return _mm_mul_pd(a, b); }
+	static packet div(packet a, packet b) { return _mm_div_pd(a, b); }
+	static packet sqrt(packet a) { return _mm_sqrt_pd(a); }
+	static packet max(packet a, packet b) { return _mm_max_pd(a, b); }
+	static mask ge(packet a, packet b) { return _mm_cmpge_pd(a, b); }
+	static mask le(packet a, packet b) { return _mm_cmple_pd(a, b); }
+	static mask lt(packet a, packet b) { return _mm_cmplt_pd(a, b); }
+	static mask both(mask a, mask b) { return _mm_and_pd(a, b); }
+	static bool any(mask m) { return _mm_movemask_pd(m) != 0; }
+	static packet select(mask m, packet a, packet b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+};
+
+template <>
+struct simd_ops<float> {
+	static constexpr int width = 4;
+	static constexpr const char* name = "SSE2";
+	using packet = __m128;
+	using mask = __m128;
+
+	static packet load(const float* p) { return _mm_loadu_ps(p); }
+	static void store(float* p, packet v) { _mm_storeu_ps(p, v); }
+	static packet set1(float v) { return _mm_set1_ps(v); }
+	static packet lanes() { return _mm_set_ps(3, 2, 1, 0); }
+	static packet add(packet a, packet b) { return _mm_add_ps(a, b); }
+	static packet sub(packet a, packet b) { return _mm_sub_ps(a, b); }
+	static packet mul(packet a, packet b) { return _mm_mul_ps(a, b); }
+	static packet div(packet a, packet b) { return _mm_div_ps(a, b); }
+	static packet sqrt(packet a) { return _mm_sqrt_ps(a); }
+	static packet max(packet a, packet b) { return _mm_max_ps(a, b); }
+	static mask ge(packet a, packet b) { return _mm_cmpge_ps(a, b); }
+	static mask le(packet a, packet b) { return _mm_cmple_ps(a, b); }
+	static mask lt(packet a, packet b) { return _mm_cmplt_ps(a, b); }
+	static mask both(mask a, mask b) { return _mm_and_ps(a, b); }
+	static bool any(mask m) { return _mm_movemask_ps(m) != 0; }
+	static packet select(mask m, packet a, packet b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+};
+#elif defined(RT_SPHERE_NEON)
+template <>
+struct simd_ops<double> {
+	static constexpr int width = 2;
+	static constexpr const char* name = "NEON";
+	using packet = float64x2_t;
+	using mask = uint64x2_t;
+
+	static packet load(const double* p) { return vld1q_f64(p); }
+	static void store(double* p, packet v) { vst1q_f64(p, v); }
+	static packet set1(double v) { return vdupq_n_f64(v); }
+	static packet lanes() { const double l[2] = { 0, 1 }; return vld1q_f64(l); }
+	static packet add(packet a, packet b) { return vaddq_f64(a, b); }
+	static packet sub(packet a, packet b) { return vsubq_f64(a, b); }
+	static packet mul(packet a, packet b) { return vmulq_f64(a, b); }
+	static packet div(packet a, packet b) { return vdivq_f64(a, b); }
+	static packet sqrt(packet a) { return vsqrtq_f64(a); }
+	static packet max(packet a, packet b) { return vmaxq_f64(a, b); }
+	static mask ge(packet a, packet b) { return vcgeq_f64(a, b); }
+	static mask le(packet a, packet b) { return vcleq_f64(a, b); }
+	static mask lt(packet a, packet b) { return vcltq_f64(a, b); }
+	static mask both(mask a, mask b) { return vandq_u64(a, b); }
+	static bool any(mask m) { return (vgetq_lane_u64(m, 0) | vgetq_lane_u64(m, 1)) != 0; }
+	static packet select(mask m, packet a, packet b) { return vbslq_f64(m, a, b); }
+};
+
+template <>
+struct simd_ops<float> {
+	static constexpr int width = 4;
+	static constexpr const char* name = "NEON";
+	using packet = float32x4_t;
+	using mask = uint32x4_t;
+
+	static packet load(const float* p) { return vld1q_f32(p); }
+	static void store(float* p, packet v) { vst1q_f32(p, v); }
+	static packet set1(float v) { return vdupq_n_f32(v); }
+	static packet lanes() { const float l[4] = { 0, 1, 2, 3 }; return vld1q_f32(l); }
+	static packet add(packet a, packet b) { return vaddq_f32(a, b); }
+	static packet sub(packet a, packet b) { return vsubq_f32(a, b); }
+	static packet mul(packet a, packet b) { return vmulq_f32(a, b); }
+	static packet div(packet a, packet b) { return vdivq_f32(a, b); }
+	static packet sqrt(packet a) { return vsqrtq_f32(a); }
+	static packet max(packet a, packet b) { return vmaxq_f32(a, b); }
+	static mask ge(packet a, packet b) { return vcgeq_f32(a, b); }
+	static mask le(packet a, packet b) { return vcleq_f32(a, b); }
+	static mask lt(packet a, packet b) { return vcltq_f32(a, b); }
+	static mask both(mask a, mask b) { return vandq_u32(a, b); }
+	static bool any(mask m) { return vmaxvq_u32(m) != 0; }
+	static packet select(mask m, packet a, packet b) { return vbslq_f32(m, a, b); }
+};
+#else
+template <typename T>
+struct simd_ops {
+	static constexpr int width = 1;
+	static constexpr const char* name = "scalar";
+	using packet = T;
+	using mask = bool;
+
+	static packet load(const T* p) { return *p; }
+	static void store(T* p, packet v) { *p = v; }
+	static packet set1(T v) { return v; }
+	static packet lanes() { return 0; }
+	static packet add(packet a, packet b) { return a + b; }
+	static packet sub(packet a, packet b) { return a - b; }
+	static packet mul(packet a, packet b) { return a * b; }
+	static packet div(packet a, packet b) { return a / b; }
+	static packet sqrt(packet a) { return std::sqrt(a); }
+	static packet max(packet a, packet b) { return a > b ? a : b; }
+	static mask ge(packet a, packet b) { return a >= b; }
+	static mask le(packet a, packet b) { return a <= b; }
+	static mask lt(packet a, packet b) { return a < b; }
+	static mask both(mask a, mask b) { return a && b; }
+	static bool any(mask m) { return m; }
+	static packet select(mask m, packet a, packet b) { return m ? a : b; }
+};
+#endif
+
+using ops = simd_ops<real>;
+
+// Enough padding for the widest kernel, so that the array layout does not depend on the build flags.
+static const std::size_t padding = 16;
+
+sphere_soa sphere_soa::view(const real* center_x, const real* center_y, const real* center_z, const real* radii, std::size_t count,
+	const std::uint32_t* materials) {
+
+	sphere_soa result;
+	result.external[0] = center_x;
+	result.external[1] = center_y;
+	result.external[2] = center_z;
+	result.external[3] = radii;
+	result.external_materials = materials;
+	result.count = count;
+
+	return result;
+}
+
+const real* sphere_soa::data(int component) const {
+
+	if (external[0]) {
+
+		return external[component];
+	}
+
+	switch (component) {
+	case 0: return center_x.data();
+	case 1: return center_y.data();
+	case 2: return center_z.data();
+	default: return radii.data();
+	}
+}
+
+std::size_t sphere_soa::padding_slots() {
+
+	return padding;
+}
+
+void sphere_soa::reserve(std::size_t n) {
+
+	center_x.reserve(n + padding);
+	center_y.reserve(n + padding);
+	center_z.reserve(n + padding);
+	radii.reserve(n + padding);
+	materials.reserve(n);
+}
+
+void sphere_soa::clear() {
+
+	center_x.clear();
+	center_y.clear();
+	center_z.clear();
+	radii.clear();
+	materials.clear();
+	count = 0;
+	std::fill(std::begin(external), std::end(external), nullptr);
+	external_materials = nullptr;
+}
+
+void sphere_soa::add(const point3& center, real radius, std::uint32_t material) {
+
+	if (external[0]) {
+
+		throw std::logic_error("sphere_soa: a view cannot be modified");
+	}
+
+	center_x.resize(count);
+	center_y.resize(count);
+	center_z.resize(count);
+	radii.resize(count);
+
+	center_x.push_back(center.x());
+	center_y.push_back(center.y());
+	center_z.push_back(center.z());
+	radii.push_back(radius);
+	materials.push_back(material);
+	++count;
+
+	pad();
+}
+
+void sphere_soa::add_empty() {
+
+	// A NaN radius makes the discriminant NaN, which fails every comparison in the kernel.
+	add(point3(0, 0, 0), std::numeric_limits<real>::quiet_NaN());
+}
+
+void sphere_soa::set(std::size_t index, const point3& center, real radius) {
+
+	if (external[0]) {
+
+		throw std::logic_error("sphere_soa: a view cannot be modified");
+	}
+
+	center_x[index] = center.x();
+	center_y[index] = center.y();
+	center_z[index] = center.z();
+	radii[index] = radius;
+}
+
+void sphere_soa::set_material(std::size_t index, std::uint32_t material) {
+
+	if (external[0]) {
+
+		throw std::logic_error("sphere_soa: a view cannot be modified");
+	}
+
+	materials[index] = material;
+}
+
+void sphere_soa::pad() {
+
+	center_x.resize(count + padding, 0);
+	center_y.resize(count + padding, 0);
+	center_z.resize(count + padding, 0);
+	radii.resize(count + padding, std::numeric_limits<real>::quiet_NaN());
+}
+
+std::size_t sphere_soa::size() const {
+
+	return count;
+}
+
+point3 sphere_soa::center(std::size_t index) const {
+
+	return point3(data(0)[index], data(1)[index], data(2)[index]);
+}
+
+real sphere_soa::radius(std::size_t index) const {
+
+	return data(3)[index];
+}
+
+std::uint32_t sphere_soa::material(std::size_t index) const {
+
+	if (external[0]) {
+
+		return external_materials ? external_materials[index] : 0;
+	}
+	return materials[index];
+}
+
+bool sphere_soa::hit(const ray& r, real t_min, real t_max, hit_record& rec) const {
+
+	return hit_range(r, 0, count, t_min, t_max, rec);
+}
+
+bool sphere_soa::intersect(const ray& r, real t_min, real t_max, hit_record& rec) const {
+
+	return intersect_range(r, 0, count, t_min, t_max, rec);
+}
+
+bool sphere_soa::occluded(const ray& r, real t_min, real t_max) const {
+
+	return occluded_range(r, 0, count, t_min, t_max);
+}
+
+bool sphere_soa::bounding_box(aabb& output_box) const {
+
+	output_box = aabb();
+	for (std::size_t i = 0; i < count; ++i) {
+
+		if (!std::isnan(radius(i))) {
+
+			const auto rad = std::fabs(radius(i));
+			output_box.expand(center(i) - vec3(rad, rad, rad));
+			output_box.expand(center(i) + vec3(rad, rad, rad));
+		}
+	}
+
+	return !output_box.empty();
+}
+
+/*
+	The same quadratic as sphere::hit, in the same cancellation-free form, evaluated for simd_ops::width spheres per step.
+	Lanes that miss, or whose roots both fall outside [t_min, closest], carry +infinity,
+	so the nearest sphere of a step is the smallest lane, and a step is skipped cheaply when no lane hits.
+	An any-hit search returns the first lane in range instead of narrowing closest.
+	Returns the index of the sphere relative to first, or n for a miss.
+*/
+template <bool any_hit>
+static std::size_t find_sphere(const real* const arrays[4], const ray& r, std::size_t first, std::size_t n, real t_min, real t_max, real& t_hit) {
+
+	RT_PROFILE_ADD(packed_sphere_tests, n);
+
+	const int w = ops::width;
+
+	const auto origin = r.origin();
+	const auto direction = r.direction();
+	const real a = direction.length_squared();
+
+	const auto ox = ops::set1(origin.x());
+	const auto oy = ops::set1(origin.y());
+	const auto oz = ops::set1(origin.z());
+	const auto dx = ops::set1(direction.x());
+	const auto dy = ops::set1(direction.y());
+	const auto dz = ops::set1(direction.z());
+	const auto inv_a = ops::set1(1 / a);
+	const auto vt_min = ops::set1(t_min);
+	const auto zero = ops::set1(0);
+	const auto miss = ops::set1(infinity);
+	const auto lanes = ops::lanes();
+
+	const real* xs = arrays[0];
+	const real* ys = arrays[1];
+	const real* zs = arrays[2];
+	const real* rs = arrays[3];
+
+	real closest = t_max;
+	std::size_t closest_index = n;
+	alignas(64) real roots[16];
+
+	for (std::size_t base = 0; base < n; base += w) {
+
+		const std::size_t i = first + base;
+		const auto ocx = ops::sub(ox, ops::load(xs + i));
+		const auto ocy = ops::sub(oy, ops::load(ys + i));
+		const auto ocz = ops::sub(oz, ops::load(zs + i));
+		const auto rad = ops::load(rs + i);
+
+		const auto half_b = ops::add(ops::add(ops::mul(ocx, dx), ops::mul(ocy, dy)), ops::mul(ocz, dz));
+		const auto mid = ops::mul(half_b, inv_a);
+		const auto lx = ops::sub(ocx, ops::mul(mid, dx));
+		const auto ly = ops::sub(ocy, ops::mul(mid, dy));
+		const auto lz = ops::sub(ocz, ops::mul(mid, dz));
+		const auto l_sq = ops::add(ops::add(ops::mul(lx, lx), ops::mul(ly, ly)), ops::mul(lz, lz));
+		const auto h = ops::sub(ops::mul(rad, rad), l_sq);
+
+		// Lanes past the end of the range read padding or the next leaf's spheres and are masked out.
+		const auto live = ops::both(ops::ge(h, zero), ops::lt(lanes, ops::set1(static_cast<real>(n - base))));
+		if (!ops::any(live)) {
+
+			continue;
+		}
+
+		const auto vt_max = ops::set1(closest);
+		const auto half_chord = ops::sqrt(ops::mul(ops::max(h, zero), inv_a));
+		const auto near_root = ops::sub(ops::sub(zero, mid), half_chord);
+		const auto far_root = ops::add(ops::sub(zero, mid), half_chord);
+		const auto near_ok = ops::both(ops::ge(near_root, vt_min), ops::le(near_root, vt_max));
+		const auto far_ok = ops::both(ops::ge(far_root, vt_min), ops::le(far_root, vt_max));
+
+		auto root = ops::select(far_ok, far_root, miss);
+		root = ops::select(near_ok, near_root, root);
+		root = ops::select(live, root, miss);
+
+		ops::store(roots, root);
+		for (int lane = 0; lane < w; ++lane) {
+
+			// The first candidate may sit exactly on t_max, later ones have to be strictly closer.
+			const real t = roots[lane];
+			if (t != infinity && (closest_index == n ? t <= closest : t < closest)) {
+
+				closest = t;
+				closest_index = base + lane;
+				if (any_hit) {
+
+					t_hit = closest;
+					return closest_index;
+				}
+			}
+		}
+	}
+
+	t_hit = closest;
+	return closest_index;
+}
+
+bool sphere_soa::hit_range(const ray& r, std::size_t first, std::size_t n, real t_min, real t_max, hit_record& rec) const {
+
+	if (!intersect_range(r, first, n, t_min, t_max, rec)) {
+
+		return false;
+	}
+
+	finish_hit(r, rec);
+	return true;
+}
+
+bool sphere_soa::intersect_range(const ray& r, std::size_t first, std::size_t n, real t_min, real t_max, hit_record& rec) const {
+
+	const real* const arrays[4] = { data(0), data(1), data(2), data(3) };
+	real t;
+	const auto index = find_sphere<false>(arrays, r, first, n, t_min, t_max, t);
+	if (index == n) {
+
+		return false;
+	}
+
+	rec.t = t;
+	rec.object = this;
+	rec.primitive = static_cast<std::uint32_t>(first + index);
+	return true;
+}
+
+void sphere_soa::finish_hit(const ray& r, hit_record& rec) const {
+
+	rec.p = r.at(rec.t);
+	vec3 outward_normal = (rec.p - center(rec.primitive)) / radius(rec.primitive);
+	rec.set_face_normal(r, outward_normal);
+	rec.material = material(rec.primitive);
+}
+
+bool sphere_soa::occluded_range(const ray& r, std::size_t first, std::size_t n, real t_min, real t_max) const {
+
+	const real* const arrays[4] = { data(0), data(1), data(2), data(3) };
+	real t;
+	return find_sphere<true>(arrays, r, first, n, t_min, t_max, t) != n;
+}
+
+const char* sphere_soa::simd_backend() {
+
+	return ops::name;
+}
+
+int sphere_soa::simd_width() {
+
+	return ops::width;
+}
\ No newline at end of file
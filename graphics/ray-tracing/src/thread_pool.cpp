@@ -0,0 +1,160 @@
+#include "thread_pool.hpp"
+
+thread_pool::thread_pool(unsigned thread_count) {
+
+	if (thread_count == 0) {
+
+		thread_count = std::thread::hardware_concurrency();
+	}
+	if (thread_count == 0) {
+
+		thread_count = 1;
+	}
+
+	queues = std::vector<task_queue>(thread_count);
+	workers.reserve(thread_count);
+	for (unsigned i = 0; i < thread_count; ++i) {
+
+		workers.emplace_back(&thread_pool::worker_loop, this, i);
+	}
+}
+
+thread_pool::~thread_pool() {
+
+	{
+		std::lock_guard<std::mutex> lock(state_mutex);
+		stopping = true;
+	}
+	wake_workers.notify_all();
+
+	for (auto& worker : workers) {
+
+		worker.join();
+	}
+}
+
+unsigned thread_pool::size() const {
+
+	return static_cast<unsigned>(workers.size());
+}
+
+void thread_pool::parallel_for(std::size_t count, const task_function& task) {
+
+	if (count == 0) {
+
+		return;
+	}
+
+	std::lock_guard<std::mutex> submit(submit_mutex);
+
+	// The task has to be published before any index becomes visible,
+	// since a worker still stealing from the previous batch may pick up the new indices.
+	current_task.store(&task);
+	pending.store(count);
+
+	// Hand out contiguous ranges, so neighbouring tasks start out on the same worker.
+	const std::size_t queue_count = queues.size();
+	for (std::size_t w = 0; w < queue_count; ++w) {
+
+		std::lock_guard<std::mutex> lock(queues[w].mutex);
+		for (std::size_t i = count * w / queue_count; i < count * (w + 1) / queue_count; ++i) {
+
+			queues[w].tasks.push_back(i);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(state_mutex);
+		++generation;
+	}
+	wake_workers.notify_all();
+
+	std::exception_ptr error;
+	{
+		std::unique_lock<std::mutex> lock(state_mutex);
+		batch_done.wait(lock, [this] { return pending.load() == 0; });
+		error = first_error;
+		first_error = nullptr;
+	}
+
+	if (error) {
+
+		std::rethrow_exception(error);
+	}
+}
+
+void thread_pool::worker_loop(unsigned index) {
+
+	unsigned long long seen_generation = 0;
+	while (true) {
+
+		{
+			std::unique_lock<std::mutex> lock(state_mutex);
+			wake_workers.wait(lock, [&] { return stopping || generation != seen_generation; });
+			if (stopping) {
+
+				return;
+			}
+			seen_generation = generation;
+		}
+
+		std::size_t task;
+		while (pop_task(index, task)) {
+
+			run_task(task);
+		}
+	}
+}
+
+bool thread_pool::pop_task(unsigned index, std::size_t& task) {
+
+	// Own work is taken from the front...
+	{
+		auto& own = queues[index];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.tasks.empty()) {
+
+			task = own.tasks.front();
+			own.tasks.pop_front();
+			return true;
+		}
+	}
+
+	// ...while stolen work is taken from the back, the part the owner would reach last.
+	const std::size_t queue_count = queues.size();
+	for (std::size_t k = 1; k < queue_count; ++k) {
+
+		auto& victim = queues[(index + k) % queue_count];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty()) {
+
+			task = victim.tasks.back();
+			victim.tasks.pop_back();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void thread_pool::run_task(std::size_t task) {
+
+	try {
+
+		(*current_task.load())(task);
+	}
+	catch (...) {
+
+		std::lock_guard<std::mutex> lock(state_mutex);
+		if (!first_error) {
+
+			first_error = std::current_exception();
+		}
+	}
+
+	if (pending.fetch_sub(1) == 1) {
+
+		std::lock_guard<std::mutex> lock(state_mutex);
+		batch_done.notify_all();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "transform.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+affine_transform::affine_transform() {
+
+	for (int i = 0; i < 3; ++i) {
+
+		for (int j = 0; j < 4; ++j) {
+
+			m[i][j] = i == j ? real(1) : real(0);
+		}
+	}
+}
+
+affine_transform affine_transform::translation(const vec3& offset) {
+
+	affine_transform t;
+	for (int i = 0; i < 3; ++i) {
+
+		t.m[i][3] = offset[i];
+	}
+	return t;
+}
+
+affine_transform affine_transform::scaling(const vec3& factors) {
+
+	affine_transform t;
+	for (int i = 0; i < 3; ++i) {
+
+		t.m[i][i] = factors[i];
+	}
+	return t;
+}
+
+affine_transform affine_transform::rotation(const vec3& axis, real degrees) {
+
+	const double length = axis.length();
+	if (!(length > 0)) {
+
+		throw std::invalid_argument("affine_transform: the rotation axis has no length");
+	}
+
+	// Rodrigues' formula: R = cos I + sin [a]x + (1 - cos) a a^T.
+	const double a[3] = { axis.x() / length, axis.y() / length, axis.z() / length };
+	const double angle = degrees_to_radians(degrees);
+	const double c = std::cos(angle);
+	const double s = std::sin(angle);
+	const double cross[3][3] = { { 0, -a[2], a[1] }, { a[2], 0, -a[0] }, { -a[1], a[0], 0 } };
+
+	affine_transform t;
+	for (int i = 0; i < 3; ++i) {
+
+		for (int j = 0; j < 3; ++j) {
+
+			t.m[i][j] = static_cast<real>((i == j ? c : 0) + s * cross[i][j] + (1 - c) * a[i] * a[j]);
+		}
+	}
+	return t;
+}
+
+affine_transform affine_transform::operator*(const affine_transform& other) const {
+
+	affine_transform t;
+	for (int i = 0; i < 3; ++i) {
+
+		for (int j = 0; j < 4; ++j) {
+
+			real sum = j == 3 ? m[i][3] : real(0);
+			for (int k = 0; k < 3; ++k) {
+
+				sum += m[i][k] * other.m[k][j];
+			}
+			t.m[i][j] = sum;
+		}
+	}
+	return t;
+}
+
+affine_transform affine_transform::inverse() const {
+
+	double a[3][3];
+	for (int i = 0; i < 3; ++i) {
+
+		for (int j = 0; j < 3; ++j) {
+
+			a[i][j] = m[i][j];
+		}
+	}
+
+	// The inverse of A is its adjugate over the determinant; the offset becomes -A^-1 b.
+	double adjugate[3][3];
+	for (int i = 0; i < 3; ++i) {
+
+		for (int j = 0; j < 3; ++j) {
+
+			const int r0 = (j + 1) % 3, r1 = (j + 2) % 3;
+			const int c0 = (i + 1) % 3, c1 = (i + 2) % 3;
+			adjugate[i][j] = a[r0][c0] * a[r1][c1] - a[r0][c1] * a[r1][c0];
+		}
+	}
+	const double determinant = a[0][0] * adjugate[0][0] + a[0][1] * adjugate[1][0] + a[0][2] * adjugate[2][0];
+	if (!(std::fabs(determinant) > 1e-300) || !std::isfinite(determinant)) {
+
+		throw std::invalid_argument("affine_transform: the transform is singular");
+	}
+
+	affine_transform t;
+	for (int i = 0; i < 3; ++i) {
+
+		double offset = 0;
+		for (int j = 0; j < 3; ++j) {
+
+			const double entry = adjugate[i][j] / determinant;
+			t.m[i][j] = static_cast<real>(entry);
+			offset -= entry * m[j][3];
+		}
+		t.m[i][3] = static_cast<real>(offset);
+	}
+	return t;
+}
+
+point3 affine_transform::point(const point3& p) const {
+
+	return point3(
+		m[0][0] * p.x() + m[0][1] * p.y() + m[0][2] * p.z() + m[0][3],
+		m[1][0] * p.x() + m[1][1] * p.y() + m[1][2] * p.z() + m[1][3],
+		m[2][0] * p.x() + m[2][1] * p.y() + m[2][2] * p.z() + m[2][3]);
+}
+
+vec3 affine_transform::vector(const vec3& v) const {
+
+	return vec3(
+		m[0][0] * v.x() + m[0][1] * v.y() + m[0][2] * v.z(),
+		m[1][0] * v.x() + m[1][1] * v.y() + m[1][2] * v.z(),
+		m[2][0] * v.x() + m[2][1] * v.y() + m[2][2] * v.z());
+}
+
+vec3 affine_transform::transposed_vector(const vec3& v) const {
+
+	return vec3(
+		m[0][0] * v.x() + m[1][0] * v.y() + m[2][0] * v.z(),
+		m[0][1] * v.x() + m[1][1] * v.y() + m[2][1] * v.z(),
+		m[0][2] * v.x() + m[1][2] * v.y() + m[2][2] * v.z());
+}
+
+aabb affine_transform::box(const aabb& b) const {
+
+	if (b.empty()) {
+
+		return b;
+	}
+
+	const point3 center = point(b.centroid());
+	const vec3 half = 0.5 * (b.maximum - b.minimum);
+	vec3 extent;
+	for (int i = 0; i < 3; ++i) {
+
+		extent.e[i] = std::fabs(m[i][0]) * half.x() + std::fabs(m[i][1]) * half.y() + std::fabs(m[i][2]) * half.z();
+	}
+	return aabb(center - extent, center + extent);
+}
\ No newline at end of file
@@ -0,0 +1,401 @@
+#include "wavefront.hpp"
+
+#include <algorithm>
+
+#include "integrator.hpp"
+#include "profiler.hpp"
+
+std::size_t path_queue::size() const {
+
+	return pixel.size();
+}
+
+void path_queue::reserve(std::size_t count) {
+
+	for (int a = 0; a < 3; ++a) {
+
+		origin[a].reserve(count);
+		direction[a].reserve(count);
+		throughput[a].reserve(count);
+		hit_point[a].reserve(count);
+		hit_normal[a].reserve(count);
+	}
+	pixel.reserve(count);
+	hit_t.reserve(count);
+	hit_material.reserve(count);
+	hit_front.reserve(count);
+	alive.reserve(count);
+}
+
+void path_queue::clear() {
+
+	for (int a = 0; a < 3; ++a) {
+
+		origin[a].clear();
+		direction[a].clear();
+		throughput[a].clear();
+		hit_point[a].clear();
+		hit_normal[a].clear();
+	}
+	pixel.clear();
+	hit_t.clear();
+	hit_material.clear();
+	hit_front.clear();
+	alive.clear();
+}
+
+void path_queue::push(const ray& r, std::uint32_t pixel_index) {
+
+	for (int a = 0; a < 3; ++a) {
+
+		origin[a].push_back(r.origin()[a]);
+		direction[a].push_back(r.direction()[a]);
+		throughput[a].push_back(1);
+		hit_point[a].push_back(0);
+		hit_normal[a].push_back(0);
+	}
+	pixel.push_back(pixel_index);
+	hit_t.push_back(static_cast<real>(infinity));
+	hit_material.push_back(0);
+	hit_front.push_back(0);
+	alive.push_back(1);
+}
+
+ray path_queue::path_ray(std::size_t i) const {
+
+	return ray(point3(origin[0][i], origin[1][i], origin[2][i]), vec3(direction[0][i], direction[1][i], direction[2][i]));
+}
+
+std::uint64_t intersect_paths(const hittable& world, path_queue& paths) {
+
+	const std::size_t n = paths.size();
+	for (std::size_t i = 0; i < n; ++i) {
+
+		const ray r = paths.path_ray(i);
+		hit_record rec;
+		if (!world.hit(r, surface_epsilon, infinity, rec)) {
+
+			paths.hit_t[i] = static_cast<real>(infinity);
+			continue;
+		}
+
+		paths.hit_t[i] = rec.t;
+		for (int a = 0; a < 3; ++a) {
+
+			paths.hit_point[a][i] = rec.p[a];
+			paths.hit_normal[a][i] = rec.normal[a];
+		}
+		paths.hit_material[i] = rec.material;
+		paths.hit_front[i] = rec.front_face ? 1 : 0;
+	}
+
+	return n;
+}
+
+void shade_paths(path_queue& paths, std::vector<wave_pixel>& pixels, const material_table* materials) {
+
+	const std::size_t n = paths.size();
+	for (std::size_t i = 0; i < n; ++i) {
+
+		const color throughput(paths.throughput[0][i], paths.throughput[1][i], paths.throughput[2][i]);
+		if (paths.hit_t[i] == infinity) {
+
+			pixels[paths.pixel[i]].radiance += throughput * sky_color(paths.path_ray(i));
+			paths.alive[i] = 0;
+			continue;
+		}
+
+		if (materials) {
+
+			const material_record& m = materials->get(paths.hit_material[i]);
+			if (m.type == material_type::emissive) {
+
+				pixels[paths.pixel[i]].radiance += throughput * emitted(m);
+			}
+			continue;
+		}
+
+		for (int a = 0; a < 3; ++a) {
+
+			paths.throughput[a][i] *= surface_albedo;
+		}
+	}
+}
+
+// The same survival test as path_integrator, on the throughput after the bounce. Ends the path if it fails.
+static void roulette_path(path_queue& paths, std::size_t i, random_engine& rng) {
+
+	const real survival = std::min(std::max({ paths.throughput[0][i], paths.throughput[1][i], paths.throughput[2][i] }), real(0.95));
+	if (survival <= 0 || random_double(rng) >= survival) {
+
+		paths.alive[i] = 0;
+		return;
+	}
+	// Multiplied by the reciprocal, as vec3::operator/= does.
+	const real inverse = 1 / survival;
+	for (int a = 0; a < 3; ++a) {
+
+		paths.throughput[a][i] *= inverse;
+	}
+}
+
+void bounce_paths(path_queue& paths, std::vector<wave_pixel>& pixels, bool roulette) {
+
+	const std::size_t n = paths.size();
+	for (std::size_t i = 0; i < n; ++i) {
+
+		if (!paths.alive[i]) {
+
+			continue;
+		}
+
+		auto& rng = pixels[paths.pixel[i]].rng;
+		const vec3 normal(paths.hit_normal[0][i], paths.hit_normal[1][i], paths.hit_normal[2][i]);
+		const vec3 direction = random_in_hemisphere(rng, normal);
+		for (int a = 0; a < 3; ++a) {
+
+			paths.origin[a][i] = paths.hit_point[a][i];
+			paths.direction[a][i] = direction[a];
+		}
+
+		if (roulette) {
+
+			roulette_path(paths, i, rng);
+		}
+	}
+}
+
+void scatter_paths(path_queue& paths, std::vector<wave_pixel>& pixels, const material_table& materials, bool roulette) {
+
+	// Ids past the table share the last bucket, they all read as the default material.
+	const std::size_t n = paths.size();
+	const std::size_t buckets = materials.size() + 1;
+	std::vector<std::uint32_t> offsets(buckets + 1, 0);
+	for (std::size_t i = 0; i < n; ++i) {
+
+		if (paths.alive[i]) {
+
+			++offsets[std::min<std::size_t>(paths.hit_material[i], buckets - 1) + 1];
+		}
+	}
+	for (std::size_t b = 1; b <= buckets; ++b) {
+
+		offsets[b] += offsets[b - 1];
+	}
+	std::vector<std::uint32_t> order(offsets[buckets]);
+	for (std::size_t i = 0; i < n; ++i) {
+
+		if (paths.alive[i]) {
+
+			order[offsets[std::min<std::size_t>(paths.hit_material[i], buckets - 1)]++] = static_cast<std::uint32_t>(i);
+		}
+	}
+
+	for (const auto i : order) {
+
+		const material_record& m = materials.get(paths.hit_material[i]);
+		auto& rng = pixels[paths.pixel[i]].rng;
+
+		hit_record rec;
+		rec.t = paths.hit_t[i];
+		rec.p = point3(paths.hit_point[0][i], paths.hit_point[1][i], paths.hit_point[2][i]);
+		rec.normal = vec3(paths.hit_normal[0][i], paths.hit_normal[1][i], paths.hit_normal[2][i]);
+		rec.front_face = paths.hit_front[i] != 0;
+		rec.material = paths.hit_material[i];
+
+		sample_context ctx(rng);
+		ray scattered;
+		color attenuation;
+		if (!scatter(m, paths.path_ray(i), rec, ctx, scattered, attenuation)) {
+
+			paths.alive[i] = 0;
+			continue;
+		}
+		for (int a = 0; a < 3; ++a) {
+
+			paths.origin[a][i] = scattered.origin()[a];
+			paths.direction[a][i] = scattered.direction()[a];
+			paths.throughput[a][i] *= attenuation[a];
+		}
+
+		if (roulette) {
+
+			roulette_path(paths, i, rng);
+		}
+	}
+}
+
+void compact_paths(path_queue& paths) {
+
+	const std::size_t n = paths.size();
+	std::size_t kept = 0;
+	for (std::size_t i = 0; i < n; ++i) {
+
+		if (!paths.alive[i]) {
+
+			continue;
+		}
+
+		if (kept != i) {
+
+			for (int a = 0; a < 3; ++a) {
+
+				paths.origin[a][kept] = paths.origin[a][i];
+				paths.direction[a][kept] = paths.direction[a][i];
+				paths.throughput[a][kept] = paths.throughput[a][i];
+			}
+			paths.pixel[kept] = paths.pixel[i];
+		}
+		++kept;
+	}
+
+	// Hit data is rewritten by the next intersection stage, so only its size has to follow.
+	for (int a = 0; a < 3; ++a) {
+
+		paths.origin[a].resize(kept);
+		paths.direction[a].resize(kept);
+		paths.throughput[a].resize(kept);
+		paths.hit_point[a].resize(kept);
+		paths.hit_normal[a].resize(kept);
+	}
+	paths.pixel.resize(kept);
+	paths.hit_t.resize(kept);
+	paths.hit_material.resize(kept);
+	paths.hit_front.resize(kept);
+	paths.alive.assign(kept, 1);
+}
+
+wavefront_engine::wavefront_engine(const render_settings& settings, const material_table* materials) :
+	config{ settings },
+	// The recursive integrator is the path estimator without Russian roulette.
+	roulette_depth{ settings.integrator == integrator_type::recursive ? settings.max_depth + 1 : settings.rr_min_depth },
+	surfaces{ materials }
+{}
+
+void wavefront_engine::generate_camera_rays(const camera_raster& raster, std::vector<wave_pixel>& pixels, path_queue& paths) const {
+
+	paths.clear();
+	for (std::size_t p = 0; p < pixels.size(); ++p) {
+
+		auto& pixel = pixels[p];
+		if (!pixel.sampling) {
+
+			continue;
+		}
+
+		// The values the tiled engine fills in for this sample, in the same order.
+		double sample[4];
+		for (int k = 0; k < raster.sample_dimensions(); ++k) {
+
+			sample[k] = pixel.jitter.next_double();
+		}
+
+		pixel.radiance = color(0, 0, 0);
+		paths.push(raster.get_ray(pixel.x, pixel.y, sample), static_cast<std::uint32_t>(p));
+	}
+}
+
+std::uint64_t wavefront_engine::render_tile(const tile& t, const hittable& world, const camera_raster& raster, framebuffer& image,
+	std::vector<std::uint32_t>& sample_counts) const {
+
+	const bool adaptive = config.adaptive_threshold > 0;
+	const int max_samples = std::max(config.samples_per_pixel, 1);
+	const int check_interval = std::min(std::max(config.min_samples, 1), max_samples);
+
+	std::vector<wave_pixel> pixels;
+	pixels.reserve(static_cast<std::size_t>(t.x1 - t.x0) * (t.y1 - t.y0));
+	for (int y = t.y0; y < t.y1; ++y) {
+
+		for (int i = t.x0; i < t.x1; ++i) {
+
+			wave_pixel pixel;
+			pixel.x = i;
+			pixel.y = y;
+			pixel.jitter = random_engine(config.seed, static_cast<std::uint64_t>(y) * config.image_width + i);
+			pixel.rng = pixel.jitter;
+
+			// Skip the jitter the tiled engine fills in before its first path.
+			for (int k = 0; k < raster.sample_dimensions() * max_samples; ++k) {
+
+				pixel.rng.next_double();
+			}
+			pixels.push_back(pixel);
+		}
+	}
+
+	std::uint64_t rays = 0;
+	path_queue paths;
+	paths.reserve(pixels.size());
+
+	for (int s = 1; s <= max_samples; ++s) {
+
+		{
+			RT_PROFILE_SPAN(profile_stage::camera);
+			generate_camera_rays(raster, pixels, paths);
+		}
+		if (paths.size() == 0) {
+
+			break;
+		}
+
+		int depth = 0;
+		for (; depth < config.max_depth && paths.size() > 0; ++depth) {
+
+			{
+				RT_PROFILE_SPAN(profile_stage::intersect);
+				rays += intersect_paths(world, paths);
+			}
+			{
+				RT_PROFILE_SPAN(profile_stage::shade);
+				shade_paths(paths, pixels, surfaces);
+				if (surfaces) {
+
+					scatter_paths(paths, pixels, *surfaces, depth + 1 >= roulette_depth);
+				}
+				else {
+
+					bounce_paths(paths, pixels, depth + 1 >= roulette_depth);
+				}
+			}
+			const std::size_t in_flight = paths.size();
+			{
+				RT_PROFILE_SPAN(profile_stage::compact);
+				compact_paths(paths);
+			}
+			RT_PROFILE_PATHS(depth + 1, in_flight - paths.size());
+		}
+		RT_PROFILE_PATHS(depth, paths.size());
+
+		// Paths still alive at the depth limit gather no light.
+		for (auto& pixel : pixels) {
+
+			if (!pixel.sampling) {
+
+				continue;
+			}
+
+			pixel.sum += pixel.radiance;
+			pixel.samples = s;
+			if (s == max_samples) {
+
+				pixel.sampling = false;
+			}
+			else if (adaptive) {
+
+				pixel.estimate.add(pixel.radiance, s);
+				if (s % check_interval == 0 && s > 1 && pixel.estimate.converged(s, config.adaptive_threshold)) {
+
+					pixel.sampling = false;
+				}
+			}
+		}
+	}
+
+	for (const auto& pixel : pixels) {
+
+		image.set(pixel.x, pixel.y, pixel.sum / static_cast<real>(pixel.samples));
+		sample_counts[static_cast<std::size_t>(pixel.y) * config.image_width + pixel.x] = static_cast<std::uint32_t>(pixel.samples);
+	}
+
+	return rays;
+}
\ No newline at end of file